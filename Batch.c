@@ -0,0 +1,507 @@
+#ifndef BATCH_C
+#define BATCH_C
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+#include "Coil.c"
+
+// Structure of arrays holding the inputs of a batch of designs.
+//  - PRIWG: American wire gauge of PRI.
+//  - SECWG: American wire gauge of SEC.
+//  - SECD:  Diameter of SEC expressed in meters.
+//  - SECH:  Height of SEC expressed in meters.
+//  - TOPD:  Diameter of TOP expressed in meters.
+//  - LTRCS: Larger than resonant static capacitance of PTC expressed in farads.
+typedef struct
+{
+
+	float *PRIWG, *SECWG, *SECD, *SECH, *TOPD, *LTRCS;
+
+} BatchIn;
+
+// Structure of arrays receiving the outputs of a batch of designs.
+// Each field holds the parameter of the same name described in Coil.c.
+typedef struct
+{
+
+	float *PRIWD, *SECWD, *SECN, *SECLN, *SECL, *SECC, *SECHD, *TOPC, *SECF, *PTCCR, *PRIL;
+
+} BatchOut;
+
+// Calculate the wire, secondary, topload and resonance parameters of n designs
+// with the fastest kernel supported by the processor.
+void batchCalculate( BatchIn* in, BatchOut* out, long n );
+
+// Calculate every stage of n designs, using batchCalculate for the expensive part.
+// Outputs stay within 2.0e-6 relative of calculate(), which rounds through double.
+// In DOUBLE precision each design is calculated by calculatePrecise() instead.
+void batchCoils( Coil* c, long n );
+
+// Return the name of the kernel used by batchCalculate.
+char* batchKernel();
+
+// Vectorized approximations used by the kernels, shown here for 8 lanes.
+// Over the normal range of floats, measured against libm in double precision:
+//  - vexp2: Relative error below 1.0e-7 (about 1 ulp) for -126 < x < 128.
+//  - vlog2: Absolute error below 1.0e-7 for 0.5 < x < 2, elsewhere half an ulp of the result more.
+// Square roots use the correctly rounded hardware instruction.
+__m256 vexp2( __m256 x ) __attribute__((target("avx2,fma")));
+__m256 vlog2( __m256 x ) __attribute__((target("avx2,fma")));
+
+// Coefficients of the minimax polynomials behind vexp2 and vlog2.
+#define EXP2_P0 1.535336188319500e-4f
+#define EXP2_P1 1.339887440266574e-3f
+#define EXP2_P2 9.618437357674640e-3f
+#define EXP2_P3 5.550332471162809e-2f
+#define EXP2_P4 2.402264791363012e-1f
+#define EXP2_P5 6.931472028550421e-1f
+#define LOG_P0  7.0376836292e-2f
+#define LOG_P1 -1.1514610310e-1f
+#define LOG_P2  1.1676998740e-1f
+#define LOG_P3 -1.2420140846e-1f
+#define LOG_P4  1.4249322787e-1f
+#define LOG_P5 -1.6668057665e-1f
+#define LOG_P6  2.0000714765e-1f
+#define LOG_P7 -2.4999993993e-1f
+#define LOG_P8  3.3333331174e-1f
+#define LOG2E   1.44269504088896341f
+
+// The base 2 logarithm of 92 divided by 39, used to turn WD() into an exp2.
+#define WD_SCALE 0.16727082f
+
+// Scalar kernel, used when the processor has no AVX2.
+static void batchScalar( BatchIn* in, BatchOut* out, long lo, long n )
+{
+
+	const float pi2 = 2.0 * PI, tope = 2.0 * PI * E0;
+	long i;
+
+	for ( i = lo; i < n; i++ )
+	{
+
+		float H = in->SECH[i];
+		float R = 0.5f * in->SECD[i];
+		float WD_, D, N, F;
+
+		out->PRIWD[i] = 0.000127f * exp2f( ( 36.0f - in->PRIWG[i] ) * WD_SCALE );
+		out->SECWD[i] = WD_ = 0.000127f * exp2f( ( 36.0f - in->SECWG[i] ) * WD_SCALE ) + 3.55600e-5f;
+		D = in->SECD[i] + WD_;
+		out->SECN[i]  = N = H / WD_;
+		out->SECLN[i] = N * (float)PI * D;
+		out->SECL[i]  = inductance == WHEELER ? N * N * D * D / ( 2.54e4f * ( 18.0f * D + 40.0f * H ) )
+			: solenoid( D, N, H, WD_ );
+		out->SECC[i]  = ( 0.29f * H + R * ( 0.41f + 1.94f * sqrtf( R / H ) ) ) * ( 1.0e-12f / 0.0254f );
+		out->SECHD[i] = H / D;
+		out->TOPC[i]  = tope * in->TOPD[i];
+		out->SECF[i]  = F = 1.0f / ( pi2 * sqrtf( out->SECL[i] * ( out->SECC[i] + out->TOPC[i] ) ) );
+		out->PTCCR[i] = 1.0f / ( pi2 * F * in->LTRCS[i] );
+		out->PRIL[i]  = out->PTCCR[i] / ( pi2 * F );
+
+	}
+
+}
+
+__m256 vexp2( __m256 x )
+{
+
+	// Split x into an integer n and a fraction f in [-0.5,0.5].
+	const __m256 magic = _mm256_set1_ps( 12582912.0f );
+	__m256 n, f, p;
+	__m256i e;
+
+	x = _mm256_min_ps( _mm256_max_ps( x, _mm256_set1_ps( -126.0f ) ), _mm256_set1_ps( 127.0f ) );
+	n = _mm256_sub_ps( _mm256_add_ps( x, magic ), magic );
+	f = _mm256_sub_ps( x, n );
+
+	p = _mm256_set1_ps( EXP2_P0 );
+	p = _mm256_fmadd_ps( p, f, _mm256_set1_ps( EXP2_P1 ) );
+	p = _mm256_fmadd_ps( p, f, _mm256_set1_ps( EXP2_P2 ) );
+	p = _mm256_fmadd_ps( p, f, _mm256_set1_ps( EXP2_P3 ) );
+	p = _mm256_fmadd_ps( p, f, _mm256_set1_ps( EXP2_P4 ) );
+	p = _mm256_fmadd_ps( p, f, _mm256_set1_ps( EXP2_P5 ) );
+	p = _mm256_fmadd_ps( p, f, _mm256_set1_ps( 1.0f ) );
+
+	// Scale by 2^n by building the exponent field directly.
+	e = _mm256_slli_epi32( _mm256_add_epi32( _mm256_cvtps_epi32( n ), _mm256_set1_epi32( 127 ) ), 23 );
+	return _mm256_mul_ps( p, _mm256_castsi256_ps( e ) );
+
+}
+
+__m256 vlog2( __m256 x )
+{
+
+	// Split x into an exponent e and a mantissa m in [sqrt(0.5),sqrt(2)).
+	__m256i bits = _mm256_castps_si256( x );
+	__m256 e = _mm256_cvtepi32_ps( _mm256_sub_epi32( _mm256_srli_epi32( bits, 23 ), _mm256_set1_epi32( 127 ) ) );
+	__m256 m = _mm256_castsi256_ps( _mm256_or_si256( _mm256_and_si256( bits, _mm256_set1_epi32( 0x007FFFFF ) ), _mm256_set1_epi32( 0x3F800000 ) ) );
+	__m256 big = _mm256_cmp_ps( m, _mm256_set1_ps( 1.41421356f ), _CMP_GT_OQ );
+	__m256 z, p;
+
+	m = _mm256_blendv_ps( m, _mm256_mul_ps( m, _mm256_set1_ps( 0.5f ) ), big );
+	e = _mm256_add_ps( e, _mm256_and_ps( big, _mm256_set1_ps( 1.0f ) ) );
+	x = _mm256_sub_ps( m, _mm256_set1_ps( 1.0f ) );
+	z = _mm256_mul_ps( x, x );
+
+	p = _mm256_set1_ps( LOG_P0 );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P1 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P2 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P3 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P4 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P5 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P6 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P7 ) );
+	p = _mm256_fmadd_ps( p, x, _mm256_set1_ps( LOG_P8 ) );
+
+	// ln(m) = x - x^2/2 + x^3 * P(x), then convert to base 2 and add the exponent.
+	p = _mm256_mul_ps( _mm256_mul_ps( p, z ), x );
+	p = _mm256_fmadd_ps( z, _mm256_set1_ps( -0.5f ), p );
+	p = _mm256_add_ps( p, x );
+	return _mm256_fmadd_ps( p, _mm256_set1_ps( LOG2E ), e );
+
+}
+
+// Inductance of the secondary under the Nagaoka model for 8 designs, as solenoid().
+__attribute__((target("avx2,fma")))
+static __m256 vsolenoid( __m256 D, __m256 N, __m256 H, __m256 WD )
+{
+
+	const __m256 ln2 = _mm256_set1_ps( 0.69314718f );
+	__m256 k, x, f, K, ks, km, n, L;
+	__m256i i;
+
+	// Interpolate Nagaoka's coefficient between the value and step gathered from its table.
+	k = _mm256_div_ps( D, _mm256_sqrt_ps( _mm256_fmadd_ps( D, D, _mm256_mul_ps( H, H ) ) ) );
+	// Clamped to the table, min taking its second operand for a NaN ratio.
+	x = _mm256_min_ps( _mm256_mul_ps( k, _mm256_set1_ps( NAGAOKA_TABLE ) ), _mm256_set1_ps( NAGAOKA_TABLE ) );
+	x = _mm256_max_ps( x, _mm256_setzero_ps() );
+	i = _mm256_cvttps_epi32( x );
+	f = _mm256_sub_ps( x, _mm256_cvtepi32_ps( i ) );
+	i = _mm256_slli_epi32( i, 1 );
+	K = _mm256_fmadd_ps( f, _mm256_i32gather_ps( &nagaokaTable[0][1], i, 4 ), _mm256_i32gather_ps( &nagaokaTable[0][0], i, 4 ) );
+
+	n  = _mm256_div_ps( _mm256_set1_ps( 1.0f ), N );
+	ks = _mm256_div_ps( _mm256_mul_ps( _mm256_set1_ps( 2.0f ), WD ), _mm256_sub_ps( WD, _mm256_set1_ps( 3.55600e-5f ) ) );
+	ks = _mm256_fnmadd_ps( ln2, vlog2( ks ), _mm256_set1_ps( 1.25f ) );
+	km = _mm256_mul_ps( _mm256_mul_ps( n, n ), _mm256_set1_ps( 1.0f / 120.0f ) );
+	km = _mm256_fmadd_ps( _mm256_mul_ps( ln2, vlog2( N ) ), _mm256_set1_ps( 1.0f / 6.0f ), _mm256_add_ps( km, _mm256_set1_ps( 0.33084236f ) ) );
+	km = _mm256_fnmadd_ps( km, n, _mm256_set1_ps( log( 2.0 * PI ) - 1.5 ) );
+
+	L = _mm256_mul_ps( _mm256_mul_ps( N, D ), _mm256_mul_ps( N, D ) );
+	L = _mm256_mul_ps( _mm256_mul_ps( _mm256_div_ps( L, H ), K ), _mm256_set1_ps( 0.25 * PI * U0 ) );
+	return _mm256_fnmadd_ps( _mm256_mul_ps( _mm256_mul_ps( D, N ), _mm256_set1_ps( 0.5 * U0 ) ), _mm256_add_ps( ks, km ), L );
+
+}
+
+// AVX2 kernel, calculating 8 designs per instruction.
+__attribute__((target("avx2,fma")))
+static void batchAVX2( BatchIn* in, BatchOut* out, long n )
+{
+
+	const __m256 pi   = _mm256_set1_ps( PI );
+	const __m256 pi2  = _mm256_set1_ps( 2.0 * PI );
+	const __m256 tope = _mm256_set1_ps( 2.0 * PI * E0 );
+	const __m256 one  = _mm256_set1_ps( 1.0f );
+	const __m256 awg  = _mm256_set1_ps( 36.0f );
+	const __m256 wds  = _mm256_set1_ps( WD_SCALE );
+	const __m256 wd0  = _mm256_set1_ps( 0.000127f );
+	long i;
+
+	for ( i = 0; i + 8 <= n; i += 8 )
+	{
+
+		__m256 H = _mm256_loadu_ps( in->SECH + i );
+		__m256 SD = _mm256_loadu_ps( in->SECD + i );
+		__m256 R = _mm256_mul_ps( SD, _mm256_set1_ps( 0.5f ) );
+		__m256 PWD, SWD, D, N, L, C, T, F, X;
+
+		PWD = _mm256_mul_ps( wd0, vexp2( _mm256_mul_ps( _mm256_sub_ps( awg, _mm256_loadu_ps( in->PRIWG + i ) ), wds ) ) );
+		SWD = _mm256_fmadd_ps( wd0, vexp2( _mm256_mul_ps( _mm256_sub_ps( awg, _mm256_loadu_ps( in->SECWG + i ) ), wds ) ), _mm256_set1_ps( 3.55600e-5f ) );
+		D = _mm256_add_ps( SD, SWD );
+		N = _mm256_div_ps( H, SWD );
+		if ( inductance == WHEELER )
+		{
+
+			L = _mm256_mul_ps( N, D );
+			L = _mm256_div_ps( _mm256_mul_ps( L, L ), _mm256_mul_ps( _mm256_set1_ps( 2.54e4f ),
+				_mm256_fmadd_ps( _mm256_set1_ps( 18.0f ), D, _mm256_mul_ps( _mm256_set1_ps( 40.0f ), H ) ) ) );
+
+		}
+		else L = vsolenoid( D, N, H, SWD );
+		C = _mm256_fmadd_ps( _mm256_set1_ps( 1.94f ), _mm256_sqrt_ps( _mm256_div_ps( R, H ) ), _mm256_set1_ps( 0.41f ) );
+		C = _mm256_mul_ps( _mm256_fmadd_ps( R, C, _mm256_mul_ps( _mm256_set1_ps( 0.29f ), H ) ), _mm256_set1_ps( 1.0e-12f / 0.0254f ) );
+		T = _mm256_mul_ps( tope, _mm256_loadu_ps( in->TOPD + i ) );
+		F = _mm256_div_ps( one, _mm256_mul_ps( pi2, _mm256_sqrt_ps( _mm256_mul_ps( L, _mm256_add_ps( C, T ) ) ) ) );
+		X = _mm256_div_ps( one, _mm256_mul_ps( _mm256_mul_ps( pi2, F ), _mm256_loadu_ps( in->LTRCS + i ) ) );
+
+		_mm256_storeu_ps( out->PRIWD + i, PWD );
+		_mm256_storeu_ps( out->SECWD + i, SWD );
+		_mm256_storeu_ps( out->SECN  + i, N );
+		_mm256_storeu_ps( out->SECLN + i, _mm256_mul_ps( _mm256_mul_ps( N, pi ), D ) );
+		_mm256_storeu_ps( out->SECL  + i, L );
+		_mm256_storeu_ps( out->SECC  + i, C );
+		_mm256_storeu_ps( out->SECHD + i, _mm256_div_ps( H, D ) );
+		_mm256_storeu_ps( out->TOPC  + i, T );
+		_mm256_storeu_ps( out->SECF  + i, F );
+		_mm256_storeu_ps( out->PTCCR + i, X );
+		_mm256_storeu_ps( out->PRIL  + i, _mm256_div_ps( X, _mm256_mul_ps( pi2, F ) ) );
+
+	}
+
+	batchScalar( in, out, i, n );
+
+}
+
+// AVX-512 versions of vexp2 and vlog2, calculating 16 lanes per instruction.
+__attribute__((target("avx512f")))
+static __m512 vexp2x16( __m512 x )
+{
+
+	const __m512 magic = _mm512_set1_ps( 12582912.0f );
+	__m512 n, f, p;
+	__m512i e;
+
+	x = _mm512_min_ps( _mm512_max_ps( x, _mm512_set1_ps( -126.0f ) ), _mm512_set1_ps( 127.0f ) );
+	n = _mm512_sub_ps( _mm512_add_ps( x, magic ), magic );
+	f = _mm512_sub_ps( x, n );
+
+	p = _mm512_set1_ps( EXP2_P0 );
+	p = _mm512_fmadd_ps( p, f, _mm512_set1_ps( EXP2_P1 ) );
+	p = _mm512_fmadd_ps( p, f, _mm512_set1_ps( EXP2_P2 ) );
+	p = _mm512_fmadd_ps( p, f, _mm512_set1_ps( EXP2_P3 ) );
+	p = _mm512_fmadd_ps( p, f, _mm512_set1_ps( EXP2_P4 ) );
+	p = _mm512_fmadd_ps( p, f, _mm512_set1_ps( EXP2_P5 ) );
+	p = _mm512_fmadd_ps( p, f, _mm512_set1_ps( 1.0f ) );
+
+	e = _mm512_slli_epi32( _mm512_add_epi32( _mm512_cvtps_epi32( n ), _mm512_set1_epi32( 127 ) ), 23 );
+	return _mm512_mul_ps( p, _mm512_castsi512_ps( e ) );
+
+}
+
+__attribute__((target("avx512f")))
+static __m512 vlog2x16( __m512 x )
+{
+
+	__m512i bits = _mm512_castps_si512( x );
+	__m512 e = _mm512_cvtepi32_ps( _mm512_sub_epi32( _mm512_srli_epi32( bits, 23 ), _mm512_set1_epi32( 127 ) ) );
+	__m512 m = _mm512_castsi512_ps( _mm512_or_si512( _mm512_and_si512( bits, _mm512_set1_epi32( 0x007FFFFF ) ), _mm512_set1_epi32( 0x3F800000 ) ) );
+	__mmask16 big = _mm512_cmp_ps_mask( m, _mm512_set1_ps( 1.41421356f ), _CMP_GT_OQ );
+	__m512 z, p;
+
+	m = _mm512_mask_mul_ps( m, big, m, _mm512_set1_ps( 0.5f ) );
+	e = _mm512_mask_add_ps( e, big, e, _mm512_set1_ps( 1.0f ) );
+	x = _mm512_sub_ps( m, _mm512_set1_ps( 1.0f ) );
+	z = _mm512_mul_ps( x, x );
+
+	p = _mm512_set1_ps( LOG_P0 );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P1 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P2 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P3 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P4 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P5 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P6 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P7 ) );
+	p = _mm512_fmadd_ps( p, x, _mm512_set1_ps( LOG_P8 ) );
+
+	p = _mm512_mul_ps( _mm512_mul_ps( p, z ), x );
+	p = _mm512_fmadd_ps( z, _mm512_set1_ps( -0.5f ), p );
+	p = _mm512_add_ps( p, x );
+	return _mm512_fmadd_ps( p, _mm512_set1_ps( LOG2E ), e );
+
+}
+
+// Inductance of the secondary under the Nagaoka model for 16 designs, as solenoid().
+__attribute__((target("avx512f")))
+static __m512 vsolenoidx16( __m512 D, __m512 N, __m512 H, __m512 WD )
+{
+
+	const __m512 ln2 = _mm512_set1_ps( 0.69314718f );
+	__m512 k, x, f, K, ks, km, n, L;
+	__m512i i;
+
+	k = _mm512_div_ps( D, _mm512_sqrt_ps( _mm512_fmadd_ps( D, D, _mm512_mul_ps( H, H ) ) ) );
+	// Clamped to the table, min taking its second operand for a NaN ratio.
+	x = _mm512_min_ps( _mm512_mul_ps( k, _mm512_set1_ps( NAGAOKA_TABLE ) ), _mm512_set1_ps( NAGAOKA_TABLE ) );
+	x = _mm512_max_ps( x, _mm512_setzero_ps() );
+	i = _mm512_cvttps_epi32( x );
+	f = _mm512_sub_ps( x, _mm512_cvtepi32_ps( i ) );
+	i = _mm512_slli_epi32( i, 1 );
+	K = _mm512_fmadd_ps( f, _mm512_i32gather_ps( i, &nagaokaTable[0][1], 4 ), _mm512_i32gather_ps( i, &nagaokaTable[0][0], 4 ) );
+
+	n  = _mm512_div_ps( _mm512_set1_ps( 1.0f ), N );
+	ks = _mm512_div_ps( _mm512_mul_ps( _mm512_set1_ps( 2.0f ), WD ), _mm512_sub_ps( WD, _mm512_set1_ps( 3.55600e-5f ) ) );
+	ks = _mm512_fnmadd_ps( ln2, vlog2x16( ks ), _mm512_set1_ps( 1.25f ) );
+	km = _mm512_mul_ps( _mm512_mul_ps( n, n ), _mm512_set1_ps( 1.0f / 120.0f ) );
+	km = _mm512_fmadd_ps( _mm512_mul_ps( ln2, vlog2x16( N ) ), _mm512_set1_ps( 1.0f / 6.0f ), _mm512_add_ps( km, _mm512_set1_ps( 0.33084236f ) ) );
+	km = _mm512_fnmadd_ps( km, n, _mm512_set1_ps( log( 2.0 * PI ) - 1.5 ) );
+
+	L = _mm512_mul_ps( _mm512_mul_ps( N, D ), _mm512_mul_ps( N, D ) );
+	L = _mm512_mul_ps( _mm512_mul_ps( _mm512_div_ps( L, H ), K ), _mm512_set1_ps( 0.25 * PI * U0 ) );
+	return _mm512_fnmadd_ps( _mm512_mul_ps( _mm512_mul_ps( D, N ), _mm512_set1_ps( 0.5 * U0 ) ), _mm512_add_ps( ks, km ), L );
+
+}
+
+// AVX-512 kernel, calculating 16 designs per instruction.
+__attribute__((target("avx512f")))
+static void batchAVX512( BatchIn* in, BatchOut* out, long n )
+{
+
+	const __m512 pi   = _mm512_set1_ps( PI );
+	const __m512 pi2  = _mm512_set1_ps( 2.0 * PI );
+	const __m512 tope = _mm512_set1_ps( 2.0 * PI * E0 );
+	const __m512 one  = _mm512_set1_ps( 1.0f );
+	const __m512 awg  = _mm512_set1_ps( 36.0f );
+	const __m512 wds  = _mm512_set1_ps( WD_SCALE );
+	const __m512 wd0  = _mm512_set1_ps( 0.000127f );
+	long i;
+
+	for ( i = 0; i + 16 <= n; i += 16 )
+	{
+
+		__m512 H = _mm512_loadu_ps( in->SECH + i );
+		__m512 SD = _mm512_loadu_ps( in->SECD + i );
+		__m512 R = _mm512_mul_ps( SD, _mm512_set1_ps( 0.5f ) );
+		__m512 PWD, SWD, D, N, L, C, T, F, X;
+
+		PWD = _mm512_mul_ps( wd0, vexp2x16( _mm512_mul_ps( _mm512_sub_ps( awg, _mm512_loadu_ps( in->PRIWG + i ) ), wds ) ) );
+		SWD = _mm512_fmadd_ps( wd0, vexp2x16( _mm512_mul_ps( _mm512_sub_ps( awg, _mm512_loadu_ps( in->SECWG + i ) ), wds ) ), _mm512_set1_ps( 3.55600e-5f ) );
+		D = _mm512_add_ps( SD, SWD );
+		N = _mm512_div_ps( H, SWD );
+		if ( inductance == WHEELER )
+		{
+
+			L = _mm512_mul_ps( N, D );
+			L = _mm512_div_ps( _mm512_mul_ps( L, L ), _mm512_mul_ps( _mm512_set1_ps( 2.54e4f ),
+				_mm512_fmadd_ps( _mm512_set1_ps( 18.0f ), D, _mm512_mul_ps( _mm512_set1_ps( 40.0f ), H ) ) ) );
+
+		}
+		else L = vsolenoidx16( D, N, H, SWD );
+		C = _mm512_fmadd_ps( _mm512_set1_ps( 1.94f ), _mm512_sqrt_ps( _mm512_div_ps( R, H ) ), _mm512_set1_ps( 0.41f ) );
+		C = _mm512_mul_ps( _mm512_fmadd_ps( R, C, _mm512_mul_ps( _mm512_set1_ps( 0.29f ), H ) ), _mm512_set1_ps( 1.0e-12f / 0.0254f ) );
+		T = _mm512_mul_ps( tope, _mm512_loadu_ps( in->TOPD + i ) );
+		F = _mm512_div_ps( one, _mm512_mul_ps( pi2, _mm512_sqrt_ps( _mm512_mul_ps( L, _mm512_add_ps( C, T ) ) ) ) );
+		X = _mm512_div_ps( one, _mm512_mul_ps( _mm512_mul_ps( pi2, F ), _mm512_loadu_ps( in->LTRCS + i ) ) );
+
+		_mm512_storeu_ps( out->PRIWD + i, PWD );
+		_mm512_storeu_ps( out->SECWD + i, SWD );
+		_mm512_storeu_ps( out->SECN  + i, N );
+		_mm512_storeu_ps( out->SECLN + i, _mm512_mul_ps( _mm512_mul_ps( N, pi ), D ) );
+		_mm512_storeu_ps( out->SECL  + i, L );
+		_mm512_storeu_ps( out->SECC  + i, C );
+		_mm512_storeu_ps( out->SECHD + i, _mm512_div_ps( H, D ) );
+		_mm512_storeu_ps( out->TOPC  + i, T );
+		_mm512_storeu_ps( out->SECF  + i, F );
+		_mm512_storeu_ps( out->PTCCR + i, X );
+		_mm512_storeu_ps( out->PRIL  + i, _mm512_div_ps( X, _mm512_mul_ps( pi2, F ) ) );
+
+	}
+
+	batchScalar( in, out, i, n );
+
+}
+
+static void batchPortable( BatchIn* in, BatchOut* out, long n ) { batchScalar( in, out, 0, n ); }
+
+// Kernel chosen for this processor the first time a batch is calculated.
+static void (*batchChosen)( BatchIn* in, BatchOut* out, long n ) = NULL;
+static char* batchName = "scalar";
+
+static void batchChoose()
+{
+
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx512f" ) )
+	{
+
+		batchChosen = batchAVX512;
+		batchName = "avx512";
+
+	}
+	else if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+	{
+
+		batchChosen = batchAVX2;
+		batchName = "avx2";
+
+	}
+	else batchChosen = batchPortable;
+
+}
+
+void batchCalculate( BatchIn* in, BatchOut* out, long n )
+{
+
+	if ( !batchChosen ) batchChoose();
+	batchChosen( in, out, n );
+
+}
+
+char* batchKernel()
+{
+
+	if ( !batchChosen ) batchChoose();
+	return batchName;
+
+}
+
+// Number of designs gathered into structure of arrays form at a time.
+#define BATCH 256
+
+void batchCoils( Coil* c, long n )
+{
+
+	float in[6][BATCH], out[11][BATCH];
+	BatchIn bi = { in[0], in[1], in[2], in[3], in[4], in[5] };
+	BatchOut bo = { out[0], out[1], out[2], out[3], out[4], out[5], out[6], out[7], out[8], out[9], out[10] };
+	long lo, i, m;
+
+	// The kernels work in float, so designs wanted in double are calculated one at a time.
+	if ( precision == DOUBLE )
+	{
+
+		for ( i = 0; i < n; i++ ) calculatePrecise( &c[i] );
+		return;
+
+	}
+
+	for ( lo = 0; lo < n; lo += BATCH )
+	{
+
+		m = n - lo < BATCH ? n - lo : BATCH;
+
+		for ( i = 0; i < m; i++ )
+		{
+
+			Coil* d = &c[lo+i];
+			calculateNST( d );
+			calculatePTC( d );
+			bi.PRIWG[i] = d->PRIWG; bi.SECWG[i] = d->SECWG; bi.SECD[i] = d->SECD;
+			bi.SECH[i]  = d->SECH;  bi.TOPD[i]  = d->TOPD;  bi.LTRCS[i] = d->LTRCS;
+
+		}
+
+		batchCalculate( &bi, &bo, m );
+
+		for ( i = 0; i < m; i++ )
+		{
+
+			Coil* d = &c[lo+i];
+			d->PRIWD = bo.PRIWD[i]; d->SECWD = bo.SECWD[i]; d->SECN  = bo.SECN[i];
+			d->SECLN = bo.SECLN[i]; d->SECL  = bo.SECL[i];  d->SECC  = bo.SECC[i];
+			d->SECHD = bo.SECHD[i]; d->TOPC  = bo.TOPC[i];  d->SECF  = bo.SECF[i];
+			d->PTCCR = bo.PTCCR[i]; d->PRIL  = bo.PRIL[i];
+
+			// The rest of the primary is cheap enough to take from the shared nodes.
+			nodePRIF( d );
+			nodePRILR( d );
+			nodePRIRO( d );
+			nodePRILN( d );
+
+		}
+
+	}
+
+}
+
+#endif
@@ -0,0 +1,408 @@
+#ifndef CACHE_C
+#define CACHE_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "Coil.c"
+#include "Batch.c"
+
+// Number of entries in a newly created cache, and the number of entries in
+// each set of the cache from which the least recently used is evicted.
+#define CACHE_ENTRIES 65536
+#define CACHE_WAYS    8
+
+// Uses of the cache clock after which an entry still being written is taken
+// to belong to a writer that died, and may be claimed by another.
+#define CACHE_STALE ( 1u << 24 )
+
+// Holds a calculated design within the cache, shared by every process mapping it.
+//  - sequence: Odd while the entry is being written and bumped after each write.
+//  - used:     Value of the cache clock when the entry was last found, or claimed to be stored.
+//  - key:      Hash of the model and of the inputs the entry is keyed by.
+//  - mask:     Inputs the entry is keyed by as a mask of positions within registry.
+//  - design:   Design holding those inputs and everything calculated from them alone.
+typedef struct
+{
+
+	uint32_t sequence, used;
+	uint64_t key, mask;
+	Coil design;
+
+} CacheEntry;
+
+// Begins the cache file, followed by its entries.
+//  - magic:  Identifies the file and the version of its layout.
+//  - layout: Size of a Coil and number of parameters, which must match to share entries.
+//  - sets:   Number of sets of CACHE_WAYS entries.
+//  - clock:  Bumped on every use to order entries by how recently they were used.
+typedef struct
+{
+
+	char magic[8];
+	uint32_t layout[2];
+	uint32_t sets, clock;
+
+} CacheHeader;
+
+// Holds a cache file mapped into memory.
+//  - fd:     Open cache file.
+//  - size:   Number of bytes mapped.
+//  - header: Mapped header, followed by entry.
+//  - entry:  Mapped entries.
+//  - seed:   Hash of the program version and model choices, which starts every key.
+//  - hits, partial, misses: Number of designs found whole, found in part and calculated,
+//                           counted atomically as every thread of a process shares them.
+typedef struct
+{
+
+	int fd;
+	size_t size;
+	CacheHeader* header;
+	CacheEntry* entry;
+	uint64_t seed;
+	long hits, partial, misses;
+
+} Cache;
+
+// Inputs of the whole design, and of the stages cached on their own so that
+// designs sharing only a secondary coil or NST still reuse those results.
+static uint64_t cacheWhole, cacheStage[2];
+
+// Map the cache file, creating it with entries entries if it does not exist or
+// does not match this build. Entries are only shared between runs with the same
+// version and model. Returns 1 on failure, leaving the cache unusable.
+int cacheOpen( Cache* k, char* file, long entries, const char* version, uint64_t model );
+void cacheClose( Cache* k );
+
+// Fill in the outputs of c calculated from the inputs in mask alone from the
+// cache, returning 1 if they were found.
+int cacheFind( Cache* k, Coil* c, uint64_t mask );
+
+// Store the inputs of calculated design c in mask and what is calculated from them alone.
+void cacheStore( Cache* k, Coil* c, uint64_t mask );
+
+// Calculate n designs, taking whatever can be from the cache and storing the rest.
+void cacheCoils( Cache* k, Coil* c, long n );
+
+// Mix v into the hash h.
+static uint64_t cacheMix( uint64_t h, uint64_t v )
+{
+
+	h = ( h ^ v ) * 0x9e3779b97f4a7c15ULL;
+	return h ^ h >> 31;
+
+}
+
+// Return the key of the inputs of c in mask, normalizing -0 to 0.
+static uint64_t cacheKey( Cache* k, Coil* c, uint64_t mask )
+{
+
+	uint64_t h = cacheMix( k->seed, mask ), m;
+	uint32_t bits;
+	float value;
+
+	for ( m = mask; m; m &= m - 1 )
+	{
+
+		value = *(float*)( (char*)c + registry[__builtin_ctzll( m )].offset );
+		if ( value == 0.0f ) value = 0.0f;
+		memcpy( &bits, &value, sizeof bits );
+		h = cacheMix( h, bits );
+
+	}
+
+	return h;
+
+}
+
+// Return whether a and b hold the same inputs in mask.
+static int cacheSame( Coil* a, Coil* b, uint64_t mask )
+{
+
+	size_t offset;
+
+	for ( ; mask; mask &= mask - 1 )
+	{
+
+		offset = registry[__builtin_ctzll( mask )].offset;
+		if ( *(float*)( (char*)a + offset ) != *(float*)( (char*)b + offset ) ) return 0;
+
+	}
+
+	return 1;
+
+}
+
+// Copy the parameters in mask from design from to design to.
+static void cacheCopy( Coil* to, Coil* from, uint64_t mask )
+{
+
+	size_t offset;
+
+	for ( ; mask; mask &= mask - 1 )
+	{
+
+		offset = registry[__builtin_ctzll( mask )].offset;
+		*(float*)( (char*)to + offset ) = *(float*)( (char*)from + offset );
+
+	}
+
+}
+
+// Return the first entry of the set holding key.
+static CacheEntry* cacheSet( Cache* k, uint64_t key )
+{
+
+	return &k->entry[( ( key >> 32 ) * k->header->sets >> 32 ) * CACHE_WAYS];
+
+}
+
+int cacheOpen( Cache* k, char* file, long entries, const char* version, uint64_t model )
+{
+
+	CacheHeader want;
+	struct stat st;
+	size_t size;
+	void* map;
+
+	memset( k, 0, sizeof *k );
+	k->fd = -1;
+
+	memset( &want, 0, sizeof want );
+	memcpy( want.magic, "TSCACHE1", 8 );
+	want.layout[0] = sizeof( Coil );
+	want.layout[1] = PARAMETERS;
+	want.sets = ( entries > CACHE_WAYS ? entries : CACHE_WAYS ) / CACHE_WAYS;
+
+	// The seed keeps entries of other versions and models from ever matching.
+	for ( k->seed = cacheMix( 0, model ); *version; version++ ) k->seed = cacheMix( k->seed, *version );
+
+	if ( ( k->fd = open( file, O_RDWR | O_CREAT, 0644 ) ) < 0 )
+	{
+
+		perror( file );
+		return 1;
+
+	}
+
+	// Whoever first opens the file lays it out while holding every other process off.
+	flock( k->fd, LOCK_EX );
+	if ( fstat( k->fd, &st ) == 0 && (size_t)st.st_size >= sizeof want )
+	{
+
+		CacheHeader have;
+		if ( pread( k->fd, &have, sizeof have, 0 ) == sizeof have
+			&& memcmp( have.magic, want.magic, 8 ) == 0
+			&& memcmp( have.layout, want.layout, sizeof want.layout ) == 0 && have.sets > 0
+			&& (size_t)st.st_size == sizeof have + (size_t)have.sets * CACHE_WAYS * sizeof( CacheEntry ) )
+			want.sets = have.sets;
+		else st.st_size = 0;
+
+	}
+	else st.st_size = 0;
+
+	size = sizeof want + (size_t)want.sets * CACHE_WAYS * sizeof( CacheEntry );
+	if ( st.st_size == 0 && ( ftruncate( k->fd, 0 ) || ftruncate( k->fd, size )
+		|| pwrite( k->fd, &want, sizeof want, 0 ) != sizeof want ) )
+	{
+
+		perror( file );
+		flock( k->fd, LOCK_UN );
+		close( k->fd );
+		k->fd = -1;
+		return 1;
+
+	}
+
+	map = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, k->fd, 0 );
+	flock( k->fd, LOCK_UN );
+	if ( map == MAP_FAILED )
+	{
+
+		perror( file );
+		close( k->fd );
+		k->fd = -1;
+		return 1;
+
+	}
+
+	k->size   = size;
+	k->header = map;
+	k->entry  = (CacheEntry*)( k->header + 1 );
+
+	if ( !cacheWhole )
+	{
+
+		char whole[] = "NSTVI NSTF NSTVO NSTIO NSTRP NSTRS PRIWG PRIN PRIRI PRIS SECWG SECD SECH TOPD";
+		char sec[] = "SECWG SECD SECH", nst[] = "NSTVI NSTF NSTVO NSTIO NSTRP NSTRS";
+		cacheWhole    = parameterMask( whole );
+		cacheStage[0] = parameterMask( sec );
+		cacheStage[1] = parameterMask( nst );
+
+	}
+
+	return 0;
+
+}
+
+void cacheClose( Cache* k )
+{
+
+	if ( k->header ) munmap( k->header, k->size );
+	if ( k->fd >= 0 ) close( k->fd );
+	k->header = NULL;
+	k->fd = -1;
+
+}
+
+// Entries are read without locks: a reader copies an entry between two reads
+// of its sequence and only trusts the copy if the sequence was even and unchanged.
+int cacheFind( Cache* k, Coil* c, uint64_t mask )
+{
+
+	uint64_t key = cacheKey( k, c, mask );
+	CacheEntry* e = cacheSet( k, key );
+	uint32_t before;
+	Coil design;
+	int i;
+
+	for ( i = 0; i < CACHE_WAYS; i++, e++ )
+	{
+
+		if ( e->key != key ) continue;
+
+		before = __atomic_load_n( &e->sequence, __ATOMIC_ACQUIRE );
+		if ( before & 1 ) continue;
+		memcpy( &design, &e->design, sizeof design );
+		__atomic_thread_fence( __ATOMIC_ACQUIRE );
+		if ( __atomic_load_n( &e->sequence, __ATOMIC_RELAXED ) != before
+			|| e->key != key || e->mask != mask || !cacheSame( &design, c, mask ) ) continue;
+
+		cacheCopy( c, &design, determined( mask ) );
+		__atomic_store_n( &e->used, __atomic_add_fetch( &k->header->clock, 1, __ATOMIC_RELAXED ), __ATOMIC_RELAXED );
+		return 1;
+
+	}
+
+	return 0;
+
+}
+
+// Return whether an entry may be written: not being written, or left odd by a
+// writer that claimed it CACHE_STALE or more uses of the clock ago and died.
+static int cacheFree( Cache* k, CacheEntry* e, uint32_t sequence )
+{
+
+	return !( sequence & 1 ) || __atomic_load_n( &k->header->clock, __ATOMIC_RELAXED )
+		- __atomic_load_n( &e->used, __ATOMIC_RELAXED ) >= CACHE_STALE;
+
+}
+
+// Writers claim an entry by making its sequence odd, so two processes storing
+// into the same set never write the same entry at once. The claim is stamped
+// in used before the sequence turns odd, so an entry abandoned mid write is
+// reclaimed once it is stale, moving its sequence on to the next odd value.
+void cacheStore( Cache* k, Coil* c, uint64_t mask )
+{
+
+	uint64_t key = cacheKey( k, c, mask );
+	CacheEntry* set = cacheSet( k, key );
+	CacheEntry* e = NULL;
+	uint32_t sequence, claim;
+	int i;
+
+	// Replace the same key, else the least recently used entry free to write.
+	for ( i = 0; i < CACHE_WAYS; i++ )
+	{
+
+		if ( set[i].key == key ) { e = &set[i]; break; }
+		if ( cacheFree( k, &set[i], __atomic_load_n( &set[i].sequence, __ATOMIC_ACQUIRE ) )
+			&& ( !e || set[i].used < e->used ) ) e = &set[i];
+
+	}
+	if ( !e ) return;
+
+	sequence = __atomic_load_n( &e->sequence, __ATOMIC_ACQUIRE );
+	if ( !cacheFree( k, e, sequence ) ) return;
+	claim = ( sequence | 1 ) + ( sequence & 1 ) * 2;
+	__atomic_store_n( &e->used, __atomic_add_fetch( &k->header->clock, 1, __ATOMIC_RELAXED ), __ATOMIC_RELAXED );
+	if ( !__atomic_compare_exchange_n( &e->sequence, &sequence, claim, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED ) ) return;
+
+	e->key  = key;
+	e->mask = mask;
+	memset( &e->design, 0, sizeof e->design );
+	cacheCopy( &e->design, c, mask | determined( mask ) );
+	e->used = __atomic_add_fetch( &k->header->clock, 1, __ATOMIC_RELAXED );
+	__atomic_store_n( &e->sequence, claim + 1, __ATOMIC_RELEASE );
+
+}
+
+// Calculate the designs of c missing from the cache together, at their positions in where.
+static void cacheMissed( Cache* k, Coil* c, Coil* miss, long* where, int m )
+{
+
+	int i, s;
+
+	batchCoils( miss, m );
+	__atomic_add_fetch( &k->misses, m, __ATOMIC_RELAXED );
+	for ( i = 0; i < m; i++ )
+	{
+
+		c[where[i]] = miss[i];
+		for ( s = 0; s < 2; s++ ) cacheStore( k, &miss[i], cacheStage[s] );
+		cacheStore( k, &miss[i], cacheWhole );
+
+	}
+
+}
+
+void cacheCoils( Cache* k, Coil* c, long n )
+{
+
+	Coil miss[BATCH];
+	long where[BATCH], i;
+	uint64_t known;
+	int m = 0, s;
+
+	// Designs not found whole are calculated from whichever stages are found,
+	// with designs found in no part gathered to be calculated together.
+	for ( i = 0; i < n; i++ )
+	{
+
+		if ( cacheFind( k, &c[i], cacheWhole ) ) { __atomic_add_fetch( &k->hits, 1, __ATOMIC_RELAXED ); continue; }
+
+		for ( known = 0, s = 0; s < 2; s++ )
+			if ( cacheFind( k, &c[i], cacheStage[s] ) ) known |= determined( cacheStage[s] );
+
+		if ( known )
+		{
+
+			complete( &c[i], known );
+			__atomic_add_fetch( &k->partial, 1, __ATOMIC_RELAXED );
+			for ( s = 0; s < 2; s++ )
+				if ( !( known & determined( cacheStage[s] ) ) ) cacheStore( k, &c[i], cacheStage[s] );
+			cacheStore( k, &c[i], cacheWhole );
+
+		}
+		else
+		{
+
+			where[m] = i;
+			miss[m++] = c[i];
+			if ( m == BATCH ) { cacheMissed( k, c, miss, where, m ); m = 0; }
+
+		}
+
+	}
+	if ( m ) cacheMissed( k, c, miss, where, m );
+
+}
+
+#endif
@@ -0,0 +1,521 @@
+#ifndef CAPACITANCE_C
+#define CAPACITANCE_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "Coil.c"
+
+// Number of rows and columns of the matrix factored as a block at a time.
+#define FIELD_BLOCK 64
+
+// Number of solved geometries remembered, and how close two panels must be,
+// in panel lengths, for the potential of one at the other to be integrated.
+#define FIELD_CACHE 4096
+#define FIELD_NEAR  2.0
+
+// Shapes of topload.
+enum { SPHERE, TOROID };
+
+// Holds the settings of the electrostatic model shared by every design.
+//  - shape:  Shape of the topload, SPHERE of diameter TOPD or TOROID of outer diameter TOPD.
+//  - minor:  Diameter of the tube of a toroid in meters.
+//  - ground: Height of the bottom of the secondary above the ground plane in meters.
+//  - coil:   Number of panels up the secondary.
+//  - top:    Number of panels around the topload.
+typedef struct
+{
+
+	int shape;
+	double minor, ground;
+	int coil, top;
+
+} Field;
+
+// Return the capacitance seen at the top of the secondary of a calculated
+// design with its topload over the ground plane, solving with the given number
+// of threads or taking it from the geometries solved before. The secondary's
+// potential rises evenly from its grounded bottom to the topload's, and the
+// capacitance is twice the energy of the field with the topload at one volt.
+// Returns NAN if the geometry cannot be solved.
+double capacitance( Field* f, Coil* c, int threads );
+
+// Return the number of capacitances taken from solved geometries and solved anew.
+void fieldCache( long* hits, long* misses );
+
+// Parse a topload shape, sphere or toroid:minor, returning 1 if it is not valid.
+int fieldShape( Field* f, char* spec );
+
+// Holds a straight panel of a surface of revolution through its meridian.
+//  - r, z:     Centre of the panel.
+//  - r0, z0:   One end of the panel.
+//  - r1, z1:   The other end of the panel.
+//  - length:   Length of the panel.
+//  - volts:    Potential of the panel with the topload at one volt.
+typedef struct
+{
+
+	double r, z, r0, z0, r1, z1, length, volts;
+
+} Panel;
+
+// Holds a geometry being solved.
+//  - n:      Number of panels.
+//  - panel:  Panels of the secondary, then the topload.
+//  - A:      Potential at each panel of unit charge on each other, n by n by rows.
+//  - q:      Charge of each panel with the topload at one volt.
+typedef struct
+{
+
+	int n;
+	Panel* panel;
+	double *A, *q;
+
+} Geometry;
+
+// Holds a solved geometry remembered between designs.
+//  - key: Hash of the geometry, or 0 for an empty entry.
+//  - shape: Numbers describing the geometry, compared in full on a match.
+//  - C:   Its capacitance.
+typedef struct
+{
+
+	uint64_t key;
+	double shape[8], C;
+
+} Solved;
+
+static Solved fieldSolved[FIELD_CACHE];
+static pthread_mutex_t fieldLock = PTHREAD_MUTEX_INITIALIZER;
+static long fieldHits, fieldMisses;
+
+int fieldShape( Field* f, char* spec )
+{
+
+	if ( strcmp( spec, "sphere" ) == 0 ) { f->shape = SPHERE; return 0; }
+	if ( sscanf( spec, "toroid:%lf", &f->minor ) == 1 && f->minor > 0.0 ) { f->shape = TOROID; return 0; }
+	return 1;
+
+}
+
+void fieldCache( long* hits, long* misses )
+{
+
+	*hits = fieldHits;
+	*misses = fieldMisses;
+
+}
+
+// Return the complete elliptic integral of the first kind of modulus k with
+// complementary modulus kp, by the arithmetic geometric mean.
+static double ellipticK( double kp )
+{
+
+	double x = 1.0, y = kp, t;
+	int i;
+
+	for ( i = 0; i < 32 && x - y > 1.0e-15 * x; i++ )
+	{
+
+		t = 0.5 * ( x + y );
+		y = sqrt( x * y );
+		x = t;
+
+	}
+
+	return 0.5 * PI / x;
+
+}
+
+// Return the potential at (r, z) of a ring of unit charge of radius R at height Z.
+static double ring( double r, double z, double R, double Z )
+{
+
+	double D = ( r + R ) * ( r + R ) + ( z - Z ) * ( z - Z );
+	double kp = sqrt( ( ( r - R ) * ( r - R ) + ( z - Z ) * ( z - Z ) ) / D );
+
+	return ellipticK( kp ) / ( 2.0 * PI * PI * E0 * sqrt( D ) );
+
+}
+
+// Return the potential at the centre of panel i of unit charge spread evenly
+// over panel j, with the ring of charge at its centre unless they are near.
+static double potential( Panel* i, Panel* j )
+{
+
+	static const double x[4] = { -0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526 };
+	static const double w[4] = {  0.3478548451374538,  0.6521451548625461, 0.6521451548625461, 0.3478548451374538 };
+	double dr = i->r - j->r, dz = i->z - j->z, s = 0.0, t;
+	int g;
+
+	if ( dr * dr + dz * dz > FIELD_NEAR * FIELD_NEAR * j->length * j->length )
+		return ring( i->r, i->z, j->r, j->z );
+
+	for ( g = 0; g < 4; g++ )
+	{
+
+		t = 0.5 * ( 1.0 + x[g] );
+		s += 0.5 * w[g] * ring( i->r, i->z, j->r0 + t * ( j->r1 - j->r0 ), j->z0 + t * ( j->z1 - j->z0 ) );
+
+	}
+
+	return s;
+
+}
+
+// Return the potential at the centre of a panel of its own unit charge. Near
+// the panel a ring's potential grows as the log of the distance, whose mean
+// across the panel from its centre gives ln( 16 r / length ) + 1.
+static double self( Panel* p )
+{
+
+	return ( log( 16.0 * p->r / p->length ) + 1.0 ) / ( 4.0 * PI * PI * E0 * p->r );
+
+}
+
+// Add a panel between two points of a meridian at the given potential.
+static void panelAdd( Geometry* g, double r0, double z0, double r1, double z1, double volts )
+{
+
+	Panel* p = &g->panel[g->n++];
+
+	p->r0 = r0;
+	p->z0 = z0;
+	p->r1 = r1;
+	p->z1 = z1;
+	p->r = 0.5 * ( r0 + r1 );
+	p->z = 0.5 * ( z0 + z1 );
+	p->length = hypot( r1 - r0, z1 - z0 );
+	p->volts = volts;
+
+}
+
+// Lay out the panels of the secondary and topload. Charge crowds towards the
+// ends of the secondary and the panels are graded finer there to follow it.
+static int geometryInit( Geometry* g, Field* f, Coil* c )
+{
+
+	double a = 0.5 * ( c->SECD + c->SECWD ), H = c->SECH, top = f->ground + H;
+	double t0, t1, R, rho, zc;
+	int i, n = f->coil + f->top;
+
+	memset( g, 0, sizeof *g );
+	if ( !( a > 0.0 && H > 0.0 && c->TOPD > 0.0 && f->ground > 0.0 ) || f->coil < 2 || f->top < 4 ) return 1;
+	if ( f->shape == TOROID && !( f->minor < 0.5 * c->TOPD ) ) return 1;
+
+	g->panel = malloc( n * sizeof *g->panel );
+	g->A = malloc( (size_t)n * n * sizeof( double ) );
+	g->q = malloc( n * sizeof( double ) );
+	if ( !g->panel || !g->A || !g->q ) return 1;
+
+	for ( i = 0; i < f->coil; i++ )
+	{
+
+		t0 = 0.5 * ( 1.0 - cos( PI * i / f->coil ) );
+		t1 = 0.5 * ( 1.0 - cos( PI * ( i + 1 ) / f->coil ) );
+		panelAdd( g, a, f->ground + H * t0, a, f->ground + H * t1, 0.5 * ( t0 + t1 ) );
+
+	}
+
+	// A sphere rests on the top of the secondary, graded finer towards its poles,
+	// and the tube of a toroid on the plane of its top, evenly around the tube.
+	R = 0.5 * c->TOPD;
+	rho = 0.5 * f->minor;
+	zc = top + rho;
+	for ( i = 0; i < f->top; i++ )
+	{
+
+		if ( f->shape == SPHERE )
+		{
+
+			t0 = 0.5 * PI * ( 1.0 - cos( PI * i / f->top ) );
+			t1 = 0.5 * PI * ( 1.0 - cos( PI * ( i + 1 ) / f->top ) );
+			panelAdd( g, R * sin( t0 ), top + R * ( 1.0 - cos( t0 ) ), R * sin( t1 ), top + R * ( 1.0 - cos( t1 ) ), 1.0 );
+
+		}
+		else
+		{
+
+			t0 = 2.0 * PI * i / f->top;
+			t1 = 2.0 * PI * ( i + 1 ) / f->top;
+			panelAdd( g, R - rho + rho * sin( t0 ), zc - rho * cos( t0 ), R - rho + rho * sin( t1 ), zc - rho * cos( t1 ), 1.0 );
+
+		}
+
+	}
+
+	return 0;
+
+}
+
+static void geometryFree( Geometry* g )
+{
+
+	free( g->panel );
+	free( g->A );
+	free( g->q );
+
+}
+
+// Holds the work shared out between threads, each taking the tasks numbered
+// thread, thread + threads and so on.
+//  - g:       Geometry being solved.
+//  - k:       First row of the block being factored.
+//  - thread, threads: Number of this thread and of all of them.
+//  - task:    Work done for each task.
+typedef struct
+{
+
+	Geometry* g;
+	int k, thread, threads;
+	void (*task)( Geometry* g, int k, int task );
+	int tasks;
+
+} Share;
+
+static void* shareRun( void* arg )
+{
+
+	Share* s = arg;
+	int i;
+
+	for ( i = s->thread; i < s->tasks; i += s->threads ) s->task( s->g, s->k, i );
+	return NULL;
+
+}
+
+// Run tasks numbered 0 to tasks - 1 across the given number of threads.
+static void share( Geometry* g, int k, int tasks, int threads, void (*task)( Geometry* g, int k, int task ) )
+{
+
+	pthread_t thread[threads];
+	Share s[threads];
+	int started[threads], t;
+
+	if ( threads > tasks ) threads = tasks > 0 ? tasks : 1;
+	for ( t = 0; t < threads; t++ )
+	{
+
+		s[t].g = g;
+		s[t].k = k;
+		s[t].thread = t;
+		s[t].threads = threads;
+		s[t].task = task;
+		s[t].tasks = tasks;
+		started[t] = t > 0 && pthread_create( &thread[t], NULL, shareRun, &s[t] ) == 0;
+
+	}
+	for ( t = 0; t < threads; t++ )
+		if ( !started[t] ) shareRun( &s[t] );
+	for ( t = 1; t < threads; t++ )
+		if ( started[t] ) pthread_join( thread[t], NULL );
+
+}
+
+// Fill row i of the lower triangle of the matrix. Near panels take the mean
+// of the potential of each at the other, keeping the matrix symmetric, and the
+// ground plane is an image of opposite charge beneath every panel.
+static void assembleRow( Geometry* g, int k, int i )
+{
+
+	Panel* p = g->panel;
+	double* A = g->A + (size_t)i * g->n;
+	int j;
+
+	for ( j = 0; j <= i; j++ )
+	{
+
+		A[j] = j == i ? self( &p[i] ) : 0.5 * ( potential( &p[i], &p[j] ) + potential( &p[j], &p[i] ) );
+		A[j] -= ring( p[i].r, p[i].z, p[j].r, -p[j].z );
+
+	}
+
+}
+
+// Solve the panel of rows below the diagonal block at k for the block of rows task.
+static void choleskyPanel( Geometry* g, int k, int task )
+{
+
+	int n = g->n, kb = n - k < FIELD_BLOCK ? n - k : FIELD_BLOCK, i, j, p;
+	int first = k + kb + task * FIELD_BLOCK, last = first + FIELD_BLOCK < n ? first + FIELD_BLOCK : n;
+	double *A = g->A, s;
+
+	for ( i = first; i < last; i++ )
+		for ( j = k; j < k + kb; j++ )
+		{
+
+			s = A[(size_t)i*n + j];
+			for ( p = k; p < j; p++ ) s -= A[(size_t)i*n + p] * A[(size_t)j*n + p];
+			A[(size_t)i*n + j] = s / A[(size_t)j*n + j];
+
+		}
+
+}
+
+// Subtract the product of the solved panel from the block of rows task of the trailing matrix.
+static void choleskyUpdate( Geometry* g, int k, int task )
+{
+
+	int n = g->n, kb = n - k < FIELD_BLOCK ? n - k : FIELD_BLOCK, i, j, p;
+	int first = k + kb + task * FIELD_BLOCK, last = first + FIELD_BLOCK < n ? first + FIELD_BLOCK : n;
+	double *A = g->A, *a, *b, s;
+
+	for ( i = first; i < last; i++ )
+		for ( j = k + kb; j <= i; j++ )
+		{
+
+			a = A + (size_t)i*n + k;
+			b = A + (size_t)j*n + k;
+			for ( s = 0.0, p = 0; p < kb; p++ ) s += a[p] * b[p];
+			A[(size_t)i*n + j] -= s;
+
+		}
+
+}
+
+// Factor the matrix into L L^T in its lower triangle a block of FIELD_BLOCK
+// rows at a time, sharing out the rows below each block. Returns 1 unless the
+// matrix is positive definite, as the potential of any charges must be.
+static int cholesky( Geometry* g, int threads )
+{
+
+	int n = g->n, k, kb, i, j, p, blocks;
+	double *A = g->A, s;
+
+	for ( k = 0; k < n; k += FIELD_BLOCK )
+	{
+
+		kb = n - k < FIELD_BLOCK ? n - k : FIELD_BLOCK;
+		for ( j = k; j < k + kb; j++ )
+			for ( i = j; i < k + kb; i++ )
+			{
+
+				s = A[(size_t)i*n + j];
+				for ( p = k; p < j; p++ ) s -= A[(size_t)i*n + p] * A[(size_t)j*n + p];
+				if ( i == j )
+				{
+
+					if ( !( s > 0.0 ) ) return 1;
+					A[(size_t)j*n + j] = sqrt( s );
+
+				}
+				else A[(size_t)i*n + j] = s / A[(size_t)j*n + j];
+
+			}
+
+		blocks = ( n - k - kb + FIELD_BLOCK - 1 ) / FIELD_BLOCK;
+		if ( blocks == 0 ) break;
+		share( g, k, blocks, threads, choleskyPanel );
+		share( g, k, blocks, threads, choleskyUpdate );
+
+	}
+
+	return 0;
+
+}
+
+// Solve for the charges from the factored matrix and return the capacitance.
+static double geometrySolve( Geometry* g )
+{
+
+	int n = g->n, i, p;
+	double *A = g->A, *q = g->q, s, C = 0.0;
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		for ( s = g->panel[i].volts, p = 0; p < i; p++ ) s -= A[(size_t)i*n + p] * q[p];
+		q[i] = s / A[(size_t)i*n + i];
+
+	}
+	for ( i = n - 1; i >= 0; i-- )
+	{
+
+		for ( s = q[i], p = i + 1; p < n; p++ ) s -= A[(size_t)p*n + i] * q[p];
+		q[i] = s / A[(size_t)i*n + i];
+
+	}
+	for ( i = 0; i < n; i++ ) C += q[i] * g->panel[i].volts;
+
+	return C;
+
+}
+
+// Return the numbers describing the geometry of a design and their hash.
+static uint64_t fieldKey( Field* f, Coil* c, double* shape )
+{
+
+	uint64_t h = 0, bits;
+	int i;
+
+	memset( shape, 0, 8 * sizeof( double ) );
+	shape[0] = c->SECD + c->SECWD;
+	shape[1] = c->SECH;
+	shape[2] = c->TOPD;
+	shape[3] = f->shape;
+	shape[4] = f->shape == TOROID ? f->minor : 0.0;
+	shape[5] = f->ground;
+	shape[6] = f->coil;
+	shape[7] = f->top;
+	for ( i = 0; i < 8; i++ )
+	{
+
+		memcpy( &bits, &shape[i], sizeof bits );
+		h = ( h ^ bits ) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 31;
+
+	}
+
+	return h | 1;
+
+}
+
+double capacitance( Field* f, Coil* c, int threads )
+{
+
+	double shape[8], C = NAN;
+	uint64_t key = fieldKey( f, c, shape );
+	Solved* e = &fieldSolved[key % FIELD_CACHE];
+	Geometry g;
+
+	pthread_mutex_lock( &fieldLock );
+	if ( e->key == key && memcmp( e->shape, shape, sizeof shape ) == 0 )
+	{
+
+		C = e->C;
+		fieldHits++;
+
+	}
+	pthread_mutex_unlock( &fieldLock );
+	if ( !isnan( C ) ) return C;
+
+	if ( geometryInit( &g, f, c ) == 0 )
+	{
+
+		share( &g, 0, g.n, threads, assembleRow );
+		if ( cholesky( &g, threads ) == 0 ) C = geometrySolve( &g );
+
+	}
+	geometryFree( &g );
+
+	// Solved geometries displace whatever was held in their entry.
+	pthread_mutex_lock( &fieldLock );
+	fieldMisses++;
+	if ( !isnan( C ) )
+	{
+
+		e->key = key;
+		memcpy( e->shape, shape, sizeof shape );
+		e->C = C;
+
+	}
+	pthread_mutex_unlock( &fieldLock );
+
+	return C;
+
+}
+
+#endif
@@ -0,0 +1,409 @@
+#ifndef CATALOG_C
+#define CATALOG_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <pthread.h>
+
+// Longest part number held for a catalog entry.
+#define PART_NAME 32
+
+// Most different strings an optimized MMC can be built from.
+#define BANK_MIX 8
+
+// Holds a single capacitor part number from a catalog.
+//  - name:  Part number.
+//  - C:     Capacitance expressed in farads.
+//  - V:     Voltage rating expressed in volts.
+//  - price: Price of a single capacitor.
+//  - stock: Number of capacitors on hand.
+typedef struct
+{
+
+	char name[PART_NAME];
+	double C, V, price;
+	int stock;
+
+} Part;
+
+// Holds one kind of string an MMC can be built from: ser capacitors of one
+// part in series, with their capacitance and cost expressed per string.
+typedef struct
+{
+
+	int part, ser;
+	double C, cost;
+
+} String;
+
+// Holds an MMC built from parallel strings of different parts.
+//  - strings: Number of different kinds of string used.
+//  - kind:    Part and series count of each kind of string.
+//  - count:   Number of strings of each kind in parallel.
+//  - C, V:    Capacitance and derated voltage rating of the MMC.
+//  - cost:    Total price of the capacitors in the MMC.
+typedef struct
+{
+
+	int strings;
+	String kind[BANK_MIX];
+	int count[BANK_MIX];
+	double C, V, cost;
+
+} Bank;
+
+// Read a catalog of lines of the form "PART C V PRICE STOCK". Lines starting
+// with # are ignored. Returns the number of parts read, or -1 on failure.
+int readCatalog( char* file, Part** parts );
+
+// Find the cheapest MMC within tol of TC whose every string withstands TV with
+// its capacitors run at derate times their rating, mixing at most mix kinds of
+// string and searching on the given number of threads. Returns 1 if found, and
+// 0 without searching when derate is not positive.
+int optimize( Part* parts, int n, double TC, double TV, double tol, double derate,
+	int mix, int threads, Bank* bank );
+
+int readCatalog( char* file, Part** parts )
+{
+
+	char line[256];
+	int n = 0, size = 64;
+	Part p;
+	FILE* catalog = fopen( file, "r" );
+
+	if ( !catalog )
+	{
+
+		fprintf(stderr, "Cannot open %s for parsing!\n", file);
+		return -1;
+
+	}
+
+	if ( !( *parts = malloc( size * sizeof **parts ) ) )
+	{
+
+		fprintf(stderr, "Cannot hold the catalog in %s!\n", file);
+		fclose( catalog );
+		return -1;
+
+	}
+	while ( fgets( line, sizeof line, catalog ) )
+	{
+
+		if ( line[0] == '#' || line[strspn( line, " \t\r\n" )] == '\0' ) continue;
+		if ( sscanf( line, "%31s %lf %lf %lf %d", p.name, &p.C, &p.V, &p.price, &p.stock ) != 5
+			|| p.C <= 0.0 || p.V <= 0.0 || p.price < 0.0 )
+		{
+
+			fprintf(stderr, "  %s not valid catalog entry.\n", strtok( line, "\r\n" ));
+			continue;
+
+		}
+		if ( n == size )
+		{
+
+			Part* grown = realloc( *parts, ( size *= 2 ) * sizeof **parts );
+			if ( !grown )
+			{
+
+				fprintf(stderr, "Cannot hold the catalog in %s!\n", file);
+				free( *parts );
+				*parts = NULL;
+				fclose( catalog );
+				return -1;
+
+			}
+			*parts = grown;
+
+		}
+		(*parts)[n++] = p;
+
+	}
+
+	fclose( catalog );
+	return n;
+
+}
+
+// Holds the state of an optimization shared between its threads.
+//  - perFarad: Cost per farad of each kind of string, in the order of kind.
+//  - cheapest: Cost of the cheapest single string of each kind onwards.
+typedef struct
+{
+
+	String* kind;
+	double *perFarad, *cheapest;
+	Part* parts;
+	int count, kinds, mix;
+	double lo, hi;
+
+	pthread_mutex_t lock;
+	int next;
+	double best;
+	Bank bank;
+
+} Search;
+
+// Holds the partial MMC being built by one thread.
+typedef struct
+{
+
+	Search* s;
+	int* used;
+	Bank bank;
+
+} Branch;
+
+static double bestCost( Search* s )
+{
+
+	double best;
+	__atomic_load( &s->best, &best, __ATOMIC_RELAXED );
+	return best;
+
+}
+
+// Consider every way of adding strings of kinds i onwards to the partial MMC.
+static void branch( Branch* b, int i, double C, double cost )
+{
+
+	Search* s = b->s;
+	double need, room;
+	int n, max;
+
+	if ( C >= s->lo )
+	{
+
+		// Adding strings only adds cost once the MMC is within tolerance.
+		if ( cost < bestCost( s ) )
+		{
+
+			pthread_mutex_lock( &s->lock );
+			if ( cost < s->best )
+			{
+
+				s->best = cost;
+				s->bank = b->bank;
+				s->bank.C = C;
+				s->bank.cost = cost;
+
+			}
+			pthread_mutex_unlock( &s->lock );
+
+		}
+		return;
+
+	}
+
+	for ( ; i < s->kinds && b->bank.strings < s->mix; i++ )
+	{
+
+		String* k = &s->kind[i];
+
+		// Kinds are sorted by cost per farad, so no mix of the remaining
+		// kinds can reach the target for less than this, nor for less than
+		// the one string it takes at least.
+		need = s->lo - C;
+		if ( cost + fmax( need * s->perFarad[i], s->cheapest[i] ) >= bestCost( s ) ) return;
+
+		room = s->hi - C;
+		max = room / k->C;
+		if ( ( s->parts[k->part].stock - b->used[k->part] ) / k->ser < max )
+			max = ( s->parts[k->part].stock - b->used[k->part] ) / k->ser;
+		if ( ( bestCost( s ) - cost ) / k->cost < max ) max = ( bestCost( s ) - cost ) / k->cost;
+		if ( need / k->C + 1.0 < max ) max = need / k->C + 1.0;
+
+		// Strings beyond the fewest that reach the target only add cost. Short
+		// of the target the bound only grows as n falls, since the rest is made
+		// up of kinds no cheaper per farad, so the first n it rules out there
+		// rules out every smaller one too.
+		b->bank.kind[b->bank.strings] = *k;
+		for ( n = max; n >= 1; n-- )
+		{
+
+			double rest = need - n * k->C;
+			if ( cost + n * k->cost + ( rest > 0.0 && i + 1 < s->kinds ? rest * s->perFarad[i+1] : 0.0 ) >= bestCost( s ) )
+			{
+
+				if ( rest > 0.0 ) break;
+				continue;
+
+			}
+			if ( rest > 0.0 && ( i + 1 == s->kinds || b->bank.strings + 1 == s->mix ) ) break;
+
+			b->bank.count[b->bank.strings++] = n;
+			b->used[k->part] += n * k->ser;
+			branch( b, i + 1, C + n * k->C, cost + n * k->cost );
+			b->used[k->part] -= n * k->ser;
+			b->bank.strings--;
+
+		}
+
+	}
+
+}
+
+static void* searcher( void* arg )
+{
+
+	Search* s = arg;
+	Branch b;
+	int i, used[s->count > 0 ? s->count : 1];
+
+	b.s = s;
+	b.used = used;
+	memset( &b.bank, 0, sizeof b.bank );
+
+	// Each thread claims the cheapest kind of string in the MMC in turn.
+	for ( ;; )
+	{
+
+		pthread_mutex_lock( &s->lock );
+		i = s->next++;
+		pthread_mutex_unlock( &s->lock );
+		if ( i >= s->kinds ) break;
+
+		b.bank.strings = 0;
+		memset( b.used, 0, s->count * sizeof *b.used );
+		if ( s->lo * s->perFarad[i] >= bestCost( s ) ) break;
+
+		// Force at least one string of kind i, then branch on the rest.
+		{
+
+			String* k = &s->kind[i];
+			int n, max = ( s->hi ) / k->C;
+			if ( s->parts[k->part].stock / k->ser < max ) max = s->parts[k->part].stock / k->ser;
+			if ( bestCost( s ) / k->cost < max ) max = bestCost( s ) / k->cost;
+			if ( s->lo / k->C + 1.0 < max ) max = s->lo / k->C + 1.0;
+
+			b.bank.kind[0] = *k;
+			b.bank.strings = 1;
+			for ( n = max; n >= 1; n-- )
+			{
+
+				double rest = s->lo - n * k->C;
+				if ( rest > 0.0 && ( i + 1 == s->kinds || s->mix == 1
+					|| n * k->cost + rest * s->perFarad[i+1] >= bestCost( s ) ) ) break;
+				b.bank.count[0] = n;
+				b.used[k->part] = n * k->ser;
+				branch( &b, i + 1, n * k->C, n * k->cost );
+
+			}
+
+		}
+
+	}
+
+	return NULL;
+
+}
+
+static int byPerFarad( const void* a, const void* b )
+{
+
+	const String* x = a;
+	const String* y = b;
+	double u = x->cost / x->C, v = y->cost / y->C;
+	return ( u > v ) - ( u < v );
+
+}
+
+int optimize( Part* parts, int n, double TC, double TV, double tol, double derate,
+	int mix, int threads, Bank* bank )
+{
+
+	Search s;
+	pthread_t thread[threads];
+	int i, j, ser, size;
+	double vmin, single = DBL_MAX;
+
+	if ( !( derate > 0.0 ) ) return 0;
+
+	memset( &s, 0, sizeof s );
+	s.parts = parts;
+	s.count = n;
+	s.mix   = mix < BANK_MIX ? mix : BANK_MIX;
+	s.lo    = TC - tol;
+	s.hi    = TC + tol;
+	s.best  = DBL_MAX;
+	s.kind  = malloc( ( size = 64 ) * sizeof *s.kind );
+	if ( !s.kind ) return 0;
+
+	// List every kind of string that withstands the target voltage, from the
+	// fewest series capacitors that do to as many as the stock allows. No MMC
+	// holding a string dearer than the cheapest built from one kind alone can
+	// be the cheapest, so the list stops at that price; kinds expensive per
+	// farad are pruned by the search itself.
+	for ( i = 0; i < n; i++ )
+	{
+
+		vmin = ceil( TV / ( parts[i].V * derate ) );
+		if ( vmin < 1.0 ) vmin = 1.0;
+		for ( ser = vmin; ser <= parts[i].stock && parts[i].price * ser <= single; ser++ )
+			if ( parts[i].C / ser <= s.hi )
+			{
+
+				String* k;
+				double strings = s.lo > 0.0 ? ceil( s.lo / ( parts[i].C / ser ) ) : 1.0;
+
+				if ( strings * ( parts[i].C / ser ) < s.lo ) strings++;
+				if ( strings * ( parts[i].C / ser ) <= s.hi && strings * ser <= parts[i].stock
+					&& strings * parts[i].price * ser < single ) single = strings * parts[i].price * ser;
+
+				if ( s.kinds == size )
+				{
+
+					String* grown = realloc( s.kind, ( size *= 2 ) * sizeof *s.kind );
+					if ( !grown ) { free( s.kind ); return 0; }
+					s.kind = grown;
+
+				}
+				k = &s.kind[s.kinds++];
+				k->part = i;
+				k->ser  = ser;
+				k->C    = parts[i].C / ser;
+				k->cost = parts[i].price * ser;
+
+			}
+
+	}
+	for ( i = j = 0; i < s.kinds; i++ )
+		if ( s.kind[i].cost <= single ) s.kind[j++] = s.kind[i];
+	s.kinds = j;
+
+	qsort( s.kind, s.kinds, sizeof *s.kind, byPerFarad );
+	if ( !( s.perFarad = malloc( ( 2 * s.kinds + 1 ) * sizeof *s.perFarad ) ) )
+	{
+
+		free( s.kind );
+		return 0;
+
+	}
+	s.cheapest = s.perFarad + s.kinds;
+	s.cheapest[s.kinds] = DBL_MAX;
+	for ( i = 0; i < s.kinds; i++ ) s.perFarad[i] = s.kind[i].cost / s.kind[i].C;
+	for ( i = s.kinds - 1; i >= 0; i-- ) s.cheapest[i] = fmin( s.kind[i].cost, s.cheapest[i+1] );
+
+	pthread_mutex_init( &s.lock, NULL );
+	for ( i = 0; i < threads; i++ )
+		if ( pthread_create( &thread[i], NULL, searcher, &s ) != 0 ) break;
+	if ( i == 0 ) searcher( &s );
+	for ( j = 0; j < i; j++ ) pthread_join( thread[j], NULL );
+	pthread_mutex_destroy( &s.lock );
+
+	*bank = s.bank;
+	bank->V = DBL_MAX;
+	for ( i = 0; i < bank->strings; i++ )
+		if ( bank->kind[i].ser * parts[bank->kind[i].part].V * derate < bank->V )
+			bank->V = bank->kind[i].ser * parts[bank->kind[i].part].V * derate;
+
+	free( s.perFarad );
+	free( s.kind );
+	return s.best < DBL_MAX;
+
+}
+
+#endif
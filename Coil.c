@@ -0,0 +1,1103 @@
+#ifndef COIL_C
+#define COIL_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Global constants and ratios.
+//  - PI:  Ratio of circumference to diameter of a circle.
+//  - PHI: Golden ratio.
+//  - C0:  Speed of light in free space.
+//  - U0:  Magnetic permeability of free space.
+//  - E0:  Electric permittivity of free space.
+double PI, PHI, C0, U0, E0;
+
+// Powers of ten from 1e-64 to 1e63 used to format values, indexed from 64.
+static double scale[128];
+
+// Models of the inductance of the secondary, selected by inductance.
+//  - WHEELER: Wheeler's empirical formula.
+//  - NAGAOKA: Current sheet solenoid with Nagaoka's coefficient and Rosa's round wire correction.
+enum { WHEELER, NAGAOKA };
+int inductance = WHEELER;
+
+// Precisions the outputs of a design are calculated in, selected by precision.
+//  - SINGLE: Each output is rounded to a float as it is calculated and read back so by the
+//            outputs calculated from it, as batchCoils does across twice as many SIMD lanes.
+//  - DOUBLE: Outputs are held in double until the design is complete, then rounded once.
+enum { SINGLE, DOUBLE };
+int precision = SINGLE;
+
+// Nagaoka's coefficient at NAGAOKA_TABLE+1 even steps of the modulus k from 0 to 1,
+// each paired with the step to the next, so it is interpolated with one lookup.
+#define NAGAOKA_TABLE 4096
+static float nagaokaTable[NAGAOKA_TABLE+1][2];
+
+// Holds every input and output parameter of a single coil design so that
+// any number of designs can be calculated independently of one another.
+typedef struct
+{
+
+	// Input parameters pertaining to the neon sign transformer (NST).
+	//  - NSTVI:  RMS input voltage of NST expressed in volts.
+	//  - NSTF:   Input frequency of NST expressed in hertz.
+	//  - NSTVO:  RMS output voltage of NST expressed in volts.
+	//  - NSTIO:  RMS output current of NST expressed in amps.
+	//  - NSTRP:  Resistance of the NST primary expressed in ohms.
+	//  - NSTRS:  Resistance of the NST secondary expressed in ohms.
+	float NSTVI, NSTF, NSTVO, NSTIO, NSTRP, NSTRS;
+
+	// Output parameters pertaining to the neon sign transformer (NST).
+	//  - NSTVIP: Peak input voltage of NST expressed in volts.
+	//  - NSTII:  RMS input current of NST expressed in amps.
+	//  - NSTIIP: Peak input current of NST expressed in amps.
+	//  - NSTVOP: Peak output voltage of NST expressed in volts.
+	//  - NSTIOP: Peak output current of NST expressed in amps.
+	//  - NSTVA:  Power draw of NST expressed in volt-amps.
+	//  - NSTTR:  Transformer coil turn ratio of NST.
+	//  - NSTZ:   Impedance of NST expressed in ohms.
+	//  - NSTR:   Total resistive reactance of NST expressed in ohms.
+	//  - NSTPF:  Power factor correction capacitance for NST expressed in farads.
+	float NSTVIP, NSTII, NSTIIP, NSTVOP, NSTIOP, NSTVA, NSTTR, NSTZ, NSTR, NSTPF;
+
+	// Output parameters pertaining to the primary tank capacitor (PTC).
+	//  - PTCC:  Resonant capacitance for PTC expressed in farads.
+	//  - LTRCS: Larger than resonant capacitance for PTC with static spark gap expressed in farads.
+	//  - LTRCR: Larger than resonant capacitance for PTC with rotary spark gap expressed in farads.
+	//  - PTCCR: Capacitive reactance of PTC expressed in ohms.
+	float PTCCR, PTCC, LTRCS, LTRCR;
+
+	// Input parameters pertaining to the primary coil (PRI).
+	//  - PRIWG: American wire gauge of PRI.
+	//  - PRIN:  Number of turns of wire in PRI.
+	//  - PRIRI: Inner radius of PRI expressed in meters.
+	//  - PRIS:  Separation of PRI wrappings expressed in meters.
+	float PRIWG, PRIN, PRIRI, PRIS;
+
+	// Output parameters pertaining to the primary coil (PRI).
+	//  - PRILR: Inductive reactance of PRI expressed in ohms.
+	//  - PRIWD: Wire diameter of PRI expressed in meters.
+	//  - PRIRO: Outer radius of PRI expressed in meters.
+	//  - PRIF:  Resonant frequency of PRI expressed in Hertz.
+	//  - PRILN: Length of PRI expressed in meters.
+	//  - PRIL:  Inductance of PRI expressed in Henries.
+	float PRILR, PRIWD, PRIRO, PRIF, PRILN, PRIL;
+
+	// Input parameters pertaining to the secondary coil (SEC).
+	//  - SECWG: American wire gauge of SEC.
+	//  - SECD:  Diameter of SEC expressed in meters.
+	//  - SECH:  Height of SEC expressed in meters.
+	float SECWG, SECD, SECH;
+
+	// Output parameters pertaining to the secondary coil (SEC).
+	//  - SECWD: Wire diameter of SEC expressed in meters.
+	//  - SECF:  Resonant frequency of SEC expressed in hertz.
+	//  - SECLN: Length of SEC expressed in meters.
+	//  - SECL:  Inductance of SEC expressed in henries.
+	//  - SECC:  Capacitance of SEC expressed in farads.
+	//  - SECN:  Number of turns of wire in SEC.
+	//  - SECHD: Coil height to diameter ratio.
+	float SECWD, SECF, SECLN, SECL, SECC, SECN, SECHD;
+
+	// Input parameters pertaining to the top load (TOP).
+	//  - TOPD:  Diameter of TOP expressed in meters.
+	float TOPD;
+
+	// Output parameters pertaining to the top load (TOP).
+	//  - TOPC:  Capacitance of TOP expressed in Farads.
+	float TOPC;
+
+	// Miscellaneous output parameters.
+	//  - ARCLN: Maximum length of arc expressed in meters.
+	float ARCLN;
+
+} Coil;
+
+// Holds every parameter of a Coil as a double, in the same order, while the
+// design is calculated in double precision.
+typedef struct
+{
+
+	double NSTVI, NSTF, NSTVO, NSTIO, NSTRP, NSTRS;
+	double NSTVIP, NSTII, NSTIIP, NSTVOP, NSTIOP, NSTVA, NSTTR, NSTZ, NSTR, NSTPF;
+	double PTCCR, PTCC, LTRCS, LTRCR;
+	double PRIWG, PRIN, PRIRI, PRIS;
+	double PRILR, PRIWD, PRIRO, PRIF, PRILN, PRIL;
+	double SECWG, SECD, SECH;
+	double SECWD, SECF, SECLN, SECL, SECC, SECN, SECHD;
+	double TOPD;
+	double TOPC;
+	double ARCLN;
+
+} Precise;
+_Static_assert( sizeof( Precise ) == 2 * sizeof( Coil ) && offsetof( Precise, ARCLN ) == 2 * offsetof( Coil, ARCLN ),
+	"Precise must hold the parameters of Coil in the same order" );
+
+// Number of parameters held by a Coil.
+#define PARAMETERS 43
+
+// Roles a parameter plays in a design.
+#define INPUT  1
+#define OUTPUT 2
+
+// Describes a single parameter of a Coil.
+//  - name:   Name as it appears in parameters.dat and parameters.out.
+//  - unit:   Unit the value is expressed in.
+//  - role:   INPUT if it is set by the user, OUTPUT if it is calculated.
+//  - offset: Position of the value within a Coil in bytes.
+//  - prompt: Description given when asking for an input, NULL for outputs.
+//  - label:  Description given when reporting the value.
+typedef struct
+{
+
+	char* name;
+	char* unit;
+	int role;
+	size_t offset;
+	char* prompt;
+	char* label;
+
+} Parameter;
+
+// Every parameter of a Coil, in the order written by writeSettings.
+static Parameter registry[PARAMETERS] =
+{
+
+	{ "NSTVI",  "V",   INPUT,  offsetof( Coil, NSTVI  ), "Transformer Input Voltage",        "Input Voltage:"    },
+	{ "NSTF",   "Hz",  INPUT,  offsetof( Coil, NSTF   ), "Transformer Input Frequency",      "Frequency:"        },
+	{ "NSTVO",  "V",   INPUT,  offsetof( Coil, NSTVO  ), "Transformer Output Voltage",       "Output Voltage:"   },
+	{ "NSTIO",  "A",   INPUT,  offsetof( Coil, NSTIO  ), "Transformer Output Current",       "Output Current:"   },
+	{ "NSTRP",  "ohm", INPUT,  offsetof( Coil, NSTRP  ), "Transformer Primary Resistance",   "Pri Resistance:"   },
+	{ "NSTRS",  "ohm", INPUT,  offsetof( Coil, NSTRS  ), "Transformer Secondary Resistance", "Sec Resistance:"   },
+	{ "NSTVIP", "V",   OUTPUT, offsetof( Coil, NSTVIP ), NULL,                               "Peak In Voltage:"  },
+	{ "NSTII",  "A",   OUTPUT, offsetof( Coil, NSTII  ), NULL,                               "Input Current:"    },
+	{ "NSTIIP", "A",   OUTPUT, offsetof( Coil, NSTIIP ), NULL,                               "Peak In Current:"  },
+	{ "NSTVOP", "V",   OUTPUT, offsetof( Coil, NSTVOP ), NULL,                               "Peak Out Voltage:" },
+	{ "NSTIOP", "A",   OUTPUT, offsetof( Coil, NSTIOP ), NULL,                               "Peak Out Current:" },
+	{ "NSTVA",  "VA",  OUTPUT, offsetof( Coil, NSTVA  ), NULL,                               "Power:"            },
+	{ "NSTTR",  "",    OUTPUT, offsetof( Coil, NSTTR  ), NULL,                               "Step-up Ratio:"    },
+	{ "NSTZ",   "ohm", OUTPUT, offsetof( Coil, NSTZ   ), NULL,                               "Impedance:"        },
+	{ "NSTR",   "ohm", OUTPUT, offsetof( Coil, NSTR   ), NULL,                               "Resistance:"       },
+	{ "NSTPF",  "F",   OUTPUT, offsetof( Coil, NSTPF  ), NULL,                               "PFC Capacitance:"  },
+	{ "PTCCR",  "ohm", OUTPUT, offsetof( Coil, PTCCR  ), NULL,                               "Cap Reactance:"    },
+	{ "PTCC",   "F",   OUTPUT, offsetof( Coil, PTCC   ), NULL,                               "Res Capacitance:"  },
+	{ "LTRCS",  "F",   OUTPUT, offsetof( Coil, LTRCS  ), NULL,                               "LTR Static Cap:"   },
+	{ "LTRCR",  "F",   OUTPUT, offsetof( Coil, LTRCR  ), NULL,                               "LTR Rotary Cap:"   },
+	{ "PRIWG",  "AWG", INPUT,  offsetof( Coil, PRIWG  ), "Primary Coil Wire Gauge",          "Wire Gauge:"       },
+	{ "PRIN",   "",    INPUT,  offsetof( Coil, PRIN   ), "Primary Coil Wire Turns",          "Wire Turns:"       },
+	{ "PRIRI",  "m",   INPUT,  offsetof( Coil, PRIRI  ), "Primary Coil Inner Radius",        "Inner Radius:"     },
+	{ "PRIS",   "m",   INPUT,  offsetof( Coil, PRIS   ), "Primary Coil Separation",          "Winding Sep:"      },
+	{ "PRILR",  "ohm", OUTPUT, offsetof( Coil, PRILR  ), NULL,                               "L Reactance:"      },
+	{ "PRIWD",  "m",   OUTPUT, offsetof( Coil, PRIWD  ), NULL,                               "Wire Diameter:"    },
+	{ "PRIRO",  "m",   OUTPUT, offsetof( Coil, PRIRO  ), NULL,                               "Outer Radius:"     },
+	{ "PRIF",   "Hz",  OUTPUT, offsetof( Coil, PRIF   ), NULL,                               "Res Frequency:"    },
+	{ "PRILN",  "m",   OUTPUT, offsetof( Coil, PRILN  ), NULL,                               "Wire Length:"      },
+	{ "PRIL",   "H",   OUTPUT, offsetof( Coil, PRIL   ), NULL,                               "Inductance:"       },
+	{ "SECWG",  "AWG", INPUT,  offsetof( Coil, SECWG  ), "Secondary Coil Wire Gauge",        "Wire Gauge:"       },
+	{ "SECD",   "m",   INPUT,  offsetof( Coil, SECD   ), "Secondary Coil Form Diameter",     "Form Diameter:"    },
+	{ "SECH",   "m",   INPUT,  offsetof( Coil, SECH   ), "Secondary Coil Form Height",       "Form Height:"      },
+	{ "SECWD",  "m",   OUTPUT, offsetof( Coil, SECWD  ), NULL,                               "Wire Diameter:"    },
+	{ "SECF",   "Hz",  OUTPUT, offsetof( Coil, SECF   ), NULL,                               "Res Frequency:"    },
+	{ "SECLN",  "m",   OUTPUT, offsetof( Coil, SECLN  ), NULL,                               "Wire Length:"      },
+	{ "SECL",   "H",   OUTPUT, offsetof( Coil, SECL   ), NULL,                               "Inductance:"       },
+	{ "SECC",   "F",   OUTPUT, offsetof( Coil, SECC   ), NULL,                               "Capacitance:"      },
+	{ "SECN",   "",    OUTPUT, offsetof( Coil, SECN   ), NULL,                               "Wire Turns:"       },
+	{ "SECHD",  "",    OUTPUT, offsetof( Coil, SECHD  ), NULL,                               "Aspect Ratio:"     },
+	{ "TOPD",   "m",   INPUT,  offsetof( Coil, TOPD   ), "Topload Sphere Diameter",          "Diameter:"         },
+	{ "TOPC",   "F",   OUTPUT, offsetof( Coil, TOPC   ), NULL,                               "Capacitance:"      },
+	{ "ARCLN",  "m",   OUTPUT, offsetof( Coil, ARCLN  ), NULL,                               "Arc Length (max):" }
+
+};
+
+// Number of input parameters of a Coil.
+#define INPUTS 14
+
+// Position within registry of each input parameter, in the order of parameters.dat.
+static const int inputColumn[INPUTS] = { 0, 1, 2, 3, 4, 5, 20, 21, 22, 23, 30, 31, 32, 40 };
+#define inputName( i ) ( registry[inputColumn[i]].name )
+
+// Perfect hash of parameter names: the name, zero padded to eight bytes and
+// read as a little endian integer, times REGISTRY_HASH leaves a distinct slot
+// of registrySlot in its top seven bits for every parameter. The multiplier
+// was found by trial and must be searched for again if a parameter is added.
+#define REGISTRY_HASH 0x54ce7ec3771ed053ULL
+static const signed char registrySlot[128] =
+{
+
+	-1,  0, -1, -1, 15, -1, -1, -1, -1, -1, 40,  7, -1, 13, 28, -1,
+	-1, -1, -1, -1, 26, 23, 42, -1, -1, -1, -1,  4, -1, -1, 27, 31,
+	20, -1, -1, -1, -1, 11, 32, -1, 18, 41, -1, -1, 21, 36, -1, 22,
+	-1, -1, 33, -1, -1, -1, -1,  9, -1, -1, -1, -1, -1, -1, 37, -1,
+	-1, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, 17, -1, -1,  5, -1,
+	-1, -1,  6, 35, -1, -1, 12, -1, -1, -1, -1, -1,  8, -1, -1, 16,
+	-1, -1, -1, 34, -1, 30, -1,  2, -1, 29,  1, -1, 19, -1, 25, -1,
+	 3, 38, -1, -1, -1, -1, -1, -1, 39, -1, -1, -1, -1, 24, -1, 14
+
+};
+
+// Define values for the global constants and ratios.
+void constants();
+
+// Convert between American wire gauge (WG) and wire diameter (WD) expressed in meters.
+float WD( float WG );
+float WG( float WD );
+
+// Returns the empirical self-capacitance of a helical coil with radius R and length L.
+float medhurst( float R, float L );
+
+// The same in double precision, for designs calculated in it.
+double WDprecise( double WG );
+double medhurstPrecise( double R, double L );
+
+// Select the model of the inductance of the secondary by name, returning 1 if there is none.
+int inductanceModel( char* name );
+
+// Select the precision designs are calculated in, float or double, returning 1 if there is none.
+int precisionModel( char* name );
+
+// Returns Nagaoka's coefficient of a solenoid whose diameter D and length l give the
+// modulus k = D / sqrt( D^2 + l^2 ), interpolated from a table or evaluated directly
+// from complete elliptic integrals.
+float nagaoka( float k );
+double nagaokaExact( double k );
+
+// Returns the inductance of a solenoid of N turns of wire WD thick, insulation
+// included, wound close with mean diameter D and length H, from the theoretical
+// current sheet inductance and Nagaoka's coefficient less Rosa's round wire corrections.
+float solenoid( float D, float N, float H, float WD );
+double solenoidPrecise( double D, double N, double H, double WD );
+
+// Returns the inductance of a flat spiral primary with inner radius RI and N turns
+// spaced S apart, from Wheeler's empirical formula.
+float spiral( float RI, float S, float N );
+
+// Calculate the output parameters of each stage of a coil from its inputs.
+// The stages must run in the order NST, PTC, SEC, TOP, PRI; calculate() runs all of them.
+void calculateNST( Coil* c );
+void calculatePTC( Coil* c );
+void calculateSEC( Coil* c );
+void calculateTOP( Coil* c );
+void calculatePRI( Coil* c );
+void calculate( Coil* c );
+
+// Calculate every output parameter of a coil in double precision, rounding
+// each to a float once every one has been calculated. calculate() does so
+// when precision is DOUBLE.
+void calculatePrecise( Coil* c );
+
+// Recalculate only the output parameters of a calculated design that depend
+// on the parameters in changed, a mask of positions within registry.
+// In DOUBLE precision the whole design is calculated again.
+void recalculate( Coil* c, uint64_t changed );
+
+// Return the mask of the parameters named in a space or comma separated list,
+// or 0 if any of them is not valid.
+uint64_t parameterMask( char* names );
+
+// Return the mask of every output parameter calculated, directly or not, from
+// the parameters in mask, or of every parameter they are calculated from.
+uint64_t dependents( uint64_t mask );
+uint64_t dependencies( uint64_t mask );
+
+// Return the mask of every output parameter calculated from the parameters in mask alone.
+uint64_t determined( uint64_t mask );
+
+// Calculate every output parameter of c outside known, taking those in known
+// as already calculated from its inputs. In DOUBLE precision the whole design is calculated again.
+void complete( Coil* c, uint64_t known );
+
+// Return the position within registry of the parameter whose name is the
+// length bytes at name, or -1 if there is none.
+int lookup( const char* name, size_t length );
+
+// Return the storage of the named input parameter, or NULL if there is none.
+float* parameter( Coil* c, char* param );
+
+// Return the storage of the named input or output parameter, or NULL if there is none.
+float* column( Coil* c, char* param );
+
+// Parse settings from external file, echoing each parameter to echo unless it is NULL.
+int parseSettings( Coil* c, char* file, FILE* echo );
+int parseParameter( Coil* c, char* param, float value, FILE* echo );
+
+// Parse every design in a file of settings in which blank lines separate one
+// design from the next, such as the output of TeslaDump. Each design starts
+// from base, output parameters are skipped, and design is called with each in
+// turn. Returns the number of designs parsed, or -1 if the file cannot be read.
+long parseDesigns( char* file, Coil* base, void (*design)( Coil* c, void* arg ), void* arg );
+
+// Write settings to external file.
+int writeSettings( Coil* c, char* file );
+void writeParameter( FILE* file, char* param, float value );
+
+// Write every parameter of a design as a single tab separated line.
+void writeHeader( FILE* file );
+void writeRecord( FILE* file, Coil* c );
+
+// Format the line written by writeRecord into buffer, returning its length.
+// The buffer must hold at least 16 bytes per parameter.
+int formatRecord( char* buffer, Coil* c );
+
+// Format value into buffer exactly as printf's %e would, returning its length.
+// Values are scaled in double precision, which is exact wherever a float can
+// round either way, and an order of magnitude faster than printf.
+int formatFloat( char* buffer, float value );
+
+static void linkGraph();
+
+void constants()
+{
+
+	int i;
+
+	PI  = 3.1415926535897932384626433832795;
+	PHI = 0.5 * ( 1.0 + sqrt(5.0) );
+	C0  = 299792458;
+	U0  = 4.0e-7 * PI;
+	E0  = 1.0 / ( U0*C0*C0 );
+
+	for ( i = 0; i < 128; i++ ) scale[i] = pow( 10.0, i - 64 );
+
+	for ( i = 0; i <= NAGAOKA_TABLE; i++ ) nagaokaTable[i][0] = nagaokaExact( (double)i / NAGAOKA_TABLE );
+	for ( i = 0; i <= NAGAOKA_TABLE; i++ )
+		nagaokaTable[i][1] = i < NAGAOKA_TABLE ? nagaokaTable[i+1][0] - nagaokaTable[i][0] : 0.0;
+
+	linkGraph();
+
+}
+
+float WG( float WD ) { return -39.0 * log10( WD / 0.000127 ) / log10( 92.0 ) + 36.0; }
+
+int inductanceModel( char* name )
+{
+
+	if ( strcmp( name, "wheeler" ) == 0 ) inductance = WHEELER;
+	else if ( strcmp( name, "nagaoka" ) == 0 ) inductance = NAGAOKA;
+	else return 1;
+	return 0;
+
+}
+
+int precisionModel( char* name )
+{
+
+	if ( strcmp( name, "float" ) == 0 ) precision = SINGLE;
+	else if ( strcmp( name, "double" ) == 0 ) precision = DOUBLE;
+	else return 1;
+	return 0;
+
+}
+
+// Linear interpolation keeps within 1.2e-7 of nagaokaExact() for k <= 0.7 (SECHD >= 1),
+// 9.0e-7 for k <= 0.95 (SECHD >= 0.33) and 2.0e-5 for k <= 0.99 (SECHD >= 0.14),
+// where the slope of the coefficient grows without bound.
+float nagaoka( float k )
+{
+
+	float x = k * NAGAOKA_TABLE;
+	int i;
+
+	// Ratios off the table, or NaN, take its nearest end.
+	x = !( x > 0.0f ) ? 0.0f : x < NAGAOKA_TABLE ? x : NAGAOKA_TABLE;
+	i = x;
+	return nagaokaTable[i][0] + ( x - i ) * nagaokaTable[i][1];
+
+}
+
+// Complete elliptic integrals of the first and second kind K and E by the
+// arithmetic-geometric mean, giving Nagaoka's coefficient
+// 4 / ( 3 PI k' ) * ( k'^2 / k^2 * ( K - E ) + E - k ).
+double nagaokaExact( double k )
+{
+
+	double a = 1.0, b, c, t, K, E, sum, power = 0.5, q;
+	int i;
+
+	if ( k <= 0.0 ) return 1.0;
+	if ( k >= 1.0 ) return 0.0;
+	q = sqrt( 1.0 - k * k );
+	b = q;
+	c = k;
+	sum = power * c * c;
+	for ( i = 0; i < 16 && fabs( c ) > 1.0e-16 * a; i++ )
+	{
+
+		c = 0.5 * ( a - b );
+		t = 0.5 * ( a + b );
+		b = sqrt( a * b );
+		a = t;
+		power *= 2.0;
+		sum += power * c * c;
+
+	}
+	K = PI / ( 2.0 * a );
+	E = K * ( 1.0 - sum );
+
+	// K - E is K times the sum, which keeps long coils free of cancellation.
+	return 4.0 / ( 3.0 * PI * q ) * ( q * q / ( k * k ) * K * sum + E - k );
+
+}
+
+// Rosa's corrections for round wire spaced WD apart: ks for the self-inductance
+// of each turn and km for the mutual inductance between turns.
+float solenoid( float D, float N, float H, float WD )
+{
+
+	float k  = D / sqrtf( D*D + H*H ), n = 1.0f / N;
+	float ks = 1.25f - logf( 2.0f * WD / ( WD - 3.55600e-5f ) );
+	float km = 0.33787707f - n * ( logf( N ) * ( 1.0f/6.0f ) + 0.33084236f + n*n * ( 1.0f/120.0f ) );
+
+	return (float)( 0.25*PI*U0 ) * N*N*D*D/H * nagaoka( k ) - (float)( 0.5*U0 ) * D*N*( ks + km );
+
+}
+
+// The coefficient is evaluated directly rather than interpolated from the table.
+double solenoidPrecise( double D, double N, double H, double WD )
+{
+
+	double k  = D / sqrt( D*D + H*H ), n = 1.0 / N;
+	double ks = 1.25 - log( 2.0 * WD / ( WD - 3.55600e-5 ) );
+	double km = 0.33787707 - n * ( log( N ) / 6.0 + 0.33084236 + n*n / 120.0 );
+
+	return 0.25*PI*U0 * N*N*D*D/H * nagaokaExact( k ) - 0.5*U0 * D*N*( ks + km );
+
+}
+
+// Mean radius and width of the winding in inches, giving microhenries.
+// Accurate to within 1% for spirals wider than a fifth of their mean radius.
+float spiral( float RI, float S, float N )
+{
+
+	double R = ( RI + 0.5 * N * S ) / 0.0254, W = N * S / 0.0254;
+	return R * R * N * N / ( 8.0 * R + 11.0 * W ) * 1.0e-6;
+
+}
+
+// Every formula is compiled from Nodes.c once for designs held in floats,
+// giving calculateNST() and the other stages, and once for designs held in
+// doubles, giving preciseNST() and the others.
+#define REAL            float
+#define DESIGN          Coil
+#define NODE( name )    node##name
+#define STAGE( name )   calculate##name
+#define WIRE            WD
+#define SELF            medhurst
+#define SOLENOID        solenoid
+#include "Nodes.c"
+#undef REAL
+#undef DESIGN
+#undef NODE
+#undef STAGE
+#undef WIRE
+#undef SELF
+#undef SOLENOID
+
+#define REAL            double
+#define DESIGN          Precise
+#define NODE( name )    nodePrecise##name
+#define STAGE( name )   precise##name
+#define WIRE            WDprecise
+#define SELF            medhurstPrecise
+#define SOLENOID        solenoidPrecise
+#include "Nodes.c"
+#undef REAL
+#undef DESIGN
+#undef NODE
+#undef STAGE
+#undef WIRE
+#undef SELF
+#undef SOLENOID
+
+// Holds a node of the dependency graph of the output parameters.
+//  - name:  Name of the output parameter the node calculates.
+//  - run:   Calculates the output parameter.
+//  - reads: Names of the parameters the output is calculated from.
+//  - in:    Mask of the parameters read, by position within registry.
+//  - out:   Mask of the output parameter.
+typedef struct
+{
+
+	char* name;
+	void (*run)( Coil* c );
+	char* reads;
+	uint64_t in, out;
+
+} Node;
+
+// Every node of the dependency graph, each after every node it reads from.
+static Node graph[] =
+{
+
+	{ "NSTTR",  nodeNSTTR,  "NSTVO NSTVI"             },
+	{ "NSTVA",  nodeNSTVA,  "NSTVO NSTIO"             },
+	{ "NSTII",  nodeNSTII,  "NSTVA NSTVI"             },
+	{ "NSTPF",  nodeNSTPF,  "NSTVA NSTF NSTVI"        },
+	{ "NSTVIP", nodeNSTVIP, "NSTVI"                   },
+	{ "NSTIIP", nodeNSTIIP, "NSTII"                   },
+	{ "NSTVOP", nodeNSTVOP, "NSTVO"                   },
+	{ "NSTIOP", nodeNSTIOP, "NSTIO"                   },
+	{ "NSTR",   nodeNSTR,   "NSTRS NSTRP NSTTR"       },
+	{ "NSTZ",   nodeNSTZ,   "NSTVO NSTIO NSTR"        },
+	{ "ARCLN",  nodeARCLN,  "NSTVA"                   },
+	{ "PTCC",   nodePTCC,   "NSTF NSTZ"               },
+	{ "LTRCS",  nodeLTRCS,  "PTCC"                    },
+	{ "LTRCR",  nodeLTRCR,  "PTCC"                    },
+	{ "SECWD",  nodeSECWD,  "SECWG"                   },
+	{ "SECN",   nodeSECN,   "SECH SECWD"              },
+	{ "SECLN",  nodeSECLN,  "SECN SECD SECWD"         },
+	{ "SECL",   nodeSECL,   "SECN SECD SECWD SECH"    },
+	{ "SECC",   nodeSECC,   "SECD SECH"               },
+	{ "SECHD",  nodeSECHD,  "SECH SECD SECWD"         },
+	{ "TOPC",   nodeTOPC,   "TOPD"                    },
+	{ "SECF",   nodeSECF,   "SECL SECC TOPC"          },
+	{ "PRIWD",  nodePRIWD,  "PRIWG"                   },
+	{ "PRIRO",  nodePRIRO,  "PRIRI PRIN PRIS"         },
+	{ "PRIF",   nodePRIF,   "SECF"                    },
+	{ "PTCCR",  nodePTCCR,  "PRIF LTRCS"              },
+	{ "PRILR",  nodePRILR,  "PTCCR"                   },
+	{ "PRIL",   nodePRIL,   "PRILR PRIF"              },
+	{ "PRILN",  nodePRILN,  "PRIN PRIS"               }
+
+};
+#define NODES ( sizeof graph / sizeof *graph )
+
+// Link every node of the dependency graph to the parameters it reads.
+static void linkGraph()
+{
+
+	char reads[64];
+	int i;
+
+	for ( i = 0; i < (int)NODES; i++ )
+	{
+
+		strcpy( reads, graph[i].reads );
+		graph[i].in  = parameterMask( reads );
+		graph[i].out = 1ULL << lookup( graph[i].name, strlen( graph[i].name ) );
+
+	}
+
+}
+
+void calculate( Coil* c )
+{
+
+	if ( precision == DOUBLE ) { calculatePrecise( c ); return; }
+
+	calculateNST( c );
+	calculatePTC( c );
+	calculateSEC( c );
+	calculateTOP( c );
+	calculatePRI( c );
+
+}
+
+int lookup( const char* name, size_t length )
+{
+
+	uint64_t key = 0;
+	const char* known;
+	size_t j;
+	int i;
+
+	if ( length == 0 || length > sizeof key ) return -1;
+	for ( j = 0; j < length; j++ ) key |= (uint64_t)(unsigned char)name[j] << ( 8 * j );
+	if ( ( i = registrySlot[( key * REGISTRY_HASH ) >> 57] ) < 0 ) return -1;
+
+	// Names are distinct in their first eight bytes, so one pass confirms the match.
+	for ( known = registry[i].name, j = 0; j < length; j++ )
+		if ( known[j] != name[j] ) return -1;
+
+	return known[length] == '\0' ? i : -1;
+
+}
+
+void calculatePrecise( Coil* c )
+{
+
+	Precise p;
+	int i;
+
+	for ( i = 0; i < PARAMETERS; i++ )
+		*(double*)( (char*)&p + 2 * registry[i].offset ) = *(float*)( (char*)c + registry[i].offset );
+
+	preciseNST( &p );
+	precisePTC( &p );
+	preciseSEC( &p );
+	preciseTOP( &p );
+	precisePRI( &p );
+
+	for ( i = 0; i < PARAMETERS; i++ )
+		*(float*)( (char*)c + registry[i].offset ) = *(double*)( (char*)&p + 2 * registry[i].offset );
+
+}
+
+void recalculate( Coil* c, uint64_t changed )
+{
+
+	int i;
+
+	if ( precision == DOUBLE ) { calculatePrecise( c ); return; }
+
+	for ( i = 0; i < (int)NODES; i++ )
+		if ( graph[i].in & changed )
+		{
+
+			graph[i].run( c );
+			changed |= graph[i].out;
+
+		}
+
+}
+
+uint64_t parameterMask( char* names )
+{
+
+	uint64_t mask = 0;
+	char* name;
+	int i;
+
+	for ( name = strtok( names, " ," ); name; name = strtok( NULL, " ," ) )
+	{
+
+		if ( ( i = lookup( name, strlen( name ) ) ) < 0 ) return 0;
+		mask |= 1ULL << i;
+
+	}
+
+	return mask;
+
+}
+
+uint64_t dependents( uint64_t mask )
+{
+
+	uint64_t changed = mask;
+	int i;
+
+	for ( i = 0; i < (int)NODES; i++ )
+		if ( graph[i].in & changed ) changed |= graph[i].out;
+
+	return changed & ~mask;
+
+}
+
+uint64_t dependencies( uint64_t mask )
+{
+
+	uint64_t needed = mask;
+	int i;
+
+	for ( i = NODES - 1; i >= 0; i-- )
+		if ( graph[i].out & needed ) needed |= graph[i].in;
+
+	return needed & ~mask;
+
+}
+
+uint64_t determined( uint64_t mask )
+{
+
+	uint64_t known = mask;
+	int i;
+
+	for ( i = 0; i < (int)NODES; i++ )
+		if ( ( graph[i].in & ~known ) == 0 ) known |= graph[i].out;
+
+	return known & ~mask;
+
+}
+
+void complete( Coil* c, uint64_t known )
+{
+
+	int i;
+
+	if ( precision == DOUBLE ) { calculatePrecise( c ); return; }
+
+	for ( i = 0; i < (int)NODES; i++ )
+		if ( !( graph[i].out & known ) ) graph[i].run( c );
+
+}
+
+float* parameter( Coil* c, char* param )
+{
+
+	int i = lookup( param, strlen( param ) );
+	return i >= 0 && registry[i].role == INPUT ? (float*)( (char*)c + registry[i].offset ) : NULL;
+
+}
+
+float* column( Coil* c, char* param )
+{
+
+	int i = lookup( param, strlen( param ) );
+	return i >= 0 ? (float*)( (char*)c + registry[i].offset ) : NULL;
+
+}
+
+// Results of scanning a single line of a settings file.
+#define SCAN_BLANK   -1
+#define SCAN_UNKNOWN -2
+#define SCAN_INVALID -3
+
+// Parse the decimal number at p, returning the end of it or p if there is none.
+// Mantissas below 2^53 with small exponents are converted with a single
+// correctly rounded operation; anything else goes to strtof.
+static const char* scanFloat( const char* p, const char* end, float* value )
+{
+
+	static const double exact[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const char *start = p, *first, *q;
+	uint64_t digits = 0;
+	int exponent = 0, negative = 0, count;
+	unsigned d;
+
+	if ( p < end && ( *p == '-' || *p == '+' ) ) negative = *p++ == '-';
+	for ( first = p; p < end && ( d = *p - '0' ) < 10; p++ ) digits = digits * 10 + d;
+	count = p - first;
+	if ( p < end && *p == '.' )
+		for ( p++; p < end && ( d = *p - '0' ) < 10; p++ ) digits = digits * 10 + d, exponent--, count++;
+	if ( count > 0 )
+	{
+
+		if ( p < end && ( *p == 'e' || *p == 'E' ) )
+		{
+
+			int sign = 1, e = 0;
+			q = p + 1;
+			if ( q < end && ( *q == '-' || *q == '+' ) ) sign = *q++ == '-' ? -1 : 1;
+			if ( q < end && ( d = *q - '0' ) < 10 )
+			{
+
+				for ( ; q < end && ( d = *q - '0' ) < 10; q++ ) if ( e < 10000 ) e = e * 10 + d;
+				exponent += sign * e;
+				p = q;
+
+			}
+
+		}
+
+		// Beyond nineteen digits the mantissa may have overflowed.
+		if ( count <= 19 && digits <= 1ULL << 53 && exponent >= -22 && exponent <= 22 )
+		{
+
+			double v = exponent < 0 ? digits / exact[-exponent] : digits * exact[exponent];
+			*value = negative ? -v : v;
+			return p;
+
+		}
+
+	}
+
+	// Leave anything unusual, such as inf and nan, to the C library.
+	{
+
+		char buffer[64], *stop;
+		size_t length = 0;
+		while ( start + length < end && length + 1 < sizeof buffer && !strchr( " \t\r\n", start[length] ) ) length++;
+		memcpy( buffer, start, length );
+		buffer[length] = '\0';
+		*value = strtof( buffer, &stop );
+		return start + ( stop - buffer );
+
+	}
+
+}
+
+// Scan the line of settings starting at p, returning the start of the next line.
+// Sets index to the position of its parameter within registry or to one of the
+// SCAN results, and name and length to the key found on the line.
+static const char* scanSetting( const char* p, const char* end, int* index, float* value, const char** name, int* length )
+{
+
+	const char* q;
+
+	while ( p < end && ( *p == ' ' || *p == '\t' || *p == '\r' ) ) p++;
+	if ( p == end || *p == '\n' || *p == '#' )
+	{
+
+		*index = SCAN_BLANK;
+		q = memchr( p, '\n', end - p );
+		return q ? q + 1 : end;
+
+	}
+
+	for ( *name = p; p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n'; p++ );
+	*length = p - *name;
+	*index = lookup( *name, *length );
+	if ( *index < 0 ) *index = SCAN_UNKNOWN;
+
+	while ( p < end && ( *p == ' ' || *p == '\t' ) ) p++;
+	if ( *index >= 0 && ( ( q = scanFloat( p, end, value ) ) == p
+		|| ( q < end && *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n' ) ) ) *index = SCAN_INVALID;
+
+	q = memchr( p, '\n', end - p );
+	return q ? q + 1 : end;
+
+}
+
+// Map a settings file into memory, returning NULL if it cannot be read.
+static const char* mapSettings( char* file, size_t* size )
+{
+
+	struct stat st;
+	const char* map;
+	int fd = open( file, O_RDONLY );
+
+	if ( fd < 0 || fstat( fd, &st ) != 0 )
+	{
+
+		fprintf(stderr, "Cannot open %s for parsing!\n", file);
+		if ( fd >= 0 ) close( fd );
+		return NULL;
+
+	}
+
+	*size = st.st_size;
+	map = *size ? mmap( NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0 ) : "";
+	close( fd );
+	if ( map == MAP_FAILED )
+	{
+
+		fprintf(stderr, "Cannot map %s!\n", file);
+		return NULL;
+
+	}
+	if ( *size ) madvise( (void*)map, *size, MADV_SEQUENTIAL );
+
+	return map;
+
+}
+
+int parseSettings( Coil* c, char* file, FILE* echo )
+{
+
+	size_t size;
+	const char *map = mapSettings( file, &size ), *p, *name;
+	float value = 0.0;
+	int index, length;
+
+	if ( !map ) return 1;
+
+	for ( p = map; p < map + size; )
+	{
+
+		p = scanSetting( p, map + size, &index, &value, &name, &length );
+		if ( index == SCAN_BLANK ) continue;
+
+		// Outputs are recalculated, so only inputs are valid settings.
+		if ( index == SCAN_INVALID )
+			fprintf(stderr, "  %.*s not valid value.\n", length, name);
+		else if ( index == SCAN_UNKNOWN || registry[index].role != INPUT )
+			fprintf(stderr, "  %.*s not valid parameter.\n", length, name);
+		else
+		{
+
+			*(float*)( (char*)c + registry[index].offset ) = value;
+			if ( echo ) fprintf(echo, "  %s  \t%e\n", registry[index].name, value);
+
+		}
+
+	}
+
+	if ( size ) munmap( (void*)map, size );
+	return 0;
+
+}
+
+int parseParameter( Coil* c, char* param, float value, FILE* echo )
+{
+
+	float* field = parameter( c, param );
+
+	if ( !field )
+	{
+
+		fprintf(stderr, "  %s not valid parameter.\n", param);
+		return 1;
+
+	}
+
+	*field = value;
+	if ( echo ) fprintf(echo, "  %s  	%e\n", param, value);
+	return 0;
+
+}
+
+long parseDesigns( char* file, Coil* base, void (*design)( Coil* c, void* arg ), void* arg )
+{
+
+	size_t size;
+	const char *map = mapSettings( file, &size ), *p, *name;
+	long designs = 0, line = 0;
+	int index, length, pending = 0;
+	float value = 0.0;
+	Coil c = *base;
+
+	if ( !map ) return -1;
+
+	for ( p = map; p < map + size; )
+	{
+
+		p = scanSetting( p, map + size, &index, &value, &name, &length );
+		line++;
+		if ( index >= 0 )
+		{
+
+			if ( registry[index].role == INPUT ) *(float*)( (char*)&c + registry[index].offset ) = value;
+			pending = 1;
+
+		}
+		else if ( index == SCAN_BLANK && pending )
+		{
+
+			design( &c, arg );
+			designs++;
+			c = *base;
+			pending = 0;
+
+		}
+		else if ( index != SCAN_BLANK )
+			fprintf(stderr, "  %.*s not valid %s on line %ld.\n", length, name,
+				index == SCAN_UNKNOWN ? "parameter" : "value", line);
+
+	}
+	if ( pending )
+	{
+
+		design( &c, arg );
+		designs++;
+
+	}
+
+	if ( size ) munmap( (void*)map, size );
+	return designs;
+
+}
+
+int writeSettings( Coil* c, char* file )
+{
+
+	FILE* settings = fopen( file, "w" );
+	int i;
+
+	if ( !settings )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", file);
+		return 1;
+
+	}
+	else
+	{
+
+		for ( i = 0; i < PARAMETERS; i++ )
+			writeParameter( settings, registry[i].name, *(float*)( (char*)c + registry[i].offset ) );
+
+		fclose( settings );
+
+		return 0;
+
+	}
+
+}
+
+void writeParameter( FILE* file, char* param, float value )
+{
+
+		fprintf( file, "%s	%e\n", param, value );
+		printf( "  %s  	%e\n", param, value );
+
+}
+
+void writeHeader( FILE* file )
+{
+
+	int i;
+
+	for ( i = 0; i < PARAMETERS; i++ )
+		fprintf( file, i ? "\t%s" : "%s", registry[i].name );
+	fprintf( file, "\n" );
+
+}
+
+void writeRecord( FILE* file, Coil* c )
+{
+
+	char buffer[16*PARAMETERS];
+	fwrite( buffer, 1, formatRecord( buffer, c ), file );
+
+}
+
+int formatRecord( char* buffer, Coil* c )
+{
+
+	char* p = buffer;
+	int i;
+
+	for ( i = 0; i < PARAMETERS; i++ )
+	{
+
+		if ( i ) *p++ = '\t';
+		p += formatFloat( p, *(float*)( (char*)c + registry[i].offset ) );
+
+	}
+	*p++ = '\n';
+
+	return p - buffer;
+
+}
+
+// Return value scaled to seven significant digits for a decimal exponent e.
+static long digitsOf( double value, int e ) { return e > 6 ? rint( value / scale[64+e-6] ) : rint( value * scale[64+6-e] ); }
+
+int formatFloat( char* buffer, float value )
+{
+
+	char* p = buffer;
+	double a = value;
+	long digits = 0;
+	int e = 0, i;
+
+	if ( signbit( value ) ) { *p++ = '-'; a = -a; }
+	if ( isnan( value ) ) { memcpy( p, "nan", 3 ); return p + 3 - buffer; }
+	if ( isinf( value ) ) { memcpy( p, "inf", 3 ); return p + 3 - buffer; }
+
+	// Find the exponent, correcting log10 where it lands on the wrong side of a power of ten.
+	if ( a != 0.0 )
+	{
+
+		e = floor( log10( a ) );
+		digits = digitsOf( a, e );
+		if ( digits >= 10000000 ) digits = digitsOf( a, ++e );
+		else if ( digits < 1000000 ) digits = digitsOf( a, --e );
+
+	}
+
+	for ( i = 7; i >= 2; i-- ) { p[i] = '0' + digits % 10; digits /= 10; }
+	p[1] = '.';
+	p[0] = '0' + digits;
+	p += 8;
+
+	*p++ = 'e';
+	*p++ = e < 0 ? '-' : '+';
+	if ( e < 0 ) e = -e;
+	if ( e >= 100 ) { *p++ = '0' + e / 100; e %= 100; }
+	*p++ = '0' + e / 10;
+	*p++ = '0' + e % 10;
+
+	return p - buffer;
+
+}
+
+#endif
@@ -0,0 +1,672 @@
+#ifndef DAEMON_C
+#define DAEMON_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "Coil.c"
+#include "Batch.c"
+#include "Cache.c"
+
+// Marks every frame passing either way through the socket ("TSQ1" in memory).
+#define DAEMON_MAGIC 0x31515354
+
+// Most designs a single frame may carry.
+#define DAEMON_BATCH 4096
+
+// Flag of a frame asking for the latency counters instead of designs.
+#define DAEMON_STATS 1
+
+// Number of latency buckets: eight to each power of two, so each is within 12.5% of its values.
+#define DAEMON_BUCKETS 512
+
+// Most events taken from the event loop at a time.
+#define DAEMON_EVENTS 64
+
+// Number of records a client packs or unpacks at a time.
+#define DAEMON_CHUNK 256
+
+// Heads every frame, followed by its records. Frames are in the byte order of
+// the host, as both ends of a Unix domain socket share it.
+//  - magic: DAEMON_MAGIC.
+//  - count: Number of records following, at most DAEMON_BATCH.
+//  - flags: DAEMON_STATS or 0, returned as given.
+//  - id:    Chosen by the client and returned as given.
+// A query frame carries count records of the INPUTS input parameters as floats,
+// in the order of parameters.dat; a NaN takes the value of the daemon's settings.
+// Its reply carries count records of all PARAMETERS parameters as floats, in the
+// order of parameters.out. A stats frame carries no records and its reply one Latency.
+typedef struct
+{
+
+	uint32_t magic, count, flags, id;
+
+} Frame;
+
+// Holds the latency counters of a daemon, measured from the moment a frame has
+// been read whole until its reply has been written, in nanoseconds.
+//  - frames:   Number of frames answered.
+//  - queries:  Number of designs calculated.
+//  - rejected: Number of connections dropped for sending a malformed frame.
+//  - p50, p99: Median and 99th percentile latency of a frame.
+//  - max:      Largest latency of a frame.
+//  - q50, q99: Median and 99th percentile of the latency of a frame shared among its designs.
+typedef struct
+{
+
+	uint64_t frames, queries, rejected, p50, p99, max, q50, q99;
+
+} Latency;
+
+// Holds a client connected to a daemon. A connection belongs to the event loop
+// until a frame has been read whole, then to one worker until it has answered.
+//  - fd:            Socket of the connection.
+//  - in:            Frame being read, with room for room bytes, have of them read.
+//  - design:        Designs of the frame, with room for designs of them.
+//  - out:           Reply to the frame, with room for space bytes.
+//  - start:         When the frame was read whole.
+//  - next:          Next connection waiting for a worker.
+//  - before, after: Neighbours among every open connection.
+typedef struct Connection
+{
+
+	int fd;
+	char* in;
+	size_t room, have;
+	Coil* design;
+	long designs;
+	char* out;
+	size_t space;
+	struct timespec start;
+	struct Connection* next;
+	struct Connection *before, *after;
+
+} Connection;
+
+// Holds a daemon serving design queries over a Unix domain socket.
+//  - base:     Values of the inputs a query leaves as NaN.
+//  - cache:    Cache of results the designs are taken from, or NULL.
+//  - path:     Path of the socket, removed once the daemon stops.
+//  - listener: Socket accepting connections.
+//  - loop:     Event loop watching the listener and every idle connection.
+//  - wake:     Event counter stopping the loop once written.
+//  - worker:   Threads answering the frames read by the loop.
+//  - waiting:  Connections holding a whole frame, first to last.
+//  - open:     Every open connection.
+//  - frame:    Number of frames answered within each latency bucket.
+//  - query:    Number of designs answered within each bucket of per design latency.
+typedef struct
+{
+
+	Coil base;
+	Cache* cache;
+	char path[sizeof ((struct sockaddr_un*)0)->sun_path];
+	int listener, loop, wake, threads, done;
+	pthread_t* worker;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	Connection *waiting, *last, *open;
+	uint64_t frames, queries, rejected, max;
+	uint64_t frame[DAEMON_BUCKETS], query[DAEMON_BUCKETS];
+
+} Daemon;
+
+// Listen on the socket at path, answering queries about designs whose missing
+// inputs come from base, with results taken from and stored in cache unless it
+// is NULL, across the given number of worker threads. Returns 0 once listening.
+int daemonOpen( Daemon* d, char* path, Coil* base, Cache* cache, int threads );
+
+// Run the event loop until daemonStop is called, then close every connection and the socket.
+int daemonRun( Daemon* d );
+
+// Stop a running daemon. Safe to call from a signal handler.
+void daemonStop( Daemon* d );
+
+// Fill l with the latency counters of the daemon so far.
+void daemonLatency( Daemon* d, Latency* l );
+
+// Connect to the daemon listening at path, returning the socket or -1.
+int daemonConnect( char* path );
+
+// Send the inputs of n designs, at most DAEMON_BATCH, to a daemon and fill in
+// every parameter of them from its reply. Returns 0 on success.
+int daemonQuery( int fd, Coil* c, int n );
+
+// Fill l with the latency counters of a daemon. Returns 0 on success.
+int daemonStats( int fd, Latency* l );
+
+// Return the bucket of a latency, and the smallest latency falling in a bucket.
+static int daemonBucket( uint64_t ns )
+{
+
+	int e;
+
+	if ( ns < 8 ) return ns;
+	e = 63 - __builtin_clzll( ns );
+	return ( e - 2 ) * 8 + ( ( ns >> ( e - 3 ) ) & 7 );
+
+}
+
+static uint64_t daemonFloor( int b )
+{
+
+	return b < 8 ? (uint64_t)b : (uint64_t)( 8 + b % 8 ) << ( b / 8 - 1 );
+
+}
+
+// Return the largest latency within the given fraction of a histogram, to the resolution of its buckets.
+static uint64_t daemonPercentile( uint64_t* bucket, double fraction )
+{
+
+	uint64_t total = 0, seen = 0;
+	int b;
+
+	for ( b = 0; b < DAEMON_BUCKETS; b++ ) total += __atomic_load_n( &bucket[b], __ATOMIC_RELAXED );
+	if ( total == 0 ) return 0;
+	for ( b = 0; b < DAEMON_BUCKETS - 1; b++ )
+		if ( ( seen += __atomic_load_n( &bucket[b], __ATOMIC_RELAXED ) ) >= fraction * total && seen ) break;
+	return daemonFloor( b + 1 ) - 1;
+
+}
+
+void daemonLatency( Daemon* d, Latency* l )
+{
+
+	l->frames   = __atomic_load_n( &d->frames, __ATOMIC_RELAXED );
+	l->queries  = __atomic_load_n( &d->queries, __ATOMIC_RELAXED );
+	l->rejected = __atomic_load_n( &d->rejected, __ATOMIC_RELAXED );
+	l->max      = __atomic_load_n( &d->max, __ATOMIC_RELAXED );
+	l->p50 = daemonPercentile( d->frame, 0.50 );
+	l->p99 = daemonPercentile( d->frame, 0.99 );
+	if ( l->p50 > l->max ) l->p50 = l->max;
+	if ( l->p99 > l->max ) l->p99 = l->max;
+	l->q50 = daemonPercentile( d->query, 0.50 );
+	l->q99 = daemonPercentile( d->query, 0.99 );
+
+}
+
+// Count the latency of a frame of count designs answered now.
+static void daemonCount( Daemon* d, Connection* c, uint32_t count )
+{
+
+	struct timespec now;
+	uint64_t ns, max;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	ns = ( now.tv_sec - c->start.tv_sec ) * 1000000000LL + ( now.tv_nsec - c->start.tv_nsec );
+	__atomic_add_fetch( &d->frames, 1, __ATOMIC_RELAXED );
+	__atomic_add_fetch( &d->frame[daemonBucket( ns )], 1, __ATOMIC_RELAXED );
+	if ( count )
+	{
+
+		__atomic_add_fetch( &d->queries, count, __ATOMIC_RELAXED );
+		__atomic_add_fetch( &d->query[daemonBucket( ns / count )], count, __ATOMIC_RELAXED );
+
+	}
+	max = __atomic_load_n( &d->max, __ATOMIC_RELAXED );
+	while ( ns > max && !__atomic_compare_exchange_n( &d->max, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
+
+}
+
+// Hand a connection back to the event loop to wait for its next frame.
+static int daemonWatch( Daemon* d, Connection* c, int op )
+{
+
+	struct epoll_event e;
+
+	e.events = EPOLLIN | EPOLLONESHOT;
+	e.data.ptr = c;
+	return epoll_ctl( d->loop, op, c->fd, &e );
+
+}
+
+static void daemonDrop( Daemon* d, Connection* c )
+{
+
+	pthread_mutex_lock( &d->lock );
+	if ( c->before ) c->before->after = c->after;
+	else d->open = c->after;
+	if ( c->after ) c->after->before = c->before;
+	pthread_mutex_unlock( &d->lock );
+
+	close( c->fd );
+	free( c->in );
+	free( c->design );
+	free( c->out );
+	free( c );
+
+}
+
+// Read what has arrived of the frame of a connection, returning 1 once it is
+// whole, 0 if more is yet to come and -1 if the connection is to be dropped.
+static int daemonRead( Daemon* d, Connection* c )
+{
+
+	Frame* f;
+	size_t need;
+	ssize_t got;
+
+	if ( !c->in )
+	{
+
+		if ( !( c->in = malloc( sizeof( Frame ) ) ) ) return -1;
+		c->room = sizeof( Frame );
+
+	}
+
+	for ( ;; )
+	{
+
+		f = (Frame*)c->in;
+		need = sizeof( Frame );
+		if ( c->have >= need )
+		{
+
+			if ( f->magic != DAEMON_MAGIC || f->count > DAEMON_BATCH || ( f->flags & ~DAEMON_STATS )
+				|| ( ( f->flags & DAEMON_STATS ) && f->count ) )
+			{
+
+				__atomic_add_fetch( &d->rejected, 1, __ATOMIC_RELAXED );
+				return -1;
+
+			}
+			need += (size_t)f->count * INPUTS * sizeof( float );
+			if ( need > c->room )
+			{
+
+				char* grown = realloc( c->in, need );
+				if ( !grown ) return -1;
+				c->in = grown;
+				c->room = need;
+
+			}
+			if ( c->have == need ) break;
+
+		}
+
+		got = read( c->fd, c->in + c->have, need - c->have );
+		if ( got > 0 ) c->have += got;
+		else if ( got < 0 && errno == EINTR ) continue;
+		else if ( got < 0 && errno == EAGAIN ) return 0;
+		else return -1;
+
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &c->start );
+	return 1;
+
+}
+
+// Write the whole of a buffer to a non-blocking socket, waiting while it is full.
+static int daemonSend( int fd, char* p, size_t n )
+{
+
+	struct pollfd w = { fd, POLLOUT, 0 };
+	ssize_t put;
+
+	while ( n > 0 )
+	{
+
+		put = send( fd, p, n, MSG_NOSIGNAL );
+		if ( put > 0 ) { p += put; n -= put; }
+		else if ( put < 0 && errno == EAGAIN ) poll( &w, 1, -1 );
+		else if ( put < 0 && errno != EINTR ) return -1;
+
+	}
+	return 0;
+
+}
+
+// Answer the whole frame read by a connection.
+static int daemonAnswer( Daemon* d, Connection* c )
+{
+
+	Frame* f = (Frame*)c->in;
+	float* in = (float*)( c->in + sizeof( Frame ) );
+	size_t need;
+	float* out;
+	long i;
+	int j;
+
+	need = sizeof( Frame ) + ( f->flags & DAEMON_STATS ? sizeof( Latency ) : (size_t)f->count * PARAMETERS * sizeof( float ) );
+	if ( need > c->space )
+	{
+
+		char* grown = realloc( c->out, need );
+		if ( !grown ) return -1;
+		c->out = grown;
+		c->space = need;
+
+	}
+	*(Frame*)c->out = *f;
+	out = (float*)( c->out + sizeof( Frame ) );
+
+	if ( f->flags & DAEMON_STATS ) daemonLatency( d, (Latency*)out );
+	else if ( f->count )
+	{
+
+		if ( f->count > c->designs )
+		{
+
+			Coil* grown = realloc( c->design, f->count * sizeof( Coil ) );
+			if ( !grown ) return -1;
+			c->design = grown;
+			c->designs = f->count;
+
+		}
+
+		for ( i = 0; i < f->count; i++, in += INPUTS )
+		{
+
+			c->design[i] = d->base;
+			for ( j = 0; j < INPUTS; j++ )
+				if ( !isnan( in[j] ) ) *(float*)( (char*)&c->design[i] + registry[inputColumn[j]].offset ) = in[j];
+
+		}
+
+		if ( d->cache ) cacheCoils( d->cache, c->design, f->count );
+		else batchCoils( c->design, f->count );
+
+		for ( i = 0; i < f->count; i++ )
+			for ( j = 0; j < PARAMETERS; j++ )
+				*out++ = *(float*)( (char*)&c->design[i] + registry[j].offset );
+
+	}
+
+	if ( daemonSend( c->fd, c->out, need ) ) return -1;
+	daemonCount( d, c, f->count );
+	c->have = 0;
+	return 0;
+
+}
+
+// Answer the frames of connections handed over by the event loop until the daemon stops.
+static void* daemonWorker( void* arg )
+{
+
+	Daemon* d = arg;
+	Connection* c;
+
+	for ( ;; )
+	{
+
+		pthread_mutex_lock( &d->lock );
+		while ( !d->waiting && !d->done ) pthread_cond_wait( &d->ready, &d->lock );
+		if ( !( c = d->waiting ) )
+		{
+
+			pthread_mutex_unlock( &d->lock );
+			return NULL;
+
+		}
+		if ( !( d->waiting = c->next ) ) d->last = NULL;
+		pthread_mutex_unlock( &d->lock );
+
+		if ( daemonAnswer( d, c ) || daemonWatch( d, c, EPOLL_CTL_MOD ) ) daemonDrop( d, c );
+
+	}
+
+}
+
+int daemonOpen( Daemon* d, char* path, Coil* base, Cache* cache, int threads )
+{
+
+	struct sockaddr_un a;
+	struct epoll_event e;
+	int t;
+
+	memset( d, 0, sizeof *d );
+	d->base = *base;
+	d->cache = cache;
+	d->threads = threads > 0 ? threads : 1;
+	if ( strlen( path ) >= sizeof d->path )
+	{
+
+		fprintf(stderr, "  %s is too long for a socket path.\n", path);
+		return 1;
+
+	}
+	strcpy( d->path, path );
+
+	memset( &a, 0, sizeof a );
+	a.sun_family = AF_UNIX;
+	strcpy( a.sun_path, path );
+
+	// A socket left behind by a daemon that did not stop cleanly is replaced.
+	unlink( path );
+	if ( ( d->listener = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 ) ) < 0
+		|| bind( d->listener, (struct sockaddr*)&a, sizeof a ) || listen( d->listener, SOMAXCONN ) )
+	{
+
+		fprintf(stderr, "Cannot listen on %s: %s\n", path, strerror( errno ));
+		if ( d->listener >= 0 ) close( d->listener );
+		return 1;
+
+	}
+
+	d->loop = epoll_create1( EPOLL_CLOEXEC );
+	d->wake = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	e.events = EPOLLIN;
+	e.data.ptr = &d->listener;
+	epoll_ctl( d->loop, EPOLL_CTL_ADD, d->listener, &e );
+	e.data.ptr = &d->wake;
+	epoll_ctl( d->loop, EPOLL_CTL_ADD, d->wake, &e );
+
+	pthread_mutex_init( &d->lock, NULL );
+	pthread_cond_init( &d->ready, NULL );
+	d->worker = malloc( d->threads * sizeof *d->worker );
+	for ( t = 0; t < d->threads; t++ )
+		if ( pthread_create( &d->worker[t], NULL, daemonWorker, d ) ) break;
+
+	// With no workers at all there is nothing to answer frames.
+	if ( ( d->threads = t ) == 0 )
+	{
+
+		fprintf(stderr, "Cannot start the worker threads!\n");
+		close( d->wake );
+		close( d->loop );
+		close( d->listener );
+		unlink( path );
+		free( d->worker );
+		return 1;
+
+	}
+	return 0;
+
+}
+
+// Accept every pending connection and watch it for frames.
+static void daemonAccept( Daemon* d )
+{
+
+	Connection* c;
+	int fd;
+
+	while ( ( fd = accept( d->listener, NULL, NULL ) ) >= 0 )
+	{
+
+		fcntl( fd, F_SETFL, O_NONBLOCK );
+		fcntl( fd, F_SETFD, FD_CLOEXEC );
+		if ( !( c = calloc( 1, sizeof *c ) ) ) { close( fd ); continue; }
+		c->fd = fd;
+
+		pthread_mutex_lock( &d->lock );
+		if ( ( c->after = d->open ) ) c->after->before = c;
+		d->open = c;
+		pthread_mutex_unlock( &d->lock );
+
+		if ( daemonWatch( d, c, EPOLL_CTL_ADD ) ) daemonDrop( d, c );
+
+	}
+
+}
+
+int daemonRun( Daemon* d )
+{
+
+	struct epoll_event e[DAEMON_EVENTS];
+	Connection* c;
+	int stop = 0, n, i, r;
+
+	while ( !stop )
+	{
+
+		if ( ( n = epoll_wait( d->loop, e, DAEMON_EVENTS, -1 ) ) < 0 )
+		{
+
+			if ( errno == EINTR ) continue;
+			break;
+
+		}
+
+		for ( i = 0; i < n; i++ )
+		{
+
+			if ( e[i].data.ptr == &d->wake ) { stop = 1; continue; }
+			if ( e[i].data.ptr == &d->listener ) { daemonAccept( d ); continue; }
+
+			// A connection stays out of the loop from here until its frame is answered.
+			c = e[i].data.ptr;
+			if ( ( r = daemonRead( d, c ) ) < 0 ) daemonDrop( d, c );
+			else if ( r == 0 ) { if ( daemonWatch( d, c, EPOLL_CTL_MOD ) ) daemonDrop( d, c ); }
+			else
+			{
+
+				pthread_mutex_lock( &d->lock );
+				c->next = NULL;
+				if ( d->last ) d->last->next = c;
+				else d->waiting = c;
+				d->last = c;
+				pthread_cond_signal( &d->ready );
+				pthread_mutex_unlock( &d->lock );
+
+			}
+
+		}
+
+	}
+
+	// Let the workers answer what they hold, then close whatever is left.
+	pthread_mutex_lock( &d->lock );
+	d->done = 1;
+	pthread_cond_broadcast( &d->ready );
+	pthread_mutex_unlock( &d->lock );
+	for ( i = 0; i < d->threads; i++ ) pthread_join( d->worker[i], NULL );
+	while ( d->open ) daemonDrop( d, d->open );
+
+	close( d->wake );
+	close( d->loop );
+	close( d->listener );
+	unlink( d->path );
+	free( d->worker );
+	pthread_cond_destroy( &d->ready );
+	pthread_mutex_destroy( &d->lock );
+	return stop ? 0 : -1;
+
+}
+
+void daemonStop( Daemon* d )
+{
+
+	uint64_t one = 1;
+	ssize_t put = write( d->wake, &one, sizeof one );
+	(void)put;
+
+}
+
+// Read or write the whole of a buffer on a blocking socket.
+static int daemonWhole( int fd, void* p, size_t n, int writing )
+{
+
+	ssize_t done;
+
+	while ( n > 0 )
+	{
+
+		done = writing ? send( fd, p, n, MSG_NOSIGNAL ) : recv( fd, p, n, 0 );
+		if ( done > 0 ) { p = (char*)p + done; n -= done; }
+		else if ( done < 0 && errno == EINTR ) continue;
+		else return -1;
+
+	}
+	return 0;
+
+}
+
+int daemonConnect( char* path )
+{
+
+	struct sockaddr_un a;
+	int fd;
+
+	memset( &a, 0, sizeof a );
+	a.sun_family = AF_UNIX;
+	if ( strlen( path ) >= sizeof a.sun_path ) return -1;
+	strcpy( a.sun_path, path );
+	if ( ( fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) < 0 ) return -1;
+	if ( connect( fd, (struct sockaddr*)&a, sizeof a ) ) { close( fd ); return -1; }
+	return fd;
+
+}
+
+int daemonQuery( int fd, Coil* c, int n )
+{
+
+	float buffer[DAEMON_CHUNK*PARAMETERS];
+	Frame f = { DAEMON_MAGIC, n, 0, 0 };
+	float* p;
+	int i, j, k, m;
+
+	if ( n < 0 || n > DAEMON_BATCH || daemonWhole( fd, &f, sizeof f, 1 ) ) return -1;
+
+	// The records pass through a buffer on the stack a chunk at a time each way.
+	for ( i = 0; i < n; i += m )
+	{
+
+		m = n - i < DAEMON_CHUNK ? n - i : DAEMON_CHUNK;
+		for ( p = buffer, k = i; k < i + m; k++ )
+			for ( j = 0; j < INPUTS; j++ )
+				*p++ = *(float*)( (char*)&c[k] + registry[inputColumn[j]].offset );
+		if ( daemonWhole( fd, buffer, (size_t)m * INPUTS * sizeof( float ), 1 ) ) return -1;
+
+	}
+
+	if ( daemonWhole( fd, &f, sizeof f, 0 ) || f.magic != DAEMON_MAGIC || f.count != (uint32_t)n ) return -1;
+	for ( i = 0; i < n; i += m )
+	{
+
+		m = n - i < DAEMON_CHUNK ? n - i : DAEMON_CHUNK;
+		if ( daemonWhole( fd, buffer, (size_t)m * PARAMETERS * sizeof( float ), 0 ) ) return -1;
+		for ( p = buffer, k = i; k < i + m; k++ )
+			for ( j = 0; j < PARAMETERS; j++ )
+				*(float*)( (char*)&c[k] + registry[j].offset ) = *p++;
+
+	}
+	return 0;
+
+}
+
+int daemonStats( int fd, Latency* l )
+{
+
+	Frame f = { DAEMON_MAGIC, 0, DAEMON_STATS, 0 };
+
+	if ( daemonWhole( fd, &f, sizeof f, 1 ) || daemonWhole( fd, &f, sizeof f, 0 )
+		|| f.magic != DAEMON_MAGIC || !( f.flags & DAEMON_STATS ) ) return -1;
+	return daemonWhole( fd, l, sizeof *l, 0 );
+
+}
+
+#endif
@@ -0,0 +1,476 @@
+#ifndef FILAMENT_C
+#define FILAMENT_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <immintrin.h>
+#include "Coil.c"
+
+// Number of filaments of the coil being summed over held in cache at a time,
+// their radius, height and turns filling 12KB.
+#define FILAMENT_BLOCK 512
+
+// Number of steps of the arithmetic geometric mean behind the elliptic
+// integrals, enough for filaments a thousandth of their radius apart.
+#define AGM_STEPS 7
+
+// Holds a coil discretized into coaxial circular filaments, each standing for
+// a band of the current sheet the turns of the coil make up.
+//  - n:    Number of filaments.
+//  - r:    Radius of each filament in meters.
+//  - z:    Height of each filament above the plane of the primary in meters.
+//  - w:    Turns each filament stands for.
+//  - self: Inductance of a single turn of each band on its own in henries.
+typedef struct
+{
+
+	int n;
+	double *r, *z, *w, *self;
+
+} Rings;
+
+// Holds a primary spiral and secondary solenoid discretized into filaments, and
+// the inductances summed over every pair of them.
+//  - primary:   Filaments of the primary from its inner end outwards.
+//  - secondary: Filaments of the secondary from its bottom upwards.
+//  - L:         Inductance of the primary tapped after each of its first 0 to n filaments.
+//  - M:         Mutual inductance of the secondary with the primary tapped after each.
+//  - Ls:        Inductance of the secondary.
+typedef struct
+{
+
+	Rings primary, secondary;
+	double *L, *M, Ls;
+
+} Filaments;
+
+// Discretize the primary and secondary of a calculated design into the given
+// numbers of filaments, with the bottom of the secondary winding offset above
+// the plane of the primary. Returns 1 if the coils overlap or cannot be held.
+int filamentInit( Filaments* f, Coil* c, int primary, int secondary, double offset );
+void filamentFree( Filaments* f );
+
+// Sum the inductance of every pair of filaments across the given number of threads.
+void filamentSolve( Filaments* f, int threads );
+
+// Return the inductance of the primary tapped after the given turns from its
+// inner end, and its mutual inductance with the secondary, interpolating
+// between filaments.
+double filamentL( Filaments* f, double turns );
+double filamentM( Filaments* f, double turns );
+
+// Return the turns from its inner end at which the primary must be tapped to
+// have inductance L, or -1 if the whole primary falls short.
+double filamentTap( Filaments* f, double L );
+
+// Return the mutual inductance of two coaxial circular filaments of radius a
+// and b a height z apart, from the complete elliptic integrals by the
+// arithmetic geometric mean. The series in its differences gives the
+// difference of the integrals directly, so distant filaments lose no precision.
+double mutual( double a, double b, double z );
+
+// Return the name of the kernel used to sum mutual inductances.
+char* filamentKernel();
+
+double mutual( double a, double b, double z )
+{
+
+	double D = ( a + b ) * ( a + b ) + z * z;
+	double kp = sqrt( ( ( a - b ) * ( a - b ) + z * z ) / D );
+	double x = 1.0, y = kp, c = 2.0 * a * b / ( D * ( 1.0 + kp ) ), sum = 0.0, scale = 0.5, t;
+	int i;
+
+	// c starts at c_1 = ( 1 - k' ) / 2 = k^2 / 2 / ( 1 + k' ), with k^2 = 4ab / D, and
+	// sum holds the sum of 2^(n-1) c_n^2 from n = 1, whose first term of
+	// c_0^2 / 2 cancels against the k^2 K / 2 of the mutual inductance.
+	for ( i = 0; i < AGM_STEPS; i++ )
+	{
+
+		scale *= 2.0;
+		sum += scale * c * c;
+		t = 0.5 * ( x + y );
+		y = sqrt( x * y );
+		x = t;
+		c = 0.5 * ( x - y );
+
+	}
+
+	return 0.5 * U0 * PI * sqrt( D ) * sum / x;
+
+}
+
+// Return the sum of w[j] times the mutual inductance between a filament of
+// radius a at height z and the filaments of radius b[j] at heights h[j].
+static double filamentScalar( double a, double z, double* b, double* h, double* w, int n )
+{
+
+	double s = 0.0;
+	int j;
+
+	for ( j = 0; j < n; j++ ) s += w[j] * mutual( a, b[j], z - h[j] );
+	return s;
+
+}
+
+__attribute__((target("avx512f")))
+static double filamentAVX512( double a, double z, double* b, double* h, double* w, int n )
+{
+
+	const __m512d one = _mm512_set1_pd( 1.0 ), half = _mm512_set1_pd( 0.5 );
+	__m512d A = _mm512_set1_pd( a ), Z = _mm512_set1_pd( z ), total = _mm512_setzero_pd();
+	__m512d B, dz, p, q, D, kp, x, y, c, sum, scale, t;
+	int i, j;
+
+	for ( j = 0; j + 8 <= n; j += 8 )
+	{
+
+		B = _mm512_loadu_pd( b + j );
+		dz = _mm512_sub_pd( Z, _mm512_loadu_pd( h + j ) );
+		p = _mm512_add_pd( A, B );
+		q = _mm512_sub_pd( A, B );
+		D = _mm512_fmadd_pd( p, p, _mm512_mul_pd( dz, dz ) );
+		kp = _mm512_sqrt_pd( _mm512_div_pd( _mm512_fmadd_pd( q, q, _mm512_mul_pd( dz, dz ) ), D ) );
+
+		x = one;
+		y = kp;
+		c = _mm512_div_pd( _mm512_mul_pd( _mm512_add_pd( A, A ), B ), _mm512_mul_pd( D, _mm512_add_pd( one, kp ) ) );
+		sum = _mm512_setzero_pd();
+		scale = half;
+		for ( i = 0; i < AGM_STEPS; i++ )
+		{
+
+			scale = _mm512_add_pd( scale, scale );
+			sum = _mm512_fmadd_pd( _mm512_mul_pd( scale, c ), c, sum );
+			t = _mm512_mul_pd( half, _mm512_add_pd( x, y ) );
+			y = _mm512_sqrt_pd( _mm512_mul_pd( x, y ) );
+			x = t;
+			c = _mm512_mul_pd( half, _mm512_sub_pd( x, y ) );
+
+		}
+
+		t = _mm512_div_pd( _mm512_mul_pd( _mm512_sqrt_pd( D ), sum ), x );
+		total = _mm512_fmadd_pd( _mm512_loadu_pd( w + j ), t, total );
+
+	}
+
+	return 0.5 * U0 * PI * _mm512_reduce_add_pd( total ) + filamentScalar( a, z, b + j, h + j, w + j, n - j );
+
+}
+
+__attribute__((target("avx2,fma")))
+static double filamentAVX2( double a, double z, double* b, double* h, double* w, int n )
+{
+
+	const __m256d one = _mm256_set1_pd( 1.0 ), half = _mm256_set1_pd( 0.5 );
+	__m256d A = _mm256_set1_pd( a ), Z = _mm256_set1_pd( z ), total = _mm256_setzero_pd();
+	__m256d B, dz, p, q, D, kp, x, y, c, sum, scale, t;
+	double lane[4];
+	int i, j;
+
+	for ( j = 0; j + 4 <= n; j += 4 )
+	{
+
+		B = _mm256_loadu_pd( b + j );
+		dz = _mm256_sub_pd( Z, _mm256_loadu_pd( h + j ) );
+		p = _mm256_add_pd( A, B );
+		q = _mm256_sub_pd( A, B );
+		D = _mm256_fmadd_pd( p, p, _mm256_mul_pd( dz, dz ) );
+		kp = _mm256_sqrt_pd( _mm256_div_pd( _mm256_fmadd_pd( q, q, _mm256_mul_pd( dz, dz ) ), D ) );
+
+		x = one;
+		y = kp;
+		c = _mm256_div_pd( _mm256_mul_pd( _mm256_add_pd( A, A ), B ), _mm256_mul_pd( D, _mm256_add_pd( one, kp ) ) );
+		sum = _mm256_setzero_pd();
+		scale = half;
+		for ( i = 0; i < AGM_STEPS; i++ )
+		{
+
+			scale = _mm256_add_pd( scale, scale );
+			sum = _mm256_fmadd_pd( _mm256_mul_pd( scale, c ), c, sum );
+			t = _mm256_mul_pd( half, _mm256_add_pd( x, y ) );
+			y = _mm256_sqrt_pd( _mm256_mul_pd( x, y ) );
+			x = t;
+			c = _mm256_mul_pd( half, _mm256_sub_pd( x, y ) );
+
+		}
+
+		t = _mm256_div_pd( _mm256_mul_pd( _mm256_sqrt_pd( D ), sum ), x );
+		total = _mm256_fmadd_pd( _mm256_loadu_pd( w + j ), t, total );
+
+	}
+
+	_mm256_storeu_pd( lane, total );
+	return 0.5 * U0 * PI * ( ( lane[0] + lane[1] ) + ( lane[2] + lane[3] ) )
+		+ filamentScalar( a, z, b + j, h + j, w + j, n - j );
+
+}
+
+// Kernel chosen for this processor the first time filaments are summed.
+static double (*filamentChosen)( double a, double z, double* b, double* h, double* w, int n ) = NULL;
+static char* filamentName = "scalar";
+
+static void filamentChoose()
+{
+
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx512f" ) )
+	{
+
+		filamentChosen = filamentAVX512;
+		filamentName = "avx512";
+
+	}
+	else if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+	{
+
+		filamentChosen = filamentAVX2;
+		filamentName = "avx2";
+
+	}
+	else filamentChosen = filamentScalar;
+
+}
+
+char* filamentKernel()
+{
+
+	if ( !filamentChosen ) filamentChoose();
+	return filamentName;
+
+}
+
+// Return the inductance of a single turn of radius a carrying its current
+// spread over a band w by t in cross section, from the geometric mean distance
+// of the band from itself.
+static double band( double a, double w, double t )
+{
+
+	return U0 * a * ( log( 8.0 * a / ( 0.2235 * ( w + t ) ) ) - 2.0 );
+
+}
+
+static int ringsInit( Rings* r, int n )
+{
+
+	r->n = n;
+	r->r = malloc( 4 * n * sizeof( double ) );
+	r->z = r->r + n;
+	r->w = r->z + n;
+	r->self = r->w + n;
+	return r->r == NULL;
+
+}
+
+int filamentInit( Filaments* f, Coil* c, int primary, int secondary, double offset )
+{
+
+	double a = 0.5 * ( c->SECD + c->SECWD ), pitch, height;
+	int i;
+
+	memset( f, 0, sizeof *f );
+	if ( primary < 1 || secondary < 1 || !( c->PRIN > 0.0 ) || !( c->SECN > 0.0 ) )
+	{
+
+		fprintf(stderr, "  Both coils need turns and at least one filament.\n");
+		return 1;
+
+	}
+	if ( c->PRIRI - 0.5 * c->PRIWD < a + 0.5 * c->SECWD && offset < c->PRIWD )
+	{
+
+		fprintf(stderr, "  The primary overlaps the secondary.\n");
+		return 1;
+
+	}
+	if ( ringsInit( &f->primary, primary ) || ringsInit( &f->secondary, secondary )
+		|| !( f->L = malloc( 2 * ( primary + 1 ) * sizeof( double ) ) ) )
+	{
+
+		fprintf(stderr, "  Cannot hold %d by %d filaments.\n", primary, secondary);
+		filamentFree( f );
+		return 1;
+
+	}
+	f->M = f->L + primary + 1;
+
+	// The primary spiral's radius grows by PRIS each turn from PRIRI, so each
+	// filament stands for a ring of the spiral PRIN * PRIS / primary wide.
+	pitch = c->PRIN * c->PRIS / primary;
+	for ( i = 0; i < primary; i++ )
+	{
+
+		f->primary.r[i] = c->PRIRI + pitch * ( i + 0.5 );
+		f->primary.z[i] = 0.0;
+		f->primary.w[i] = (double)c->PRIN / primary;
+		f->primary.self[i] = band( f->primary.r[i], pitch, c->PRIWD );
+
+	}
+
+	height = (double)c->SECH / secondary;
+	for ( i = 0; i < secondary; i++ )
+	{
+
+		f->secondary.r[i] = a;
+		f->secondary.z[i] = offset + height * ( i + 0.5 );
+		f->secondary.w[i] = (double)c->SECN / secondary;
+		f->secondary.self[i] = band( a, height, c->SECWD );
+
+	}
+
+	return 0;
+
+}
+
+void filamentFree( Filaments* f )
+{
+
+	free( f->primary.r );
+	free( f->secondary.r );
+	free( f->L );
+	f->primary.r = f->secondary.r = f->L = f->M = NULL;
+
+}
+
+// Holds what a thread sums, the rows of the primary i with i % threads == thread.
+//  - f:      Filaments being summed.
+//  - thread: Number of the thread.
+//  - threads: Number of threads.
+//  - inner:  Mutual inductance per turn of each primary filament with those inside it.
+//  - outer:  Mutual inductance per turn of each primary filament with the secondary.
+typedef struct
+{
+
+	Filaments* f;
+	int thread, threads;
+	double *inner, *outer;
+
+} Rows;
+
+// Sums are taken a block of FILAMENT_BLOCK filaments at a time across every
+// row of the thread, so that the block stays in cache while it is reused.
+static void* filamentRows( void* arg )
+{
+
+	Rows* r = arg;
+	Rings *p = &r->f->primary, *s = &r->f->secondary;
+	int i, j, n;
+
+	for ( j = 0; j < s->n; j += FILAMENT_BLOCK )
+	{
+
+		n = s->n - j < FILAMENT_BLOCK ? s->n - j : FILAMENT_BLOCK;
+		for ( i = r->thread; i < p->n; i += r->threads )
+			r->outer[i] += filamentChosen( p->r[i], p->z[i], s->r + j, s->z + j, s->w + j, n );
+
+	}
+
+	for ( j = 0; j < p->n; j += FILAMENT_BLOCK )
+		for ( i = r->thread; i < p->n; i += r->threads )
+		{
+
+			n = i - j < FILAMENT_BLOCK ? i - j : FILAMENT_BLOCK;
+			if ( n > 0 ) r->inner[i] += filamentChosen( p->r[i], p->z[i], p->r + j, p->z + j, p->w + j, n );
+
+		}
+
+	return NULL;
+
+}
+
+void filamentSolve( Filaments* f, int threads )
+{
+
+	Rings *p = &f->primary, *s = &f->secondary;
+	double* row = calloc( 2 * p->n, sizeof( double ) );
+	double* gap = malloc( 3 * s->n * sizeof( double ) );
+	pthread_t thread[threads];
+	Rows rows[threads];
+	int started[threads], i, t;
+
+	if ( !filamentChosen ) filamentChoose();
+
+	// Rows the threads that cannot be started would have summed are summed here.
+	for ( t = 0; t < threads; t++ )
+	{
+
+		rows[t].f = f;
+		rows[t].thread = t;
+		rows[t].threads = threads;
+		rows[t].inner = row;
+		rows[t].outer = row + p->n;
+		started[t] = t > 0 && pthread_create( &thread[t], NULL, filamentRows, &rows[t] ) == 0;
+
+	}
+	for ( t = 0; t < threads; t++ )
+		if ( !started[t] ) filamentRows( &rows[t] );
+	for ( t = 1; t < threads; t++ )
+		if ( started[t] ) pthread_join( thread[t], NULL );
+
+	// The secondary's filaments are evenly spaced on one radius, so their
+	// mutual inductance depends only on how many apart they are.
+	for ( i = 1; i < s->n; i++ )
+	{
+
+		gap[i] = s->r[0];
+		gap[s->n + i] = s->z[0] - s->z[i];
+		gap[2 * s->n + i] = s->n - i;
+
+	}
+	f->Ls = s->w[0] * s->w[0] * ( s->n * s->self[0] + ( s->n > 1 ?
+		2.0 * filamentChosen( s->r[0], 0.0, gap + 1, gap + s->n + 1, gap + 2 * s->n + 1, s->n - 1 ) : 0.0 ) );
+
+	f->L[0] = f->M[0] = 0.0;
+	for ( i = 0; i < p->n; i++ )
+	{
+
+		f->L[i+1] = f->L[i] + p->w[i] * ( p->w[i] * p->self[i] + 2.0 * row[i] );
+		f->M[i+1] = f->M[i] + p->w[i] * row[p->n + i];
+
+	}
+
+	free( gap );
+	free( row );
+
+}
+
+// Return the value of the table at the given turns of the primary.
+static double filamentAt( Filaments* f, double* table, double turns )
+{
+
+	double x = turns / f->primary.w[0];
+	int i = (int)x;
+
+	if ( x <= 0.0 ) return 0.0;
+	if ( i >= f->primary.n ) return table[f->primary.n];
+	return table[i] + ( x - i ) * ( table[i+1] - table[i] );
+
+}
+
+double filamentL( Filaments* f, double turns ) { return filamentAt( f, f->L, turns ); }
+double filamentM( Filaments* f, double turns ) { return filamentAt( f, f->M, turns ); }
+
+double filamentTap( Filaments* f, double L )
+{
+
+	int lo = 0, hi = f->primary.n, mid;
+
+	if ( L > f->L[hi] ) return -1.0;
+
+	// The inductance only grows with each filament tapped.
+	while ( hi - lo > 1 )
+	{
+
+		mid = ( lo + hi ) / 2;
+		if ( f->L[mid] < L ) lo = mid;
+		else hi = mid;
+
+	}
+
+	return f->primary.w[0] * ( lo + ( L - f->L[lo] ) / ( f->L[hi] - f->L[lo] ) );
+
+}
+
+#endif
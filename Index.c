@@ -0,0 +1,627 @@
+#ifndef INDEX_C
+#define INDEX_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Coil.c"
+#include "Results.c"
+
+// Layout of an index file, in the byte order of the machine writing it, which
+// is mapped and searched in place:
+//  - An IndexHeader naming the key columns.
+//  - A box for every node of a balanced k-d tree in heap order, the children of
+//    node i being 2i+1 and 2i+2. A node covers a run of rows, halved between its
+//    children at the median of the key column spread widest across it.
+//  - The number of every design within the result file it was built from, as uint64_t.
+//  - Every design as PARAMETERS floats in registry order, leaves in order.
+#define INDEX_MAGIC   "TSINDEX1"
+#define INDEX_VERSION 1
+#define INDEX_KEYS    8
+#define INDEX_LEAF    32
+#define INDEX_TERMS   16
+#define INDEX_SET     16
+
+// Holds the schema of an index file.
+//  - keys:  Number of key columns the tree is split on.
+//  - depth: Depth of the leaves, every one holding at most INDEX_LEAF designs.
+//  - rows:  Number of designs indexed.
+//  - nodes: Number of nodes, 2^(depth+1) - 1.
+//  - key:   Position within registry of each key column.
+typedef struct
+{
+
+	char magic[8];
+	uint32_t version, keys, leaf, depth;
+	uint64_t rows, nodes;
+	int32_t key[INDEX_KEYS];
+	char pad[56];
+
+} IndexHeader;
+
+// Holds the smallest and largest value of every column beneath a node, which
+// lets a query skip a node whatever columns it is constrained on.
+typedef struct
+{
+
+	float min[PARAMETERS], max[PARAMETERS];
+
+} IndexBox;
+
+// Holds an index file mapped into memory.
+typedef struct
+{
+
+	void* map;
+	size_t size;
+	IndexHeader* header;
+	IndexBox* box;
+	uint64_t* origin;
+	float* row;
+
+} Index;
+
+// Kinds of query term.
+//  - TARGET: Distance is measured from the value, relative to it.
+//  - RANGE:  The value lies within lo..hi.
+//  - SET:    The value is one of those listed.
+enum { TARGET, RANGE, SET };
+
+// Holds a term of a query on one column, by position within registry.
+typedef struct
+{
+
+	int column, kind, count;
+	double target;
+	float lo, hi;
+	float value[INDEX_SET];
+
+} Term;
+
+// Holds a query: the targets to measure distance from and the constraints to meet.
+typedef struct
+{
+
+	int terms, targets;
+	Term term[INDEX_TERMS];
+
+} Query;
+
+// Holds a design found by a query, by its row within the index.
+typedef struct
+{
+
+	uint64_t row;
+	double distance;
+
+} Hit;
+
+// Build an index over every design of a binary result file whose key columns,
+// given by position within registry, are all finite. Returns 0 on success.
+int indexBuild( char* results, int keys, const int* key, char* file );
+
+// Map an index file for searching, or unmap it.
+int indexMap( Index* x, char* file );
+void indexUnmap( Index* x );
+
+// Add a term given as NAME=value, NAME=lo:hi with either bound left open, or
+// NAME=a,b,... to a query, returning 1 if it is not valid.
+int queryTerm( Query* q, char* spec );
+
+// Fill hits with the k designs meeting every constraint nearest the targets,
+// nearest first, measuring the distance as the root sum of squares of each
+// relative difference. Returns the number found.
+int indexNearest( Index* x, Query* q, int k, Hit* hits );
+
+// Fill hits with up to max of the designs meeting every constraint, returning how many there are.
+long indexRange( Index* x, Query* q, Hit* hits, long max );
+
+// Return the values of a design indexed.
+static float* indexRow( Index* x, uint64_t row ) { return x->row + row * PARAMETERS; }
+
+// Holds an index being built.
+typedef struct
+{
+
+	float* row;
+	uint64_t* order;
+	IndexBox* box;
+	int keys;
+	const int* key;
+	int depth;
+
+} Build;
+
+static float buildValue( Build* b, uint64_t i, int column ) { return b->row[b->order[i] * PARAMETERS + column]; }
+
+// Order the rows lo..hi so the one at mid holds the median of column, with none below it larger or above it smaller.
+static void buildSelect( Build* b, uint64_t lo, uint64_t hi, uint64_t mid, int column )
+{
+
+	uint64_t i, j, t;
+	float pivot;
+
+	while ( hi - lo > 1 )
+	{
+
+		pivot = buildValue( b, lo + ( hi - lo ) / 2, column );
+		for ( i = lo, j = hi - 1; i <= j; )
+		{
+
+			while ( buildValue( b, i, column ) < pivot ) i++;
+			while ( buildValue( b, j, column ) > pivot ) j--;
+			if ( i <= j )
+			{
+
+				t = b->order[i]; b->order[i] = b->order[j]; b->order[j] = t;
+				i++;
+				if ( j-- == 0 ) break;
+
+			}
+
+		}
+		if ( mid <= j ) hi = j + 1;
+		else if ( mid >= i ) lo = i;
+		else return;
+
+	}
+
+}
+
+static void buildNode( Build* b, uint64_t node, uint64_t lo, uint64_t hi, int level )
+{
+
+	IndexBox* box = &b->box[node];
+	uint64_t mid = lo + ( hi - lo ) / 2, i;
+	float spread, widest = -1.0f, lowest, highest, v;
+	int column = b->key[0], j, k;
+
+	if ( level == b->depth )
+	{
+
+		for ( j = 0; j < PARAMETERS; j++ )
+		{
+
+			box->min[j] = INFINITY;
+			box->max[j] = -INFINITY;
+			for ( i = lo; i < hi; i++ )
+			{
+
+				v = buildValue( b, i, j );
+				if ( v < box->min[j] ) box->min[j] = v;
+				if ( v > box->max[j] ) box->max[j] = v;
+
+			}
+
+		}
+		return;
+
+	}
+
+	for ( k = 0; k < b->keys; k++ )
+	{
+
+		lowest = INFINITY;
+		highest = -INFINITY;
+		for ( i = lo; i < hi; i++ )
+		{
+
+			v = buildValue( b, i, b->key[k] );
+			if ( v < lowest ) lowest = v;
+			if ( v > highest ) highest = v;
+
+		}
+
+		// Keys are compared by their spread relative to their size, as distances are measured.
+		spread = ( highest - lowest ) / fmaxf( fmaxf( fabsf( lowest ), fabsf( highest ) ), FLT_MIN );
+		if ( spread > widest ) { widest = spread; column = b->key[k]; }
+
+	}
+
+	buildSelect( b, lo, hi, mid, column );
+	buildNode( b, 2 * node + 1, lo, mid, level + 1 );
+	buildNode( b, 2 * node + 2, mid, hi, level + 1 );
+	for ( j = 0; j < PARAMETERS; j++ )
+	{
+
+		box->min[j] = fminf( b->box[2*node+1].min[j], b->box[2*node+2].min[j] );
+		box->max[j] = fmaxf( b->box[2*node+1].max[j], b->box[2*node+2].max[j] );
+
+	}
+
+}
+
+int indexBuild( char* results, int keys, const int* key, char* file )
+{
+
+	IndexHeader h;
+	Results r;
+	Build b;
+	FILE* out;
+	uint64_t k, i, n = 0, design = 0, *origin;
+	int j, failed = 0;
+
+	if ( keys < 1 || keys > INDEX_KEYS || resultMap( &r, results ) ) return 1;
+	b.row = malloc( r.header->total * PARAMETERS * sizeof( float ) + 1 );
+	b.order = malloc( r.header->total * sizeof( uint64_t ) + 1 );
+	if ( !b.row || !b.order )
+	{
+
+		fprintf(stderr, "Cannot hold %llu designs in memory!\n", (unsigned long long)r.header->total);
+		resultUnmap( &r );
+		return 1;
+
+	}
+
+	// Designs are gathered into rows, dropping those with a key that is not finite.
+	for ( k = 0; k < r.chunks; k++ )
+		for ( i = 0; i < resultChunk( &r, k )->rows; i++, design++ )
+		{
+
+			for ( j = 0; j < PARAMETERS; j++ ) b.row[n * PARAMETERS + j] = resultValues( &r, k, j )[i];
+			for ( j = 0; j < keys && isfinite( b.row[n * PARAMETERS + key[j]] ); j++ );
+			if ( j == keys ) b.order[n++] = design;
+
+		}
+	resultUnmap( &r );
+	if ( n == 0 )
+	{
+
+		fprintf(stderr, "%s holds no designs to index!\n", results);
+		free( b.row );
+		free( b.order );
+		return 1;
+
+	}
+
+	memset( &h, 0, sizeof h );
+	memcpy( h.magic, INDEX_MAGIC, 8 );
+	h.version = INDEX_VERSION;
+	h.keys = keys;
+	h.leaf = INDEX_LEAF;
+	h.rows = n;
+	while ( ( ( n + ( 1ULL << h.depth ) - 1 ) >> h.depth ) > INDEX_LEAF ) h.depth++;
+	h.nodes = ( 2ULL << h.depth ) - 1;
+	for ( j = 0; j < keys; j++ ) h.key[j] = key[j];
+
+	// Rows are ordered through a permutation, so only it moves while the tree is split.
+	// It starts holding each row's own position, with the design numbers kept aside.
+	origin = malloc( n * sizeof *origin );
+	memcpy( origin, b.order, n * sizeof *origin );
+	for ( i = 0; i < n; i++ ) b.order[i] = i;
+	b.box = malloc( h.nodes * sizeof *b.box );
+	b.keys = keys;
+	b.key = key;
+	b.depth = h.depth;
+	buildNode( &b, 0, 0, n, 0 );
+
+	if ( !( out = fopen( file, "wb" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", file);
+		failed = 1;
+
+	}
+	else
+	{
+
+		failed |= fwrite( &h, sizeof h, 1, out ) != 1;
+		failed |= fwrite( b.box, sizeof *b.box, h.nodes, out ) != h.nodes;
+		for ( i = 0; i < n; i++ ) failed |= fwrite( &origin[b.order[i]], sizeof *origin, 1, out ) != 1;
+		for ( i = 0; i < n; i++ ) failed |= fwrite( &b.row[b.order[i] * PARAMETERS], sizeof( float ), PARAMETERS, out ) != PARAMETERS;
+		failed |= fclose( out ) != 0;
+		if ( failed ) fprintf(stderr, "Cannot write %s!\n", file);
+
+	}
+
+	free( origin );
+	free( b.box );
+	free( b.row );
+	free( b.order );
+	return failed;
+
+}
+
+int indexMap( Index* x, char* file )
+{
+
+	struct stat st;
+	int fd = open( file, O_RDONLY );
+	IndexHeader* h;
+
+	memset( x, 0, sizeof *x );
+	if ( fd < 0 || fstat( fd, &st ) != 0 )
+	{
+
+		fprintf(stderr, "Cannot open %s for parsing!\n", file);
+		if ( fd >= 0 ) close( fd );
+		return 1;
+
+	}
+
+	x->size = st.st_size;
+	x->map = x->size >= sizeof( IndexHeader ) ? mmap( NULL, x->size, PROT_READ, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+	close( fd );
+	if ( x->map == MAP_FAILED )
+	{
+
+		fprintf(stderr, "Cannot map %s!\n", file);
+		x->map = NULL;
+		return 1;
+
+	}
+
+	h = x->header = x->map;
+	if ( memcmp( h->magic, INDEX_MAGIC, 8 ) != 0 || h->version != INDEX_VERSION || h->leaf != INDEX_LEAF
+		|| h->keys < 1 || h->keys > INDEX_KEYS || h->depth > 40 || h->nodes != ( 2ULL << h->depth ) - 1
+		|| sizeof *h + h->nodes * sizeof( IndexBox ) + h->rows * ( sizeof( uint64_t ) + PARAMETERS * sizeof( float ) ) != x->size )
+	{
+
+		fprintf(stderr, "%s is not a valid index file!\n", file);
+		indexUnmap( x );
+		return 1;
+
+	}
+
+	x->box = (IndexBox*)( h + 1 );
+	x->origin = (uint64_t*)( x->box + h->nodes );
+	x->row = (float*)( x->origin + h->rows );
+	return 0;
+
+}
+
+void indexUnmap( Index* x )
+{
+
+	if ( x->map ) munmap( x->map, x->size );
+	x->map = NULL;
+
+}
+
+int queryTerm( Query* q, char* spec )
+{
+
+	char* equals = strchr( spec, '=' );
+	char *p, *end;
+	Term* t = &q->term[q->terms];
+	int i;
+
+	if ( !equals || q->terms == INDEX_TERMS || ( i = lookup( spec, equals - spec ) ) < 0 )
+	{
+
+		fprintf(stderr, "  %s not valid query term.\n", spec);
+		return 1;
+
+	}
+
+	memset( t, 0, sizeof *t );
+	t->column = i;
+	p = equals + 1;
+	if ( strchr( p, ':' ) )
+	{
+
+		t->kind = RANGE;
+		t->lo = *p == ':' ? -INFINITY : strtof( p, &end );
+		if ( *p != ':' && *end != ':' ) t->kind = -1;
+		p = strchr( p, ':' ) + 1;
+		t->hi = *p ? strtof( p, &end ) : INFINITY;
+		if ( *p && *end ) t->kind = -1;
+
+	}
+	else if ( strchr( p, ',' ) )
+	{
+
+		t->kind = SET;
+		for ( ; *p && t->count < INDEX_SET; p = *end ? end + 1 : end )
+		{
+
+			t->value[t->count++] = strtof( p, &end );
+			if ( end == p || ( *end && *end != ',' ) ) { t->kind = -1; break; }
+
+		}
+		if ( *p ) t->kind = -1;
+
+	}
+	else
+	{
+
+		t->kind = TARGET;
+		t->target = strtod( p, &end );
+		if ( end == p || *end ) t->kind = -1;
+
+	}
+
+	if ( t->kind < 0 )
+	{
+
+		fprintf(stderr, "  %s not valid query term.\n", spec);
+		return 1;
+
+	}
+	if ( t->kind == TARGET ) q->targets++;
+	q->terms++;
+	return 0;
+
+}
+
+// Return whether a constraint can hold of a value within lo..hi, matching the
+// values of a set to within the rounding of the floats a sweep steps through.
+static int termHolds( Term* t, float lo, float hi )
+{
+
+	int i;
+
+	if ( t->kind == RANGE ) return hi >= t->lo && lo <= t->hi;
+	if ( t->kind != SET ) return 1;
+	for ( i = 0; i < t->count; i++ )
+		if ( hi >= t->value[i] - 1.0e-5f * fabsf( t->value[i] ) && lo <= t->value[i] + 1.0e-5f * fabsf( t->value[i] ) ) return 1;
+	return 0;
+
+}
+
+// Return the squared distance from the targets of the nearest point of box, or HUGE_VAL if no design in it can meet the constraints.
+static double boxDistance( Query* q, IndexBox* box )
+{
+
+	double d = 0.0, s, e;
+	int i;
+
+	for ( i = 0; i < q->terms; i++ )
+	{
+
+		Term* t = &q->term[i];
+		float lo = box->min[t->column], hi = box->max[t->column];
+
+		if ( t->kind != TARGET )
+		{
+
+			if ( !termHolds( t, lo, hi ) ) return HUGE_VAL;
+			continue;
+
+		}
+		s = t->target != 0.0 ? fabs( t->target ) : 1.0;
+		e = t->target < lo ? ( lo - t->target ) / s : t->target > hi ? ( t->target - hi ) / s : 0.0;
+		d += e * e;
+
+	}
+
+	return d;
+
+}
+
+// Holds the search of a query, with the best hits so far as a max heap on distance.
+typedef struct
+{
+
+	Index* x;
+	Query* q;
+	Hit* hits;
+	int k, found;
+	long max, count;
+
+} Search;
+
+// Return whether a node at squared distance d may hold a design worth keeping.
+static int searchWorth( Search* s, double d )
+{
+
+	if ( d == HUGE_VAL ) return 0;
+	return s->max >= 0 || s->found < s->k || d < s->hits[0].distance;
+
+}
+
+static void searchLeaf( Search* s, uint64_t lo, uint64_t hi )
+{
+
+	IndexBox point;
+	uint64_t r;
+	double d;
+	int i, j, c;
+
+	for ( r = lo; r < hi; r++ )
+	{
+
+		float* row = indexRow( s->x, r );
+		for ( i = 0; i < s->q->terms && !isnan( row[c = s->q->term[i].column] ); i++ )
+			point.min[c] = point.max[c] = row[c];
+		if ( i < s->q->terms || !searchWorth( s, d = boxDistance( s->q, &point ) ) ) continue;
+
+		// Range queries keep the first designs met and count the rest.
+		if ( s->max >= 0 )
+		{
+
+			if ( s->count < s->max ) { s->hits[s->count].row = r; s->hits[s->count].distance = 0.0; }
+			s->count++;
+			continue;
+
+		}
+
+		// A hit joins the heap at its end and sifts up until it is full,
+		// then takes the place of the farthest at its root and sifts down.
+		if ( s->found < s->k )
+			for ( i = s->found++; i > 0 && s->hits[( i - 1 ) / 2].distance < d; i = ( i - 1 ) / 2 )
+				s->hits[i] = s->hits[( i - 1 ) / 2];
+		else
+			for ( i = 0; ( j = 2 * i + 1 ) < s->found; i = j )
+			{
+
+				if ( j + 1 < s->found && s->hits[j+1].distance > s->hits[j].distance ) j++;
+				if ( s->hits[j].distance <= d ) break;
+				s->hits[i] = s->hits[j];
+
+			}
+		s->hits[i].row = r;
+		s->hits[i].distance = d;
+
+	}
+
+}
+
+static void searchNode( Search* s, uint64_t node, uint64_t lo, uint64_t hi, int level )
+{
+
+	uint64_t mid = lo + ( hi - lo ) / 2, a = 2 * node + 1, b = 2 * node + 2;
+	double da, db;
+
+	if ( level == (int)s->x->header->depth ) { searchLeaf( s, lo, hi ); return; }
+
+	// The nearer child is searched first, so the farther is often pruned.
+	da = boxDistance( s->q, &s->x->box[a] );
+	db = boxDistance( s->q, &s->x->box[b] );
+	if ( db < da )
+	{
+
+		if ( searchWorth( s, db ) ) searchNode( s, b, mid, hi, level + 1 );
+		if ( searchWorth( s, da ) ) searchNode( s, a, lo, mid, level + 1 );
+
+	}
+	else
+	{
+
+		if ( searchWorth( s, da ) ) searchNode( s, a, lo, mid, level + 1 );
+		if ( searchWorth( s, db ) ) searchNode( s, b, mid, hi, level + 1 );
+
+	}
+
+}
+
+int indexNearest( Index* x, Query* q, int k, Hit* hits )
+{
+
+	Search s = { x, q, hits, k, 0, -1, 0 };
+	Hit t;
+	int i, j;
+
+	if ( k <= 0 || !searchWorth( &s, boxDistance( q, &x->box[0] ) ) ) return 0;
+	searchNode( &s, 0, 0, x->header->rows, 0 );
+
+	// The heap is sorted in place, nearest first.
+	for ( i = 1; i < s.found; i++ )
+	{
+
+		for ( t = hits[i], j = i; j > 0 && hits[j-1].distance > t.distance; j-- ) hits[j] = hits[j-1];
+		hits[j] = t;
+
+	}
+	for ( i = 0; i < s.found; i++ ) hits[i].distance = sqrt( hits[i].distance );
+	return s.found;
+
+}
+
+long indexRange( Index* x, Query* q, Hit* hits, long max )
+{
+
+	Search s = { x, q, hits, 0, 0, max, 0 };
+
+	if ( searchWorth( &s, boxDistance( q, &x->box[0] ) ) ) searchNode( &s, 0, 0, x->header->rows, 0 );
+	return s.count;
+
+}
+
+#endif
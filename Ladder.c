@@ -0,0 +1,295 @@
+#ifndef LADDER_C
+#define LADDER_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Coil.c"
+
+// Most modes solved for at once. Their bisections share each pass along the
+// ladder, so the dependent divisions of one hide behind those of the others.
+#define LADDER_MODES 8
+
+// Relative width to which bisection narrows the interval holding each mode
+// before Rayleigh quotient iteration takes over.
+#define LADDER_SPLIT 1.0e-3
+
+// Lowest eigenvalue looked for, relative to Gershgorin's bound on the highest.
+// The lowest of a uniform ladder is about 2.5 / n^2 of the highest.
+#define LADDER_FLOOR 1.0e-24
+
+// Holds the secondary as a transmission line cut into segments from its
+// grounded base to its top, each a series inductance up to a node with
+// capacitance to ground, the top node also carrying the topload.
+//  - n:     Number of segments, and of nodes above the base.
+//  - modes: Number of modes last solved for.
+//  - L:     Inductance of each segment in henries, from the base up.
+//  - C:     Capacitance to ground of the node at the top of each segment in farads.
+//  - z:     Height of each node above the base of the winding in meters.
+//  - a, b:  Diagonal and off diagonal of the symmetric tridiagonal matrix whose
+//           eigenvalues are the squared angular frequencies of the modes.
+//  - bb:    Square of each off diagonal element.
+//  - work:  Room for inverse iteration.
+//  - v:     Voltage of each node in each mode in turn, largest 1 and positive at the top.
+//  - f:     Frequency of each mode in hertz, lowest first.
+typedef struct
+{
+
+	int n, modes;
+	double *L, *C, *z, *a, *b, *bb, *work, *v;
+	double f[LADDER_MODES];
+
+} Ladder;
+
+// Make room for a ladder of the given number of segments. Returns 1 if it cannot be held.
+int ladderInit( Ladder* l, int segments );
+void ladderFree( Ladder* l );
+
+// Cut the secondary of a calculated design into the segments of the ladder,
+// with the base of the winding the given height above ground.
+void ladderDesign( Ladder* l, Coil* c, double base );
+
+// Solve for the lowest given number of modes of the ladder, at most
+// LADDER_MODES and no more than its segments, and the voltage along it in each.
+void ladderSolve( Ladder* l, int modes );
+
+int ladderInit( Ladder* l, int segments )
+{
+
+	memset( l, 0, sizeof *l );
+	l->n = segments;
+	if ( segments < 1 || !( l->L = malloc( ( 7 + LADDER_MODES ) * (size_t)segments * sizeof( double ) ) ) ) return 1;
+	l->C = l->L + segments;
+	l->z = l->C + segments;
+	l->a = l->z + segments;
+	l->b = l->a + segments;
+	l->bb = l->b + segments;
+	l->work = l->bb + segments;
+	l->v = l->work + segments;
+	return 0;
+
+}
+
+void ladderFree( Ladder* l )
+{
+
+	free( l->L );
+	l->L = NULL;
+
+}
+
+// Return the inductance of a current sheet of diameter D and the given height
+// wound with turns per meter, from Nagaoka's coefficient.
+static double sheet( double D, double turns, double height )
+{
+
+	return height > 0.0 ? 0.25*PI*U0 * turns*turns * D*D * height * nagaokaExact( D / sqrt( D*D + height*height ) ) : 0.0;
+
+}
+
+// Each segment carries the same current in the mode of a lumped coil, so its
+// inductance is its own with its mutual inductance with every other segment.
+// Splitting the sheet at the segment, the mutual inductance of two abutting
+// sheets is half what their inductance together exceeds their own by, and the
+// sum comes to half of S(z1) - S(z0) + S(H - z0) - S(H - z1) for a segment from
+// z0 to z1 of a sheet of height H, where S is the inductance of a sheet of the
+// given height. These sum to the inductance of the whole sheet, and are scaled
+// to sum to SECL under the inductance model in use.
+//
+// Each node takes the capacitance to ground of the segment's length of winding
+// around it, as a cylinder of the winding's radius at its height above ground
+// whose charge is spread along it: 2 pi E0 / acosh( height / radius ) per meter.
+void ladderDesign( Ladder* l, Coil* c, double base )
+{
+
+	double D = c->SECD + c->SECWD, H = c->SECH, turns = c->SECN / c->SECH, h = H / l->n;
+	double total = 0.0, z0, z1, height;
+	int n = l->n, j;
+
+	for ( j = 0; j < n; j++ )
+	{
+
+		z0 = h * j;
+		z1 = j == n - 1 ? H : h * ( j + 1 );
+		l->L[j] = 0.5 * ( sheet( D, turns, z1 ) - sheet( D, turns, z0 ) + sheet( D, turns, H - z0 ) - sheet( D, turns, H - z1 ) );
+		total += l->L[j];
+
+		height = base + z1;
+		l->z[j] = z1;
+		l->C[j] = ( j == n - 1 ? 0.5 * h : h ) * 2.0 * PI * E0 / acosh( height > 0.5 * D ? 2.0 * height / D : 1.0 + 1.0e-9 );
+
+	}
+	l->C[n-1] += c->TOPC;
+
+	// The matrix is the inverse inductances joining the nodes, scaled either side
+	// by the inverse square root of their capacitance to keep it symmetric.
+	for ( j = 0; j < n; j++ ) l->L[j] *= c->SECL / total;
+	for ( j = 0; j < n; j++ )
+	{
+
+		l->a[j] = ( 1.0 / l->L[j] + ( j < n - 1 ? 1.0 / l->L[j+1] : 0.0 ) ) / l->C[j];
+		l->b[j] = j < n - 1 ? -1.0 / ( l->L[j+1] * sqrt( l->C[j] * l->C[j+1] ) ) : 0.0;
+		l->bb[j] = l->b[j] * l->b[j];
+
+	}
+
+}
+
+// Count the eigenvalues below each of the given shifts from the signs of the
+// pivots of the matrix less each shift, by Sturm's theorem.
+static void ladderCount( Ladder* l, const double* x, int m, int* count )
+{
+
+	double q[LADDER_MODES], tiny = 1.0e-300;
+	int j, k;
+
+	for ( k = 0; k < m; k++ )
+	{
+
+		q[k] = l->a[0] - x[k];
+		if ( q[k] == 0.0 ) q[k] = -tiny;
+		count[k] = q[k] < 0.0;
+
+	}
+	for ( j = 1; j < l->n; j++ )
+		for ( k = 0; k < m; k++ )
+		{
+
+			q[k] = l->a[j] - x[k] - l->bb[j-1] / q[k];
+			if ( q[k] == 0.0 ) q[k] = -tiny;
+			count[k] += q[k] < 0.0;
+
+		}
+
+}
+
+// Solve the matrix less the shift s against the right hand side held in x,
+// leaving the solution in x. Pivots of exactly the eigenvalue are nudged off zero.
+static void ladderInverse( Ladder* l, double s, double* x )
+{
+
+	double *a = l->a, *b = l->b, *w = l->work, m, floor = 1.0e-14 * fabs( s );
+	int n = l->n, j;
+
+	m = a[0] - s;
+	if ( fabs( m ) < floor ) m = floor;
+	w[0] = b[0] / m;
+	x[0] /= m;
+	for ( j = 1; j < n; j++ )
+	{
+
+		m = a[j] - s - b[j-1] * w[j-1];
+		if ( fabs( m ) < floor ) m = m < 0.0 ? -floor : floor;
+		w[j] = b[j] / m;
+		x[j] = ( x[j] - b[j-1] * x[j-1] ) / m;
+
+	}
+	for ( j = n - 2; j >= 0; j-- ) x[j] -= w[j] * x[j+1];
+
+}
+
+// Return the Rayleigh quotient of the matrix at x, and scale x to unit length.
+static double ladderRayleigh( Ladder* l, double* x )
+{
+
+	double xx = 0.0, xTx = 0.0, scale;
+	int n = l->n, j;
+
+	for ( j = 0; j < n; j++ )
+	{
+
+		xx += x[j] * x[j];
+		xTx += x[j] * ( l->a[j] * x[j] + ( j < n - 1 ? 2.0 * l->b[j] * x[j+1] : 0.0 ) );
+
+	}
+	for ( scale = 1.0 / sqrt( xx ), j = 0; j < n; j++ ) x[j] *= scale;
+	return xTx / xx;
+
+}
+
+// Every mode is bisected together between LADDER_FLOOR and Gershgorin's bound
+// until it is held apart from its neighbours to a part in LADDER_SPLIT, each
+// count narrowing them all. The intervals span many decades, so they are cut
+// at their geometric mean, halving their logarithm each pass. Inverse
+// iteration from there gives its mode, and Rayleigh quotient iteration closes
+// on its eigenvalue, converging cubically where bisection would gain a bit a
+// pass. Should the quotient stray from the interval, the middle of the
+// interval is kept. Dividing each mode by the square root of each node's
+// capacitance gives the voltages.
+void ladderSolve( Ladder* l, int modes )
+{
+
+	double lo[LADDER_MODES], hi[LADDER_MODES], x[LADDER_MODES], bound = 0.0, r, big, shift;
+	int count[LADDER_MODES], n = l->n, open, pass, i, j, k;
+	double* v;
+
+	if ( modes > LADDER_MODES ) modes = LADDER_MODES;
+	if ( modes > n ) modes = n;
+	l->modes = modes;
+	for ( j = 0; j < n; j++ )
+	{
+
+		r = l->a[j] + fabs( l->b[j] ) + ( j > 0 ? fabs( l->b[j-1] ) : 0.0 );
+		if ( r > bound ) bound = r;
+
+	}
+	x[0] = LADDER_FLOOR * bound;
+	ladderCount( l, x, 1, count );
+	for ( k = 0; k < modes; k++ )
+	{
+
+		lo[k] = count[0] == 0 ? x[0] : 0.0;
+		hi[k] = bound;
+
+	}
+
+	for ( open = modes, pass = 0; open > 0 && pass < 256; pass++ )
+	{
+
+		for ( k = 0; k < modes; k++ ) x[k] = lo[k] > 0.0 ? sqrt( lo[k] * hi[k] ) : 0.5 * ( lo[k] + hi[k] );
+		ladderCount( l, x, modes, count );
+		for ( k = 0; k < modes; k++ )
+			for ( i = 0; i < modes; i++ )
+			{
+
+				if ( count[k] > i && x[k] < hi[i] ) hi[i] = x[k];
+				if ( count[k] <= i && x[k] > lo[i] ) lo[i] = x[k];
+
+			}
+		for ( open = 0, k = 0; k < modes; k++ )
+			open += hi[k] - lo[k] > LADDER_SPLIT * hi[k];
+
+	}
+
+	for ( k = 0; k < modes; k++ )
+	{
+
+		v = l->v + (size_t)k * n;
+		for ( j = 0; j < n; j++ ) v[j] = 1.0;
+		shift = 0.5 * ( lo[k] + hi[k] );
+		for ( i = 0; i < 4; i++ )
+		{
+
+			ladderInverse( l, shift, v );
+			r = ladderRayleigh( l, v );
+			if ( i > 0 ) shift = r > lo[k] && r <= hi[k] ? r : 0.5 * ( lo[k] + hi[k] );
+
+		}
+		l->f[k] = sqrt( shift ) / ( 2.0 * PI );
+
+		for ( big = 0.0, j = 0; j < n; j++ )
+		{
+
+			v[j] /= sqrt( l->C[j] );
+			if ( fabs( v[j] ) > big ) big = fabs( v[j] );
+
+		}
+		if ( v[n-1] < 0.0 ) big = -big;
+		for ( j = 0; j < n; j++ ) v[j] /= big;
+
+	}
+
+}
+
+#endif
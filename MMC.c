@@ -0,0 +1,65 @@
+#ifndef MMC_C
+#define MMC_C
+
+#include <math.h>
+
+// Hold the capacitance and voltage values of an individual capacitor.
+float MCC, MCV;
+
+// Calculate the equivalent capacitance of an MMC with
+// ser series capacitors and par parallel strands.
+float eqcap( int ser, int par );
+
+// Return the number of series capacitors, up to sermax, that brings an MMC with
+// par parallel strands closest to the target capacitance TC within tol while
+// withstanding TV, or 0 if there is none.
+int bestSeries( int par, float TC, float TV, float tol, int sermax );
+
+// Find the MMC with the fewest parallel strands, up to parmax, that meets the
+// target. Returns 1 and fills ser and par if one exists.
+int solve( float TC, float TV, float tol, int sermax, int parmax, int* ser, int* par );
+
+float eqcap( int ser, int par )
+{
+
+	return par*MCC/ser;
+
+}
+
+int bestSeries( int par, float TC, float TV, float tol, int sermax )
+{
+
+	// Fewest series capacitors that withstand the target voltage.
+	int lo = ceil( TV / MCV ), ideal = floor( par * MCC / TC ), ser, best = 0;
+	float del, min = tol;
+
+	if ( lo < 1 ) lo = 1;
+
+	// The capacitance falls monotonically with ser, so only the two integers
+	// either side of the ideal par*MCC/TC can be closest to the target, or
+	// lo itself when the voltage rating demands more capacitors than that.
+	// Ties keep the fewer series capacitors, as the original table search did.
+	for ( ser = ideal > lo ? ideal : lo; ser <= ( ideal + 1 > lo ? ideal + 1 : lo ) && ser <= sermax; ser++ )
+		if ( ( del = fabs( eqcap( ser, par ) - TC ) ) <= tol && ( best == 0 || del < min ) )
+		{
+
+			min = del;
+			best = ser;
+
+		}
+
+	return best;
+
+}
+
+int solve( float TC, float TV, float tol, int sermax, int parmax, int* ser, int* par )
+{
+
+	for ( *par = 1; *par <= parmax; (*par)++ )
+		if ( ( *ser = bestSeries( *par, TC, TV, tol, sermax ) ) ) return 1;
+
+	return 0;
+
+}
+
+#endif
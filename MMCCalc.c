@@ -1,36 +1,48 @@
 #define AUTHOR  "Jay Phillips"
 #define NAME    "MMC Capacitance Calculator"
-#define VERSION "1.05"
+#define VERSION "1.06"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
 #include <sys/ioctl.h>
 #include "Shared.c"
+#include "Catalog.c"
+#include "MMC.c"
 
 // Declare external centering function.
 extern void center( char* begin, char* text, int col, char pad, char* end );
 
-// Calculate the equivalent capacitance of an MMC with
-// ser series capacitors and par parallel strands.
-float eqcap( int ser, int par );
+// Print the tabulated capacitances of every MMC up to sermax by parmax in
+// pages that fit the terminal.
+void table( float TC, float TV, float tol, int sermax, int parmax );
 
-// Hold the capacitance and voltage values of an individual capacitor.
-float MCC, MCV;
+// Print the cheapest MMC that can be built from a catalog of capacitors.
+int cheapest( char* file, float TC, float TV, float tol, float derate, int mix, int threads, int width );
 
 // Return the SI unit autoscale factor and prefix of a given value.
 extern double SIfactor( double value );
 extern char SIprefix( double value );
 
-int main()
+int main( int argc, char** argv )
 {
 
 	// Holds information about program.
-	char name[strlen(NAME)+strlen(VERSION)+2];
+	char name[strlen(NAME)+strlen(VERSION)+3];
 
 	// Hold number of capacitors in series and strands in parallel.
 	int ser, par;
 
+	// Hold the bounds of the search and whether to print the table.
+	int sermax = 100, parmax = 100, tabulate = 0, opt;
+
+	// Hold the settings of a search of a capacitor catalog.
+	char* catalog = NULL;
+	float derate = 1.0;
+	int mix = 3, threads = sysconf( _SC_NPROCESSORS_ONLN );
+
 	// Hold information pertaining to the target specs of the MMC.
 	float TC, TV, tol;
 
@@ -39,104 +51,178 @@ int main()
 	TC = 14.31e-9;  TV = 9000;
 	tol = 1.0e-9;
 
-	// Holds information about terminal size.
-	struct winsize w;
-	ioctl(0, TIOCGWINSZ, &w);
-
-	// Hold information about table output size.
-	int row = w.ws_row - 11;
-	int col = ( w.ws_col - 17 ) / 11;
-	int width = 11*col+16;
-
-	// Hold all voltage, capacitance, and delta values for MMC.
-	float MMCV[row], MMCC[row][col], del;
+	while ( ( opt = getopt( argc, argv, "s:p:tc:d:m:j:" ) ) != -1 )
+		switch ( opt )
+		{
 
-	// Hold information about smallest MMC possible.
-	int MINSER[col]; for ( par = 0; par <= col; par++ ) MINSER[par] = 0;
-	
-	// Hold closest matches for each parallel strand of capacitors.
-	float MINIMUM[col]; for ( par = 0; par <= col; par++ ) MINIMUM[par] = 1.0;
+			case 's': sermax = atoi( optarg ); break;
+			case 'p': parmax = atoi( optarg ); break;
+			case 't': tabulate = 1; break;
+			case 'c': catalog = optarg; break;
+			case 'd': derate = atof( optarg ); break;
+			case 'm': mix = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'j': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			default:
+				fprintf(stderr, "Usage: %s [-s max series] [-p max parallel] [-t]\n", argv[0]);
+				fprintf(stderr, "       %s -c catalog [-d derating] [-m max mix] [-j threads]\n", argv[0]);
+				return 1;
 
-	// Calculate voltages and equivalent capacitances of MMC.
-	for ( ser = 0; ser <= row; ser++ )
+		}
+	if ( threads < 1 ) threads = 1;
+	if ( catalog && !( derate > 0.0 ) )
 	{
 
-		if ( ser != row && ser != 0 ) MMCV[ser] = ser*MCV;
-		for ( par = 1; par <= col; par++ )
-			if ( ser != row && ser != 0 )
-			{
-
-				MMCC[ser][par] = eqcap(ser, par);
-				del = fabs( MMCC[ser][par] - TC );
-				// Determine optimum size of MMC array.
-				if ( MMCV[ser] >= TV && del <= tol && del < MINIMUM[par] )
-				{
-
-					MINIMUM[par] = del;
-					MINSER[par] = ser;
-
-				}
-
-			}
+		fprintf(stderr, "  %g not valid derating.\n", derate);
+		return 1;
 
 	}
 
-	// Print tabulated calculated values to stdout.
+	if ( tabulate ) table( TC, TV, tol, sermax, parmax );
+
+	// Print optimal specs for MMC array to stdout.
+	char string[80];
+	int width = 60;
 	printf("+"); for ( par = 1; par <= width; par++ ) printf("-"); printf("+");
 	sprintf(name,"%s v%s",NAME,VERSION);
 	center("\n|",name,width,' ',"|");
 	center("\n|",AUTHOR,width,' ',"|");
-	printf("\n+-----+----------+"); 
-	for ( par = 1; par <= col; par++ ) printf("----------+");
-	printf("\n| SER | V RATING |");
-	for ( par = 1; par <= col; par++ ) printf("  PAR%3d  |", par);
-	for ( ser = 0; ser <= row; ser++ )
+	printf("\n+"); for ( par = 1; par <= width; par++ ) printf("-"); printf("+");
+	if ( catalog )
 	{
 
-		if ( ser == row || ser == 0 ) printf("\n+-----+----------+");
-		else printf("\n| %3d | %6.2f%cV |", ser, MMCV[ser]*SIfactor(MMCV[ser]), SIprefix(MMCV[ser]));
+		if ( cheapest( catalog, TC, TV, tol, derate, mix, threads, width ) ) return 1;
 
-		for ( par = 1; par <= col; par++ )
-			if ( ser == row || ser == 0 ) printf("----------+");
-			else
-			{
+	}
+	else if ( solve( TC, TV, tol, sermax, parmax, &ser, &par ) )
+	{
 
-				if ( fabs( MMCC[ser][par] - TC ) <= tol && MMCV[ser] >= TV )
-					if ( MINSER[par] == ser ) printf(" [01;32m");
-					else printf(" [01;31m");
-				else printf(" ");
-				printf("%6.2f%cF[0m |", MMCC[ser][par]*SIfactor(MMCC[ser][par]), SIprefix(MMCC[ser][par]));
+		float MINC = eqcap( ser, par );
+		float MINV = ser * MCV;
+		sprintf(string, "%d parallel x %d series array", par, ser);
+		center("\n|",string,width,' ',"|");
+		sprintf(string, "%dx %0.2f%cF/%0.2f%cV capacitors", ser*par, MCC*SIfactor(MCC), SIprefix(MCC), MCV*SIfactor(MCV), SIprefix(MCV));
+		center("\n|",string,width,' ',"|");
+		sprintf(string, "MMC rated at %0.2f%cF/%0.2f%cV", MINC*SIfactor(MINC), SIprefix(MINC), MINV*SIfactor(MINV), SIprefix(MINV));
+		center("\n|",string,width,' ',"|");
 
-			}
+	}
+	else
+	{
+
+		sprintf(string, "No MMC within %d series x %d parallel", sermax, parmax);
+		center("\n|",string,width,' ',"|");
 
 	}
+	printf("\n+"); for ( par = 1; par <= width; par++ ) printf("-"); printf("+\n");
+
+	return 0;
+
+}
+
+int cheapest( char* file, float TC, float TV, float tol, float derate, int mix, int threads, int width )
+{
+
+	char string[80];
+	Part* parts;
+	Bank bank;
+	int n = readCatalog( file, &parts ), i;
 
-	//Print optimal specs for MMC array to stdout.
-	char string[50];
-	for ( par = 0; par <= col; par++ )
-		if ( MINSER[par] != 0 )
+	if ( n < 0 ) return 1;
+
+	if ( optimize( parts, n, TC, TV, tol, derate, mix, threads, &bank ) )
+	{
+
+		for ( i = 0; i < bank.strings; i++ )
 		{
 
-			float MINC = eqcap( MINSER[par], par );
-			float MINV = MINSER[par] * MCV;
-			sprintf(string, "%d parallel x %d series array", par, MINSER[par]);
-			center("\n|",string,width,' ',"|");
-			sprintf(string, "%dx %0.2f%cF/%0.2f%cV capacitors", MINSER[par]*par, MCC*SIfactor(MCC), SIprefix(MCC), MCV*SIfactor(MCV), SIprefix(MCV));
+			Part* p = &parts[bank.kind[i].part];
+			sprintf(string, "%d parallel x %d series %.40s", bank.count[i], bank.kind[i].ser, p->name);
 			center("\n|",string,width,' ',"|");
-			sprintf(string, "MMC rated at %0.2f%cF/%0.2f%cV", MINC*SIfactor(MINC), SIprefix(MINC), MINV*SIfactor(MINV), SIprefix(MINV));
+			sprintf(string, "%dx %0.2f%cF/%0.2f%cV capacitors", bank.count[i]*bank.kind[i].ser,
+				p->C*SIfactor(p->C), SIprefix(p->C), p->V*SIfactor(p->V), SIprefix(p->V));
 			center("\n|",string,width,' ',"|");
-			printf("\n+"); for ( par = 1; par <= width; par++ ) printf("-"); printf("+\n");
-			break;
 
 		}
+		sprintf(string, "MMC rated at %0.2f%cF/%0.2f%cV costing %0.2f", bank.C*SIfactor(bank.C), SIprefix(bank.C),
+			bank.V*SIfactor(bank.V), SIprefix(bank.V), bank.cost);
+		center("\n|",string,width,' ',"|");
+
+	}
+	else
+	{
+
+		sprintf(string, "No MMC from %d parts in %.40s", n, file);
+		center("\n|",string,width,' ',"|");
+
+	}
 
+	free( parts );
 	return 0;
 
 }
 
-float eqcap( int ser, int par )
+void table( float TC, float TV, float tol, int sermax, int parmax )
 {
 
-	return par*MCC/ser;
+	// Holds information about terminal size, assuming 80x24 off a terminal.
+	struct winsize w;
+	if ( ioctl(1, TIOCGWINSZ, &w) != 0 || w.ws_row == 0 ) { w.ws_row = 24; w.ws_col = 80; }
+
+	// Hold information about page size.
+	int rows = w.ws_row - 5 > 1 ? w.ws_row - 5 : 1;
+	int cols = ( w.ws_col - 17 ) / 11 > 1 ? ( w.ws_col - 17 ) / 11 : 1;
+	int ser, par, s0, p0, pmax, best[cols+1];
+	float MMCV, MMCC;
+
+	for ( p0 = 1; p0 <= parmax; p0 += cols )
+		for ( s0 = 1; s0 <= sermax; s0 += rows )
+		{
+
+			pmax = p0 + cols - 1 < parmax ? p0 + cols - 1 : parmax;
+			for ( par = p0; par <= pmax; par++ ) best[par-p0] = bestSeries( par, TC, TV, tol, sermax );
+
+			// Print the page of tabulated calculated values to stdout.
+			printf("+-----+----------+");
+			for ( par = p0; par <= pmax; par++ ) printf("----------+");
+			printf("\n| SER | V RATING |");
+			for ( par = p0; par <= pmax; par++ ) printf("  PAR%3d  |", par);
+			printf("\n+-----+----------+");
+			for ( par = p0; par <= pmax; par++ ) printf("----------+");
+
+			for ( ser = s0; ser < s0 + rows && ser <= sermax; ser++ )
+			{
+
+				MMCV = ser*MCV;
+				printf("\n| %3d | %6.2f%cV |", ser, MMCV*SIfactor(MMCV), SIprefix(MMCV));
+				for ( par = p0; par <= pmax; par++ )
+				{
+
+					MMCC = eqcap(ser, par);
+					if ( fabs( MMCC - TC ) <= tol && MMCV >= TV )
+						if ( best[par-p0] == ser ) printf(" [01;32m");
+						else printf(" [01;31m");
+					else printf(" ");
+					printf("%6.2f%cF[0m |", MMCC*SIfactor(MMCC), SIprefix(MMCC));
+
+				}
+
+			}
+
+			printf("\n+-----+----------+");
+			for ( par = p0; par <= pmax; par++ ) printf("----------+");
+			printf("\n");
+
+			// Wait between pages when someone is reading them.
+			if ( isatty(0) && isatty(1) && ( s0 + rows <= sermax || pmax < parmax ) )
+			{
+
+				printf("-- series %d-%d of %d, parallel %d-%d of %d: press enter --",
+					s0, ser - 1, sermax, p0, pmax, parmax);
+				fflush(stdout);
+				if ( getchar() == EOF ) return;
+
+			}
+
+		}
 
 }
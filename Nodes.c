@@ -0,0 +1,149 @@
+// The formula of every output parameter, written once for designs held in
+// either precision. Coil.c includes this file once for each, and Sensitivity.c
+// once more for designs held in complex doubles, having defined:
+//  - REAL:     Type each parameter of the design is held in.
+//  - DESIGN:   Type of the design, Coil or Precise.
+//  - NODE:     Name of the node calculating the named output parameter.
+//  - STAGE:    Name of the function calculating the named stage.
+//  - WIRE:     Name of the wire diameter of a gauge, WD in float.
+//  - SELF:     Name of the self-capacitance of a helical coil, medhurst in float.
+//  - SOLENOID: Name of the current sheet inductance of a solenoid, solenoid in float.
+// Constants are doubles, so each formula is worked in double and its output
+// rounded to REAL as it is stored: only a float design rounds between outputs.
+
+REAL WIRE( REAL WG ) { return 0.000127 * pow( 92.0, ( 36.0 - WG ) / 39.0 ); }
+
+REAL SELF( REAL R, REAL L )
+{
+
+	return ( 1/0.0254 * (0.29*L + R * ( 0.41 + 1.94*sqrt(R / L) ) ) ) / 1000000000000.0;
+
+}
+
+// Each output parameter is calculated by a node of its own from the parameters
+// it reads, so that the stages below and recalculate() share every formula.
+static void NODE( NSTTR )(  DESIGN* c ) { c->NSTTR  = c->NSTVO / c->NSTVI; }
+static void NODE( NSTVA )(  DESIGN* c ) { c->NSTVA  = c->NSTVO * c->NSTIO; }
+static void NODE( NSTII )(  DESIGN* c ) { c->NSTII  = c->NSTVA / c->NSTVI; }
+static void NODE( NSTPF )(  DESIGN* c ) { c->NSTPF  = c->NSTVA / ( 2.0*PI*c->NSTF*c->NSTVI*c->NSTVI ); }
+static void NODE( NSTVIP )( DESIGN* c ) { c->NSTVIP = c->NSTVI * sqrt(2.0); }
+static void NODE( NSTIIP )( DESIGN* c ) { c->NSTIIP = c->NSTII * sqrt(2.0); }
+static void NODE( NSTVOP )( DESIGN* c ) { c->NSTVOP = c->NSTVO * sqrt(2.0); }
+static void NODE( NSTIOP )( DESIGN* c ) { c->NSTIOP = c->NSTIO * sqrt(2.0); }
+static void NODE( NSTR )(   DESIGN* c ) { c->NSTR   = c->NSTRS + c->NSTRP * c->NSTTR * c->NSTTR; }  // Reactance
+static void NODE( NSTZ )(   DESIGN* c )
+{
+
+	REAL Z = c->NSTVO / c->NSTIO;                                  // Impedance
+	/* SIGN? */ c->NSTZ  = sqrt( Z * Z - c->NSTR * c->NSTR );       // Total Impedance
+
+}
+static void NODE( ARCLN )(  DESIGN* c ) { /* VERIFY */ c->ARCLN = 0.04318*sqrt( c->NSTVA ); } // Maximum Theroetical Arclength
+
+static void NODE( PTCC )(   DESIGN* c ) { c->PTCC  = 1.0 / ( 2.0*PI*c->NSTF*c->NSTZ ); }       // Resonant Capacitance
+static void NODE( LTRCS )(  DESIGN* c ) { c->LTRCS = c->PTCC * PHI; }                          // LTR Static Capacitance
+static void NODE( LTRCR )(  DESIGN* c ) { c->LTRCR = c->PTCC * PHI * PHI; }                    // LTR Rotary Capacitance
+
+// Calculate secondary wire diameter from AWG value accounting for single insulation.
+// Single insulation: 0.0014in 3.55600e-5m
+// Double insulation: 0.0026in 6.60400e-5m
+static void NODE( SECWD )(  DESIGN* c ) { c->SECWD = WIRE( c->SECWG ) + 3.55600e-5; }
+static void NODE( SECN )(   DESIGN* c ) { c->SECN  = c->SECH / c->SECWD; }                     // Secondary Wrap Number
+static void NODE( SECLN )(  DESIGN* c ) { c->SECLN = c->SECN*PI*(c->SECD+c->SECWD); }          // Secondary Wire Length
+
+// Calculate inductance of secondary using Wheeler's empirical formula unless
+// the Nagaoka model is selected. Wheeler is accurate to within 1% for SECL > 0.4*SECD.
+static void NODE( SECL )(   DESIGN* c )
+{
+
+	REAL D = c->SECD + c->SECWD, N = c->SECN;
+
+	if ( inductance == WHEELER ) c->SECL = N*N*D*D / ( 2.54e4 * (18.0*D+40.0*c->SECH) );
+	else c->SECL = SOLENOID( D, N, c->SECH, c->SECWD );
+
+}
+static void NODE( SECC )(   DESIGN* c ) { c->SECC  = SELF(0.5*c->SECD, c->SECH); }         // Secondary Self-Capacitance
+static void NODE( SECHD )(  DESIGN* c ) { c->SECHD = c->SECH / ( c->SECD + c->SECWD ); }       // Aspect Ratio
+
+static void NODE( TOPC )(   DESIGN* c ) { c->TOPC  = 2.0 * PI * E0 * c->TOPD; }                // Topload Capacitance
+
+// Calculate the resonant frequency of the secondary circuit, rather than
+// estimating it from the quarter wavelength of the wire as 0.25 * C0 / SECLN.
+static void NODE( SECF )(   DESIGN* c ) { c->SECF  = 1.0 / ( 2.0 * PI * sqrt( c->SECL * ( c->SECC + c->TOPC ) ) ); }
+
+// Calculate primary wire diameter from AWG value.
+static void NODE( PRIWD )(  DESIGN* c ) { c->PRIWD = WIRE( c->PRIWG ); }
+static void NODE( PRIRO )(  DESIGN* c ) { c->PRIRO = c->PRIRI + c->PRIN * c->PRIS; }          // Primary Outer Radius
+static void NODE( PRIF )(   DESIGN* c ) { c->PRIF  = c->SECF; }
+
+// Calculate primary inductance such that capacitive and inductive reactances cancel.
+// Assume use of LTR static capacitor bank.
+static void NODE( PTCCR )(  DESIGN* c ) { c->PTCCR = 1.0 / ( 2.0*PI*c->PRIF*c->LTRCS ); }      // Capacitive Reactance
+static void NODE( PRILR )(  DESIGN* c ) { c->PRILR = c->PTCCR; }                               // Inductive Reactance
+static void NODE( PRIL )(   DESIGN* c ) { c->PRIL  = c->PRILR / ( 2.0*PI*c->PRIF ); }          // Primary Inductance
+//c->PRIF  = 1.0 / ( 2.0*PI*sqrt(c->PRIL*c->LTRCS) );           // Primary Resonant Frequency
+//c->PRILN = 0.5*PI*c->PRIN*(c->PRIDI+c->PRIDO);                // Primary Coil Length via DI and DO
+static void NODE( PRILN )(  DESIGN* c ) { c->PRILN = PI * c->PRIN * c->PRIS * ( c->PRIN + 2.0*PI ); } // Primary Coil Length via RI and dR
+
+void STAGE( NST )( DESIGN* c )
+{
+
+	// Calculate transformer power performance statistics.
+	NODE( NSTTR )( c );
+	NODE( NSTVA )( c );
+	NODE( NSTII )( c );
+	NODE( NSTPF )( c );
+
+	// Calculate peak voltages and currents from RMS values.
+	NODE( NSTVIP )( c );
+	NODE( NSTIIP )( c );
+	NODE( NSTVOP )( c );
+	NODE( NSTIOP )( c );
+
+	NODE( NSTR )( c );
+	NODE( NSTZ )( c );
+	NODE( ARCLN )( c );
+
+}
+
+void STAGE( PTC )( DESIGN* c )
+{
+
+	NODE( PTCC )( c );
+	NODE( LTRCS )( c );
+	NODE( LTRCR )( c );
+
+}
+
+void STAGE( SEC )( DESIGN* c )
+{
+
+	NODE( SECWD )( c );
+	NODE( SECN )( c );
+	NODE( SECLN )( c );
+	NODE( SECL )( c );
+	NODE( SECC )( c );
+	NODE( SECHD )( c );
+
+}
+
+void STAGE( TOP )( DESIGN* c )
+{
+
+	NODE( TOPC )( c );
+	NODE( SECF )( c );
+
+}
+
+void STAGE( PRI )( DESIGN* c )
+{
+
+	NODE( PRIWD )( c );
+	NODE( PRIRO )( c );
+	NODE( PRIF )( c );
+	NODE( PTCCR )( c );
+	NODE( PRILR )( c );
+	NODE( PRIL )( c );
+	NODE( PRILN )( c );
+
+}
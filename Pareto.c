@@ -0,0 +1,873 @@
+#ifndef PARETO_C
+#define PARETO_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Coil.c"
+#include "Batch.c"
+
+// Most objectives and constraints an optimization can have.
+#define PARETO_OBJECTIVES 8
+#define PARETO_CONSTRAINTS 8
+
+// Distribution indices of simulated binary crossover and polynomial mutation:
+// the larger they are, the closer children fall to their parents.
+#define PARETO_CROSSOVER 15.0
+#define PARETO_MUTATION  20.0
+
+// Designs are calculated in multiples of the widest vector kernel's lanes, so
+// none falls to the scalar tail and a design's outputs do not depend on where
+// in its population it is calculated.
+#define PARETO_LANES 16
+
+// Violation given to a design whose outputs are not finite, such as an NST
+// whose resistance exceeds its impedance.
+#define PARETO_INVALID 1.0e30
+
+// Holds an input parameter free to vary within a range.
+//  - input:  Position of the parameter within inputName().
+//  - lo, hi: Range of its value.
+//  - whole:  1 if it only takes whole values, as wire gauges and turns do.
+typedef struct
+{
+
+	int input;
+	double lo, hi;
+	int whole;
+
+} Gene;
+
+// Inputs that can only be built in whole numbers.
+static const char* paretoWhole[] = { "PRIWG", "SECWG", "PRIN" };
+
+// Holds a parameter to be minimized or maximized.
+//  - name:   Name of the parameter as it appears in parameters.dat.
+//  - offset: Position of the parameter within a Coil in bytes.
+//  - sign:   1 to minimize it, -1 to maximize it.
+typedef struct
+{
+
+	char name[8];
+	size_t offset;
+	double sign;
+
+} Objective;
+
+// Holds a parameter to be kept within a range.
+typedef struct
+{
+
+	char name[8];
+	size_t offset;
+	double lo, hi;
+
+} Constraint;
+
+// Holds a single design of a population.
+//  - x:         Every input parameter, in the order of inputName().
+//  - f:         Every objective, each to be minimized.
+//  - violation: Total relative distance of the constraints outside their ranges, 0 if feasible.
+//  - rank:      Front of the design, 0 for those dominated by no other.
+//  - crowding:  Normalized distance to the neighbours of the design along its front.
+typedef struct
+{
+
+	float x[INPUTS];
+	double f[PARETO_OBJECTIVES];
+	double violation, crowding;
+	int rank;
+
+} Individual;
+
+// Holds an island, a population evolving apart from the others between migrations.
+//  - member: Parents in the first size places and their children in the next size.
+//  - random: State of the random stream of the island.
+typedef struct
+{
+
+	Individual* member;
+	uint64_t random;
+
+} Island;
+
+// Holds a multi-objective optimization and its populations.
+//  - base:        Values of the input parameters that are not free.
+//  - genes:       Number of free input parameters.
+//  - objectives:  Number of objectives.
+//  - constraints: Number of constraints.
+//  - islands:     Number of islands, each with size members.
+//  - generation:  Number of generations evolved so far.
+//  - migrate:     Generations between migrations.
+//  - migrants:    Members sent from each island to the next on every migration.
+//  - evaluations: Number of designs calculated so far.
+typedef struct
+{
+
+	Coil base;
+	int genes, objectives, constraints;
+	Gene gene[INPUTS];
+	Objective objective[PARETO_OBJECTIVES];
+	Constraint constraint[PARETO_CONSTRAINTS];
+	int islands, size, migrate, migrants;
+	long generation, evaluations;
+	Island* island;
+
+} Pareto;
+
+// Heads a saved population, followed by the random state of every island and
+// the inputs of every member of every island as floats, in the order of inputName().
+typedef struct
+{
+
+	char magic[8];
+	uint32_t islands, size;
+	uint64_t generation, evaluations;
+
+} PopulationHeader;
+
+// Prepare an optimization of the design with the given base parameters across
+// islands of size members each, every island drawing from its own stream of seed.
+void paretoInit( Pareto* p, Coil* base, int islands, int size, uint64_t seed );
+void paretoFree( Pareto* p );
+
+// Add a free input parameter given as NAME=lo:hi, an objective given as +NAME
+// to maximize or -NAME to minimize, or a constraint given as NAME=lo:hi.
+int paretoGene( Pareto* p, char* spec );
+int paretoObjective( Pareto* p, char* spec );
+int paretoConstraint( Pareto* p, char* spec );
+
+// Fill every island with designs drawn evenly across the free ranges.
+void paretoStart( Pareto* p );
+
+// Evolve every island for the given number of generations, spread across
+// threads, migrating between islands every p->migrate generations and calling
+// saved, unless it is NULL, after each migration. Results depend on the seed
+// and not on the number of threads.
+int paretoRun( Pareto* p, long generations, int threads, void (*saved)( Pareto* p, void* arg ), void* arg );
+
+// Gather the feasible designs of every island dominated by no other into a
+// newly allocated array, returning their number.
+int paretoFront( Pareto* p, Individual** front );
+
+// Save every population to file, or restore them, clamping the free inputs to
+// their ranges. Returns 0 on success.
+int paretoSave( Pareto* p, char* file );
+int paretoLoad( Pareto* p, char* file, uint64_t seed );
+
+// Return the next uniform deviate in [0, 1) of a splitmix64 stream.
+static double paretoUniform( uint64_t* s )
+{
+
+	uint64_t z = ( *s += 0x9e3779b97f4a7c15ULL );
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+	return ( ( z ^ ( z >> 31 ) ) >> 11 ) * 0x1.0p-53;
+
+}
+
+void paretoInit( Pareto* p, Coil* base, int islands, int size, uint64_t seed )
+{
+
+	int i;
+
+	memset( p, 0, sizeof *p );
+	p->base = *base;
+	p->islands = islands > 0 ? islands : 1;
+	p->size = size > 2 ? ( size + 1 ) & ~1 : 2;
+	p->migrate = 25;
+	p->migrants = 4;
+	p->island = calloc( p->islands, sizeof *p->island );
+	for ( i = 0; i < p->islands; i++ )
+	{
+
+		p->island[i].member = calloc( 2 * p->size, sizeof( Individual ) );
+		p->island[i].random = seed + 0x632be59bd9b4e019ULL * ( i + 1 );
+
+	}
+
+}
+
+void paretoFree( Pareto* p )
+{
+
+	int i;
+
+	for ( i = 0; i < p->islands; i++ ) free( p->island[i].member );
+	free( p->island );
+	p->island = NULL;
+
+}
+
+// Parse the range of a specification of the form NAME=lo:hi, returning the length of its name or -1.
+static int paretoRange( char* spec, double* lo, double* hi )
+{
+
+	char* equals = strchr( spec, '=' );
+	char* end;
+
+	if ( !equals ) return -1;
+	*lo = strtod( equals + 1, &end );
+	if ( *end != ':' ) return -1;
+	*hi = strtod( end + 1, &end );
+	if ( *end || !( *hi >= *lo ) ) return -1;
+	return equals - spec;
+
+}
+
+int paretoGene( Pareto* p, char* spec )
+{
+
+	double lo, hi;
+	int length = paretoRange( spec, &lo, &hi ), i, j, k;
+
+	for ( i = 0; length > 0 && i < INPUTS; i++ )
+		if ( strncmp( inputName( i ), spec, length ) == 0 && inputName( i )[length] == '\0' ) break;
+	if ( length <= 0 || i == INPUTS )
+	{
+
+		fprintf(stderr, "  %s not valid free input, expected NAME=lo:hi.\n", spec);
+		return 1;
+
+	}
+
+	// A parameter given twice takes its last range. Whole inputs keep to the
+	// whole values within it.
+	for ( j = 0; j < p->genes && p->gene[j].input != i; j++ );
+	p->gene[j].input = i;
+	p->gene[j].whole = 0;
+	for ( k = 0; k < (int)( sizeof paretoWhole / sizeof *paretoWhole ); k++ )
+		if ( strcmp( inputName( i ), paretoWhole[k] ) == 0 ) p->gene[j].whole = 1;
+	if ( p->gene[j].whole )
+	{
+
+		lo = ceil( lo );
+		hi = floor( hi );
+		if ( hi < lo )
+		{
+
+			fprintf(stderr, "  %s not valid free input, no whole value within its range.\n", spec);
+			return 1;
+
+		}
+
+	}
+	p->gene[j].lo = lo;
+	p->gene[j].hi = hi;
+	if ( j == p->genes ) p->genes++;
+	return 0;
+
+}
+
+int paretoObjective( Pareto* p, char* spec )
+{
+
+	int i = lookup( spec + 1, strlen( spec + 1 ) );
+	Objective* o = &p->objective[p->objectives];
+
+	if ( ( *spec != '+' && *spec != '-' ) || i < 0 || p->objectives == PARETO_OBJECTIVES )
+	{
+
+		fprintf(stderr, "  %s not valid objective, expected +NAME or -NAME.\n", spec);
+		return 1;
+
+	}
+
+	strcpy( o->name, registry[i].name );
+	o->offset = registry[i].offset;
+	o->sign = *spec == '+' ? -1.0 : 1.0;
+	p->objectives++;
+	return 0;
+
+}
+
+int paretoConstraint( Pareto* p, char* spec )
+{
+
+	double lo, hi;
+	int length = paretoRange( spec, &lo, &hi ), i;
+	Constraint* c = &p->constraint[p->constraints];
+
+	if ( length <= 0 || ( i = lookup( spec, length ) ) < 0 || p->constraints == PARETO_CONSTRAINTS )
+	{
+
+		fprintf(stderr, "  %s not valid constraint, expected NAME=lo:hi.\n", spec);
+		return 1;
+
+	}
+
+	strcpy( c->name, registry[i].name );
+	c->offset = registry[i].offset;
+	c->lo = lo;
+	c->hi = hi;
+	p->constraints++;
+	return 0;
+
+}
+
+// Calculate n designs with the batch pipeline, filling in their objectives and
+// violations. c has room for PARETO_LANES designs more than n, padded with the last.
+static void paretoEvaluate( Pareto* p, Individual* m, int n, Coil* c )
+{
+
+	double v, scale;
+	int i, j;
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		c[i] = p->base;
+		for ( j = 0; j < INPUTS; j++ ) *(float*)( (char*)&c[i] + registry[inputColumn[j]].offset ) = m[i].x[j];
+
+	}
+	for ( ; i % PARETO_LANES; i++ ) c[i] = c[n-1];
+	batchCoils( c, i );
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		m[i].violation = 0.0;
+		for ( j = 0; j < p->objectives; j++ )
+		{
+
+			v = *(float*)( (char*)&c[i] + p->objective[j].offset );
+			m[i].f[j] = p->objective[j].sign * v;
+			if ( !isfinite( v ) ) { m[i].violation = PARETO_INVALID; m[i].f[j] = 0.0; }
+
+		}
+		for ( j = 0; j < p->constraints; j++ )
+		{
+
+			Constraint* k = &p->constraint[j];
+			v = *(float*)( (char*)&c[i] + k->offset );
+			scale = k->hi > k->lo ? k->hi - k->lo : fabs( k->hi ) > 0.0 ? fabs( k->hi ) : 1.0;
+			if ( !isfinite( v ) ) m[i].violation = PARETO_INVALID;
+			else if ( v < k->lo ) m[i].violation += ( k->lo - v ) / scale;
+			else if ( v > k->hi ) m[i].violation += ( v - k->hi ) / scale;
+
+		}
+
+	}
+
+}
+
+// Return whether a dominates b: a feasible design dominates every infeasible
+// one, an infeasible one those violating the constraints more, and among
+// feasible designs one no worse in every objective and better in one.
+static int dominates( Pareto* p, Individual* a, Individual* b )
+{
+
+	int j, better = 0;
+
+	if ( a->violation != b->violation ) return a->violation < b->violation;
+	for ( j = 0; j < p->objectives; j++ )
+	{
+
+		if ( a->f[j] > b->f[j] ) return 0;
+		if ( a->f[j] < b->f[j] ) better = 1;
+
+	}
+	return better;
+
+}
+
+// Sort the n places of index by increasing key, stably.
+static void paretoSort( double* key, int* index, int* spare, int n )
+{
+
+	int width, lo, mid, hi, i, j, k;
+
+	for ( width = 1; width < n; width *= 2 )
+	{
+
+		for ( lo = 0; lo < n; lo += 2 * width )
+		{
+
+			mid = lo + width < n ? lo + width : n;
+			hi = lo + 2 * width < n ? lo + 2 * width : n;
+			for ( i = lo, j = mid, k = lo; k < hi; k++ )
+				spare[k] = j >= hi || ( i < mid && key[index[i]] <= key[index[j]] ) ? index[i++] : index[j++];
+
+		}
+		memcpy( index, spare, n * sizeof *index );
+
+	}
+
+}
+
+// Holds the scratch space of a thread evolving islands.
+typedef struct
+{
+
+	Coil* design;
+	Individual* kept;
+	char* dominated;
+	int *count, *order, *front, *spare;
+	double* key;
+
+} Scratch;
+
+static void scratchInit( Scratch* s, int size )
+{
+
+	int n = 2 * size;
+
+	s->design    = malloc( ( n + PARETO_LANES ) * sizeof *s->design );
+	s->kept      = malloc( n * sizeof *s->kept );
+	s->dominated = malloc( (size_t)n * n );
+	s->count     = malloc( n * sizeof *s->count );
+	s->order     = malloc( n * sizeof *s->order );
+	s->front     = malloc( n * sizeof *s->front );
+	s->spare     = malloc( n * sizeof *s->spare );
+	s->key       = malloc( n * sizeof *s->key );
+
+}
+
+static void scratchFree( Scratch* s )
+{
+
+	free( s->design );
+	free( s->kept );
+	free( s->dominated );
+	free( s->count );
+	free( s->order );
+	free( s->front );
+	free( s->spare );
+	free( s->key );
+
+}
+
+// Set the crowding distance of the n members of m listed in front.
+static void crowding( Pareto* p, Individual* m, int* front, int n, Scratch* s )
+{
+
+	double range;
+	int i, j;
+
+	for ( i = 0; i < n; i++ ) m[front[i]].crowding = 0.0;
+	for ( j = 0; j < p->objectives; j++ )
+	{
+
+		for ( i = 0; i < n; i++ ) s->key[front[i]] = m[front[i]].f[j];
+		paretoSort( s->key, front, s->spare, n );
+		range = m[front[n-1]].f[j] - m[front[0]].f[j];
+		m[front[0]].crowding = m[front[n-1]].crowding = HUGE_VAL;
+		if ( range > 0.0 )
+			for ( i = 1; i < n - 1; i++ ) m[front[i]].crowding += ( m[front[i+1]].f[j] - m[front[i-1]].f[j] ) / range;
+
+	}
+
+}
+
+// Order members by their inputs, which ties between equal objectives are broken by.
+static int canonical( const void* a, const void* b )
+{
+
+	return memcmp( ( (const Individual*)a )->x, ( (const Individual*)b )->x, sizeof( float ) * INPUTS );
+
+}
+
+// Rank the n members of m by fast non-dominated sorting and crowding, keeping
+// the best keep of them, in order of rank and then of crowding, in its first
+// places. The outcome depends on the members alone and not their order, so a
+// population restored from a file evolves as it would have unbroken.
+static void survive( Pareto* p, Individual* m, int n, int keep, Scratch* s )
+{
+
+	int i, j, fronts, size, kept = 0, rank = 0, last;
+
+	qsort( m, n, sizeof *m, canonical );
+	for ( i = 0; i < n; i++ )
+	{
+
+		s->count[i] = 0;
+		for ( j = 0; j < n; j++ ) s->dominated[i*n+j] = i != j && dominates( p, &m[i], &m[j] );
+
+	}
+	for ( i = 0; i < n; i++ )
+		for ( j = 0; j < n; j++ ) s->count[j] += s->dominated[i*n+j];
+
+	// Peel off each front in turn, order holding the members of every front found so far.
+	for ( fronts = 0, i = 0; i < n; i++ )
+		if ( s->count[i] == 0 ) s->order[fronts++] = i;
+	for ( last = 0; kept < keep; rank++ )
+	{
+
+		size = fronts - last;
+		for ( i = last; i < fronts; i++ ) m[s->order[i]].rank = rank;
+		memcpy( s->front, s->order + last, size * sizeof *s->front );
+		crowding( p, m, s->front, size, s );
+
+		// The last front to fit in part keeps its least crowded members.
+		if ( kept + size > keep )
+		{
+
+			for ( i = 0; i < size; i++ ) s->key[s->front[i]] = -m[s->front[i]].crowding;
+			paretoSort( s->key, s->front, s->spare, size );
+			size = keep - kept;
+
+		}
+		for ( i = 0; i < size; i++ ) s->kept[kept++] = m[s->front[i]];
+
+		for ( i = last, last = fronts; i < last; i++ )
+			for ( j = 0; j < n; j++ )
+				if ( s->dominated[s->order[i]*n+j] && --s->count[j] == 0 ) s->order[fronts++] = j;
+
+	}
+
+	memcpy( m, s->kept, keep * sizeof *m );
+
+}
+
+// Return the member of the parents winning a binary tournament.
+static Individual* tournament( Island* island, int size )
+{
+
+	Individual* a = &island->member[(int)( paretoUniform( &island->random ) * size )];
+	Individual* b = &island->member[(int)( paretoUniform( &island->random ) * size )];
+
+	if ( a->rank != b->rank ) return a->rank < b->rank ? a : b;
+	return a->crowding >= b->crowding ? a : b;
+
+}
+
+// Breed two children from two parents by simulated binary crossover of each
+// free input, then polynomial mutation of one free input on average.
+static void breed( Pareto* p, Island* island, Individual* a, Individual* b, Individual* c, Individual* d )
+{
+
+	double u, beta, x1, x2, y1, y2, lo, hi, delta;
+	Individual* child[2];
+	int g, k, i;
+
+	*c = *a;
+	*d = *b;
+	child[0] = c;
+	child[1] = d;
+	for ( g = 0; g < p->genes; g++ )
+	{
+
+		i = p->gene[g].input;
+		lo = p->gene[g].lo;
+		hi = p->gene[g].hi;
+		x1 = a->x[i];
+		x2 = b->x[i];
+
+		if ( paretoUniform( &island->random ) < 0.5 && fabs( x1 - x2 ) > 1.0e-12 * ( hi - lo ) )
+		{
+
+			u = paretoUniform( &island->random );
+			beta = u <= 0.5 ? pow( 2.0 * u, 1.0 / ( PARETO_CROSSOVER + 1.0 ) )
+				: pow( 0.5 / ( 1.0 - u ), 1.0 / ( PARETO_CROSSOVER + 1.0 ) );
+			y1 = 0.5 * ( ( 1.0 + beta ) * x1 + ( 1.0 - beta ) * x2 );
+			y2 = 0.5 * ( ( 1.0 - beta ) * x1 + ( 1.0 + beta ) * x2 );
+			c->x[i] = fmin( fmax( y1, lo ), hi );
+			d->x[i] = fmin( fmax( y2, lo ), hi );
+
+		}
+
+		for ( k = 0; k < 2; k++ )
+			if ( paretoUniform( &island->random ) * p->genes < 1.0 )
+			{
+
+				u = paretoUniform( &island->random );
+				delta = u < 0.5 ? pow( 2.0 * u, 1.0 / ( PARETO_MUTATION + 1.0 ) ) - 1.0
+					: 1.0 - pow( 2.0 * ( 1.0 - u ), 1.0 / ( PARETO_MUTATION + 1.0 ) );
+				child[k]->x[i] = fmin( fmax( child[k]->x[i] + delta * ( hi - lo ), lo ), hi );
+
+			}
+
+		// Whole inputs are rounded before the children are calculated, and so
+		// are saved as built.
+		if ( p->gene[g].whole )
+			for ( k = 0; k < 2; k++ ) child[k]->x[i] = rint( child[k]->x[i] );
+
+	}
+
+}
+
+// Evolve an island by one generation.
+static void generation( Pareto* p, Island* island, Scratch* s )
+{
+
+	Individual* m = island->member;
+	int i;
+
+	for ( i = 0; i < p->size; i += 2 )
+		breed( p, island, tournament( island, p->size ), tournament( island, p->size ), &m[p->size+i], &m[p->size+i+1] );
+	paretoEvaluate( p, m + p->size, p->size, s->design );
+	survive( p, m, 2 * p->size, p->size, s );
+
+	// Parents are ranked again among themselves, so they carry nothing of their
+	// rejected children a saved population could not restore.
+	survive( p, m, p->size, p->size, s );
+
+}
+
+void paretoStart( Pareto* p )
+{
+
+	Scratch s;
+	Island* island;
+	int i, g, k;
+
+	scratchInit( &s, p->size );
+	for ( k = 0; k < p->islands; k++ )
+	{
+
+		island = &p->island[k];
+		for ( i = 0; i < p->size; i++ )
+		{
+
+			for ( g = 0; g < INPUTS; g++ )
+				island->member[i].x[g] = *(float*)( (char*)&p->base + registry[inputColumn[g]].offset );
+			for ( g = 0; g < p->genes; g++ )
+			{
+
+				float* x = &island->member[i].x[p->gene[g].input];
+				*x = p->gene[g].lo + ( p->gene[g].hi - p->gene[g].lo ) * paretoUniform( &island->random );
+				if ( p->gene[g].whole ) *x = rint( *x );
+
+			}
+
+		}
+		paretoEvaluate( p, island->member, p->size, s.design );
+		survive( p, island->member, p->size, p->size, &s );
+
+	}
+	p->evaluations += (long)p->islands * p->size;
+	scratchFree( &s );
+
+}
+
+// Holds the islands left to evolve through an epoch between migrations.
+typedef struct
+{
+
+	Pareto* p;
+	long generations;
+	int next;
+	pthread_mutex_t lock;
+
+} Epoch;
+
+static void* evolver( void* arg )
+{
+
+	Epoch* e = arg;
+	Pareto* p = e->p;
+	Scratch s;
+	long g;
+	int k;
+
+	scratchInit( &s, p->size );
+	for ( ;; )
+	{
+
+		pthread_mutex_lock( &e->lock );
+		k = e->next++;
+		pthread_mutex_unlock( &e->lock );
+		if ( k >= p->islands ) break;
+		for ( g = 0; g < e->generations; g++ ) generation( p, &p->island[k], &s );
+
+	}
+	scratchFree( &s );
+	return NULL;
+
+}
+
+// Send the best migrants of each island around the ring in place of the worst of the next.
+static void migrate( Pareto* p )
+{
+
+	int n = p->migrants < p->size / 2 ? p->migrants : p->size / 2, k, i;
+	Individual* sent = malloc( (size_t)p->islands * ( n > 0 ? n : 1 ) * sizeof *sent );
+	Scratch s;
+
+	if ( p->islands < 2 || n <= 0 ) { free( sent ); return; }
+	for ( k = 0; k < p->islands; k++ ) memcpy( sent + k * n, p->island[k].member, n * sizeof *sent );
+
+	scratchInit( &s, p->size );
+	for ( k = 0; k < p->islands; k++ )
+	{
+
+		Individual* m = p->island[( k + 1 ) % p->islands].member;
+		for ( i = 0; i < n; i++ ) m[p->size-n+i] = sent[k*n+i];
+		survive( p, m, p->size, p->size, &s );
+
+	}
+	scratchFree( &s );
+	free( sent );
+
+}
+
+int paretoRun( Pareto* p, long generations, int threads, void (*saved)( Pareto* p, void* arg ), void* arg )
+{
+
+	pthread_t thread[threads > p->islands ? p->islands : threads];
+	long done, step;
+	Epoch e;
+	int t, n = threads > p->islands ? p->islands : threads;
+
+	pthread_mutex_init( &e.lock, NULL );
+	e.p = p;
+	for ( done = 0; done < generations; done += step )
+	{
+
+		// Epochs end where the generation count reaches a multiple of the migration interval,
+		// so a run resumed from a saved population migrates where an unbroken run would.
+		step = p->migrate - p->generation % p->migrate;
+		if ( step > generations - done ) step = generations - done;
+		e.generations = step;
+		e.next = 0;
+
+		for ( t = 0; t < n; t++ )
+			if ( pthread_create( &thread[t], NULL, evolver, &e ) ) break;
+		if ( t == 0 ) evolver( &e );
+		while ( t > 0 ) pthread_join( thread[--t], NULL );
+
+		p->generation += step;
+		p->evaluations += step * p->islands * p->size;
+		if ( p->generation % p->migrate == 0 )
+		{
+
+			migrate( p );
+			if ( saved ) saved( p, arg );
+
+		}
+
+	}
+	pthread_mutex_destroy( &e.lock );
+	return 0;
+
+}
+
+int paretoFront( Pareto* p, Individual** front )
+{
+
+	int n = 0, k, i, j, same;
+	Individual* f = malloc( (size_t)p->islands * p->size * sizeof *f );
+
+	for ( k = 0; k < p->islands; k++ )
+		for ( i = 0; i < p->size; i++ )
+		{
+
+			Individual* m = &p->island[k].member[i];
+			if ( m->rank != 0 || m->violation > 0.0 ) continue;
+
+			// Keep the design unless one already kept dominates or repeats it,
+			// dropping those it dominates.
+			for ( same = 0, j = 0; j < n && !same; j++ )
+				same = dominates( p, &f[j], m ) || memcmp( f[j].x, m->x, sizeof m->x ) == 0;
+			if ( same ) continue;
+			for ( j = 0; j < n; j++ )
+				if ( dominates( p, m, &f[j] ) ) f[j--] = f[--n];
+			f[n++] = *m;
+
+		}
+
+	*front = f;
+	return n;
+
+}
+
+int paretoSave( Pareto* p, char* file )
+{
+
+	PopulationHeader h;
+	char temporary[strlen( file ) + 5];
+	FILE* out;
+	int k, i, failed = 0;
+
+	memset( &h, 0, sizeof h );
+	memcpy( h.magic, "TSPOP1", 6 );
+	h.islands = p->islands;
+	h.size = p->size;
+	h.generation = p->generation;
+	h.evaluations = p->evaluations;
+
+	// Written aside and renamed over the old file, so an interrupted save leaves the last one whole.
+	sprintf(temporary, "%s.new", file);
+	if ( !( out = fopen( temporary, "wb" ) ) ) return 1;
+	failed |= fwrite( &h, sizeof h, 1, out ) != 1;
+	for ( k = 0; k < p->islands; k++ ) failed |= fwrite( &p->island[k].random, sizeof( uint64_t ), 1, out ) != 1;
+	for ( k = 0; k < p->islands; k++ )
+		for ( i = 0; i < p->size; i++ ) failed |= fwrite( p->island[k].member[i].x, sizeof( float ), INPUTS, out ) != INPUTS;
+	failed |= fclose( out ) != 0;
+	if ( failed || rename( temporary, file ) ) { unlink( temporary ); return 1; }
+	return 0;
+
+}
+
+int paretoLoad( Pareto* p, char* file, uint64_t seed )
+{
+
+	PopulationHeader h;
+	Pareto q = *p;
+	FILE* in = fopen( file, "rb" );
+	Scratch s;
+	int k, i, g, failed;
+
+	if ( !in ) return 1;
+	if ( fread( &h, sizeof h, 1, in ) != 1 || memcmp( h.magic, "TSPOP1", 7 ) || h.islands == 0 || h.size < 2 || h.size & 1 )
+	{
+
+		fclose( in );
+		return 1;
+
+	}
+
+	// The populations take the shape saved, whatever was asked for.
+	paretoInit( &q, &p->base, h.islands, h.size, seed );
+	memcpy( q.gene, p->gene, sizeof q.gene );
+	memcpy( q.objective, p->objective, sizeof q.objective );
+	memcpy( q.constraint, p->constraint, sizeof q.constraint );
+	q.genes = p->genes;
+	q.objectives = p->objectives;
+	q.constraints = p->constraints;
+	q.migrate = p->migrate;
+	q.migrants = p->migrants;
+	q.generation = h.generation;
+	q.evaluations = h.evaluations;
+
+	for ( failed = 0, k = 0; k < q.islands; k++ ) failed |= fread( &q.island[k].random, sizeof( uint64_t ), 1, in ) != 1;
+	for ( k = 0; k < q.islands; k++ )
+		for ( i = 0; i < q.size; i++ ) failed |= fread( q.island[k].member[i].x, sizeof( float ), INPUTS, in ) != INPUTS;
+	fclose( in );
+	if ( failed )
+	{
+
+		paretoFree( &q );
+		return 1;
+
+	}
+
+	// Members are ranked afresh, as the objectives or ranges may have changed since.
+	scratchInit( &s, q.size );
+	for ( k = 0; k < q.islands; k++ )
+	{
+
+		for ( i = 0; i < q.size; i++ )
+			for ( g = 0; g < q.genes; g++ )
+			{
+
+				float* x = &q.island[k].member[i].x[q.gene[g].input];
+				*x = fmin( fmax( *x, q.gene[g].lo ), q.gene[g].hi );
+
+			}
+		paretoEvaluate( &q, q.island[k].member, q.size, s.design );
+		survive( &q, q.island[k].member, q.size, q.size, &s );
+
+	}
+	scratchFree( &s );
+
+	paretoFree( p );
+	*p = q;
+	return 0;
+
+}
+
+#endif
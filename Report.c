@@ -0,0 +1,233 @@
+#ifndef REPORT_C
+#define REPORT_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "Coil.c"
+
+// Return the SI prefix of a value along with the factor that scales into it,
+// using prefix itself unless it is 0. Defined in Shared.c.
+extern char SIscale( double value, char prefix, double* factor );
+
+// Format value scaled to its SI prefix as printf's "%*.*f" followed by the
+// prefix and unit would, returning the length. Defined in Shared.c.
+extern int SIformat( char* buffer, double value, int width, int precision, char prefix, char* unit );
+
+// Holds text being built up in memory to be written out in one go.
+//  - text:   The text itself, always terminated.
+//  - length: Number of bytes of text.
+//  - size:   Number of bytes allocated for text.
+//  - prefix: SI prefix every value is given in, or 0 to choose one per value.
+typedef struct
+{
+
+	char* text;
+	size_t length, size;
+	char prefix;
+
+} Text;
+
+void textInit( Text* t );
+void textFree( Text* t );
+
+// Append to the text as strcat, printf and center would.
+void textAppend( Text* t, const char* s );
+void textPrintf( Text* t, const char* format, ... );
+void textCenter( Text* t, char* begin, char* text, int col, char pad, char* end );
+
+// Append value scaled to its SI prefix, as "%*.*f%c%s" with the SI prefix and unit.
+void textSI( Text* t, double value, int width, int precision, char* unit );
+
+// Write out the text with a single call and empty it, returning 1 on failure.
+int textFlush( Text* t, FILE* out );
+
+// Append the full TeslaStats report of a calculated design, with its banners col wide.
+void report( Text* t, Coil* c, int col );
+
+void textInit( Text* t )
+{
+
+	t->size   = 4096;
+	t->text   = malloc( t->size );
+	t->length = 0;
+	t->prefix = 0;
+	t->text[0] = '\0';
+
+}
+
+void textFree( Text* t )
+{
+
+	free( t->text );
+	t->text = NULL;
+
+}
+
+// Return room for at least n more bytes of text and its terminator.
+static char* textRoom( Text* t, size_t n )
+{
+
+	if ( t->length + n + 1 > t->size )
+	{
+
+		while ( t->length + n + 1 > t->size ) t->size *= 2;
+		t->text = realloc( t->text, t->size );
+
+	}
+
+	return t->text + t->length;
+
+}
+
+void textAppend( Text* t, const char* s )
+{
+
+	size_t n = strlen( s );
+	memcpy( textRoom( t, n ), s, n + 1 );
+	t->length += n;
+
+}
+
+void textPrintf( Text* t, const char* format, ... )
+{
+
+	va_list args;
+	int n;
+
+	va_start( args, format );
+	n = vsnprintf( t->text + t->length, t->size - t->length, format, args );
+	va_end( args );
+	if ( n >= 0 && t->length + n + 1 > t->size )
+	{
+
+		textRoom( t, n );
+		va_start( args, format );
+		vsnprintf( t->text + t->length, t->size - t->length, format, args );
+		va_end( args );
+
+	}
+	if ( n > 0 ) t->length += n;
+
+}
+
+void textCenter( Text* t, char* begin, char* text, int col, char pad, char* end )
+{
+
+	int length = strlen( text );
+	int j = 0.5 * ( col - length - 2 ), i;
+	char* p;
+
+	textAppend( t, begin );
+	p = textRoom( t, ( col > length + 2 ? col : length + 2 ) + 2 );
+	for ( i = 0; i < j; i++ ) *p++ = pad;
+	if ( *text != '\0' ) { *p++ = ' '; memcpy( p, text, length ); p += length; *p++ = ' '; }
+	else { *p++ = pad; *p++ = pad; }
+	for ( i = j + 2 + length; i < col; i++ ) *p++ = pad;
+	*p = '\0';
+	t->length = p - t->text;
+	textAppend( t, end );
+
+}
+
+void textSI( Text* t, double value, int width, int precision, char* unit )
+{
+
+	char* p = textRoom( t, ( width > 0 ? width : 0 ) + precision + strlen( unit ) + 320 );
+	t->length += SIformat( p, value, width, precision, t->prefix, unit );
+
+}
+
+int textFlush( Text* t, FILE* out )
+{
+
+	size_t n = fwrite( t->text, 1, t->length, out );
+	int failed = n != t->length || fflush( out ) != 0;
+
+	t->length = 0;
+	t->text[0] = '\0';
+	return failed;
+
+}
+
+// Append the start of a line of the report with its label padded to a column.
+static void reportLabel( Text* t, char* label )
+{
+
+	size_t n = strlen( label );
+	char* p = textRoom( t, n + 20 );
+
+	*p++ = ' ';
+	*p++ = ' ';
+	memcpy( p, label, n );
+	for ( p += n; n < 18; n++ ) *p++ = ' ';
+	*p = '\0';
+	t->length = p - t->text;
+
+}
+
+// Append a line of the report holding the named parameter.
+static void reportLine( Text* t, Coil* c, char* param )
+{
+
+	Parameter* p = &registry[lookup( param, strlen( param ) )];
+
+	reportLabel( t, p->label );
+	textSI( t, *(float*)( (char*)c + p->offset ), 6, 2, p->unit );
+	textAppend( t, "\n" );
+
+}
+
+// Append a line of the report holding a voltage, current and frequency.
+static void reportVAF( Text* t, char* label, float V, float A, float F )
+{
+
+	reportLabel( t, label );
+	textSI( t, V, 6, 2, "V " );
+	textSI( t, A, 6, 2, "A " );
+	textSI( t, F, 6, 2, "Hz\n" );
+
+}
+
+void report( Text* t, Coil* c, int col )
+{
+
+	static char* primary[]   = { "PRILR", "PRIWG", "PRIWD", "PRIN", "PRILN", "PRIRI", "PRIS", "PRIRO", "PRIL", "PRIF" };
+	static char* secondary[] = { "SECD", "SECH", "SECHD", "SECWG", "SECWD", "SECLN", "SECN", "SECL", "SECC", "SECF" };
+	int i;
+
+	textCenter( t, "\n", "Neon Sign Transformer", col, '=', "\n\n" );
+	reportVAF( t, "Input (RMS):",   c->NSTVI,  c->NSTII,  c->NSTF );
+	reportVAF( t, "Input (Peak):",  c->NSTVIP, c->NSTIIP, c->NSTF );
+	reportVAF( t, "Output (RMS):",  c->NSTVO,  c->NSTIO,  c->NSTF );
+	reportVAF( t, "Output (Peak):", c->NSTVOP, c->NSTIOP, c->NSTF );
+	reportLine( t, c, "NSTTR" );
+	reportLine( t, c, "NSTVA" );
+	reportLine( t, c, "NSTPF" );
+	reportLine( t, c, "NSTZ"  );
+
+	textCenter( t, "\n", "Primary Tank Capacitor", col, '=', "\n\n" );
+	reportLine( t, c, "PTCCR" );
+	reportLine( t, c, "PTCC"  );
+	reportLine( t, c, "LTRCS" );
+	reportLine( t, c, "LTRCR" );
+
+	textCenter( t, "\n", "Primary Coil", col, '=', "\n\n" );
+	for ( i = 0; i < 10; i++ ) reportLine( t, c, primary[i] );
+
+	textCenter( t, "\n", "Secondary Coil", col, '=', "\n\n" );
+	for ( i = 0; i < 10; i++ ) reportLine( t, c, secondary[i] );
+
+	textCenter( t, "\n", "Spherical Top Load", col, '=', "\n\n" );
+	reportLine( t, c, "TOPD" );
+	reportLine( t, c, "TOPC" );
+
+	textCenter( t, "\n", "Miscellaneous", col, '=', "\n\n" );
+	reportLine( t, c, "ARCLN" );
+
+	textCenter( t, "\n", "", col, '=', "\n\n" );
+
+}
+
+#endif
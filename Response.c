@@ -0,0 +1,431 @@
+#ifndef RESPONSE_C
+#define RESPONSE_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <pthread.h>
+#include <immintrin.h>
+#include "Coil.c"
+
+// Only _Complex_I is used, keeping I free for the programs including this file.
+#undef I
+
+// Number of frequencies held in cache at a time while every tank capacitance
+// is scanned across them, their angular frequencies filling 16KB.
+#define RESPONSE_BLOCK 4096
+
+// Holds the circuit charging the tank: the open circuit voltage of the NST
+// behind its leakage inductance and winding resistance, referred to its
+// secondary, across the tank capacitor, with the PFC capacitor across the
+// mains. The magnetizing current of the NST is not modeled.
+//  - L:  Leakage inductance of the NST in henries, NSTZ at the mains frequency.
+//  - R:  Resistance of the NST windings in ohms, NSTR.
+//  - TR: Turn ratio of the NST.
+//  - PF: PFC capacitance across the mains in farads.
+//  - f:  Mains frequency in hertz.
+//  - VI: RMS mains voltage in volts.
+typedef struct
+{
+
+	double L, R, TR, PF, f, VI;
+
+} Charger;
+
+// Holds a log spaced grid of frequencies.
+//  - lo, hi: Lowest and highest frequency in hertz.
+//  - points: Number of frequencies, at least 3.
+//  - w:      Angular frequency of each point.
+typedef struct
+{
+
+	double lo, hi;
+	long points;
+	float* w;
+
+} Response;
+
+// Holds what the response of the circuit with one tank capacitance found.
+//  - C:      Tank capacitance in farads.
+//  - peak:   Frequency of the largest tank voltage in hertz.
+//  - gain:   Largest ratio of tank voltage to the open circuit voltage of the NST.
+//  - margin: Distance of the peak from the mains frequency as a fraction of it, negative below it.
+//  - mains:  Ratio of tank voltage to open circuit voltage at the mains frequency.
+//  - line:   RMS line current at the mains voltage and frequency in amps.
+//  - edge:   Whether the largest gain lies at an end of the grid, so the peak, if any, is outside it.
+typedef struct
+{
+
+	double C, peak, gain, margin, mains, line;
+	int edge;
+
+} Resonance;
+
+// Set up the charging circuit of a calculated design.
+void chargerInit( Charger* k, Coil* c );
+
+// Return the complex ratio of the tank voltage to the open circuit voltage of
+// the NST, and the complex admittance the circuit presents to the mains, with a
+// tank capacitance C at frequency f.
+double complex chargerGain( Charger* k, double C, double f );
+double complex chargerAdmittance( Charger* k, double C, double f );
+
+// Lay out a grid of points frequencies from lo to hi. Returns 1 if they cannot be held.
+int responseInit( Response* r, double lo, double hi, long points );
+void responseFree( Response* r );
+
+// Return the frequency at a possibly fractional index of the grid.
+double responseFrequency( Response* r, double index );
+
+// Find the resonance with each of n tank capacitances C across the grid,
+// splitting the grid across the given number of threads.
+void responseScan( Response* r, Charger* k, int n, const double* C, Resonance* res, int threads );
+
+// Return the name of the kernel used by responseScan.
+char* responseKernel();
+
+void chargerInit( Charger* k, Coil* c )
+{
+
+	k->L  = c->NSTZ / ( 2.0 * PI * c->NSTF );
+	k->R  = c->NSTR;
+	k->TR = c->NSTTR;
+	k->PF = c->NSTPF;
+	k->f  = c->NSTF;
+	k->VI = c->NSTVI;
+
+}
+
+// The tank and the impedance feeding it divide the open circuit voltage:
+// 1/jwC over R + jwL + 1/jwC is 1/(1 - w^2LC + jwRC).
+double complex chargerGain( Charger* k, double C, double f )
+{
+
+	double w = 2.0 * PI * f;
+
+	return 1.0 / ( 1.0 - w * w * k->L * C + w * k->R * C * _Complex_I );
+
+}
+
+// The secondary loop draws TR^2 times its current from the mains, and its
+// impedance is 1/jwC over the gain, beside the PFC capacitor's jwPF.
+double complex chargerAdmittance( Charger* k, double C, double f )
+{
+
+	double w = 2.0 * PI * f;
+
+	return w * _Complex_I * ( k->PF + C * k->TR * k->TR * chargerGain( k, C, f ) );
+
+}
+
+int responseInit( Response* r, double lo, double hi, long points )
+{
+
+	double step = log( hi / lo ) / ( points - 1 );
+	long i;
+
+	r->lo = lo;
+	r->hi = hi;
+	r->points = points;
+	if ( !( r->w = malloc( points * sizeof *r->w ) ) ) return 1;
+	for ( i = 0; i < points; i++ ) r->w[i] = 2.0 * PI * lo * exp( step * i );
+	return 0;
+
+}
+
+void responseFree( Response* r )
+{
+
+	free( r->w );
+	r->w = NULL;
+
+}
+
+double responseFrequency( Response* r, double index )
+{
+
+	return r->lo * exp( log( r->hi / r->lo ) * index / ( r->points - 1 ) );
+
+}
+
+// The kernels take the squared magnitude of the complex denominator of the
+// gain, (1 - w^2a)^2 + (wb)^2 with a = LC and b = RC, at n angular frequencies
+// w. Its least is the largest gain. If it is below *least, *least is lowered
+// to it and the index of its first occurrence returned, or -1 if not.
+static int responseScalar( const float* w, int n, float a, float b, float* least )
+{
+
+	float re, im, d;
+	int j, at = -1;
+
+	for ( j = 0; j < n; j++ )
+	{
+
+		re = 1.0f - w[j] * w[j] * a;
+		im = w[j] * b;
+		d = re * re + im * im;
+		if ( d < *least ) { *least = d; at = j; }
+
+	}
+
+	return at;
+
+}
+
+// Pick the least of the lanes of a vector kernel, the earliest on a tie, then
+// carry on with the points left over past its last whole vector.
+static int responseLanes( const float* value, const int* index, int lanes,
+	const float* w, int j, int n, float a, float b, float* least )
+{
+
+	int k, at = -1, tail;
+
+	for ( k = 0; k < lanes; k++ )
+		if ( index[k] >= 0 && ( value[k] < *least || ( value[k] == *least && index[k] < at ) ) )
+		{
+
+			*least = value[k];
+			at = index[k];
+
+		}
+
+	tail = responseScalar( w + j, n - j, a, b, least );
+	return tail >= 0 ? j + tail : at;
+
+}
+
+__attribute__((target("avx512f")))
+static int responseAVX512( const float* w, int n, float a, float b, float* least )
+{
+
+	const __m512 one = _mm512_set1_ps( 1.0f ), A = _mm512_set1_ps( a ), B = _mm512_set1_ps( b );
+	const __m512i step = _mm512_set1_epi32( 16 );
+	__m512 x, re, im, d, best = _mm512_set1_ps( *least );
+	__m512i index = _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+	__m512i at = _mm512_set1_epi32( -1 );
+	__mmask16 m;
+	float value[16];
+	int lane[16], j;
+
+	for ( j = 0; j + 16 <= n; j += 16 )
+	{
+
+		x = _mm512_loadu_ps( w + j );
+		re = _mm512_fnmadd_ps( _mm512_mul_ps( x, x ), A, one );
+		im = _mm512_mul_ps( x, B );
+		d = _mm512_fmadd_ps( re, re, _mm512_mul_ps( im, im ) );
+		m = _mm512_cmp_ps_mask( d, best, _CMP_LT_OQ );
+		best = _mm512_mask_mov_ps( best, m, d );
+		at = _mm512_mask_mov_epi32( at, m, index );
+		index = _mm512_add_epi32( index, step );
+
+	}
+
+	_mm512_storeu_ps( value, best );
+	_mm512_storeu_si512( lane, at );
+	return responseLanes( value, lane, 16, w, j, n, a, b, least );
+
+}
+
+__attribute__((target("avx2,fma")))
+static int responseAVX2( const float* w, int n, float a, float b, float* least )
+{
+
+	const __m256 one = _mm256_set1_ps( 1.0f ), A = _mm256_set1_ps( a ), B = _mm256_set1_ps( b );
+	const __m256i step = _mm256_set1_epi32( 8 );
+	__m256 x, re, im, d, m, best = _mm256_set1_ps( *least );
+	__m256i index = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ), at = _mm256_set1_epi32( -1 );
+	float value[8];
+	int lane[8], j;
+
+	for ( j = 0; j + 8 <= n; j += 8 )
+	{
+
+		x = _mm256_loadu_ps( w + j );
+		re = _mm256_fnmadd_ps( _mm256_mul_ps( x, x ), A, one );
+		im = _mm256_mul_ps( x, B );
+		d = _mm256_fmadd_ps( re, re, _mm256_mul_ps( im, im ) );
+		m = _mm256_cmp_ps( d, best, _CMP_LT_OQ );
+		best = _mm256_blendv_ps( best, d, m );
+		at = _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( at ), _mm256_castsi256_ps( index ), m ) );
+		index = _mm256_add_epi32( index, step );
+
+	}
+
+	_mm256_storeu_ps( value, best );
+	_mm256_storeu_si256( (__m256i*)lane, at );
+	return responseLanes( value, lane, 8, w, j, n, a, b, least );
+
+}
+
+// Kernel chosen for this processor the first time a response is scanned.
+static int (*responseChosen)( const float* w, int n, float a, float b, float* least ) = NULL;
+static char* responseName = "scalar";
+
+static void responseChoose()
+{
+
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx512f" ) )
+	{
+
+		responseChosen = responseAVX512;
+		responseName = "avx512";
+
+	}
+	else if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+	{
+
+		responseChosen = responseAVX2;
+		responseName = "avx2";
+
+	}
+	else responseChosen = responseScalar;
+
+}
+
+char* responseKernel()
+{
+
+	if ( !responseChosen ) responseChoose();
+	return responseName;
+
+}
+
+// Holds what a thread scans, the points from first up to last.
+//  - r:        Grid being scanned.
+//  - first:    First point of the thread.
+//  - last:     Point past the last of the thread.
+//  - n:        Number of tank capacitances.
+//  - a, b:     LC and RC of each capacitance.
+//  - least:    Least squared denominator of each capacitance found by the thread.
+//  - at:       Point at which each least was found, or -1.
+typedef struct
+{
+
+	Response* r;
+	long first, last;
+	int n;
+	float *a, *b, *least;
+	long* at;
+
+} Span;
+
+// Every capacitance is scanned across a block of RESPONSE_BLOCK points before
+// moving on, so that the block stays in cache while it is reused.
+static void* responseSpan( void* arg )
+{
+
+	Span* s = arg;
+	long j;
+	int i, m, at;
+
+	for ( i = 0; i < s->n; i++ )
+	{
+
+		s->least[i] = INFINITY;
+		s->at[i] = -1;
+
+	}
+	for ( j = s->first; j < s->last; j += RESPONSE_BLOCK )
+	{
+
+		m = s->last - j < RESPONSE_BLOCK ? s->last - j : RESPONSE_BLOCK;
+		for ( i = 0; i < s->n; i++ )
+			if ( ( at = responseChosen( s->r->w + j, m, s->a[i], s->b[i], &s->least[i] ) ) >= 0 ) s->at[i] = j + at;
+
+	}
+
+	return NULL;
+
+}
+
+void responseScan( Response* r, Charger* k, int n, const double* C, Resonance* res, int threads )
+{
+
+	float* a = malloc( ( 2 + threads ) * n * sizeof( float ) );
+	long* at = malloc( threads * n * sizeof( long ) );
+	long blocks = ( r->points + RESPONSE_BLOCK - 1 ) / RESPONSE_BLOCK, best;
+	pthread_t thread[threads];
+	Span span[threads];
+	int started[threads], i, t;
+	double d[3], delta;
+
+	if ( !responseChosen ) responseChoose();
+	for ( i = 0; i < n; i++ )
+	{
+
+		a[i] = k->L * C[i];
+		a[n + i] = k->R * C[i];
+
+	}
+
+	// Each thread takes a run of whole blocks; those of threads that cannot be started are scanned here.
+	for ( t = 0; t < threads; t++ )
+	{
+
+		span[t].r = r;
+		span[t].first = blocks * t / threads * RESPONSE_BLOCK;
+		span[t].last = blocks * ( t + 1 ) / threads * RESPONSE_BLOCK;
+		if ( span[t].last > r->points ) span[t].last = r->points;
+		span[t].n = n;
+		span[t].a = a;
+		span[t].b = a + n;
+		span[t].least = a + ( 2 + t ) * n;
+		span[t].at = at + t * n;
+		started[t] = t > 0 && pthread_create( &thread[t], NULL, responseSpan, &span[t] ) == 0;
+
+	}
+	for ( t = 0; t < threads; t++ )
+		if ( !started[t] ) responseSpan( &span[t] );
+	for ( t = 1; t < threads; t++ )
+		if ( started[t] ) pthread_join( thread[t], NULL );
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		// The spans run in order, so the earliest of equal leasts comes first.
+		for ( best = -1, t = 0; t < threads; t++ )
+			if ( span[t].at[i] >= 0 && ( best < 0 || span[t].least[i] < span[0].least[i] ) )
+			{
+
+				best = span[t].at[i];
+				span[0].least[i] = span[t].least[i];
+
+			}
+		if ( best < 0 ) best = 0;
+
+		// The peak is placed between points by the parabola through the
+		// squared denominators about the least, worked again in double.
+		res[i].C = C[i];
+		res[i].edge = best == 0 || best == r->points - 1;
+		delta = 0.0;
+		if ( !res[i].edge )
+		{
+
+			for ( t = 0; t < 3; t++ )
+			{
+
+				double complex g = chargerGain( k, C[i], responseFrequency( r, best - 1 + t ) );
+				d[t] = 1.0 / ( creal( g ) * creal( g ) + cimag( g ) * cimag( g ) );
+
+			}
+			if ( d[0] - 2.0 * d[1] + d[2] > 0.0 ) delta = 0.5 * ( d[0] - d[2] ) / ( d[0] - 2.0 * d[1] + d[2] );
+
+		}
+		res[i].peak = responseFrequency( r, best + delta );
+		res[i].gain = cabs( chargerGain( k, C[i], res[i].peak ) );
+		res[i].margin = res[i].edge ? NAN : ( res[i].peak - k->f ) / k->f;
+		res[i].mains = cabs( chargerGain( k, C[i], k->f ) );
+		res[i].line = k->VI * cabs( chargerAdmittance( k, C[i], k->f ) );
+
+	}
+
+	free( at );
+	free( a );
+
+}
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef RESULTS_C
+#define RESULTS_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Coil.c"
+
+// Layout of a binary result file, in the byte order of the machine writing it:
+//  - A ResultHeader naming every column.
+//  - Chunks of up to RESULT_ROWS designs, each a ResultChunk holding the number
+//    of designs and the smallest and largest value of every column, followed by
+//    every column of the chunk in turn as RESULT_ROWS floats.
+// Every chunk but the last is full, so chunk k starts at a fixed offset.
+#define RESULT_MAGIC   "TSRESULT"
+#define RESULT_VERSION 1
+#define RESULT_COLUMNS PARAMETERS
+#define RESULT_ROWS    4096
+
+// Holds the schema of a binary result file.
+//  - magic:   Always RESULT_MAGIC.
+//  - version: Layout version of the file.
+//  - columns: Number of columns in each chunk.
+//  - rows:    Capacity of each chunk in designs.
+//  - width:   Width of each value in bytes, always that of a float. A design holds
+//             every parameter as a float whichever precision calculated it, so
+//             wider columns would only hold the same values widened.
+//  - total:   Number of designs in the file.
+//  - name:    Name of each column as it appears in parameters.out.
+//  - pad:     Keeps the columns that follow aligned to 64 bytes.
+typedef struct
+{
+
+	char magic[8];
+	uint32_t version, columns, rows, width;
+	uint64_t total;
+	char name[RESULT_COLUMNS][8];
+	char pad[136];
+
+} ResultHeader;
+
+// Holds the statistics that lead each chunk.
+typedef struct
+{
+
+	uint64_t rows;
+	float min[RESULT_COLUMNS], max[RESULT_COLUMNS];
+	char pad[32];
+
+} ResultChunk;
+
+// Holds a binary result file being written.
+typedef struct
+{
+
+	FILE* file;
+	ResultHeader header;
+	ResultChunk chunk;
+	float* column;
+
+} ResultWriter;
+
+// Holds a binary result file mapped into memory for reading.
+typedef struct
+{
+
+	void* map;
+	size_t size;
+	ResultHeader* header;
+	uint64_t chunks;
+
+} Results;
+
+// Create a binary result file, returning 1 if it cannot be opened.
+int resultOpen( ResultWriter* w, char* file );
+
+// Append n designs to a binary result file.
+void resultWrite( ResultWriter* w, Coil* c, long n );
+
+// Flush the last chunk and the final header of a binary result file.
+int resultClose( ResultWriter* w );
+
+// Make every full chunk written so far durable and count it in the header, so
+// that an interrupted file can be resumed from it. Returns 1 if it cannot be.
+int resultCommit( ResultWriter* w );
+
+// Reopen a binary result file to append designs after those counted in its
+// header, dropping anything written since. Returns 1 if it is not valid.
+int resultResume( ResultWriter* w, char* file );
+
+// Map a binary result file into memory, returning 1 if it is not valid.
+int resultMap( Results* r, char* file );
+void resultUnmap( Results* r );
+
+// Return the statistics of chunk k and the values of its given column.
+ResultChunk* resultChunk( Results* r, uint64_t k );
+float* resultValues( Results* r, uint64_t k, int column );
+
+// Number of bytes taken by a full chunk, statistics included.
+static size_t resultChunkSize() { return sizeof( ResultChunk ) + (size_t)RESULT_COLUMNS * RESULT_ROWS * sizeof( float ); }
+
+// Return the number of chunks holding total designs, or 0 if they would not
+// fit in a file of the given size.
+static uint64_t resultChunks( uint64_t total, uint64_t size )
+{
+
+	uint64_t chunks = total / RESULT_ROWS + ( total % RESULT_ROWS != 0 );
+
+	if ( size < sizeof( ResultHeader ) || chunks > ( size - sizeof( ResultHeader ) ) / resultChunkSize() ) return 0;
+	return chunks;
+
+}
+
+static void resultReset( ResultWriter* w )
+{
+
+	int i;
+
+	w->chunk.rows = 0;
+	for ( i = 0; i < RESULT_COLUMNS; i++ )
+	{
+
+		w->chunk.min[i] = FLT_MAX;
+		w->chunk.max[i] = -FLT_MAX;
+
+	}
+
+}
+
+static void resultFlush( ResultWriter* w )
+{
+
+	if ( w->chunk.rows == 0 ) return;
+	fwrite( &w->chunk, sizeof w->chunk, 1, w->file );
+	fwrite( w->column, sizeof( float ), (size_t)RESULT_COLUMNS * RESULT_ROWS, w->file );
+	w->header.total += w->chunk.rows;
+	resultReset( w );
+
+}
+
+int resultOpen( ResultWriter* w, char* file )
+{
+
+	int i;
+
+	memset( w, 0, sizeof *w );
+	if ( !( w->file = fopen( file, "wb" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", file);
+		return 1;
+
+	}
+
+	memcpy( w->header.magic, RESULT_MAGIC, 8 );
+	w->header.version = RESULT_VERSION;
+	w->header.columns = RESULT_COLUMNS;
+	w->header.rows    = RESULT_ROWS;
+	w->header.width   = sizeof( float );
+	for ( i = 0; i < RESULT_COLUMNS; i++ ) strncpy( w->header.name[i], registry[i].name, 8 );
+	fwrite( &w->header, sizeof w->header, 1, w->file );
+
+	w->column = calloc( (size_t)RESULT_COLUMNS * RESULT_ROWS, sizeof( float ) );
+	resultReset( w );
+	return 0;
+
+}
+
+void resultWrite( ResultWriter* w, Coil* c, long n )
+{
+
+	long j;
+	int i;
+
+	for ( j = 0; j < n; j++ )
+	{
+
+		for ( i = 0; i < RESULT_COLUMNS; i++ )
+		{
+
+			float value = *(float*)( (char*)&c[j] + registry[i].offset );
+			w->column[(size_t)i * RESULT_ROWS + w->chunk.rows] = value;
+			if ( value < w->chunk.min[i] ) w->chunk.min[i] = value;
+			if ( value > w->chunk.max[i] ) w->chunk.max[i] = value;
+
+		}
+		if ( ++w->chunk.rows == RESULT_ROWS ) resultFlush( w );
+
+	}
+
+}
+
+int resultClose( ResultWriter* w )
+{
+
+	int failed;
+
+	resultFlush( w );
+	rewind( w->file );
+	fwrite( &w->header, sizeof w->header, 1, w->file );
+	failed = ferror( w->file );
+	failed |= fclose( w->file );
+	free( w->column );
+
+	return failed != 0;
+
+}
+
+// The chunks are synced before the header counting them is written, so the
+// header never counts a chunk that is not on disk.
+int resultCommit( ResultWriter* w )
+{
+
+	off_t end;
+
+	if ( fflush( w->file ) || fsync( fileno( w->file ) ) ) return 1;
+	end = ftello( w->file );
+	rewind( w->file );
+	fwrite( &w->header, sizeof w->header, 1, w->file );
+	if ( fflush( w->file ) || fsync( fileno( w->file ) ) ) return 1;
+	return fseeko( w->file, end, SEEK_SET ) != 0 || ferror( w->file );
+
+}
+
+int resultResume( ResultWriter* w, char* file )
+{
+
+	struct stat st;
+	uint64_t chunks;
+	off_t end;
+
+	memset( w, 0, sizeof *w );
+	if ( !( w->file = fopen( file, "r+b" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", file);
+		return 1;
+
+	}
+
+	if ( fread( &w->header, sizeof w->header, 1, w->file ) != 1 || memcmp( w->header.magic, RESULT_MAGIC, 8 ) != 0
+		|| w->header.version != RESULT_VERSION || w->header.columns != RESULT_COLUMNS
+		|| w->header.rows != RESULT_ROWS || w->header.width != sizeof( float )
+		|| fstat( fileno( w->file ), &st ) != 0
+		|| ( ( chunks = resultChunks( w->header.total, st.st_size ) ) == 0 && w->header.total > 0 )
+		|| ftruncate( fileno( w->file ), end = sizeof w->header + chunks * resultChunkSize() ) != 0 || fseeko( w->file, end, SEEK_SET ) != 0 )
+	{
+
+		fprintf(stderr, "%s is not a valid result file!\n", file);
+		fclose( w->file );
+		return 1;
+
+	}
+
+	w->column = calloc( (size_t)RESULT_COLUMNS * RESULT_ROWS, sizeof( float ) );
+	resultReset( w );
+	return 0;
+
+}
+
+int resultMap( Results* r, char* file )
+{
+
+	struct stat st;
+	uint64_t k;
+	int fd = open( file, O_RDONLY );
+
+	memset( r, 0, sizeof *r );
+	if ( fd < 0 || fstat( fd, &st ) != 0 )
+	{
+
+		fprintf(stderr, "Cannot open %s for parsing!\n", file);
+		if ( fd >= 0 ) close( fd );
+		return 1;
+
+	}
+
+	r->size = st.st_size;
+	r->map = r->size >= sizeof( ResultHeader ) ? mmap( NULL, r->size, PROT_READ, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+	close( fd );
+	if ( r->map == MAP_FAILED )
+	{
+
+		fprintf(stderr, "Cannot map %s!\n", file);
+		r->map = NULL;
+		return 1;
+
+	}
+
+	// Readers trust the rows of each chunk, so every chunk but the last must be
+	// full and the last must hold what remains of the total.
+	r->header = r->map;
+	r->chunks = resultChunks( r->header->total, r->size );
+	for ( k = 0; k < r->chunks; k++ )
+		if ( resultChunk( r, k )->rows != ( k + 1 < r->chunks ? RESULT_ROWS : r->header->total - k * RESULT_ROWS ) ) break;
+	if ( memcmp( r->header->magic, RESULT_MAGIC, 8 ) != 0 || r->header->version != RESULT_VERSION
+		|| r->header->columns != RESULT_COLUMNS || r->header->rows != RESULT_ROWS
+		|| r->header->width != sizeof( float )
+		|| ( r->header->total > 0 && r->chunks == 0 ) || k < r->chunks )
+	{
+
+		fprintf(stderr, "%s is not a valid result file!\n", file);
+		resultUnmap( r );
+		return 1;
+
+	}
+
+	return 0;
+
+}
+
+void resultUnmap( Results* r )
+{
+
+	if ( r->map ) munmap( r->map, r->size );
+	r->map = NULL;
+
+}
+
+ResultChunk* resultChunk( Results* r, uint64_t k )
+{
+
+	return (ResultChunk*)( (char*)r->map + sizeof( ResultHeader ) + k * resultChunkSize() );
+
+}
+
+float* resultValues( Results* r, uint64_t k, int column )
+{
+
+	return (float*)( resultChunk( r, k ) + 1 ) + (size_t)column * RESULT_ROWS;
+
+}
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef SENSITIVITY_C
+#define SENSITIVITY_C
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "Coil.c"
+
+// Only _Complex_I is used, keeping I free for the programs including this file.
+#undef I
+
+// Imaginary step given to the input a derivative is taken with respect to.
+// Its square vanishes beside every value, so the imaginary part of each output
+// is its exact first derivative times the step, with no difference taken to
+// lose digits as perturbing and subtracting would.
+#define SENSITIVITY_STEP 1.0e-30
+
+// Holds every parameter of a Coil as a complex double, in the same order,
+// while the design is calculated along an imaginary step of one input.
+typedef struct
+{
+
+	double complex NSTVI, NSTF, NSTVO, NSTIO, NSTRP, NSTRS;
+	double complex NSTVIP, NSTII, NSTIIP, NSTVOP, NSTIOP, NSTVA, NSTTR, NSTZ, NSTR, NSTPF;
+	double complex PTCCR, PTCC, LTRCS, LTRCR;
+	double complex PRIWG, PRIN, PRIRI, PRIS;
+	double complex PRILR, PRIWD, PRIRO, PRIF, PRILN, PRIL;
+	double complex SECWG, SECD, SECH;
+	double complex SECWD, SECF, SECLN, SECL, SECC, SECN, SECHD;
+	double complex TOPD;
+	double complex TOPC;
+	double complex ARCLN;
+
+} Tangent;
+_Static_assert( sizeof( Tangent ) == 4 * sizeof( Coil ) && offsetof( Tangent, ARCLN ) == 4 * offsetof( Coil, ARCLN ),
+	"Tangent must hold the parameters of Coil in the same order" );
+
+// Number of inputs whose derivatives are carried beside each parameter in a
+// single pass, padded to a whole number of vectors.
+#define SENSITIVITY_LANES 16
+_Static_assert( SENSITIVITY_LANES >= INPUTS, "Every input must have a lane of its own" );
+
+// Holds the derivatives of one parameter with respect to each input, one lane each.
+typedef double Derivatives __attribute__(( vector_size( SENSITIVITY_LANES * sizeof( double ) ) ));
+
+// Fill d[j] with the partial derivative of every parameter of c, in registry
+// order, with respect to the input parameter at position input[j] within
+// inputName(), for each of the n inputs. Every derivative of a design comes
+// from a single pass over the dependency graph, worked in double whatever the
+// precision: each node carries the derivatives of the parameters it reads on
+// to its output by the chain rule, with its own partials taken by an imaginary
+// step. Parameters whose value is not a finite real number have NaN derivatives.
+void sensitivity( Coil* c, int n, const int* input, double (*d)[PARAMETERS] );
+
+// Fill d as sensitivity() does, calculating the whole design once along an
+// imaginary step of each input in turn. Slower, but the reference the single
+// pass is checked against.
+void sensitivityStep( Coil* c, int n, const int* input, double (*d)[PARAMETERS] );
+
+// Return Nagaoka's coefficient and the inductance of a solenoid as nagaokaExact()
+// and solenoidPrecise() do, carrying the imaginary parts of their arguments through.
+static double complex nagaokaTangent( double complex k )
+{
+
+	double complex a = 1.0, b, c, t, K, E, sum, q;
+	double power = 0.5;
+	int i;
+
+	if ( creal( k ) <= 0.0 ) return 1.0;
+	if ( creal( k ) >= 1.0 ) return 0.0;
+	q = csqrt( 1.0 - k * k );
+	b = q;
+	c = k;
+	sum = power * c * c;
+	for ( i = 0; i < 16 && cabs( c ) > 1.0e-16 * cabs( a ); i++ )
+	{
+
+		c = 0.5 * ( a - b );
+		t = 0.5 * ( a + b );
+		b = csqrt( a * b );
+		a = t;
+		power *= 2.0;
+		sum += power * c * c;
+
+	}
+	K = PI / ( 2.0 * a );
+	E = K * ( 1.0 - sum );
+
+	return 4.0 / ( 3.0 * PI * q ) * ( q * q / ( k * k ) * K * sum + E - k );
+
+}
+
+static double complex solenoidTangent( double complex D, double complex N, double complex H, double complex WD )
+{
+
+	double complex k  = D / csqrt( D*D + H*H ), n = 1.0 / N;
+	double complex ks = 1.25 - clog( 2.0 * WD / ( WD - 3.55600e-5 ) );
+	double complex km = 0.33787707 - n * ( clog( N ) / 6.0 + 0.33084236 + n*n / 120.0 );
+
+	return 0.25*PI*U0 * N*N*D*D/H * nagaokaTangent( k ) - 0.5*U0 * D*N*( ks + km );
+
+}
+
+// The formulas are compiled from Nodes.c a third time, with the square roots
+// and powers they take mapped onto their complex forms, giving tangentNST()
+// and the other stages.
+#define REAL            double complex
+#define DESIGN          Tangent
+#define NODE( name )    nodeTangent##name
+#define STAGE( name )   tangent##name
+#define WIRE            WDtangent
+#define SELF            medhurstTangent
+#define SOLENOID        solenoidTangent
+#define sqrt            csqrt
+#define pow             cpow
+#include "Nodes.c"
+#undef REAL
+#undef DESIGN
+#undef NODE
+#undef STAGE
+#undef WIRE
+#undef SELF
+#undef SOLENOID
+#undef sqrt
+#undef pow
+
+// Every node of the dependency graph compiled for Tangent, in the order of graph.
+static void (*tangentGraph[])( Tangent* t ) =
+{
+
+	nodeTangentNSTTR, nodeTangentNSTVA, nodeTangentNSTII, nodeTangentNSTPF, nodeTangentNSTVIP,
+	nodeTangentNSTIIP, nodeTangentNSTVOP, nodeTangentNSTIOP, nodeTangentNSTR, nodeTangentNSTZ,
+	nodeTangentARCLN, nodeTangentPTCC, nodeTangentLTRCS, nodeTangentLTRCR, nodeTangentSECWD,
+	nodeTangentSECN, nodeTangentSECLN, nodeTangentSECL, nodeTangentSECC, nodeTangentSECHD,
+	nodeTangentTOPC, nodeTangentSECF, nodeTangentPRIWD, nodeTangentPRIRO, nodeTangentPRIF,
+	nodeTangentPTCCR, nodeTangentPRILR, nodeTangentPRIL, nodeTangentPRILN
+
+};
+_Static_assert( sizeof tangentGraph / sizeof *tangentGraph == NODES, "Every node of graph must be compiled for Tangent" );
+
+// Return the parameter at position i within registry of t.
+static double complex* tangentField( Tangent* t, int i )
+{
+
+	return (double complex*)( (char*)t + 4 * registry[i].offset );
+
+}
+
+// Calculate every output parameter of t.
+static void tangentCalculate( Tangent* t )
+{
+
+	tangentNST( t );
+	tangentPTC( t );
+	tangentSEC( t );
+	tangentTOP( t );
+	tangentPRI( t );
+
+}
+
+void sensitivity( Coil* c, int n, const int* input, double (*d)[PARAMETERS] )
+{
+
+	Tangent t;
+	Derivatives lane[PARAMETERS], none = { 0 };
+	double complex v, w, *out, *read;
+	double partial;
+	uint64_t in;
+	int i, j, g, o, r;
+
+	for ( i = 0; i < PARAMETERS; i++ )
+	{
+
+		*tangentField( &t, i ) = *(float*)( (char*)c + registry[i].offset );
+		lane[i] = none;
+
+	}
+	for ( j = 0; j < n; j++ ) lane[inputColumn[input[j]]][j] = 1.0;
+	for ( i = 0; i < PARAMETERS; i++ )
+		if ( !isfinite( creal( *tangentField( &t, i ) ) ) ) lane[i] = none + NAN;
+
+	for ( g = 0; g < (int)NODES; g++ )
+	{
+
+		// A parameter that takes an imaginary part of its own, such as NSTZ with
+		// more resistance than impedance, has left the reals and has no derivative.
+		o = __builtin_ctzll( graph[g].out );
+		out = tangentField( &t, o );
+		tangentGraph[g]( &t );
+		v = *out;
+		lane[o] = none;
+		if ( !( isfinite( creal( v ) ) && cimag( v ) == 0.0 ) )
+		{
+
+			lane[o] = none + NAN;
+			continue;
+
+		}
+
+		// Step each parameter read in turn for the partial of the output with
+		// respect to it, unless none of the inputs moves it. An infinite partial
+		// spoils only the lanes it multiplies.
+		for ( in = graph[g].in; in; in &= in - 1 )
+		{
+
+			r = __builtin_ctzll( in );
+			for ( j = 0; j < n && lane[r][j] == 0.0; j++ );
+			if ( j == n ) continue;
+			read = tangentField( &t, r );
+			w = *read;
+			*read += SENSITIVITY_STEP * _Complex_I;
+			tangentGraph[g]( &t );
+			*read = w;
+			partial = cimag( *out ) / SENSITIVITY_STEP;
+			if ( isfinite( partial ) ) lane[o] += partial * lane[r];
+			else for ( j = 0; j < n; j++ ) if ( lane[r][j] != 0.0 ) lane[o][j] = NAN;
+
+		}
+		*out = v;
+
+	}
+
+	for ( j = 0; j < n; j++ )
+		for ( i = 0; i < PARAMETERS; i++ ) d[j][i] = lane[i][j];
+
+}
+
+void sensitivityStep( Coil* c, int n, const int* input, double (*d)[PARAMETERS] )
+{
+
+	Tangent base, t;
+	double complex v;
+	int real[PARAMETERS];
+	int i, j;
+
+	for ( i = 0; i < PARAMETERS; i++ )
+		*(double complex*)( (char*)&base + 4 * registry[i].offset ) = *(float*)( (char*)c + registry[i].offset );
+
+	// A parameter that takes an imaginary part of its own, such as NSTZ with
+	// more resistance than impedance, has left the reals and has no derivative.
+	t = base;
+	tangentCalculate( &t );
+	for ( i = 0; i < PARAMETERS; i++ )
+	{
+
+		v = *(double complex*)( (char*)&t + 4 * registry[i].offset );
+		real[i] = isfinite( creal( v ) ) && cimag( v ) == 0.0;
+
+	}
+
+	for ( j = 0; j < n; j++ )
+	{
+
+		t = base;
+		*(double complex*)( (char*)&t + 4 * registry[inputColumn[input[j]]].offset ) += SENSITIVITY_STEP * _Complex_I;
+		tangentCalculate( &t );
+		for ( i = 0; i < PARAMETERS; i++ )
+		{
+
+			v = *(double complex*)( (char*)&t + 4 * registry[i].offset );
+			d[j][i] = real[i] && isfinite( cimag( v ) ) ? cimag( v ) / SENSITIVITY_STEP : NAN;
+
+		}
+
+	}
+
+}
+
+#endif
@@ -0,0 +1,400 @@
+#ifndef SHARD_C
+#define SHARD_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "Sweep.c"
+#include "Results.c"
+
+// Layout of the shared directory through which the workers of a sharded sweep
+// coordinate, with no other channel between them:
+//  - plan:         A ShardPlan holding the sweep, written by the first worker to
+//                  arrive and checked against their own by every other.
+//  - shard.K.lock: Locked by the worker running shard K for as long as it runs
+//                  it, and released by the system should the worker die.
+//  - shard.K.part: Binary result file of shard K as far as its last checkpoint.
+//  - shard.K.bin:  The same file, renamed once every block of the shard is in it.
+// Shard K holds, in order, the blocks of SWEEP_BLOCK designs sweepShard() puts in it,
+// each a single chunk of its result file.
+#define SHARD_MAGIC "TSPLAN1"
+#define SHARD_PATH  4096
+_Static_assert( SWEEP_BLOCK == RESULT_ROWS, "Each block of a shard must fill one chunk of its result file" );
+
+// What became of a shard a worker was asked to run.
+//  - SHARD_RUN:    The worker ran it to the end.
+//  - SHARD_DONE:   It was already complete.
+//  - SHARD_HELD:   Another worker is running it.
+//  - SHARD_FAILED: It could not be run.
+enum { SHARD_RUN, SHARD_DONE, SHARD_HELD, SHARD_FAILED };
+
+// Holds everything that must agree between the workers of a sharded sweep.
+//  - magic:      Always SHARD_MAGIC.
+//  - shards:     Number of shards.
+//  - precision:  Precision the designs are calculated in.
+//  - inductance: Model of the secondary inductance.
+//  - sweep:      Design space being swept.
+typedef struct
+{
+
+	char magic[8];
+	int32_t shards, precision, inductance, pad;
+	Sweep sweep;
+
+} ShardPlan;
+
+// Holds a worker's view of a sharded sweep.
+//  - dir:     Shared directory.
+//  - plan:    Sweep the directory holds.
+//  - every:   Seconds between checkpoints.
+//  - blocks:  Number of blocks in the shard last run.
+//  - resumed: Number of them found complete at its last checkpoint.
+//  - commits: Number of checkpoints taken while running it.
+typedef struct
+{
+
+	char* dir;
+	ShardPlan plan;
+	double every;
+	long blocks, resumed, commits;
+
+} Shards;
+
+// Join the sharded sweep held in dir, or begin one there split into the given
+// number of shards. A count of 0 takes the count of the sweep already begun.
+// Returns 1 if dir holds a different sweep or cannot be written.
+int shardInit( Shards* h, char* dir, Sweep* s, int shards, double every );
+
+// Read the sharded sweep held in dir, adopting its precision and inductance
+// model. Returns 1 if there is none.
+int shardOpen( Shards* h, char* dir );
+
+// Fill block, unless it is NULL, with the number of every block of the given
+// shard in order, returning how many there are.
+long shardBlocks( Shards* h, int shard, long* block );
+
+// Calculate the blocks of the given shard not already checkpointed across the
+// given number of threads, passing each to visit, unless it is NULL, in order.
+// Returns one of SHARD_RUN, SHARD_DONE, SHARD_HELD or SHARD_FAILED.
+int shardRun( Shards* h, int shard, int threads, Visit visit, void* arg );
+
+// Combine the result files of every complete shard into a single binary result
+// file holding the whole sweep in order. Returns 1 if a shard is not complete.
+int shardMerge( Shards* h, char* file );
+
+// Read the plan held in dir into plan, returning 1 if there is none.
+static int shardPlan( char* dir, ShardPlan* plan )
+{
+
+	char path[SHARD_PATH];
+	FILE* in;
+	int read;
+
+	snprintf(path, sizeof path, "%s/plan", dir);
+	if ( !( in = fopen( path, "rb" ) ) ) return 1;
+	read = fread( plan, sizeof *plan, 1, in );
+	fclose( in );
+	return read != 1 || memcmp( plan->magic, SHARD_MAGIC, 8 ) != 0;
+
+}
+
+// The plan is written whole under a name of its own and linked into place, so
+// of workers arriving together exactly one plan is taken and none is seen torn.
+int shardInit( Shards* h, char* dir, Sweep* s, int shards, double every )
+{
+
+	char host[64] = "", path[SHARD_PATH], mine[SHARD_PATH];
+	ShardPlan held;
+	FILE* out;
+	int linked;
+
+	memset( h, 0, sizeof *h );
+	h->dir = dir;
+	h->every = every;
+	memcpy( h->plan.magic, SHARD_MAGIC, 8 );
+	h->plan.shards = shards;
+	h->plan.precision = precision;
+	h->plan.inductance = inductance;
+	h->plan.sweep = *s;
+
+	if ( mkdir( dir, 0777 ) != 0 && errno != EEXIST )
+	{
+
+		fprintf(stderr, "Cannot create %s!\n", dir);
+		return 1;
+
+	}
+	if ( shards == 0 && shardPlan( dir, &held ) == 0 ) h->plan.shards = held.shards;
+	if ( h->plan.shards <= 0 )
+	{
+
+		fprintf(stderr, "  %s holds no sweep to join, give the number of shards to begin one.\n", dir);
+		return 1;
+
+	}
+
+	gethostname( host, sizeof host - 1 );
+	snprintf(path, sizeof path, "%s/plan", dir);
+	snprintf(mine, sizeof mine, "%s/plan.%s.%d", dir, host, (int)getpid());
+	if ( !( out = fopen( mine, "wb" ) ) || ( fwrite( &h->plan, sizeof h->plan, 1, out ) != 1 ) | fclose( out ) )
+	{
+
+		fprintf(stderr, "Cannot write %s!\n", mine);
+		return 1;
+
+	}
+	linked = link( mine, path ) == 0 || errno != EEXIST;
+	unlink( mine );
+
+	if ( !linked && ( shardPlan( dir, &held ) || memcmp( &held, &h->plan, sizeof held ) != 0 ) )
+	{
+
+		fprintf(stderr, "  %s holds a different sweep, with other settings, axes, precision, model or shards.\n", dir);
+		return 1;
+
+	}
+
+	return 0;
+
+}
+
+int shardOpen( Shards* h, char* dir )
+{
+
+	memset( h, 0, sizeof *h );
+	h->dir = dir;
+	if ( shardPlan( dir, &h->plan ) )
+	{
+
+		fprintf(stderr, "  %s holds no sharded sweep.\n", dir);
+		return 1;
+
+	}
+	precision = h->plan.precision;
+	inductance = h->plan.inductance;
+	return 0;
+
+}
+
+long shardBlocks( Shards* h, int shard, long* block )
+{
+
+	long blocks = ( h->plan.sweep.total + SWEEP_BLOCK - 1 ) / SWEEP_BLOCK, b, n = 0;
+
+	for ( b = 0; b < blocks; b++ )
+		if ( sweepShard( b, h->plan.shards ) == shard )
+		{
+
+			if ( block ) block[n] = b;
+			n++;
+
+		}
+
+	return n;
+
+}
+
+// Holds what is needed to write the blocks of a shard as they are visited.
+//  - h:      Sharded sweep.
+//  - writer: Result file of the shard.
+//  - visit:  Visit of the caller, or NULL.
+//  - arg:    Argument of the caller's visit.
+//  - last:   Time of the last checkpoint.
+//  - failed: Whether a checkpoint could not be taken.
+typedef struct
+{
+
+	Shards* h;
+	ResultWriter writer;
+	Visit visit;
+	void* arg;
+	struct timespec last;
+	int failed;
+
+} Progress;
+
+// Blocks arrive in order, so a checkpoint always falls between whole blocks.
+static void shardVisit( Coil* designs, long first, int count, int thread, void* arg )
+{
+
+	Progress* p = arg;
+	struct timespec now;
+
+	resultWrite( &p->writer, designs, count );
+	if ( p->visit ) p->visit( designs, first, count, thread, p->arg );
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	if ( ( now.tv_sec - p->last.tv_sec ) + 1.0e-9 * ( now.tv_nsec - p->last.tv_nsec ) >= p->h->every )
+	{
+
+		p->failed |= resultCommit( &p->writer );
+		p->last = now;
+		p->h->commits++;
+
+	}
+
+}
+
+int shardRun( Shards* h, int shard, int threads, Visit visit, void* arg )
+{
+
+	char lock[SHARD_PATH], part[SHARD_PATH], bin[SHARD_PATH];
+	int fd, status = SHARD_FAILED;
+	long* block;
+	Progress p;
+
+	snprintf(lock, sizeof lock, "%s/shard.%d.lock", h->dir, shard);
+	snprintf(part, sizeof part, "%s/shard.%d.part", h->dir, shard);
+	snprintf(bin, sizeof bin, "%s/shard.%d.bin", h->dir, shard);
+	h->blocks = h->resumed = h->commits = 0;
+
+	if ( ( fd = open( lock, O_RDWR | O_CREAT, 0666 ) ) < 0 )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", lock);
+		return SHARD_FAILED;
+
+	}
+	if ( flock( fd, LOCK_EX | LOCK_NB ) != 0 )
+	{
+
+		close( fd );
+		return SHARD_HELD;
+
+	}
+	if ( access( bin, F_OK ) == 0 )
+	{
+
+		close( fd );
+		return SHARD_DONE;
+
+	}
+
+	// Whatever was written after the last checkpoint of an earlier worker is dropped.
+	h->blocks = shardBlocks( h, shard, NULL );
+	block = malloc( ( h->blocks + 1 ) * sizeof *block );
+	shardBlocks( h, shard, block );
+	memset( &p, 0, sizeof p );
+	if ( access( part, F_OK ) == 0 ? resultResume( &p.writer, part ) : resultOpen( &p.writer, part ) )
+	{
+
+		free( block );
+		close( fd );
+		return SHARD_FAILED;
+
+	}
+	h->resumed = ( p.writer.header.total + SWEEP_BLOCK - 1 ) / SWEEP_BLOCK;
+
+	p.h = h;
+	p.visit = visit;
+	p.arg = arg;
+	clock_gettime( CLOCK_MONOTONIC, &p.last );
+	if ( h->resumed < h->blocks
+		&& sweepBlocks( &h->plan.sweep, block + h->resumed, h->blocks - h->resumed, threads, 1, shardVisit, &p ) )
+		p.failed = 1;
+
+	if ( resultClose( &p.writer ) || p.failed ) fprintf(stderr, "Cannot write %s!\n", part);
+	else if ( rename( part, bin ) != 0 ) fprintf(stderr, "Cannot rename %s to %s!\n", part, bin);
+	else status = SHARD_RUN;
+
+	free( block );
+	close( fd );
+	return status;
+
+}
+
+// Map the result file of every shard into part, checking each is complete
+// and holds the designs it should. Returns 1 if one is not.
+static int shardParts( Shards* h, Results* part )
+{
+
+	long blocks = ( h->plan.sweep.total + SWEEP_BLOCK - 1 ) / SWEEP_BLOCK, rows;
+	char path[SHARD_PATH];
+	int k;
+
+	for ( k = 0; k < h->plan.shards; k++ )
+	{
+
+		snprintf(path, sizeof path, "%s/shard.%d.bin", h->dir, k);
+		if ( access( path, F_OK ) != 0 )
+		{
+
+			fprintf(stderr, "  Shard %d of %s is not complete.\n", k, h->dir);
+			return 1;
+
+		}
+		if ( resultMap( &part[k], path ) ) return 1;
+
+		// Every block of a shard is full but the last block of the sweep.
+		rows = shardBlocks( h, k, NULL ) * SWEEP_BLOCK;
+		if ( sweepShard( blocks - 1, h->plan.shards ) == k ) rows -= blocks * SWEEP_BLOCK - h->plan.sweep.total;
+		if ( part[k].header->total != (uint64_t)rows )
+		{
+
+			fprintf(stderr, "  Shard %d of %s holds %llu designs, not %ld.\n", k, h->dir,
+				(unsigned long long)part[k].header->total, rows);
+			return 1;
+
+		}
+
+	}
+
+	return 0;
+
+}
+
+// Chunks are copied whole from each shard in turn as the blocks come round,
+// into a file that is renamed over the merged file only once complete.
+int shardMerge( Shards* h, char* file )
+{
+
+	long blocks = ( h->plan.sweep.total + SWEEP_BLOCK - 1 ) / SWEEP_BLOCK, b;
+	Results* part = calloc( h->plan.shards, sizeof *part );
+	uint64_t* next = calloc( h->plan.shards, sizeof *next );
+	char temp[SHARD_PATH];
+	ResultHeader header;
+	FILE* out = NULL;
+	int failed = 1, k;
+
+	snprintf(temp, sizeof temp, "%s.new", file);
+	if ( shardParts( h, part ) == 0 && !( out = fopen( temp, "wb" ) ) )
+		fprintf(stderr, "Cannot open %s for writing!\n", temp);
+	if ( out )
+	{
+
+		header = *part[0].header;
+		header.total = h->plan.sweep.total;
+		fwrite( &header, sizeof header, 1, out );
+		for ( b = 0; b < blocks; b++ )
+		{
+
+			k = sweepShard( b, h->plan.shards );
+			fwrite( resultChunk( &part[k], next[k]++ ), resultChunkSize(), 1, out );
+
+		}
+		failed = ferror( out ) | fclose( out ) || rename( temp, file ) != 0;
+		if ( failed )
+		{
+
+			fprintf(stderr, "Cannot write %s!\n", file);
+			unlink( temp );
+
+		}
+
+	}
+
+	for ( k = 0; k < h->plan.shards; k++ ) resultUnmap( &part[k] );
+	free( next );
+	free( part );
+	return failed;
+
+}
+
+#endif
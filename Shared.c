@@ -1,69 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
 void center( char* begin, char* text, int col, char pad, char* end )
 {
 
-	int length = strlen(text);
+	// Build the whole line first so that it reaches stdout in a single call.
+	int length = strlen(text), head = strlen(begin);
 	int i, j = 0.5 * ( col - length - 2 );
+	char line[head + length + strlen(end) + ( col > 0 ? col : 0 ) + 5], *p = line;
 
-	printf("%s", begin);
-	for ( i = 0; i < j; i++ ) printf("%c",pad);
-	if ( *text != '\0' ) printf(" %s ", text);
-	else printf("%c%c", pad, pad);
+	memcpy( p, begin, head ); p += head;
+	for ( i = 0; i < j; i++ ) *p++ = pad;
+	if ( *text != '\0' ) { *p++ = ' '; memcpy( p, text, length ); p += length; *p++ = ' '; }
+	else { *p++ = pad; *p++ = pad; }
 	j += 2 + length;
-	for ( i = j; i < col; i++ ) printf("%c",pad);
-	printf("%s", end);
+	for ( i = j; i < col; i++ ) *p++ = pad;
+	strcpy( p, end );
+	fputs( line, stdout );
 
 }
 
-double SIfactor( double value )
+// Prefixes of the SI units below and above the base unit, with the factors that scale into them.
+static const char   SIbelow[] = "munpfazy";
+static const char   SIabove[] = "KMGTPEZY";
+static const double SIshrink[] = { 1.0e3, 1.0e6, 1.0e9, 1.0e12, 1.0e15, 1.0e18, 1.0e21, 1.0e24 };
+static const double SIgrow[]   = { 1.0e-3, 1.0e-6, 1.0e-9, 1.0e-12, 1.0e-15, 1.0e-18, 1.0e-21, 1.0e-24 };
+
+char SIscale( double value, char prefix, double* factor )
 {
 
-	if ( value < 1.0 )
+	double a = fabs( value );
+	char* p;
+	int i;
+
+	// A prefix given by the caller is used whatever the value.
+	if ( prefix == ' ' ) { *factor = 1.0; return ' '; }
+	if ( prefix && ( p = strchr( SIbelow, prefix ) ) ) { *factor = SIshrink[p - SIbelow]; return prefix; }
+	if ( prefix && ( p = strchr( SIabove, prefix ) ) ) { *factor = SIgrow[p - SIabove]; return prefix; }
+
+	*factor = 1.0;
+	if ( a < 1.0 )
 	{
 
-		if ( ( value *= 1000.0 ) > 1.0 ) return 1.0e3;   // milli
-		if ( ( value *= 1000.0 ) > 1.0 ) return 1.0e6;   // micro
-		if ( ( value *= 1000.0 ) > 1.0 ) return 1.0e9;   // nano
-		if ( ( value *= 1000.0 ) > 1.0 ) return 1.0e12;  // pico
+		for ( i = 0; i < 8; i++ )
+			if ( ( a *= 1000.0 ) > 1.0 ) { *factor = SIshrink[i]; return SIbelow[i]; }
 
 	}
-	else
+	else if ( ( a /= 1000.0 ) >= 1.0 )
 	{
 
-		if ( ( value /= 1000.0 ) < 1.0 ) return 1.0;     // base
-		if ( ( value /= 1000.0 ) < 1.0 ) return 1.0e-3;  // kilo
-		if ( ( value /= 1000.0 ) < 1.0 ) return 1.0e-6;  // mega
-		if ( ( value /= 1000.0 ) < 1.0 ) return 1.0e-9;  // giga
-		if ( ( value /= 1000.0 ) < 1.0 ) return 1.0e-12; // tera
+		for ( i = 0; i < 8; i++ )
+			if ( ( a /= 1000.0 ) < 1.0 ) { *factor = SIgrow[i]; return SIabove[i]; }
 
 	}
 
-	return 1.0;
+	return ' ';
 
 }
 
-char SIprefix( double value )
+int SIformat( char* buffer, double value, int width, int precision, char prefix, char* unit )
 {
 
-	if ( value < 1.0 )
-	{
+	static const double power[] = { 1.0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9 };
+	char digits[32], *p = digits + sizeof digits;
+	double factor, r;
+	char symbol = SIscale( value, prefix, &factor );
+	long n;
+	int i, length;
 
-		if ( ( value *= 1000.0 ) > 1.0 ) return 'm'; // milli
-		if ( ( value *= 1000.0 ) > 1.0 ) return 'u'; // micro
-		if ( ( value *= 1000.0 ) > 1.0 ) return 'n'; // nano
-		if ( ( value *= 1000.0 ) > 1.0 ) return 'p'; // pico
+	value *= factor;
+	r = fabs( value ) * ( precision >= 0 && precision <= 9 ? power[precision] : 0.0 );
 
-	}
-	else
-	{
+	// Leave halfway cases, huge values and odd precisions to printf's exact rounding.
+	if ( precision < 0 || precision > 9 || !( r < 1.0e15 ) || fabs( r - floor( r ) - 0.5 ) < 1.0e-6 )
+		return sprintf(buffer, "%*.*f%c%s", width, precision, value, symbol, unit);
 
-		if ( ( value /= 1000.0 ) < 1.0 ) return ' '; // base
-		if ( ( value /= 1000.0 ) < 1.0 ) return 'K'; // kilo
-		if ( ( value /= 1000.0 ) < 1.0 ) return 'M'; // mega
-		if ( ( value /= 1000.0 ) < 1.0 ) return 'G'; // giga
-		if ( ( value /= 1000.0 ) < 1.0 ) return 'T'; // tera
+	n = floor( r + 0.5 );
+	for ( i = 0; i < precision; i++ ) { *--p = '0' + n % 10; n /= 10; }
+	if ( precision > 0 ) *--p = '.';
+	do { *--p = '0' + n % 10; n /= 10; } while ( n );
+	if ( signbit( value ) ) *--p = '-';
 
-	}
+	length = digits + sizeof digits - p;
+	for ( i = 0; i < width - length; i++ ) buffer[i] = ' ';
+	memcpy( buffer + i, p, length );
+	i += length;
+	buffer[i++] = symbol;
+	length = strlen( unit );
+	memcpy( buffer + i, unit, length + 1 );
 
-	return ' ';
+	return i + length;
+
+}
+
+double SIfactor( double value )
+{
+
+	double factor;
+	SIscale( value, 0, &factor );
+	return factor;
+
+}
+
+char SIprefix( double value )
+{
+
+	double factor;
+	return SIscale( value, 0, &factor );
 
 }
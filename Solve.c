@@ -0,0 +1,209 @@
+#ifndef SOLVE_C
+#define SOLVE_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Coil.c"
+#include "Sensitivity.c"
+
+// Most output parameters a design can be solved for at once.
+#define SOLVE_TARGETS 8
+
+// Position of each input parameter within inputName().
+enum { iNSTVI, iNSTF, iNSTVO, iNSTIO, iNSTRP, iNSTRS, iPRIWG, iPRIN, iPRIRI, iPRIS, iSECWG, iSECD, iSECH, iTOPD };
+
+// Fill g with the derivative of the natural log of the named output parameter
+// with respect to every input parameter of a calculated design, in the order
+// of inputName(). Returns 1 if it is not an output parameter.
+int gradient( Coil* c, char* output, double* g );
+
+// Adjust the free input parameters of c, given by their position in inputName(),
+// until each named output parameter is within a relative tol of its goal.
+// Every free input must start positive and stays positive. Returns 0 once the
+// goals are met, leaving c calculated and the evaluations made in evaluations.
+int goalSeek( Coil* c, int targets, char** output, double* goal, int free, int* input,
+	double tol, int limit, int* evaluations );
+
+int gradient( Coil* c, char* output, double* g )
+{
+
+	double d[INPUTS][PARAMETERS];
+	int i = lookup( output, strlen( output ) ), j, all[INPUTS];
+
+	if ( i < 0 || registry[i].role != OUTPUT ) return 1;
+	for ( j = 0; j < INPUTS; j++ ) all[j] = j;
+	sensitivity( c, INPUTS, all, d );
+	for ( j = 0; j < INPUTS; j++ ) g[j] = d[j][i] / *(float*)( (char*)c + registry[i].offset );
+	return 0;
+
+}
+
+// Solve the n by n system a x = b in place by Gaussian elimination with partial pivoting.
+static int eliminate( double* a, double* b, int n )
+{
+
+	int i, j, k, p;
+
+	for ( k = 0; k < n; k++ )
+	{
+
+		for ( p = k, i = k + 1; i < n; i++ )
+			if ( fabs( a[i*n+k] ) > fabs( a[p*n+k] ) ) p = i;
+		if ( a[p*n+k] == 0.0 ) return 1;
+		if ( p != k )
+		{
+
+			for ( j = 0; j < n; j++ ) { double t = a[k*n+j]; a[k*n+j] = a[p*n+j]; a[p*n+j] = t; }
+			{ double t = b[k]; b[k] = b[p]; b[p] = t; }
+
+		}
+		for ( i = k + 1; i < n; i++ )
+		{
+
+			double m = a[i*n+k] / a[k*n+k];
+			for ( j = k; j < n; j++ ) a[i*n+j] -= m * a[k*n+j];
+			b[i] -= m * b[k];
+
+		}
+
+	}
+	for ( k = n - 1; k >= 0; k-- )
+	{
+
+		for ( j = k + 1; j < n; j++ ) b[k] -= a[k*n+j] * b[j];
+		b[k] /= a[k*n+k];
+
+	}
+
+	return 0;
+
+}
+
+// Recalculate what the changed inputs of c feed and fill r with the log of each
+// output over its goal, returning the sum of squares.
+static double residual( Coil* c, uint64_t changed, int targets, float** field, double* goal, double* r )
+{
+
+	double cost = 0.0;
+	int i;
+
+	recalculate( c, changed );
+	for ( i = 0; i < targets; i++ )
+	{
+
+		r[i] = *field[i] > 0.0 ? log( *field[i] / goal[i] ) : HUGE_VAL;
+		cost += r[i] * r[i];
+
+	}
+
+	return isfinite( cost ) ? cost : HUGE_VAL;
+
+}
+
+int goalSeek( Coil* c, int targets, char** output, double* goal, int free, int* input,
+	double tol, int limit, int* evaluations )
+{
+
+	float* field[SOLVE_TARGETS];
+	float* x[INPUTS];
+	double r[SOLVE_TARGETS], rt[SOLVE_TARGETS], J[SOLVE_TARGETS][INPUTS], d[INPUTS][PARAMETERS];
+	double A[INPUTS*INPUTS], b[INPUTS], saved[INPUTS];
+	double cost, trial, worst, lambda = 1.0e-3;
+	uint64_t changed = 0;
+	int index[SOLVE_TARGETS];
+	int i, j, k, n;
+
+	if ( evaluations ) *evaluations = 0;
+	if ( targets > SOLVE_TARGETS || free > INPUTS ) return 1;
+	for ( i = 0; i < targets; i++ )
+		if ( !( field[i] = column( c, output[i] ) ) || goal[i] <= 0.0 ) return 1;
+	for ( i = 0; i < targets; i++ )
+		if ( registry[index[i] = lookup( output[i], strlen( output[i] ) )].role != OUTPUT ) return 1;
+	for ( j = 0; j < free; j++ )
+		if ( *( x[j] = parameter( c, inputName( input[j] ) ) ) <= 0.0 ) return 1;
+	for ( j = 0; j < free; j++ ) changed |= 1ULL << inputColumn[input[j]];
+
+	// Work in the logs of the free inputs and of the outputs over their goals,
+	// which keeps every input positive and makes power laws nearly linear.
+	// Only what the free inputs feed changes after the first full calculation.
+	calculate( c );
+	cost = residual( c, 0, targets, field, goal, r );
+	for ( n = 1; n < limit; )
+	{
+
+		for ( worst = 0.0, i = 0; i < targets; i++ )
+			if ( fabs( r[i] ) > worst ) worst = fabs( r[i] );
+		if ( worst <= tol ) break;
+
+		// One calculation per free input gives the exact Jacobian of every target.
+		sensitivity( c, free, input, d );
+		for ( i = 0; i < targets; i++ )
+			for ( j = 0; j < free; j++ ) J[i][j] = d[j][index[i]] / *field[i] * *x[j];
+
+		// Levenberg-Marquardt: damp the normal equations until a step pays off.
+		for ( ;; )
+		{
+
+			for ( j = 0; j < free; j++ )
+			{
+
+				for ( b[j] = 0.0, i = 0; i < targets; i++ ) b[j] -= J[i][j] * r[i];
+				for ( k = 0; k < free; k++ )
+					for ( A[j*free+k] = 0.0, i = 0; i < targets; i++ ) A[j*free+k] += J[i][j] * J[i][k];
+				A[j*free+j] += lambda * ( A[j*free+j] + 1.0e-12 );
+
+			}
+			if ( eliminate( A, b, free ) )
+			{
+
+				if ( evaluations ) *evaluations = n;
+				return 1;
+
+			}
+
+			for ( j = 0; j < free; j++ )
+			{
+
+				saved[j] = *x[j];
+				*x[j] = *x[j] * exp( b[j] > 2.0 ? 2.0 : b[j] < -2.0 ? -2.0 : b[j] );
+
+			}
+			trial = residual( c, changed, targets, field, goal, rt );
+			n++;
+
+			if ( trial < cost )
+			{
+
+				cost = trial;
+				memcpy( r, rt, targets * sizeof *r );
+				lambda = lambda * 0.3 > 1.0e-9 ? lambda * 0.3 : 1.0e-9;
+				break;
+
+			}
+
+			for ( j = 0; j < free; j++ ) *x[j] = saved[j];
+			lambda *= 4.0;
+			if ( lambda > 1.0e12 || n >= limit )
+			{
+
+				residual( c, changed, targets, field, goal, r );
+				if ( evaluations ) *evaluations = n;
+				return 1;
+
+			}
+
+		}
+
+	}
+
+	if ( evaluations ) *evaluations = n;
+	for ( worst = 0.0, i = 0; i < targets; i++ )
+		if ( fabs( r[i] ) > worst ) worst = fabs( r[i] );
+
+	return worst > tol;
+
+}
+
+#endif
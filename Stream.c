@@ -0,0 +1,466 @@
+#ifndef STREAM_C
+#define STREAM_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "Coil.c"
+#include "Batch.c"
+#include "Cache.c"
+
+// Number of designs passed between the stages of a stream at a time.
+#define STREAM_BLOCK 1024
+
+// Number of blocks each queue between the stages of a stream can hold.
+#define STREAM_QUEUE 8
+
+// Longest line of input accepted by a stream. Longer lines are rejected whole.
+#define STREAM_LINE 1024
+
+// Holds a block of designs passing through a stream.
+//  - n:      Number of designs in the block.
+//  - design: The designs themselves.
+//  - text:   Formatted results of the designs once calculated.
+//  - length: Number of bytes of text.
+typedef struct
+{
+
+	int n;
+	Coil design[STREAM_BLOCK];
+	char* text;
+	size_t length;
+
+} Block;
+
+// Holds a bounded queue of blocks between two stages of a stream.
+typedef struct
+{
+
+	Block* slot[STREAM_QUEUE];
+	int head, count, closed;
+	pthread_mutex_t lock;
+	pthread_cond_t filled, emptied;
+
+} Queue;
+
+// Holds the state shared by every stage of a stream.
+//  - base:    Values of the input parameters missing from a record.
+//  - in, out: Files the stream reads designs from and writes results to.
+//  - parsed:  Blocks of designs read but not yet calculated.
+//  - done:    Blocks of designs calculated but not yet written.
+//  - spare:   Blocks of designs ready to be reused.
+//  - cache:    Cache of results the designs are taken from, or NULL.
+//  - serial:   1 if the stages could not be given threads of their own, so the
+//              reader calculates and writes each block itself.
+//  - rejected: Number of lines rejected by the reader.
+typedef struct
+{
+
+	Coil base;
+	FILE* in;
+	FILE* out;
+	Queue parsed, done, spare;
+	Cache* cache;
+	int serial;
+	long rejected;
+
+} Stream;
+
+// Calculate every design read from in, one per line, and write the results to
+// out one per line. Each line is either a record of KEY value pairs as found
+// in parameters.dat, or comma separated values of the input parameters in the
+// order of parameters.dat or of a header line naming them. Parameters missing
+// from a line, or left empty between its commas, keep their value in base.
+// Results are taken from and stored in cache unless it is NULL. Returns the
+// number of lines rejected, headers naming unknown parameters among them, or 1
+// if the stream cannot be set up.
+long stream( Coil* base, FILE* in, FILE* out, Cache* cache );
+
+static void queueInit( Queue* q )
+{
+
+	memset( q, 0, sizeof *q );
+	pthread_mutex_init( &q->lock, NULL );
+	pthread_cond_init( &q->filled, NULL );
+	pthread_cond_init( &q->emptied, NULL );
+
+}
+
+static void queueDestroy( Queue* q )
+{
+
+	pthread_cond_destroy( &q->emptied );
+	pthread_cond_destroy( &q->filled );
+	pthread_mutex_destroy( &q->lock );
+
+}
+
+static void queuePut( Queue* q, Block* b )
+{
+
+	pthread_mutex_lock( &q->lock );
+	while ( q->count == STREAM_QUEUE ) pthread_cond_wait( &q->emptied, &q->lock );
+	q->slot[( q->head + q->count++ ) % STREAM_QUEUE] = b;
+	pthread_cond_signal( &q->filled );
+	pthread_mutex_unlock( &q->lock );
+
+}
+
+// Return the next block in the queue, or NULL once it is closed and empty.
+static Block* queueGet( Queue* q )
+{
+
+	Block* b = NULL;
+
+	pthread_mutex_lock( &q->lock );
+	while ( q->count == 0 && !q->closed ) pthread_cond_wait( &q->filled, &q->lock );
+	if ( q->count > 0 )
+	{
+
+		b = q->slot[q->head];
+		q->head = ( q->head + 1 ) % STREAM_QUEUE;
+		q->count--;
+		pthread_cond_signal( &q->emptied );
+
+	}
+	pthread_mutex_unlock( &q->lock );
+
+	return b;
+
+}
+
+static void queueClose( Queue* q )
+{
+
+	pthread_mutex_lock( &q->lock );
+	q->closed = 1;
+	pthread_cond_broadcast( &q->filled );
+	pthread_mutex_unlock( &q->lock );
+
+}
+
+// Parse one line of input into c, returning 1 if it is not a valid design.
+// Comma separated lines fill the fields named by columns in turn, empty
+// fields leaving theirs as they were.
+static int parseLine( char* line, Coil* c, float** columns, int count, Coil* layout )
+{
+
+	char *p = line, *end;
+	float* field;
+	float value;
+	int i;
+
+	if ( strchr( line, ',' ) )
+	{
+
+		for ( i = 0; i < count; i++ )
+		{
+
+			p += strspn( p, " \t" );
+			value = strtof( p, &end );
+			if ( end == p )
+			{
+
+				if ( *p != ',' && *p != '\0' && *p != '\n' && *p != '\r' ) return 1;
+
+			}
+			else *(float*)( (char*)c + ( (char*)columns[i] - (char*)layout ) ) = value;
+			p = end + strspn( end, " \t" );
+			if ( *p == ',' ) p++;
+			else if ( i + 1 < count ) return 1;
+
+		}
+		return *p != '\0' && *p != '\n' && *p != '\r';
+
+	}
+
+	for ( ;; )
+	{
+
+		char* key;
+
+		p += strspn( p, " \t\r\n" );
+		if ( *p == '\0' ) return 0;
+		key = p;
+		p += strcspn( p, " \t\r\n" );
+		if ( *p == '\0' ) return 1;
+		*p++ = '\0';
+		if ( !( field = parameter( c, key ) ) ) return 1;
+		value = strtof( p, &end );
+		if ( end == p ) return 1;
+		*field = value;
+		p = end;
+
+	}
+
+}
+
+// Return the number of names in a comma separated header line, all of which
+// must be parameters, filling columns with them. Returns 0 if any is not a
+// parameter, or if there are more than columns can hold, reporting each.
+static int parseHeader( Stream* s, char* line, float** columns, long number )
+{
+
+	float* named[INPUTS];
+	char* name;
+	int count = 0, failed = 0;
+
+	for ( name = strtok( line, ", \t\r\n" ); name; name = strtok( NULL, ", \t\r\n" ) )
+	{
+
+		if ( !( count < INPUTS ? ( named[count] = parameter( &s->base, name ) ) : NULL ) )
+		{
+
+			fprintf(stderr, "  %s not valid %s on line %ld.\n", name, count < INPUTS ? "parameter" : "column", number);
+			failed = 1;
+
+		}
+		count++;
+
+	}
+	if ( failed || count == 0 ) return 0;
+	memcpy( columns, named, count * sizeof *named );
+	return count;
+
+}
+
+// Return whether every comma separated token of line names a parameter.
+static int isHeader( Stream* s, char* line )
+{
+
+	char copy[STREAM_LINE];
+	char* name;
+
+	strcpy( copy, line );
+	for ( name = strtok( copy, ", \t\r\n" ); name; name = strtok( NULL, ", \t\r\n" ) )
+		if ( !parameter( &s->base, name ) ) return 0;
+	return 1;
+
+}
+
+// Calculate a block of designs and format their results, so the writer only
+// has to copy them out.
+static void streamCalculate( Stream* s, Block* b )
+{
+
+	char* p = b->text;
+	int i;
+
+	if ( s->cache ) cacheCoils( s->cache, b->design, b->n );
+	else batchCoils( b->design, b->n );
+	for ( i = 0; i < b->n; i++ ) p += formatRecord( p, &b->design[i] );
+	b->length = p - b->text;
+
+}
+
+// Pass a block read on to be calculated, or calculate and write it at once
+// when the stream runs on a single thread.
+static void streamPass( Stream* s, Block* b )
+{
+
+	if ( !s->serial )
+	{
+
+		queuePut( &s->parsed, b );
+		return;
+
+	}
+	streamCalculate( s, b );
+	fwrite( b->text, 1, b->length, s->out );
+	queuePut( &s->spare, b );
+
+}
+
+static void* reader( void* arg )
+{
+
+	Stream* s = arg;
+	char line[STREAM_LINE], copy[STREAM_LINE], *end;
+	float* columns[INPUTS];
+	int count = INPUTS, named, i, c;
+	long number = 0, *rejected = &s->rejected;
+	Block* b = queueGet( &s->spare );
+
+	// Comma separated values follow the order of parameters.dat unless named.
+	for ( i = 0; i < count; i++ ) columns[i] = parameter( &s->base, inputName( i ) );
+
+	b->n = 0;
+	while ( fgets( line, sizeof line, s->in ) )
+	{
+
+		number++;
+
+		// A line that does not fit is skipped to its end and rejected whole.
+		if ( !strchr( line, '\n' ) && ( c = getc( s->in ) ) != EOF )
+		{
+
+			if ( c != '\n' )
+			{
+
+				while ( ( c = getc( s->in ) ) != EOF && c != '\n' );
+				fprintf(stderr, "  Line %ld longer than %d characters.\n", number, STREAM_LINE - 1);
+				(*rejected)++;
+				continue;
+
+			}
+
+		}
+
+		i = strspn( line, " \t\r\n" );
+		if ( line[i] == '\0' || line[i] == '#' ) continue;
+
+		// A comma separated line naming only parameters sets the order of the
+		// columns. One starting with a word that is not a number, but naming
+		// something else, is a header in error and leaves the order as it was.
+		if ( strchr( line, ',' ) )
+		{
+
+			strtof( line + i, &end );
+			if ( isHeader( s, line ) || ( isalpha( (unsigned char)line[i] ) && end == line + i ) )
+			{
+
+				if ( ( named = parseHeader( s, line, columns, number ) ) ) count = named;
+				else (*rejected)++;
+				continue;
+
+			}
+
+		}
+
+		b->design[b->n] = s->base;
+		strcpy( copy, line );
+		if ( parseLine( line, &b->design[b->n], columns, count, &s->base ) )
+		{
+
+			fprintf(stderr, "  Line %ld not valid design: %s", number, copy);
+			(*rejected)++;
+			continue;
+
+		}
+
+		if ( ++b->n == STREAM_BLOCK )
+		{
+
+			streamPass( s, b );
+			b = queueGet( &s->spare );
+			b->n = 0;
+
+		}
+
+	}
+
+	if ( b->n > 0 ) streamPass( s, b );
+	else queuePut( &s->spare, b );
+	queueClose( &s->parsed );
+
+	return NULL;
+
+}
+
+static void* calculator( void* arg )
+{
+
+	Stream* s = arg;
+	Block* b;
+
+	while ( ( b = queueGet( &s->parsed ) ) )
+	{
+
+		streamCalculate( s, b );
+		queuePut( &s->done, b );
+
+	}
+	queueClose( &s->done );
+
+	return NULL;
+
+}
+
+static void* writer( void* arg )
+{
+
+	Stream* s = arg;
+	Block* b;
+
+	while ( ( b = queueGet( &s->done ) ) )
+	{
+
+		fwrite( b->text, 1, b->length, s->out );
+		queuePut( &s->spare, b );
+
+	}
+	fflush( s->out );
+
+	return NULL;
+
+}
+
+long stream( Coil* base, FILE* in, FILE* out, Cache* cache )
+{
+
+	// Leave room for the widest formatted value of every field of every design.
+	static const size_t text = STREAM_BLOCK * PARAMETERS * 16;
+	Block* blocks = calloc( STREAM_QUEUE, sizeof *blocks );
+	pthread_t parse, calculate, write;
+	int calculating, writing, i;
+	Stream s;
+
+	for ( i = 0; blocks && i < STREAM_QUEUE; i++ )
+		if ( !( blocks[i].text = malloc( text ) ) ) break;
+	if ( !blocks || i < STREAM_QUEUE )
+	{
+
+		fprintf(stderr, "Cannot hold the blocks of the stream!\n");
+		for ( ; blocks && i > 0; i-- ) free( blocks[i-1].text );
+		free( blocks );
+		return 1;
+
+	}
+
+	s.base = *base;
+	s.in = in;
+	s.out = out;
+	s.cache = cache;
+	s.rejected = 0;
+	queueInit( &s.parsed );
+	queueInit( &s.done );
+	queueInit( &s.spare );
+	for ( i = 0; i < STREAM_QUEUE; i++ ) queuePut( &s.spare, &blocks[i] );
+
+	// Without threads for the calculator and writer the reader does their work
+	// itself, and without one for the reader it runs on this thread.
+	writeHeader( out );
+	calculating = pthread_create( &calculate, NULL, calculator, &s ) == 0;
+	writing = calculating && pthread_create( &write, NULL, writer, &s ) == 0;
+	if ( calculating && !writing )
+	{
+
+		queueClose( &s.parsed );
+		pthread_join( calculate, NULL );
+
+	}
+	s.serial = !writing;
+	if ( !writing || pthread_create( &parse, NULL, reader, &s ) != 0 ) reader( &s );
+	else pthread_join( parse, NULL );
+	if ( writing )
+	{
+
+		pthread_join( calculate, NULL );
+		pthread_join( write, NULL );
+
+	}
+	else fflush( out );
+
+	for ( i = 0; i < STREAM_QUEUE; i++ ) free( blocks[i].text );
+	free( blocks );
+	queueDestroy( &s.spare );
+	queueDestroy( &s.done );
+	queueDestroy( &s.parsed );
+
+	return s.rejected;
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SUMMARY_C
+#define SUMMARY_C
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Number of results a summary can hold the range of.
+#define SUMMARY_LIMIT 8
+
+// Holds the range of the summarized results seen by one thread.
+//  - min, max: Smallest and largest finite value of each result.
+//  - at:       Index of the design holding the smallest and largest value.
+//  - seen:     Whether any design has given a finite value of each result.
+//  - pad:      Keeps the summaries of neighbouring threads on separate cache lines.
+typedef struct
+{
+
+	float min[SUMMARY_LIMIT], max[SUMMARY_LIMIT];
+	long at[SUMMARY_LIMIT][2];
+	char seen[SUMMARY_LIMIT];
+	char pad[64];
+
+} Summary;
+
+// Prepare a summary that has seen no design.
+void summaryInit( Summary* s );
+
+// Add the value of result i given by the design with the given index. Values
+// that are not finite, such as those of designs that cannot be built, are left out.
+static inline void summaryAdd( Summary* s, int i, float value, long design )
+{
+
+	if ( !isfinite( value ) ) return;
+	if ( !s->seen[i] || value < s->min[i] ) { s->min[i] = value; s->at[i][0] = design; }
+	if ( !s->seen[i] || value > s->max[i] ) { s->max[i] = value; s->at[i][1] = design; }
+	s->seen[i] = 1;
+
+}
+
+// Combine the summaries of every thread into the first.
+void summaryMerge( Summary* s, int threads, int results );
+
+// Print the range of each result, by name and unit, with the designs holding it.
+void summaryPrint( Summary* s, int results, char** name, char** unit );
+
+void summaryInit( Summary* s )
+{
+
+	memset( s, 0, sizeof *s );
+
+}
+
+void summaryMerge( Summary* s, int threads, int results )
+{
+
+	int t, i;
+
+	// Ties go to the earlier design, so the result does not depend on the threads.
+	for ( t = 1; t < threads; t++ )
+		for ( i = 0; i < results; i++ )
+		{
+
+			Summary* o = &s[t];
+			if ( !o->seen[i] ) continue;
+			if ( !s->seen[i] || o->min[i] < s->min[i] || ( o->min[i] == s->min[i] && o->at[i][0] < s->at[i][0] ) )
+			{
+
+				s->min[i] = o->min[i];
+				s->at[i][0] = o->at[i][0];
+
+			}
+			if ( !s->seen[i] || o->max[i] > s->max[i] || ( o->max[i] == s->max[i] && o->at[i][1] < s->at[i][1] ) )
+			{
+
+				s->max[i] = o->max[i];
+				s->at[i][1] = o->at[i][1];
+
+			}
+			s->seen[i] = 1;
+
+		}
+
+}
+
+void summaryPrint( Summary* s, int results, char** name, char** unit )
+{
+
+	float lo, hi;
+	int i;
+
+	for ( i = 0; i < results; i++ )
+	{
+
+		lo = s->min[i];
+		hi = s->max[i];
+		if ( !s->seen[i] ) printf("  %-6s no finite values\n", name[i]);
+		else printf("  %-6s %6.2f%c%-3s (design %ld) .. %6.2f%c%-3s (design %ld)\n", name[i],
+			lo*SIfactor(lo), SIprefix(lo), unit[i], s->at[i][0],
+			hi*SIfactor(hi), SIprefix(hi), unit[i], s->at[i][1]);
+
+	}
+
+}
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef SWEEP_C
+#define SWEEP_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "Coil.c"
+#include "Batch.c"
+
+// Number of input parameters a design space can be swept over.
+#define SWEEP_AXES 14
+
+// Number of consecutive designs handed to a worker thread at a time.
+#define SWEEP_BLOCK 4096
+
+// Sweeps whose last axis feeds at most this many output parameters are
+// calculated incrementally from each design to the next, recalculating only
+// what the changed axes feed, rather than in batches.
+#define SWEEP_INCREMENTAL 4
+
+// Holds the range of values swept for a single input parameter.
+//  - name:   Name of the input parameter as it appears in parameters.dat.
+//  - offset: Position of the input parameter within a Coil in bytes.
+//  - mask:   Mask of the input parameter by its position within registry.
+//  - lo:     First value of the range.
+//  - step:   Increment between consecutive values of the range.
+//  - count:  Number of values in the range.
+typedef struct
+{
+
+	char name[8];
+	size_t offset;
+	uint64_t mask;
+	float lo, step;
+	long count;
+
+} Axis;
+
+// Holds a design space made up of the cartesian product of every axis.
+//  - base:  Values of the input parameters that are not swept.
+//  - axes:  Number of swept input parameters.
+//  - axis:  Ranges of the swept input parameters, the first varying slowest.
+//  - total: Number of designs in the design space.
+typedef struct
+{
+
+	Coil base;
+	int axes;
+	Axis axis[SWEEP_AXES];
+	long total;
+
+} Sweep;
+
+// Called with each calculated block of designs. Unless the sweep is ordered,
+// blocks arrive concurrently and out of order from every worker thread.
+typedef void (*Visit)( Coil* designs, long first, int count, int thread, void* arg );
+
+// Prepare a sweep of a single design with the given base parameters.
+void sweepInit( Sweep* s, Coil* base );
+
+// Add an axis to the sweep given a specification of the form NAME=lo:hi:step.
+int sweepAxis( Sweep* s, char* spec );
+
+// Fill c with the inputs of the design with the given index in the sweep.
+void sweepDesign( Sweep* s, long index, Coil* c );
+
+// Calculate every design in the sweep across the given number of threads and
+// pass each block to visit. Ordered sweeps visit blocks one at a time in order.
+int sweepRun( Sweep* s, int threads, int ordered, Visit visit, void* arg );
+
+// Calculate the designs of the given blocks of SWEEP_BLOCK designs, by number
+// within the sweep, as sweepRun does. Ordered sweeps visit them in list order.
+int sweepBlocks( Sweep* s, const long* block, long blocks, int threads, int ordered, Visit visit, void* arg );
+
+// Return the shard of the given number that a block of SWEEP_BLOCK designs falls
+// in, from a hash of its number that does not depend on the machine or the run.
+int sweepShard( long block, int shards );
+
+// Return the number of processors available to run worker threads.
+int processors();
+
+// Holds the state shared between the worker threads of a running sweep.
+typedef struct
+{
+
+	Sweep* sweep;
+	Visit visit;
+	void* arg;
+	int ordered, incremental;
+	const long* block;
+	long blocks;
+
+	pthread_mutex_t lock;
+	pthread_cond_t turn;
+	long next, done;
+
+} Run;
+
+// Holds the state private to a single worker thread.
+typedef struct
+{
+
+	Run* run;
+	int thread;
+
+} Worker;
+
+void sweepInit( Sweep* s, Coil* base )
+{
+
+	memset( s, 0, sizeof *s );
+	s->base = *base;
+	s->total = 1;
+
+}
+
+int sweepAxis( Sweep* s, char* spec )
+{
+
+	char name[8] = {0};
+	float lo, hi, step = 1.0;
+	double count;
+	float* field;
+	Axis* a;
+	int i;
+
+	if ( s->axes == SWEEP_AXES ) return 1;
+	if ( sscanf( spec, "%7[^=]=%f:%f:%f", name, &lo, &hi, &step ) < 3 || step <= 0.0 || hi < lo )
+	{
+
+		fprintf(stderr, "  %s not valid sweep of form NAME=lo:hi[:step].\n", spec);
+		return 1;
+
+	}
+	if ( !( field = parameter( &s->base, name ) ) )
+	{
+
+		fprintf(stderr, "  %s not valid parameter.\n", name);
+		return 1;
+
+	}
+	for ( i = 0; i < s->axes; i++ )
+		if ( s->axis[i].offset == (char*)field - (char*)&s->base )
+		{
+
+			fprintf(stderr, "  %s not valid sweep, the parameter is already swept.\n", spec);
+			return 1;
+
+		}
+
+	// The design space must be small enough to number every design.
+	count = floor( ( hi - lo ) / step + 1.0e-3 ) + 1.0;
+	if ( !( count <= LONG_MAX / s->total ) )
+	{
+
+		fprintf(stderr, "  %s not valid sweep, %.3e designs are too many to number.\n", spec, count * s->total);
+		return 1;
+
+	}
+
+	a = &s->axis[s->axes++];
+	strcpy( a->name, name );
+	a->offset = (char*)field - (char*)&s->base;
+	a->mask   = 1ULL << lookup( name, strlen( name ) );
+	a->lo     = lo;
+	a->step   = step;
+	a->count  = (long)count;
+	s->total *= a->count;
+
+	return 0;
+
+}
+
+void sweepDesign( Sweep* s, long index, Coil* c )
+{
+
+	int i;
+
+	*c = s->base;
+	for ( i = s->axes - 1; i >= 0; i-- )
+	{
+
+		Axis* a = &s->axis[i];
+		*(float*)( (char*)c + a->offset ) = a->lo + a->step * ( index % a->count );
+		index /= a->count;
+
+	}
+
+}
+
+// Calculate a block of designs in order, each from the one before it.
+static void sweepBlock( Sweep* s, long first, int count, Coil* designs )
+{
+
+	long index;
+	uint64_t changed;
+	int i, j;
+
+	sweepDesign( s, first, &designs[0] );
+	calculate( &designs[0] );
+	for ( i = 1; i < count; i++ )
+	{
+
+		// Step the last axis, carrying into the axes before it as they wrap.
+		designs[i] = designs[i-1];
+		changed = 0;
+		for ( index = first + i, j = s->axes - 1; j >= 0; j-- )
+		{
+
+			Axis* a = &s->axis[j];
+			long digit = index % a->count;
+			*(float*)( (char*)&designs[i] + a->offset ) = a->lo + a->step * digit;
+			changed |= a->mask;
+			if ( digit != 0 ) break;
+			index /= a->count;
+
+		}
+		recalculate( &designs[i], changed );
+
+	}
+
+}
+
+static void* worker( void* arg )
+{
+
+	Worker* w = arg;
+	Run* r = w->run;
+	Sweep* s = r->sweep;
+	Coil* designs = malloc( SWEEP_BLOCK * sizeof *designs );
+	long claimed, first;
+	int i, count;
+
+	for ( ;; )
+	{
+
+		// Claim the next block of designs.
+		pthread_mutex_lock( &r->lock );
+		claimed = r->next++;
+		pthread_mutex_unlock( &r->lock );
+		if ( claimed >= r->blocks ) break;
+		first = ( r->block ? r->block[claimed] : claimed ) * SWEEP_BLOCK;
+		count = s->total - first < SWEEP_BLOCK ? s->total - first : SWEEP_BLOCK;
+
+		if ( r->incremental ) sweepBlock( s, first, count, designs );
+		else
+		{
+
+			for ( i = 0; i < count; i++ ) sweepDesign( s, first + i, &designs[i] );
+			batchCoils( designs, count );
+
+		}
+
+		if ( r->ordered )
+		{
+
+			// Wait until every earlier block has been visited.
+			pthread_mutex_lock( &r->lock );
+			while ( r->done != claimed ) pthread_cond_wait( &r->turn, &r->lock );
+			pthread_mutex_unlock( &r->lock );
+			r->visit( designs, first, count, w->thread, r->arg );
+			pthread_mutex_lock( &r->lock );
+			r->done = claimed + 1;
+			pthread_cond_broadcast( &r->turn );
+			pthread_mutex_unlock( &r->lock );
+
+		}
+		else r->visit( designs, first, count, w->thread, r->arg );
+
+	}
+
+	free( designs );
+	return NULL;
+
+}
+
+int sweepRun( Sweep* s, int threads, int ordered, Visit visit, void* arg )
+{
+
+	return sweepBlocks( s, NULL, ( s->total + SWEEP_BLOCK - 1 ) / SWEEP_BLOCK, threads, ordered, visit, arg );
+
+}
+
+int sweepBlocks( Sweep* s, const long* block, long blocks, int threads, int ordered, Visit visit, void* arg )
+{
+
+	pthread_t thread[threads];
+	Worker work[threads];
+	Run r;
+	int i;
+
+	r.sweep   = s;
+	r.visit   = visit;
+	r.arg     = arg;
+	r.ordered = ordered;
+	r.incremental = s->axes > 0
+		&& __builtin_popcountll( dependents( s->axis[s->axes-1].mask ) ) <= SWEEP_INCREMENTAL;
+	r.block   = block;
+	r.blocks  = blocks;
+	r.next    = 0;
+	r.done    = 0;
+	pthread_mutex_init( &r.lock, NULL );
+	pthread_cond_init( &r.turn, NULL );
+
+	for ( i = 0; i < threads; i++ )
+	{
+
+		work[i].run = &r;
+		work[i].thread = i;
+		if ( pthread_create( &thread[i], NULL, worker, &work[i] ) != 0 )
+		{
+
+			fprintf(stderr, "Cannot start worker thread %d!\n", i);
+			threads = i;
+			break;
+
+		}
+
+	}
+	for ( i = 0; i < threads; i++ ) pthread_join( thread[i], NULL );
+
+	pthread_cond_destroy( &r.turn );
+	pthread_mutex_destroy( &r.lock );
+
+	return threads == 0;
+
+}
+
+// The block number is finished as splitmix64 finishes its state, so that
+// neighbouring blocks, which cost much the same, spread evenly over the shards.
+int sweepShard( long block, int shards )
+{
+
+	uint64_t z = (uint64_t)block + 0x9e3779b97f4a7c15ULL;
+
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+	return ( z ^ ( z >> 31 ) ) % shards;
+
+}
+
+int processors()
+{
+
+	long n = sysconf( _SC_NPROCESSORS_ONLN );
+	return n > 0 ? n : 1;
+
+}
+
+#endif
@@ -0,0 +1,1023 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaBench"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Coil.c"
+#include "Batch.c"
+#include "Catalog.c"
+#include "MMC.c"
+#include "Report.c"
+#include "Transient.c"
+#include "Filament.c"
+#include "Daemon.c"
+#include "Pareto.c"
+#include "Sensitivity.c"
+#include "Response.c"
+#include "Ladder.c"
+
+// Formats and centers text.
+extern void center( char* begin, char* text, int col, char pad, char* end );
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Number of distinct values each microbenchmark cycles through.
+#define SAMPLES 1024
+
+// Number of timed runs of each benchmark, of which the fastest is reported.
+#define RUNS 3
+
+// Holds a single benchmark.
+//  - name:  Name reported for the benchmark.
+//  - run:   Performs n operations of the benchmark.
+//  - quiet: Whether stdout is sent to /dev/null while it runs.
+typedef struct
+{
+
+	char* name;
+	void (*run)( long n );
+	int quiet;
+
+} Benchmark;
+
+// Holds the result of a benchmark.
+//  - ns:     Nanoseconds per operation.
+//  - allocs: Heap allocations per operation.
+typedef struct
+{
+
+	char name[32];
+	double ns, allocs;
+
+} Measure;
+
+// Number of heap allocations made by the code under test. The bench target
+// links with --wrap so that every malloc, calloc and realloc call made from
+// this program lands in the wrappers below; without it the count stays zero.
+static long allocations;
+void* __real_malloc( size_t size );
+void* __real_calloc( size_t n, size_t size );
+void* __real_realloc( void* p, size_t size );
+void* __wrap_malloc( size_t size ) { __atomic_add_fetch( &allocations, 1, __ATOMIC_RELAXED ); return __real_malloc( size ); }
+void* __wrap_calloc( size_t n, size_t size ) { __atomic_add_fetch( &allocations, 1, __ATOMIC_RELAXED ); return __real_calloc( n, size ); }
+void* __wrap_realloc( void* p, size_t size ) { __atomic_add_fetch( &allocations, 1, __ATOMIC_RELAXED ); return __real_realloc( p, size ); }
+
+// Inputs shared by the benchmarks.
+//  - value:    Values spanning every SI prefix.
+//  - gauge:    Wire gauges from 0 to 40.
+//  - diameter: Wire diameters matching gauge.
+//  - settings: Settings file holding the inputs of parameters.dat.
+static double value[SAMPLES];
+static float gauge[SAMPLES], diameter[SAMPLES];
+static char settings[] = "/tmp/TeslaBenchXXXXXX";
+static Coil design;
+
+// Defeats the optimizer by giving every benchmark somewhere to put its results.
+static volatile double sink;
+
+static void benchSI( long n )
+{
+
+	double s = 0.0;
+	long i;
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		double v = value[i % SAMPLES];
+		s += v * SIfactor( v ) + SIprefix( v );
+
+	}
+	sink = s;
+
+}
+
+static void benchCenter( long n )
+{
+
+	long i;
+
+	for ( i = 0; i < n; i++ ) center( "\n|", "Primary Tank Capacitor", 60, '=', "|" );
+
+}
+
+static void benchWD( long n )
+{
+
+	float s = 0.0;
+	long i;
+
+	for ( i = 0; i < n; i++ ) s += WD( gauge[i % SAMPLES] );
+	sink = s;
+
+}
+
+static void benchWG( long n )
+{
+
+	float s = 0.0;
+	long i;
+
+	for ( i = 0; i < n; i++ ) s += WG( diameter[i % SAMPLES] );
+	sink = s;
+
+}
+
+static void benchMedhurst( long n )
+{
+
+	float s = 0.0;
+	long i;
+
+	for ( i = 0; i < n; i++ ) s += medhurst( 0.01 + 1.0e-4 * ( i % SAMPLES ), 0.47 );
+	sink = s;
+
+}
+
+static void benchCalculate( long n )
+{
+
+	Coil c = design;
+	float s = 0.0;
+	long i;
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		c.SECH = 0.3 + 1.0e-4 * ( i % SAMPLES );
+		calculate( &c );
+		s += c.PRIL;
+
+	}
+	sink = s;
+
+}
+
+// Only what SECH feeds, which is most of the secondary, primary and tank.
+static void benchRecalculate( long n )
+{
+
+	Coil c = design;
+	uint64_t changed = 1ULL << lookup( "SECH", 4 );
+	float s = 0.0;
+	long i;
+
+	calculate( &c );
+	for ( i = 0; i < n; i++ )
+	{
+
+		c.SECH = 0.3 + 1.0e-4 * ( i % SAMPLES );
+		recalculate( &c, changed );
+		s += c.PRIL;
+
+	}
+	sink = s;
+
+}
+
+static void benchBatch( long n )
+{
+
+	static Coil c[SAMPLES];
+	float s = 0.0;
+	long i, j, count;
+
+	for ( i = 0; i < n; i += count )
+	{
+
+		count = n - i < SAMPLES ? n - i : SAMPLES;
+		for ( j = 0; j < count; j++ )
+		{
+
+			c[j] = design;
+			c[j].SECH = 0.3 + 1.0e-4 * j;
+
+		}
+		batchCoils( c, count );
+		s += c[0].PRIL;
+
+	}
+	sink = s;
+
+}
+
+// The inductance of the secondary alone under the given model.
+static void benchSECL( long n, int model )
+{
+
+	Coil c = design;
+	float s = 0.0;
+	long i;
+
+	inductance = model;
+	for ( i = 0; i < n; i++ )
+	{
+
+		c.SECH = 0.3 + 1.0e-4 * ( i % SAMPLES );
+		nodeSECL( &c );
+		s += c.SECL;
+
+	}
+	inductance = WHEELER;
+	sink = s;
+
+}
+
+static void benchWheeler( long n ) { benchSECL( n, WHEELER ); }
+static void benchNagaoka( long n ) { benchSECL( n, NAGAOKA ); }
+
+// Nagaoka's coefficient evaluated directly rather than from its table.
+static void benchNagaokaExact( long n )
+{
+
+	double s = 0.0;
+	long i;
+
+	for ( i = 0; i < n; i++ ) s += nagaokaExact( 0.05 + 1.0e-4 * ( i % SAMPLES ) );
+	sink = s;
+
+}
+
+static void benchBatchNagaoka( long n )
+{
+
+	inductance = NAGAOKA;
+	benchBatch( n );
+	inductance = WHEELER;
+
+}
+
+// A cycle of the secondary of one design, stepped with the others of a batch.
+static void benchTransient( long n )
+{
+
+	static Coil c[TRANSIENT_LANES];
+	Transient t = { 0.15f, 0.5f, -1.0f, 1, 64, 64, 0 };
+	Bang bang[TRANSIENT_LANES];
+	int j;
+
+	for ( j = 0; j < TRANSIENT_LANES; j++ )
+	{
+
+		c[j] = design;
+		c[j].SECH = 0.3 + 1.0e-3 * j;
+		calculate( &c[j] );
+
+	}
+	t.cycles = n / TRANSIENT_LANES > 0 ? n / TRANSIENT_LANES : 1;
+	transient( &t, c, TRANSIENT_LANES, bang, NULL );
+	sink = bang[0].peak;
+
+}
+
+// The mutual inductance of one pair of filaments, summed a block at a time.
+static void benchFilament( long n )
+{
+
+	static double b[FILAMENT_BLOCK], h[FILAMENT_BLOCK], w[FILAMENT_BLOCK];
+	double s = 0.0;
+	long i;
+	int j;
+
+	filamentKernel();
+	for ( j = 0; j < FILAMENT_BLOCK; j++ )
+	{
+
+		b[j] = 0.03;
+		h[j] = 1.0e-3 * j;
+		w[j] = 1.0;
+
+	}
+	for ( i = 0; i < n; i += FILAMENT_BLOCK )
+		s += filamentChosen( 0.05 + 1.0e-5 * ( i % SAMPLES ), 0.0, b, h, w, n - i < FILAMENT_BLOCK ? n - i : FILAMENT_BLOCK );
+	sink = s;
+
+}
+
+// A daemon answering the bench over a socket beside the settings file, started by its first use.
+static Daemon server;
+static pthread_t serving;
+static char address[sizeof settings + 5];
+
+static void* serve( void* arg ) { daemonRun( arg ); return NULL; }
+
+// The derivative of every output with respect to all 14 inputs, in a single
+// pass or in one complex calculation per input.
+static void benchJacobian( long n, void (*jacobian)( Coil* c, int n, const int* input, double (*d)[PARAMETERS] ) )
+{
+
+	static double d[INPUTS][PARAMETERS];
+	int all[INPUTS], j;
+	Coil c = design;
+	long i;
+
+	for ( j = 0; j < INPUTS; j++ ) all[j] = j;
+	calculate( &c );
+	for ( i = 0; i < n; i++ )
+	{
+
+		c.SECH = 0.3f + 1.0e-6f * ( i & 1023 );
+		jacobian( &c, INPUTS, all, d );
+
+	}
+	sink = d[INPUTS-1][PARAMETERS-1];
+
+}
+static void benchSensitivity( long n ) { benchJacobian( n, sensitivity ); }
+static void benchSensitivityStep( long n ) { benchJacobian( n, sensitivityStep ); }
+
+// The gain of the charging circuit at one frequency, scanned 65536 points at a time.
+static void benchResponse( long n )
+{
+
+	static Response r;
+	Resonance res;
+	Charger k;
+	Coil c = design;
+	double C;
+	long i;
+
+	if ( !r.w ) responseInit( &r, 1.0, 10000.0, 65536 );
+	calculate( &c );
+	chargerInit( &k, &c );
+	for ( i = 0; i < n; i += r.points )
+	{
+
+		C = c.LTRCS * ( 1.0 + 1.0e-6 * ( i & 1023 ) );
+		responseScan( &r, &k, 1, &C, &res, 1 );
+
+	}
+	sink = res.peak;
+
+}
+
+// One segment of a secondary cut into 10^4, solved for its lowest three modes.
+static void benchLadder( long n )
+{
+
+	static Ladder l;
+	Coil c = design;
+	long i;
+
+	if ( !l.L ) ladderInit( &l, 10000 );
+	calculate( &c );
+	for ( i = 0; i < n; i += l.n )
+	{
+
+		ladderDesign( &l, &c, 0.5 + 1.0e-6 * ( i & 1023 ) );
+		ladderSolve( &l, 3 );
+
+	}
+	sink = l.f[0];
+
+}
+
+// One child bred, calculated and ranked by a single island of 100, a generation at a time.
+static void benchPareto( long n )
+{
+
+	static Pareto p;
+	static int started;
+
+	if ( !started )
+	{
+
+		paretoInit( &p, &design, 1, 100, 1 );
+		paretoObjective( &p, "+ARCLN" );
+		paretoObjective( &p, "-SECLN" );
+		paretoObjective( &p, "-PRIRO" );
+		paretoObjective( &p, "-LTRCS" );
+		paretoConstraint( &p, "SECHD=3:6" );
+		paretoGene( &p, "NSTVO=4000:15000" );
+		paretoGene( &p, "PRIN=5:15" );
+		paretoGene( &p, "SECD=0.04:0.3" );
+		paretoGene( &p, "SECH=0.2:1.5" );
+		paretoStart( &p );
+		started = 1;
+
+	}
+	paretoRun( &p, n / p.size > 0 ? n / p.size : 1, 1, NULL, NULL );
+	sink = p.island[0].member[0].f[0];
+
+}
+
+// The round trip of one design through the daemon, in frames of DAEMON_CHUNK designs.
+static void benchDaemon( long n )
+{
+
+	static Coil c[DAEMON_CHUNK];
+	static int fd = -1;
+	long i;
+	int j;
+
+	if ( fd < 0 )
+	{
+
+		sprintf(address, "%s.sock", settings);
+		if ( daemonOpen( &server, address, &design, NULL, 1 ) ) exit( 1 );
+		pthread_create( &serving, NULL, serve, &server );
+		if ( ( fd = daemonConnect( address ) ) < 0 ) exit( 1 );
+
+	}
+	for ( j = 0; j < DAEMON_CHUNK; j++ )
+	{
+
+		c[j] = design;
+		c[j].SECH = 0.3 + 1.0e-3 * j;
+
+	}
+	for ( i = 0; i < n; i += DAEMON_CHUNK )
+		if ( daemonQuery( fd, c, n - i < DAEMON_CHUNK ? n - i : DAEMON_CHUNK ) ) exit( 1 );
+	sink = c[0].SECF;
+
+}
+
+static void benchSIformat( long n )
+{
+
+	char buffer[64];
+	long i, s = 0;
+
+	for ( i = 0; i < n; i++ ) s += SIformat( buffer, value[i % SAMPLES], 6, 2, 0, "Hz" );
+	sink = s;
+
+}
+
+static void benchReport( long n )
+{
+
+	Text t;
+	long i, s = 0;
+
+	textInit( &t );
+	for ( i = 0; i < n; i++ )
+	{
+
+		t.length = 0;
+		report( &t, &design, 80 );
+		s += t.length;
+
+	}
+	textFree( &t );
+	sink = s;
+
+}
+
+static void benchFormat( long n )
+{
+
+	char buffer[16*PARAMETERS];
+	long i, s = 0;
+
+	for ( i = 0; i < n; i++ ) s += formatRecord( buffer, &design );
+	sink = s;
+
+}
+
+// The whole of a TeslaStats run short of the prompts: parse, calculate, write and report.
+static void benchPipeline( long n )
+{
+
+	Coil c;
+	long i;
+
+	for ( i = 0; i < n; i++ )
+	{
+
+		memset( &c, 0, sizeof c );
+		parseSettings( &c, settings, stdout );
+		calculate( &c );
+		writeSettings( &c, "/dev/null" );
+		printf("  Res Frequency:    %6.2f%cHz\n", c.SECF*SIfactor(c.SECF), SIprefix(c.SECF));
+
+	}
+
+}
+
+static void benchCatalog( long n )
+{
+
+	static Part parts[24];
+	Bank bank;
+	long i;
+	int j;
+
+	for ( j = 0; j < 24; j++ )
+	{
+
+		sprintf(parts[j].name, "CAP%02d", j);
+		parts[j].C     = ( 0.01 + 0.02 * ( j % 8 ) ) * 1.0e-6;
+		parts[j].V     = 600.0 * ( 1 + j / 8 );
+		parts[j].price = 0.5 + 0.37 * j;
+		parts[j].stock = 200;
+
+	}
+	for ( i = 0; i < n; i++ ) optimize( parts, 24, 14.31e-9, 9000.0, 1.0e-9, 1.0, 3, 1, &bank );
+	sink = bank.cost;
+
+}
+
+// The MMC of MMCCalc with the fewest strands for targets from 5nF to 50nF.
+static void benchSolve( long n )
+{
+
+	int ser, par, s = 0;
+	long i;
+
+	MCC = 0.15e-6; MCV = 1200;
+	for ( i = 0; i < n; i++ )
+		if ( solve( ( 5.0 + 45.0 * ( i % SAMPLES ) / SAMPLES ) * 1.0e-9, 9000, 1.0e-9, 100, 100, &ser, &par ) ) s += ser * par;
+	sink = s;
+
+}
+
+static Benchmark benchmark[] =
+{
+
+	{ "SIfactor+SIprefix", benchSI,        0 },
+	{ "SIformat",          benchSIformat,  0 },
+	{ "center",            benchCenter,    1 },
+	{ "WD",                benchWD,        0 },
+	{ "WG",                benchWG,        0 },
+	{ "medhurst",          benchMedhurst,  0 },
+	{ "calculate",         benchCalculate, 0 },
+	{ "recalculate",       benchRecalculate, 0 },
+	{ "batchCoils",        benchBatch,     0 },
+	{ "SECL/wheeler",      benchWheeler,   0 },
+	{ "SECL/nagaoka",      benchNagaoka,   0 },
+	{ "nagaokaExact",      benchNagaokaExact, 0 },
+	{ "batchCoils/nagaoka", benchBatchNagaoka, 0 },
+	{ "transient",         benchTransient, 0 },
+	{ "mutual",            benchFilament,  0 },
+	{ "daemon",            benchDaemon,    0 },
+	{ "pareto",            benchPareto,    0 },
+	{ "sensitivity",       benchSensitivity, 0 },
+	{ "sensitivity/step",  benchSensitivityStep, 0 },
+	{ "response",          benchResponse,  0 },
+	{ "ladder",            benchLadder,    0 },
+	{ "formatRecord",      benchFormat,    0 },
+	{ "report",            benchReport,    0 },
+	{ "pipeline",          benchPipeline,  1 },
+	{ "solve",             benchSolve,     0 },
+	{ "optimize",          benchCatalog,   0 }
+
+};
+#define BENCHMARKS ( sizeof benchmark / sizeof *benchmark )
+
+// Return the current time in seconds.
+static double now()
+{
+
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + 1.0e-9 * t.tv_nsec;
+
+}
+
+// Time a benchmark, doubling its operations until a run lasts at least least seconds.
+Measure measure( Benchmark* b, double least );
+
+// Read the results of an earlier run, returning the number read.
+int readMeasures( char* file, Measure* m, int size );
+
+// Print the largest error of each tabulated approximation against direct evaluation.
+void accuracy();
+
+// Print the largest error of each output calculated in float against double.
+void precisionReport();
+
+// Print how many random small catalogs optimize() prices differently from an
+// exhaustive search of every bank of up to two kinds of string.
+void catalogReport();
+
+int main( int argc, char** argv )
+{
+
+	char* out = NULL;
+	char* baseline = NULL;
+	double least = 0.2, slower = 10.0;
+	Measure result[BENCHMARKS], before[BENCHMARKS];
+	int opt, i, j, k, fd, known = 0, regressions = 0;
+	FILE* file;
+
+	while ( ( opt = getopt( argc, argv, "o:c:s:r:a" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'o': out = optarg; break;
+			case 'c': baseline = optarg; break;
+			case 's': least = atof( optarg ) > 0.0 ? atof( optarg ) : least; break;
+			case 'r': slower = atof( optarg ) > 0.0 ? atof( optarg ) : slower; break;
+			case 'a': constants(); accuracy(); return 0;
+			default:
+				fprintf(stderr, "Usage: %s [-a] [-o results.tsv] [-c baseline.tsv] [-r percent slower] [-s seconds] [name ...]\n", argv[0]);
+				return 1;
+
+		}
+
+	constants();
+	for ( i = 0; i < SAMPLES; i++ )
+	{
+
+		value[i]    = pow( 10.0, -13.0 + 26.0 * i / SAMPLES );
+		gauge[i]    = 40.0 * i / SAMPLES;
+		diameter[i] = WD( gauge[i] );
+
+	}
+
+	// Start every design from the defaults of parameters.dat.
+	if ( ( fd = mkstemp( settings ) ) < 0 )
+	{
+
+		fprintf(stderr, "Cannot create a settings file!\n");
+		return 1;
+
+	}
+	{
+
+		FILE* f = fdopen( fd, "w" );
+		fprintf(f, "NSTVI\t120\nNSTF\t60\nNSTVO\t9000\nNSTIO\t0.030\nNSTRP\t1.7\nNSTRS\t13000\nPRIWG\t12\n"
+			"PRIN\t7\nPRIRI\t0.05\nPRIS\t0.02\nSECWG\t26\nSECD\t0.06\nSECH\t0.47\nTOPD\t0.15\n");
+		fclose( f );
+
+	}
+	memset( &design, 0, sizeof design );
+	parseSettings( &design, settings, NULL );
+	calculate( &design );
+
+	if ( baseline && ( known = readMeasures( baseline, before, BENCHMARKS ) ) < 0 ) return 1;
+
+	for ( i = j = 0; i < (int)BENCHMARKS; i++ )
+	{
+
+		int chosen = optind == argc;
+		for ( k = optind; k < argc; k++ ) chosen |= strstr( benchmark[i].name, argv[k] ) != NULL;
+		if ( chosen ) result[j++] = measure( &benchmark[i], least );
+
+	}
+	unlink( settings );
+
+	// Results are written as tab separated lines only when asked for, the table below being for reading.
+	if ( out )
+	{
+
+		if ( !( file = fopen( out, "w" ) ) )
+		{
+
+			fprintf(stderr, "Cannot open %s for writing!\n", out);
+			return 1;
+
+		}
+		fprintf(file, "# %s v%s %s kernel\n", NAME, VERSION, batchKernel());
+		fprintf(file, "name\tns/op\tops/s\tallocs/op\n");
+		for ( i = 0; i < j; i++ )
+			fprintf(file, "%s\t%.3f\t%.6e\t%.3f\n", result[i].name, result[i].ns, 1.0e9 / result[i].ns, result[i].allocs);
+		fclose( file );
+
+	}
+
+	// Show the change from the baseline of every benchmark found in both.
+	for ( i = 0; i < j; i++ )
+	{
+
+		double change = 0.0;
+		for ( k = 0; k < known && strcmp( before[k].name, result[i].name ) != 0; k++ );
+		if ( k < known ) change = 100.0 * ( result[i].ns / before[k].ns - 1.0 );
+		printf("  %-18s %12.3f ns/op %12.3e ops/s %8.3f allocs/op", result[i].name, result[i].ns,
+			1.0e9 / result[i].ns, result[i].allocs);
+		if ( k < known ) printf(" %+7.1f%%%s", change, change > slower ? " REGRESSION" : "");
+		printf("\n");
+		regressions += k < known && change > slower;
+
+	}
+
+	// Stop the daemon the bench started and show what it measured at its end.
+	if ( *address )
+	{
+
+		Latency l;
+		daemonStop( &server );
+		pthread_join( serving, NULL );
+		daemonLatency( &server, &l );
+		printf("  daemon: frame p50 %.1fus p99 %.1fus, design p50 %.3fus p99 %.3fus at the server\n",
+			1.0e-3 * l.p50, 1.0e-3 * l.p99, 1.0e-3 * l.q50, 1.0e-3 * l.q99);
+
+	}
+
+	return regressions != 0;
+
+}
+
+Measure measure( Benchmark* b, double least )
+{
+
+	Measure m;
+	double start, elapsed, best = 0.0;
+	long n = 1, count = 0;
+	int run, saved = -1, null;
+
+	memset( &m, 0, sizeof m );
+	strncpy( m.name, b->name, sizeof m.name - 1 );
+
+	if ( b->quiet )
+	{
+
+		fflush( stdout );
+		saved = dup( 1 );
+		null = open( "/dev/null", O_WRONLY );
+		dup2( null, 1 );
+		close( null );
+
+	}
+
+	// Find how many operations fill the time, then keep the fastest of several runs.
+	for ( ;; n *= 2 )
+	{
+
+		start = now();
+		b->run( n );
+		if ( ( elapsed = now() - start ) >= least || n >= 1L << 40 ) break;
+
+	}
+	best = elapsed;
+	for ( run = 1; run < RUNS; run++ )
+	{
+
+		long before = allocations;
+		start = now();
+		b->run( n );
+		if ( ( elapsed = now() - start ) < best ) best = elapsed;
+		count = allocations - before;
+
+	}
+
+	if ( b->quiet )
+	{
+
+		fflush( stdout );
+		dup2( saved, 1 );
+		close( saved );
+
+	}
+
+	m.ns = 1.0e9 * best / n;
+	m.allocs = (double)count / n;
+	return m;
+
+}
+
+int readMeasures( char* file, Measure* m, int size )
+{
+
+	char line[256];
+	int n = 0;
+	FILE* f = fopen( file, "r" );
+
+	if ( !f )
+	{
+
+		fprintf(stderr, "Cannot open %s for parsing!\n", file);
+		return -1;
+
+	}
+
+	while ( n < size && fgets( line, sizeof line, f ) )
+		if ( line[0] != '#' && sscanf( line, "%31[^\t]\t%lf", m[n].name, &m[n].ns ) == 2 && m[n].ns > 0.0 ) n++;
+
+	fclose( f );
+	return n;
+
+}
+
+void accuracy()
+{
+
+	static const double upto[] = { 0.45, 0.7, 0.95, 0.99 };
+	double worst, k, e;
+	Coil c;
+	long i;
+	int j;
+
+	for ( j = 0; j < 4; j++ )
+	{
+
+		for ( worst = 0.0, i = 0; i <= 1000000; i++ )
+		{
+
+			k = upto[j] * i / 1000000;
+			e = fabs( nagaoka( k ) / nagaokaExact( k ) - 1.0 );
+			if ( e > worst ) worst = e;
+
+		}
+		printf("  nagaoka       k <= %.2f (SECHD >= %5.2f) %.3e\n", upto[j], sqrt( 1.0 - upto[j]*upto[j] ) / upto[j], worst);
+
+	}
+
+	// How far Wheeler's formula strays from the Nagaoka model over usual secondaries.
+	memset( &c, 0, sizeof c );
+	c.SECWG = 26;
+	c.SECD = 0.1;
+	nodeSECWD( &c );
+	for ( worst = 0.0, i = 0; i <= 1000; i++ )
+	{
+
+		float wheeler;
+		c.SECH = c.SECD * ( 1.0 + 9.0 * i / 1000 );
+		nodeSECN( &c );
+		inductance = WHEELER;
+		nodeSECL( &c );
+		wheeler = c.SECL;
+		inductance = NAGAOKA;
+		nodeSECL( &c );
+		e = fabs( wheeler / c.SECL - 1.0 );
+		if ( e > worst ) worst = e;
+
+	}
+	inductance = WHEELER;
+	printf("  wheeler       1 <= SECHD <= 10 against nagaoka %.3e\n", worst);
+
+	precisionReport();
+	catalogReport();
+
+}
+
+// Holds the inputs of the reference designs, each drawn evenly between lo and hi,
+// the gauges and turns whole and SECH and TOPD in multiples of SECD.
+static const struct { char* name; double lo, hi; int whole; } reference[INPUTS] =
+{
+
+	{ "NSTVI", 110.0, 240.0, 0 }, { "NSTF",  50.0,   60.0,    0 }, { "NSTVO", 4000.0, 15000.0, 0 },
+	{ "NSTIO", 0.02,  0.12,  0 }, { "NSTRP", 0.5,    3.0,     0 }, { "NSTRS", 5000.0, 20000.0, 0 },
+	{ "PRIWG", 6.0,   14.0,  1 }, { "PRIN",  5.0,    15.0,    1 }, { "PRIRI", 0.03,   0.15,    0 },
+	{ "PRIS",  0.005, 0.03,  0 }, { "SECWG", 20.0,   36.0,    1 }, { "SECD",  0.04,   0.3,     0 },
+	{ "SECH",  1.0,   8.0,   0 }, { "TOPD",  1.0,    4.0,     0 }
+
+};
+
+// Number of reference designs the precisions are compared over.
+#define REFERENCE 4096
+
+// Print the largest relative error of every output of calculate() and batchCoils() in float
+// against calculatePrecise() over the reference designs, under either inductance model.
+void precisionReport()
+{
+
+	static Coil exact[REFERENCE], single[REFERENCE], batch[REFERENCE];
+	double worst[PARAMETERS][4], e;
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	float* v;
+	int i, j, m;
+
+	for ( i = 0; i < REFERENCE; i++ )
+	{
+
+		memset( &exact[i], 0, sizeof exact[i] );
+		for ( j = 0; j < INPUTS; j++ )
+		{
+
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			e = reference[j].lo + ( reference[j].hi - reference[j].lo ) * ( state >> 11 ) * 0x1.0p-53;
+			*parameter( &exact[i], reference[j].name ) = reference[j].whole ? floor( e + 0.5 ) : e;
+
+		}
+		exact[i].SECH *= exact[i].SECD;
+		exact[i].TOPD *= exact[i].SECD;
+
+	}
+
+	memset( worst, 0, sizeof worst );
+	for ( m = 0; m < 2; m++ )
+	{
+
+		inductance = m ? NAGAOKA : WHEELER;
+		memcpy( single, exact, sizeof exact );
+		memcpy( batch, exact, sizeof exact );
+		for ( i = 0; i < REFERENCE; i++ ) calculate( &single[i] );
+		batchCoils( batch, REFERENCE );
+		for ( i = 0; i < REFERENCE; i++ ) calculatePrecise( &exact[i] );
+
+		for ( j = 0; j < PARAMETERS; j++ )
+			for ( i = 0; i < REFERENCE; i++ )
+			{
+
+				v = (float*)( (char*)&exact[i] + registry[j].offset );
+				if ( *v == 0.0f ) continue;
+				e = fabs( *(float*)( (char*)&single[i] + registry[j].offset ) / *v - 1.0 );
+				if ( e > worst[j][2*m] ) worst[j][2*m] = e;
+				e = fabs( *(float*)( (char*)&batch[i] + registry[j].offset ) / *v - 1.0 );
+				if ( e > worst[j][2*m+1] ) worst[j][2*m+1] = e;
+
+			}
+
+	}
+	inductance = WHEELER;
+
+	printf("\n  Float against double over %d reference designs\n", REFERENCE);
+	printf("  %-8s %-25s %s\n", "", "wheeler", "nagaoka");
+	printf("  %-8s %-12s %-12s %-12s %s\n", "output", "calculate", "batchCoils", "calculate", "batchCoils");
+	for ( j = 0; j < PARAMETERS; j++ )
+		if ( registry[j].role == OUTPUT )
+			printf("  %-8s %-12.3e %-12.3e %-12.3e %.3e\n", registry[j].name, worst[j][0], worst[j][1], worst[j][2], worst[j][3]);
+
+}
+
+// Number of random catalogs optimize() is checked over, and the most capacitors
+// of a part each holds, which keeps the exhaustive search small.
+#define CATALOGS 3000
+#define CATALOG_STOCK 24
+
+// Return the price of the cheapest bank of at most two kinds of string within
+// tol of TC that withstands TV, or DBL_MAX if there is none.
+static double exhaustive( Part* parts, int n, double TC, double TV, double tol )
+{
+
+	String kind[2*CATALOG_STOCK];
+	double best = DBL_MAX, C;
+	int kinds = 0, i, j, a, b, p, ser;
+
+	for ( p = 0; p < n; p++ )
+		for ( ser = fmax( ceil( TV / parts[p].V ), 1.0 ); ser <= parts[p].stock; ser++ )
+		{
+
+			kind[kinds].part = p;
+			kind[kinds].ser  = ser;
+			kind[kinds].C    = parts[p].C / ser;
+			kind[kinds].cost = parts[p].price * ser;
+			kinds++;
+
+		}
+
+	for ( i = 0; i < kinds; i++ )
+		for ( a = 1; a * kind[i].ser <= parts[kind[i].part].stock; a++ )
+		{
+
+			C = a * kind[i].C;
+			if ( C >= TC - tol && C <= TC + tol && a * kind[i].cost < best ) best = a * kind[i].cost;
+			for ( j = i + 1; j < kinds; j++ )
+				for ( b = 1; b * kind[j].ser + ( kind[i].part == kind[j].part ? a * kind[i].ser : 0 ) <= parts[kind[j].part].stock; b++ )
+				{
+
+					C = a * kind[i].C + b * kind[j].C;
+					if ( C >= TC - tol && C <= TC + tol && a * kind[i].cost + b * kind[j].cost < best )
+						best = a * kind[i].cost + b * kind[j].cost;
+
+				}
+
+		}
+
+	return best;
+
+}
+
+void catalogReport()
+{
+
+	uint64_t state = 0x2545f4914f6cdd1dULL;
+	Part parts[2];
+	Bank bank;
+	double draw[7], TC, TV, tol, best, found;
+	int i, j, p, wrong = 0, solved = 0;
+
+	for ( i = 0; i < CATALOGS; i++ )
+	{
+
+		for ( j = 0; j < 7; j++ )
+		{
+
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			draw[j] = ( state >> 11 ) * 0x1.0p-53;
+
+		}
+		for ( p = 0; p < 2; p++ )
+		{
+
+			sprintf(parts[p].name, "CAP%d", p);
+			parts[p].C     = ( 10 + floor( 190 * draw[3*p] ) ) * 1.0e-9;
+			parts[p].V     = 500 + 100 * floor( 16 * draw[3*p+1] );
+			parts[p].price = 0.1 + floor( 50 * draw[3*p+2] ) / 10;
+			parts[p].stock = 1 + ( i + p ) % CATALOG_STOCK;
+
+		}
+		TC  = ( 5 + floor( 60 * draw[6] ) ) * 1.0e-9;
+		TV  = 2000 + 1000 * ( i % 8 );
+		tol = 0.0503 * TC;
+
+		best  = exhaustive( parts, 2, TC, TV, tol );
+		found = optimize( parts, 2, TC, TV, tol, 1.0, 2, 1, &bank ) ? bank.cost : DBL_MAX;
+		if ( best < DBL_MAX ) solved++;
+		if ( fabs( found - best ) > 1.0e-9 * best ) wrong++;
+
+	}
+
+	printf("\n  optimize      %d of %d two part catalogs priced differently from exhaustive search (%d solvable)\n",
+		wrong, CATALOGS, solved);
+
+}
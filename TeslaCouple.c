@@ -0,0 +1,103 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaCouple"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Filament.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Print an inductance against the value it is compared with.
+void compare( char* label, double L, char* against, double value );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	int primary = 1000, secondary = 2000, threads = processors();
+	double offset = 0.0, tap, elapsed;
+	struct timespec start, stop;
+	int opt;
+	Filaments f;
+	Coil c;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "f:p:s:t:z:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'p': primary = atoi( optarg ); break;
+			case 's': secondary = atoi( optarg ); break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'z': offset = atof( optarg ); break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-p primary filaments] [-s secondary filaments] [-z secondary offset] [-t threads]\n", argv[0]);
+				return 1;
+
+		}
+
+	// Read in and calculate the design whose coils are discretized.
+	memset( &c, 0, sizeof c );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &c, settings, stdout ) ) return 1;
+	calculate( &c );
+	if ( filamentInit( &f, &c, primary, secondary, offset ) ) return 1;
+
+	printf("\n  Filaments: %d primary, %d secondary, %.3fm apart, on %d threads with %s kernel\n",
+		primary, secondary, offset, threads, filamentKernel());
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	filamentSolve( &f, threads );
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+	printf("  Elapsed: %.3fs (%.3e filament pairs/s)\n\n", elapsed,
+		( (double)primary * secondary + 0.5 * primary * primary + secondary ) / elapsed);
+
+	compare( "Primary:", filamentL( &f, c.PRIN ), "spiral", spiral( c.PRIRI, c.PRIS, c.PRIN ) );
+	compare( "Secondary:", f.Ls, inductance == NAGAOKA ? "nagaoka" : "wheeler", c.SECL );
+	printf("  Coupling:  %.4f with the whole primary\n", filamentM( &f, c.PRIN ) / sqrt( filamentL( &f, c.PRIN ) * f.Ls ));
+
+	// The tap is where the primary reaches the inductance resonating the bank at SECF.
+	if ( ( tap = filamentTap( &f, c.PRIL ) ) < 0.0 )
+		printf("  Tap:       none, the whole primary falls short of %6.2f%cH\n", c.PRIL*SIfactor(c.PRIL), SIprefix(c.PRIL));
+	else
+	{
+
+		double M = filamentM( &f, tap );
+		printf("  Tap:       %.3f of %g turns for %6.2f%cH\n", tap, c.PRIN, c.PRIL*SIfactor(c.PRIL), SIprefix(c.PRIL));
+		printf("  Mutual:    %6.2f%cH, coupling %.4f at the tap\n", M*SIfactor(M), SIprefix(M), M / sqrt( c.PRIL * f.Ls ));
+
+	}
+
+	filamentFree( &f );
+	return 0;
+
+}
+
+void compare( char* label, double L, char* against, double value )
+{
+
+	printf("  %-10s %6.2f%cH (%s %6.2f%cH, %+.2f%%)\n", label, L*SIfactor(L), SIprefix(L),
+		against, value*SIfactor(value), SIprefix(value), 100.0 * ( value / L - 1.0 ));
+
+}
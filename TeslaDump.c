@@ -0,0 +1,91 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaDump"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Results.c"
+
+// Print every design in a binary result file in the format of parameters.out,
+// separating designs with a blank line.
+void dump( Results* r );
+
+// Print the number of designs and the range of every column of each chunk.
+void stats( Results* r );
+
+int main( int argc, char** argv )
+{
+
+	int summary = 0, opt;
+	Results r;
+
+	while ( ( opt = getopt( argc, argv, "s" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 's': summary = 1; break;
+			default:
+				fprintf(stderr, "Usage: %s [-s] results.bin\n", argv[0]);
+				return 1;
+
+		}
+	if ( optind != argc - 1 )
+	{
+
+		fprintf(stderr, "Usage: %s [-s] results.bin\n", argv[0]);
+		return 1;
+
+	}
+
+	if ( resultMap( &r, argv[optind] ) ) return 1;
+	if ( summary ) stats( &r );
+	else dump( &r );
+	resultUnmap( &r );
+
+	return 0;
+
+}
+
+void dump( Results* r )
+{
+
+	uint64_t k, j;
+	int i;
+
+	for ( k = 0; k < r->chunks; k++ )
+	{
+
+		ResultChunk* chunk = resultChunk( r, k );
+		for ( j = 0; j < chunk->rows; j++ )
+		{
+
+			if ( k != 0 || j != 0 ) printf("\n");
+			for ( i = 0; i < RESULT_COLUMNS; i++ )
+				printf("%.8s\t%e\n", r->header->name[i], resultValues( r, k, i )[j]);
+
+		}
+
+	}
+
+}
+
+void stats( Results* r )
+{
+
+	uint64_t k;
+	int i;
+
+	printf("  Designs: %llu in %llu chunks\n", (unsigned long long)r->header->total, (unsigned long long)r->chunks);
+	for ( k = 0; k < r->chunks; k++ )
+	{
+
+		ResultChunk* chunk = resultChunk( r, k );
+		printf("\n  Chunk %llu: %llu designs\n", (unsigned long long)k, (unsigned long long)chunk->rows);
+		for ( i = 0; i < RESULT_COLUMNS; i++ )
+			printf("  %-6.8s\t%e\t%e\n", r->header->name[i], chunk->min[i], chunk->max[i]);
+
+	}
+
+}
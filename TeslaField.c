@@ -0,0 +1,234 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaField"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Capacitance.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Holds what every worker thread needs to solve a block of designs.
+//  - field:   Electrostatic model.
+//  - sweep:   Design space, whose axes are written with each result.
+//  - out:     Text file receiving the results of every design, or NULL.
+//  - range:   Per thread smallest and largest relative shift of SECF, with padding between threads.
+//  - failed:  Number of designs whose geometry could not be solved.
+typedef struct
+{
+
+	Field* field;
+	Sweep* sweep;
+	FILE* out;
+	double (*range)[8];
+	long failed;
+
+} Report;
+
+// Return the resonant frequency of the secondary with capacitance C.
+static double resonance( Coil* c, double C ) { return 1.0 / ( 2.0 * PI * sqrt( c->SECL * C ) ); }
+
+// Solve a block of designs, accumulating the range and writing results if requested.
+void visit( Coil* designs, long first, int count, int thread, void* arg );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char* results = NULL;
+	Field f = { SPHERE, 0.0, 0.5, 200, 100 };
+	int threads = processors();
+	int opt, i, t;
+	struct timespec start, stop;
+	double elapsed, C, F;
+	long hits, misses;
+	Coil base, c;
+	Sweep s;
+	Report r;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "f:g:m:n:o:t:T:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'g': f.ground = atof( optarg ); break;
+			case 'm': f.top = atoi( optarg ); break;
+			case 'n': f.coil = atoi( optarg ); break;
+			case 'o': results = optarg; break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'T':
+				if ( fieldShape( &f, optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid topload shape.\n", optarg);
+					return 1;
+
+				}
+				break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-T sphere|toroid:minor] [-g ground height] [-n secondary panels] [-m topload panels] [-o results.tsv] [-t threads] [NAME=lo:hi[:step] ...]\n", argv[0]);
+				return 1;
+
+		}
+
+	// Read in the parameters that are held fixed across the designs.
+	memset( &base, 0, sizeof base );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &base, settings, stdout ) ) return 1;
+
+	sweepInit( &s, &base );
+	for ( i = optind; i < argc; i++ )
+		if ( sweepAxis( &s, argv[i] ) ) return 1;
+
+	printf("\n");
+	for ( i = 0; i < s.axes; i++ )
+		printf("  %-6s %e .. %e (%ld values)\n", s.axis[i].name, s.axis[i].lo,
+			s.axis[i].lo + s.axis[i].step * ( s.axis[i].count - 1 ), s.axis[i].count);
+	if ( f.shape == SPHERE ) printf("  Topload: sphere");
+	else printf("  Topload: toroid with a %.3fm tube", f.minor);
+	printf(", %.3fm above ground, %d secondary and %d topload panels\n", f.ground, f.coil, f.top);
+
+	// A single design shares the threads out within its solve.
+	if ( s.total == 1 )
+	{
+
+		printf("  Threads: %d\n", threads);
+		c = base;
+		calculate( &c );
+		clock_gettime( CLOCK_MONOTONIC, &start );
+		C = capacitance( &f, &c, threads );
+		clock_gettime( CLOCK_MONOTONIC, &stop );
+		elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+		printf("  Elapsed: %.3fs\n\n", elapsed);
+		if ( isnan( C ) )
+		{
+
+			fprintf(stderr, "  The geometry cannot be solved.\n");
+			return 1;
+
+		}
+
+		F = resonance( &c, C );
+		printf("  Capacitance: %6.2f%cF (SECC + TOPC %6.2f%cF, %+.2f%%)\n", C*SIfactor(C), SIprefix(C),
+			(c.SECC+c.TOPC)*SIfactor(c.SECC+c.TOPC), SIprefix(c.SECC+c.TOPC), 100.0 * ( ( c.SECC + c.TOPC ) / C - 1.0 ));
+		printf("  Resonance:   %6.2f%cHz (SECF %6.2f%cHz, %+.2f%%)\n", F*SIfactor(F), SIprefix(F),
+			c.SECF*SIfactor(c.SECF), SIprefix(c.SECF), 100.0 * ( c.SECF / F - 1.0 ));
+		return 0;
+
+	}
+
+	printf("  Designs: %ld on %d threads\n", s.total, threads);
+	r.field = &f;
+	r.sweep = &s;
+	r.failed = 0;
+	r.out = NULL;
+	if ( results && !( r.out = fopen( results, "w" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", results);
+		return 1;
+
+	}
+	if ( r.out )
+	{
+
+		fprintf(r.out, "DESIGN\t");
+		for ( i = 0; i < s.axes; i++ ) fprintf(r.out, "%s\t", s.axis[i].name);
+		fprintf(r.out, "CAP\tSECC+TOPC\tFIELDF\tSECF\n");
+
+	}
+	r.range = malloc( threads * sizeof *r.range );
+	for ( t = 0; t < threads; t++ )
+	{
+
+		r.range[t][0] = DBL_MAX;
+		r.range[t][1] = -DBL_MAX;
+
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	if ( sweepRun( &s, threads, r.out != NULL, visit, &r ) ) return 1;
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+	if ( r.out ) fclose( r.out );
+
+	for ( t = 1; t < threads; t++ )
+	{
+
+		if ( r.range[t][0] < r.range[0][0] ) r.range[0][0] = r.range[t][0];
+		if ( r.range[t][1] > r.range[0][1] ) r.range[0][1] = r.range[t][1];
+
+	}
+
+	fieldCache( &hits, &misses );
+	printf("  Elapsed: %.3fs (%.3e designs/s)\n", elapsed, s.total / elapsed);
+	printf("  Geometries: %ld solved, %ld reused", misses, hits);
+	if ( r.failed ) printf(", %ld could not be solved", r.failed);
+	printf("\n");
+	if ( r.failed == s.total )
+	{
+
+		fprintf(stderr, "  None of the %ld geometries could be solved.\n", s.total);
+		free( r.range );
+		return 1;
+
+	}
+	printf("\n  SECF is %+.2f%% .. %+.2f%% of the resonance with the solved capacitance\n",
+		100.0 * r.range[0][0], 100.0 * r.range[0][1]);
+
+	free( r.range );
+	return 0;
+
+}
+
+void visit( Coil* designs, long first, int count, int thread, void* arg )
+{
+
+	Report* r = arg;
+	double C, F, shift;
+	int i, j;
+
+	for ( j = 0; j < count; j++ )
+	{
+
+		C = capacitance( r->field, &designs[j], 1 );
+		if ( isnan( C ) ) { __atomic_add_fetch( &r->failed, 1, __ATOMIC_RELAXED ); continue; }
+
+		F = resonance( &designs[j], C );
+		shift = designs[j].SECF / F - 1.0;
+		if ( shift < r->range[thread][0] ) r->range[thread][0] = shift;
+		if ( shift > r->range[thread][1] ) r->range[thread][1] = shift;
+
+		if ( r->out )
+		{
+
+			fprintf(r->out, "%ld\t", first + j);
+			for ( i = 0; i < r->sweep->axes; i++ )
+				fprintf(r->out, "%g\t", *(float*)( (char*)&designs[j] + r->sweep->axis[i].offset ));
+			fprintf(r->out, "%e\t%e\t%e\t%e\n", C, designs[j].SECC + designs[j].TOPC, F, designs[j].SECF);
+
+		}
+
+	}
+
+}
@@ -0,0 +1,200 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaIndex"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Index.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Answer a query, printing each design found and writing it to out unless it is NULL.
+// Returns the time taken to search in seconds.
+double answer( Index* x, Query* q, int nearest, Hit* hits, FILE* out );
+
+int main( int argc, char** argv )
+{
+
+	char *results = NULL, *keys = NULL, *written = NULL, *index = NULL, *queries = NULL, *hitsFile = NULL;
+	int key[INDEX_KEYS], nearest = 10, count = 0, opt, i;
+	char line[1024], *term;
+	struct timespec start, stop;
+	double elapsed = 0.0;
+	long asked = 0;
+	FILE *in, *out = NULL;
+	Query q;
+	Index x;
+	Hit* hits;
+
+	while ( ( opt = getopt( argc, argv, "b:k:w:i:n:q:o:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'b': results = optarg; break;
+			case 'k': keys = optarg; break;
+			case 'w': written = optarg; break;
+			case 'i': index = optarg; break;
+			case 'n': nearest = atoi( optarg ) > 0 ? atoi( optarg ) : nearest; break;
+			case 'q': queries = optarg; break;
+			case 'o': hitsFile = optarg; break;
+			default:
+				fprintf(stderr, "Usage: %s -b results.bin -k NAME[,NAME...] -w designs.idx\n"
+					"       %s -i designs.idx [-n nearest] [-q queries.txt] [-o hits.tsv] NAME=value|NAME=lo:hi|NAME=a,b,... ...\n", argv[0], argv[0]);
+				return 1;
+
+		}
+
+	// Build an index from a binary result file written by TeslaSweep -b.
+	if ( results )
+	{
+
+		if ( !keys || !written )
+		{
+
+			fprintf(stderr, "Give the key columns with -k and the index to write with -w.\n");
+			return 1;
+
+		}
+		for ( term = strtok( keys, "," ); term; term = strtok( NULL, "," ) )
+			if ( count == INDEX_KEYS || ( key[count++] = lookup( term, strlen( term ) ) ) < 0 )
+			{
+
+				fprintf(stderr, "  %s not valid key column.\n", term);
+				return 1;
+
+			}
+
+		clock_gettime( CLOCK_MONOTONIC, &start );
+		if ( indexBuild( results, count, key, written ) || indexMap( &x, written ) ) return 1;
+		clock_gettime( CLOCK_MONOTONIC, &stop );
+		printf("  Indexed: %llu designs on", (unsigned long long)x.header->rows);
+		for ( i = 0; i < count; i++ ) printf(" %s", registry[key[i]].name);
+		printf(" in %.3fs, %u levels of leaves of %d\n", ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec ),
+			x.header->depth, INDEX_LEAF);
+		indexUnmap( &x );
+		return 0;
+
+	}
+
+	if ( !index )
+	{
+
+		fprintf(stderr, "Give an index to build with -b or to search with -i.\n");
+		return 1;
+
+	}
+	if ( indexMap( &x, index ) ) return 1;
+	if ( hitsFile )
+	{
+
+		if ( !( out = fopen( hitsFile, "w" ) ) )
+		{
+
+			fprintf(stderr, "Cannot open %s for writing!\n", hitsFile);
+			return 1;
+
+		}
+		fprintf(out, "DESIGN\tDISTANCE\t");
+		writeHeader( out );
+
+	}
+	hits = malloc( nearest * sizeof *hits );
+
+	// A query given on the command line is answered alone, or each line of -q in turn.
+	if ( !queries )
+	{
+
+		memset( &q, 0, sizeof q );
+		for ( i = optind; i < argc; i++ )
+			if ( queryTerm( &q, argv[i] ) ) return 1;
+		elapsed = answer( &x, &q, nearest, hits, out );
+		asked = 1;
+
+	}
+	else if ( !( in = fopen( queries, "r" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for parsing!\n", queries);
+		return 1;
+
+	}
+	else
+	{
+
+		while ( fgets( line, sizeof line, in ) )
+		{
+
+			memset( &q, 0, sizeof q );
+			for ( term = strtok( line, " \t\r\n" ); term; term = strtok( NULL, " \t\r\n" ) )
+				if ( queryTerm( &q, term ) ) break;
+			if ( term || q.terms == 0 ) continue;
+			printf("  Query:");
+			for ( i = 0; i < q.terms; i++ ) printf(" %s", registry[q.term[i].column].name);
+			printf("\n");
+			elapsed += answer( &x, &q, nearest, hits, out );
+			asked++;
+
+		}
+		fclose( in );
+
+	}
+
+	printf("\n  Searched %llu designs: %ld queries in %.3fms (%.2fus per query)\n", (unsigned long long)x.header->rows,
+		asked, 1.0e3 * elapsed, asked ? 1.0e6 * elapsed / asked : 0.0);
+
+	if ( out ) fclose( out );
+	free( hits );
+	indexUnmap( &x );
+	return 0;
+
+}
+
+double answer( Index* x, Query* q, int nearest, Hit* hits, FILE* out )
+{
+
+	struct timespec start, stop;
+	long found, i;
+	int j;
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	found = q->targets ? indexNearest( x, q, nearest, hits ) : indexRange( x, q, hits, nearest );
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+
+	if ( !q->targets ) printf("  %ld designs meet every constraint\n", found);
+	if ( found > nearest ) found = nearest;
+	for ( i = 0; i < found; i++ )
+	{
+
+		float* row = indexRow( x, hits[i].row );
+		printf("  design %-10llu", (unsigned long long)x->origin[hits[i].row]);
+		if ( q->targets ) printf(" %9.3e", hits[i].distance);
+		for ( j = 0; j < q->terms; j++ )
+		{
+
+			Parameter* p = &registry[q->term[j].column];
+			double v = row[q->term[j].column];
+			printf("  %s %6.2f%c%s", p->name, v*SIfactor(v), SIprefix(v), p->unit);
+
+		}
+		printf("\n");
+
+		if ( out )
+		{
+
+			fprintf(out, "%llu\t%e\t", (unsigned long long)x->origin[hits[i].row], hits[i].distance);
+			for ( j = 0; j < PARAMETERS; j++ ) fprintf(out, j ? "\t%e" : "%e", row[j]);
+			fprintf(out, "\n");
+
+		}
+
+	}
+
+	return ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+
+}
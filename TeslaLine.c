@@ -0,0 +1,293 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaLine"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Summary.c"
+#include "Ladder.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Number of results summarized over every design.
+#define SUMMARY 3
+_Static_assert( SUMMARY <= SUMMARY_LIMIT, "Every summarized result must fit in a Summary" );
+
+// Holds what every worker thread needs to solve a block of designs.
+//  - base:    Height of the bottom of the winding above ground in meters.
+//  - sweep:   Design space, whose axes are written with each result.
+//  - out:     Text file receiving the results of every design, or NULL.
+//  - profile: Text file receiving the voltage along the first design, or NULL.
+//  - ladder:  Per thread ladder the designs are cut into.
+//  - summary: Per thread ranges of the summarized results.
+//  - single:  Mode frequencies of the first design, reported in full when it is the only one.
+typedef struct
+{
+
+	double base;
+	Sweep* sweep;
+	FILE *out, *profile;
+	Ladder* ladder;
+	Summary* summary;
+	double single[LADDER_MODES];
+
+} Report;
+
+// Names and units of the summarized results.
+static char* summaryName[SUMMARY] = { "F1", "RATIO", "CEFF" };
+static char* summaryUnit[SUMMARY] = { "Hz", "",      "F"    };
+
+// Return the self-capacitance that, lumped with the topload across SECL,
+// resonates at the lowest mode of the line.
+static double effective( Coil* c, double f )
+{
+
+	return 1.0 / ( 4.0*PI*PI * f*f * c->SECL ) - c->TOPC;
+
+}
+
+// Solve a block of designs, accumulating the summary and writing results if requested.
+void visit( Coil* designs, long first, int count, int thread, void* arg );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char *results = NULL, *profile = NULL;
+	int threads = processors(), segments = 1000, modes = 3;
+	int opt, i, t;
+	struct timespec start, stop;
+	double elapsed, C, F;
+	Coil base, c;
+	Sweep s;
+	Report r;
+
+	// Define values for the global constants and ratios.
+	constants();
+	r.base = 0.5;
+
+	while ( ( opt = getopt( argc, argv, "f:g:m:n:o:p:t:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'g': r.base = atof( optarg ); break;
+			case 'm':
+				if ( ( modes = atoi( optarg ) ) < 1 || modes > LADDER_MODES )
+				{
+
+					fprintf(stderr, "  %s not valid number of modes, from 1 to %d.\n", optarg, LADDER_MODES);
+					return 1;
+
+				}
+				break;
+			case 'n':
+				if ( ( segments = atoi( optarg ) ) < 1 )
+				{
+
+					fprintf(stderr, "  %s not valid number of segments.\n", optarg);
+					return 1;
+
+				}
+				break;
+			case 'o': results = optarg; break;
+			case 'p': profile = optarg; break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-g ground height] [-n segments] [-m modes] [-o results.tsv] [-p profile.tsv] [-t threads] [NAME=lo:hi[:step] ...]\n", argv[0]);
+				return 1;
+
+		}
+	if ( modes > segments )
+	{
+
+		fprintf(stderr, "  %d modes not valid for %d segments, which have at most as many.\n", modes, segments);
+		return 1;
+
+	}
+
+	// Read in the parameters that are held fixed across the designs.
+	memset( &base, 0, sizeof base );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &base, settings, stdout ) ) return 1;
+
+	sweepInit( &s, &base );
+	for ( i = optind; i < argc; i++ )
+		if ( sweepAxis( &s, argv[i] ) ) return 1;
+
+	printf("\n");
+	for ( i = 0; i < s.axes; i++ )
+		printf("  %-6s %e .. %e (%ld values)\n", s.axis[i].name, s.axis[i].lo,
+			s.axis[i].lo + s.axis[i].step * ( s.axis[i].count - 1 ), s.axis[i].count);
+	printf("  Designs: %ld, %d segments %.3fm above ground, %d modes on %d threads\n",
+		s.total, segments, r.base, modes, threads);
+
+	r.sweep = &s;
+	r.out = NULL;
+	if ( results && !( r.out = fopen( results, "w" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", results);
+		return 1;
+
+	}
+	if ( r.out )
+	{
+
+		fprintf(r.out, "DESIGN\t");
+		for ( i = 0; i < s.axes; i++ ) fprintf(r.out, "%s\t", s.axis[i].name);
+		fprintf(r.out, "SECF");
+		for ( i = 0; i < modes; i++ ) fprintf(r.out, "\tF%d", i + 1);
+		fprintf(r.out, "\tCEFF\tSECC\n");
+
+	}
+	r.profile = NULL;
+	if ( profile && !( r.profile = fopen( profile, "w" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", profile);
+		return 1;
+
+	}
+
+	r.ladder = malloc( threads * sizeof *r.ladder );
+	r.summary = malloc( threads * sizeof *r.summary );
+	for ( t = 0; t < threads; t++ )
+	{
+
+		if ( ladderInit( &r.ladder[t], segments ) )
+		{
+
+			fprintf(stderr, "Cannot hold %d segments!\n", segments);
+			return 1;
+
+		}
+		r.ladder[t].modes = modes;
+		summaryInit( &r.summary[t] );
+
+	}
+
+	// Results are only written in order when they are written at all.
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	if ( sweepRun( &s, threads, r.out != NULL, visit, &r ) ) return 1;
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+
+	if ( r.out ) fclose( r.out );
+	if ( r.profile && ( ferror( r.profile ) | fclose( r.profile ) ) )
+	{
+
+		fprintf(stderr, "Cannot write %s!\n", profile);
+		return 1;
+
+	}
+
+	// Combine the summaries of every thread.
+	summaryMerge( r.summary, threads, SUMMARY );
+
+	printf("  Elapsed: %.3fms (%.3e designs/s)\n\n", 1.0e3 * elapsed, (double)s.total / elapsed);
+	if ( s.total == 1 )
+	{
+
+		c = base;
+		calculate( &c );
+		F = 0.25 * C0 / c.SECLN;
+		printf("  Lumped:       %6.2f%cHz, quarter wave of the wire %6.2f%cHz\n",
+			c.SECF*SIfactor(c.SECF), SIprefix(c.SECF), F*SIfactor(F), SIprefix(F));
+		for ( i = 0; i < modes; i++ )
+		{
+
+			F = r.single[i];
+			printf("  Mode %d:       %6.2f%cHz (%.3f of the lowest)\n", i + 1, F*SIfactor(F), SIprefix(F), F / r.single[0]);
+
+		}
+		C = effective( &c, r.single[0] );
+		printf("  Capacitance:  %6.2f%cF self-capacitance, %6.2f%cF by medhurst()\n",
+			C*SIfactor(C), SIprefix(C), c.SECC*SIfactor(c.SECC), SIprefix(c.SECC));
+
+	}
+	else summaryPrint( r.summary, SUMMARY, summaryName, summaryUnit );
+
+	for ( t = 0; t < threads; t++ ) ladderFree( &r.ladder[t] );
+	free( r.ladder );
+	free( r.summary );
+	return 0;
+
+}
+
+void visit( Coil* designs, long first, int count, int thread, void* arg )
+{
+
+	Report* r = arg;
+	Summary* s = &r->summary[thread];
+	Ladder* l = &r->ladder[thread];
+	Coil* c;
+	float field[SUMMARY];
+	int i, j, k;
+
+	for ( j = 0; j < count; j++ )
+	{
+
+		c = &designs[j];
+		ladderDesign( l, c, r->base );
+		ladderSolve( l, l->modes );
+		field[0] = l->f[0];
+		field[1] = l->f[0] / c->SECF;
+		field[2] = effective( c, l->f[0] );
+
+		for ( i = 0; i < SUMMARY; i++ ) summaryAdd( s, i, field[i], first + j );
+		if ( r->out )
+		{
+
+			fprintf(r->out, "%ld\t", first + j);
+			for ( i = 0; i < r->sweep->axes; i++ )
+				fprintf(r->out, "%g\t", *(float*)( (char*)c + r->sweep->axis[i].offset ));
+			fprintf(r->out, "%e", c->SECF);
+			for ( k = 0; k < l->modes; k++ ) fprintf(r->out, "\t%e", l->f[k]);
+			fprintf(r->out, "\t%e\t%e\n", field[2], c->SECC);
+
+		}
+
+		// The first design alone has its voltage along the winding written out.
+		if ( first + j == 0 )
+		{
+
+			memcpy( r->single, l->f, sizeof r->single );
+			if ( r->profile )
+			{
+
+				fprintf(r->profile, "Z\tL\tC");
+				for ( k = 0; k < l->modes; k++ ) fprintf(r->profile, "\tV%d", k + 1);
+				fprintf(r->profile, "\n");
+				for ( i = 0; i < l->n; i++ )
+				{
+
+					fprintf(r->profile, "%e\t%e\t%e", l->z[i], l->L[i], l->C[i]);
+					for ( k = 0; k < l->modes; k++ ) fprintf(r->profile, "\t%.6f", l->v[(size_t)k * l->n + i]);
+					fprintf(r->profile, "\n");
+
+				}
+
+			}
+
+		}
+
+	}
+
+}
@@ -0,0 +1,251 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaPareto"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Pareto.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Objectives and constraint used when none are given: the longest arc for the
+// least secondary wire, primary footprint and tank capacitance, from a secondary
+// of practical proportions.
+static char* objectives = "+ARCLN,-SECLN,-PRIRO,-LTRCS";
+static char* constraints = "SECHD=3:6";
+
+// Add each comma separated specification in list with add.
+int addList( Pareto* p, char* list, int (*add)( Pareto* p, char* spec ) );
+
+// Save the populations after each migration so an interrupted run can be resumed.
+void checkpoint( Pareto* p, void* file );
+
+// Write the front to a tab separated file, one design per row.
+int writeFront( Pareto* p, Individual* f, int n, char* file );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char *results = NULL, *save = NULL, *resume = NULL, *objective = objectives, *constraint = constraints;
+	int islands = 4, size = 100, migrate = 25, threads = processors();
+	long generations = 200;
+	uint64_t seed = 1;
+	struct timespec start, stop;
+	double elapsed, lo, hi, v;
+	char spec[64];
+	const char* unit;
+	int opt, i, j, n;
+	long before;
+	Individual* f;
+	Pareto p;
+	Coil c;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "f:g:i:n:m:s:t:o:w:r:O:C:P:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'g': generations = atol( optarg ) >= 0 ? atol( optarg ) : generations; break;
+			case 'i': islands = atoi( optarg ) > 0 ? atoi( optarg ) : islands; break;
+			case 'n': size = atoi( optarg ) > 2 ? atoi( optarg ) : size; break;
+			case 'm': migrate = atoi( optarg ) > 0 ? atoi( optarg ) : migrate; break;
+			case 's': seed = strtoull( optarg, NULL, 0 ); break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'o': results = optarg; break;
+			case 'w': save = optarg; break;
+			case 'r': resume = optarg; break;
+			case 'O': objective = optarg; break;
+			case 'C': constraint = optarg; break;
+			case 'P':
+				if ( precisionModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid precision.\n", optarg);
+					return 1;
+
+				}
+				break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-O +NAME,-NAME,...] [-C NAME=lo:hi,...] [-g generations] [-i islands] [-n population] [-m migration interval] [-s seed] [-t threads] [-P float|double] [-r resume.pop] [-w save.pop] [-o front.tsv] [NAME=lo:hi ...]\n", argv[0]);
+				return 1;
+
+		}
+
+	// Read in the parameters that hold wherever an input is not free.
+	memset( &c, 0, sizeof c );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &c, settings, stdout ) ) return 1;
+
+	paretoInit( &p, &c, islands, size, seed );
+	p.migrate = migrate;
+	if ( addList( &p, objective, paretoObjective ) || addList( &p, *constraint ? constraint : NULL, paretoConstraint ) ) return 1;
+	if ( p.objectives < 2 )
+	{
+
+		fprintf(stderr, "  At least two objectives are needed for a front.\n");
+		return 1;
+
+	}
+	for ( i = optind; i < argc; i++ )
+		if ( paretoGene( &p, argv[i] ) ) return 1;
+
+	// Without free inputs given, every input ranges from half to twice its value in the settings.
+	for ( i = 0; optind == argc && i < INPUTS; i++ )
+	{
+
+		v = *(float*)( (char*)&c + registry[inputColumn[i]].offset );
+		snprintf(spec, sizeof spec, "%s=%.9g:%.9g", inputName( i ), 0.5 * v, 2.0 * v);
+		if ( paretoGene( &p, spec ) ) return 1;
+
+	}
+
+	if ( resume )
+	{
+
+		if ( paretoLoad( &p, resume, seed ) )
+		{
+
+			fprintf(stderr, "Cannot resume from %s!\n", resume);
+			return 1;
+
+		}
+
+	}
+	else paretoStart( &p );
+
+	printf("\n");
+	for ( i = 0; i < p.genes; i++ )
+		printf("  %-6s %e .. %e\n", inputName( p.gene[i].input ), p.gene[i].lo, p.gene[i].hi);
+	for ( i = 0; i < p.objectives; i++ )
+		printf("  %-6s %s\n", p.objective[i].name, p.objective[i].sign < 0.0 ? "maximized" : "minimized");
+	for ( i = 0; i < p.constraints; i++ )
+		printf("  %-6s kept within %g .. %g\n", p.constraint[i].name, p.constraint[i].lo, p.constraint[i].hi);
+	printf("  Islands: %d of %d designs, migrating every %d generations, on %d threads with %s kernel\n",
+		p.islands, p.size, p.migrate, threads, precision == DOUBLE ? "double" : batchKernel());
+	if ( resume ) printf("  Resumed: generation %ld from %s\n", p.generation, resume);
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	before = p.evaluations;
+	paretoRun( &p, generations, threads, save ? checkpoint : NULL, save );
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+	printf("  Elapsed: %.3fs for %ld generations (%.3e designs/s)\n\n", elapsed, generations,
+		elapsed > 0.0 ? ( p.evaluations - before ) / elapsed : 0.0);
+
+	if ( save && paretoSave( &p, save ) )
+	{
+
+		fprintf(stderr, "Cannot write %s!\n", save);
+		return 1;
+
+	}
+
+	n = paretoFront( &p, &f );
+	printf("  Front: %d feasible designs after %ld generations and %ld evaluations\n", n, p.generation, p.evaluations);
+	for ( j = 0; j < p.objectives && n > 0; j++ )
+	{
+
+		for ( lo = hi = f[0].f[j], i = 1; i < n; i++ )
+		{
+
+			if ( f[i].f[j] < lo ) lo = f[i].f[j];
+			if ( f[i].f[j] > hi ) hi = f[i].f[j];
+
+		}
+		lo *= p.objective[j].sign;
+		hi *= p.objective[j].sign;
+		if ( lo > hi ) { v = lo; lo = hi; hi = v; }
+		unit = registry[lookup( p.objective[j].name, strlen( p.objective[j].name ) )].unit;
+		printf("  %-6s %6.2f%c%s .. %6.2f%c%s\n", p.objective[j].name, lo*SIfactor(lo), SIprefix(lo), unit,
+			hi*SIfactor(hi), SIprefix(hi), unit);
+
+	}
+
+	if ( results && writeFront( &p, f, n, results ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", results);
+		return 1;
+
+	}
+
+	free( f );
+	paretoFree( &p );
+	return 0;
+
+}
+
+int addList( Pareto* p, char* list, int (*add)( Pareto* p, char* spec ) )
+{
+
+	char copy[list ? strlen( list ) + 1 : 1];
+	char* spec;
+
+	if ( !list ) return 0;
+	strcpy( copy, list );
+	for ( spec = strtok( copy, "," ); spec; spec = strtok( NULL, "," ) )
+		if ( add( p, spec ) ) return 1;
+	return 0;
+
+}
+
+void checkpoint( Pareto* p, void* file )
+{
+
+	if ( paretoSave( p, file ) ) fprintf(stderr, "Cannot write %s!\n", (char*)file);
+
+}
+
+int writeFront( Pareto* p, Individual* f, int n, char* file )
+{
+
+	FILE* out = fopen( file, "w" );
+	Coil c;
+	int i, j;
+
+	if ( !out ) return 1;
+	fprintf(out, "DESIGN");
+	for ( j = 0; j < p->genes; j++ ) fprintf(out, "\t%s", inputName( p->gene[j].input ));
+	for ( j = 0; j < p->objectives; j++ ) fprintf(out, "\t%s", p->objective[j].name);
+	for ( j = 0; j < p->constraints; j++ ) fprintf(out, "\t%s", p->constraint[j].name);
+	fprintf(out, "\n");
+
+	// Rows are recalculated so the constraints are written with the objectives.
+	for ( i = 0; i < n; i++ )
+	{
+
+		c = p->base;
+		for ( j = 0; j < INPUTS; j++ ) *(float*)( (char*)&c + registry[inputColumn[j]].offset ) = f[i].x[j];
+		batchCoils( &c, 1 );
+
+		fprintf(out, "%d", i);
+		for ( j = 0; j < p->genes; j++ ) fprintf(out, "\t%g", f[i].x[p->gene[j].input]);
+		for ( j = 0; j < p->objectives; j++ ) fprintf(out, "\t%e", *(float*)( (char*)&c + p->objective[j].offset ));
+		for ( j = 0; j < p->constraints; j++ ) fprintf(out, "\t%e", *(float*)( (char*)&c + p->constraint[j].offset ));
+		fprintf(out, "\n");
+
+	}
+
+	return fclose( out ) != 0;
+
+}
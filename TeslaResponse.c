@@ -0,0 +1,220 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaResponse"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Response.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Parse the tank capacitances of -c, either lo:hi:count log spaced or a comma
+// separated list, into a newly allocated array. Returns their number or 0.
+int capacitors( char* spec, double** C );
+
+// Write the gain, its phase and the impedance seen by the mains of every
+// capacitance at every given number of points of the grid.
+int writeResponse( Response* r, Charger* k, int n, double* C, long every, char* file );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char *results = NULL, *tanks = NULL, *band = NULL;
+	int threads = processors(), n, opt, i;
+	long points = 1000000, every = 1;
+	double lo, hi, guard = 10.0, *C;
+	struct timespec start, stop;
+	double elapsed;
+	Resonance* res;
+	Response r;
+	Charger k;
+	Coil c;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "f:c:b:n:m:o:e:t:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'c': tanks = optarg; break;
+			case 'b': band = optarg; break;
+			case 'n': points = atol( optarg ) >= 3 ? atol( optarg ) : points; break;
+			case 'm': guard = atof( optarg ); break;
+			case 'o': results = optarg; break;
+			case 'e': every = atol( optarg ) > 0 ? atol( optarg ) : every; break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-c lo:hi:count|C,C,...] [-b lo:hi] [-n points] [-m margin %%] [-o response.tsv] [-e points per row] [-t threads]\n", argv[0]);
+				return 1;
+
+		}
+
+	memset( &c, 0, sizeof c );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &c, settings, stdout ) ) return 1;
+	calculate( &c );
+	chargerInit( &k, &c );
+	if ( !( k.L > 0.0 ) || !( k.f > 0.0 ) )
+	{
+
+		fprintf(stderr, "  The NST has no leakage inductance to resonate with.\n");
+		return 1;
+
+	}
+
+	// Without capacitances given the resonant, static and rotary LTR sizes are compared.
+	if ( tanks ) n = capacitors( tanks, &C );
+	else
+	{
+
+		C = malloc( 3 * sizeof *C );
+		C[0] = c.PTCC;
+		C[1] = c.LTRCS;
+		C[2] = c.LTRCR;
+		n = 3;
+
+	}
+	if ( n == 0 )
+	{
+
+		fprintf(stderr, "  %s not valid capacitances.\n", tanks);
+		return 1;
+
+	}
+
+	// Without a band the grid spans two decades either side of the mains.
+	lo = 0.01 * k.f;
+	hi = 100.0 * k.f;
+	if ( band && ( sscanf( band, "%lf:%lf", &lo, &hi ) != 2 || !( lo > 0.0 && hi > lo ) ) )
+	{
+
+		fprintf(stderr, "  %s not valid band.\n", band);
+		return 1;
+
+	}
+	if ( responseInit( &r, lo, hi, points ) )
+	{
+
+		fprintf(stderr, "Cannot hold %ld points!\n", points);
+		return 1;
+
+	}
+
+	printf("\n  Leakage: %6.2f%cH, %6.2f%cohm, turn ratio %.2f, PFC %6.2f%cF at %6.2f%cHz\n",
+		k.L*SIfactor(k.L), SIprefix(k.L), k.R*SIfactor(k.R), SIprefix(k.R), k.TR,
+		k.PF*SIfactor(k.PF), SIprefix(k.PF), k.f*SIfactor(k.f), SIprefix(k.f));
+	printf("  Band: %6.2f%cHz .. %6.2f%cHz, %ld points for %d capacitances on %d threads with %s kernel\n",
+		lo*SIfactor(lo), SIprefix(lo), hi*SIfactor(hi), SIprefix(hi), points, n, threads, responseKernel());
+
+	res = malloc( n * sizeof *res );
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	responseScan( &r, &k, n, C, res, threads );
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+	printf("  Elapsed: %.3fms (%.3e points/s)\n\n", 1.0e3 * elapsed, elapsed > 0.0 ? (double)points * n / elapsed : 0.0);
+
+	printf("  %-9s  %-10s %8s %9s %10s %10s\n", "Tank", "Resonance", "Margin", "Peak", "Mains", "Line");
+	for ( i = 0; i < n; i++ )
+	{
+
+		Resonance* s = &res[i];
+
+		printf("  %6.2f%cF  ", s->C*SIfactor(s->C), SIprefix(s->C));
+		if ( s->edge ) printf("%-10s %8s", "none", "-");
+		else printf("%6.2f%cHz %+7.1f%%", s->peak*SIfactor(s->peak), SIprefix(s->peak), 100.0 * s->margin);
+		printf(" %8.2fx %9.3fx %6.2f%cA%s\n", s->gain, s->mains, s->line*SIfactor(s->line), SIprefix(s->line),
+			!s->edge && fabs( 100.0 * s->margin ) < guard ? "  too close to mains" : "");
+
+	}
+
+	if ( results && writeResponse( &r, &k, n, C, every, results ) )
+	{
+
+		fprintf(stderr, "Cannot write %s!\n", results);
+		return 1;
+
+	}
+
+	free( res );
+	free( C );
+	responseFree( &r );
+	return 0;
+
+}
+
+int capacitors( char* spec, double** C )
+{
+
+	double lo, hi;
+	char* term;
+	int n = 0, count, i;
+
+	if ( sscanf( spec, "%lf:%lf:%d", &lo, &hi, &count ) == 3 )
+	{
+
+		if ( !( lo > 0.0 && hi > lo ) || count < 2 ) return 0;
+		*C = malloc( count * sizeof **C );
+		for ( i = 0; i < count; i++ ) (*C)[i] = lo * pow( hi / lo, (double)i / ( count - 1 ) );
+		return count;
+
+	}
+
+	*C = malloc( ( strlen( spec ) / 2 + 1 ) * sizeof **C );
+	for ( term = strtok( spec, "," ); term; term = strtok( NULL, "," ) )
+		if ( !( ( (*C)[n++] = atof( term ) ) > 0.0 ) ) { free( *C ); return 0; }
+	return n;
+
+}
+
+int writeResponse( Response* r, Charger* k, int n, double* C, long every, char* file )
+{
+
+	FILE* out = fopen( file, "w" );
+	double complex g;
+	double f;
+	long j;
+	int i;
+
+	if ( !out ) return 1;
+	fprintf(out, "FREQ");
+	for ( i = 0; i < n; i++ ) fprintf(out, "\tGAIN%d\tPHASE%d\tZIN%d", i + 1, i + 1, i + 1);
+	fprintf(out, "\n");
+
+	for ( j = 0; j < r->points; j += every )
+	{
+
+		f = responseFrequency( r, j );
+		fprintf(out, "%e", f);
+		for ( i = 0; i < n; i++ )
+		{
+
+			g = chargerGain( k, C[i], f );
+			fprintf(out, "\t%e\t%.3f\t%e", cabs( g ), carg( g ) * 180.0 / PI, 1.0 / cabs( chargerAdmittance( k, C[i], f ) ));
+
+		}
+		fprintf(out, "\n");
+
+	}
+
+	return ferror( out ) | fclose( out );
+
+}
@@ -0,0 +1,154 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaSolve"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Coil.c"
+#include "Solve.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Add the comma separated input parameters in list to the free inputs.
+int freeInputs( char* list, int* input, int* free );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char* output[SOLVE_TARGETS];
+	double goal[SOLVE_TARGETS], tol = 1.0e-5;
+	int input[INPUTS], free = 0, targets = 0, limit = 200, evaluations = 0;
+	int opt, i, failed;
+	Coil c;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "f:x:e:n:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'x': if ( freeInputs( optarg, input, &free ) ) return 1; break;
+			case 'e': tol = atof( optarg ) > 0.0 ? atof( optarg ) : tol; break;
+			case 'n': limit = atoi( optarg ) > 1 ? atoi( optarg ) : limit; break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-e tolerance] [-n max evaluations] -x INPUT[,INPUT...] OUTPUT=goal ...\n", argv[0]);
+				return 1;
+
+		}
+
+	for ( i = optind; i < argc; i++ )
+	{
+
+		char* value = strchr( argv[i], '=' );
+		if ( !value || targets == SOLVE_TARGETS || ( goal[targets] = atof( value + 1 ) ) <= 0.0 )
+		{
+
+			fprintf(stderr, "  %s not valid goal of form OUTPUT=value.\n", argv[i]);
+			return 1;
+
+		}
+		*value = '\0';
+		output[targets++] = argv[i];
+
+	}
+	if ( free == 0 || targets == 0 )
+	{
+
+		fprintf(stderr, "Nothing to solve: give free inputs with -x and at least one OUTPUT=goal.\n");
+		return 1;
+
+	}
+
+	memset( &c, 0, sizeof c );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &c, settings, stdout ) ) return 1;
+
+	calculate( &c );
+	for ( i = 0; i < targets; i++ )
+	{
+
+		double g[INPUTS];
+		if ( !column( &c, output[i] ) || gradient( &c, output[i], g ) )
+		{
+
+			fprintf(stderr, "  %s not valid output to solve for.\n", output[i]);
+			return 1;
+
+		}
+
+	}
+	for ( i = 0; i < free; i++ )
+		if ( *parameter( &c, inputName( input[i] ) ) <= 0.0 )
+		{
+
+			fprintf(stderr, "  %s must start positive to be solved for.\n", inputName( input[i] ));
+			return 1;
+
+		}
+
+	failed = goalSeek( &c, targets, output, goal, free, input, tol, limit, &evaluations );
+
+	printf("\n  %s after %d evaluations\n\n", failed ? "Not solved" : "Solved", evaluations);
+	for ( i = 0; i < free; i++ )
+	{
+
+		float value = *parameter( &c, inputName( input[i] ) );
+		printf("  %-6s %e\n", inputName( input[i] ), value);
+
+	}
+	printf("\n");
+	for ( i = 0; i < targets; i++ )
+	{
+
+		float value = *column( &c, output[i] );
+		printf("  %-6s %6.2f%c (goal %6.2f%c, off by %+.2e)\n", output[i],
+			value*SIfactor(value), SIprefix(value), goal[i]*SIfactor(goal[i]), SIprefix(goal[i]),
+			value / goal[i] - 1.0);
+
+	}
+
+	return failed;
+
+}
+
+int freeInputs( char* list, int* input, int* free )
+{
+
+	char* name;
+	int i;
+
+	for ( name = strtok( list, "," ); name; name = strtok( NULL, "," ) )
+	{
+
+		for ( i = 0; i < INPUTS && strcmp( name, inputName( i ) ) != 0; i++ );
+		if ( i == INPUTS )
+		{
+
+			fprintf(stderr, "  %s not valid input parameter.\n", name);
+			return 1;
+
+		}
+		if ( *free < INPUTS ) input[(*free)++] = i;
+
+	}
+
+	return 0;
+
+}
@@ -6,23 +6,16 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <unistd.h>
+#include <signal.h>
 #include <sys/ioctl.h>
 #include "Shared.c"
-
-// Global constants and ratios.
-//  - PI:  Ratio of circumference to diameter of a circle.
-//  - PHI: Golden ratio. 
-//  - C0:  Speed of light in free space.
-//  - U0:  Magnetic permeability of free space.
-//  - E0:  Electric permittivity of free space.
-double PI, PHI, C0, U0, E0;
-
-// Convert between American wire gauge (WG) and wire diameter (WD) expressed in meters.
-float WD( float WG );
-float WG( float WD );
-
-// Returns the empirical self-capacitance of a helical coil with radius R and length L.
-float medhurst( float R, float L );
+#include "Coil.c"
+#include "Stream.c"
+#include "Report.c"
+#include "Sweep.c"
+#include "Daemon.c"
+#include "Sensitivity.c"
 
 // Return the SI unit autoscale factor and prefix of a given value.
 extern double SIfactor( double value );
@@ -31,111 +24,136 @@ extern char SIprefix( double value );
 // Formats and centers text.
 extern void center( char* begin, char* text, int col, char pad, char* end );
 
-// Control the input and output of parameter values.
-void input(  char* description, float* value, char* unit );
-void output( char* description, float* value, char* unit );
-
-// Parse settings from external file.
-int parseSettings( char* file );
-int parseParameter( char* param, float value );
-
-// Write settings to external file.
-int writeSettings( char* file );
-void writeParameter( FILE* file, char* param, float value );
-
-// Input parameters pertaining to the neon sign transformer (NST).
-//  - NSTVI:  RMS input voltage of NST expressed in volts.
-//  - NSTF:   Input frequency of NST expressed in hertz.
-//  - NSTVO:  RMS output voltage of NST expressed in volts.
-//  - NSTIO:  RMS output current of NST expressed in amps.
-//  - NSTRP:  Resistance of the NST primary expressed in ohms.
-//  - NSTRS:  Resistance of the NST secondary expressed in ohms.
-float NSTVI, NSTF, NSTVO, NSTIO, NSTRP, NSTRS;
-
-// Output parameters pertaining to the neon sign transformer (NST).
-//  - NSTVIP: Peak input voltage of NST expressed in volts.
-//  - NSTII:  RMS input current of NST expressed in amps.
-//  - NSTIIP: Peak input current of NST expressed in amps.
-//  - NSTVOP: Peak output voltage of NST expressed in volts.
-//  - NSTIOP: Peak output current of NST expressed in amps.
-//  - NSTVA:  Power draw of NST expressed in volt-amps.
-//  - NSTTR:  Transformer coil turn ratio of NST.
-//  - NSTZ:   Impedance of NST expressed in ohms.
-//  - NSTR:   Total resistive reactance of NST expressed in ohms.
-//  - NSTPF:  Power factor correction capacitance for NST expressed in farads.
-float NSTVIP, NSTII, NSTIIP, NSTVOP, NSTIOP, NSTVA, NSTTR, NSTZ, NSTR, NSTPF;
-
-// Output parameters pertaining to the primary tank capacitor (PTC).
-//  - PTCC:  Resonant capacitance for PTC expressed in farads.
-//  - LTRCS: Larger than resonant capacitance for PTC with static spark gap expressed in farads.
-//  - LTRCR: Larger than resonant capacitance for PTC with rotary spark gap expressed in farads.
-//  - PTCCR: Capacitive reactance of PTC expressed in ohms.
-float PTCCR, PTCC, LTRCS, LTRCR;
-
-// Input parameters pertaining to the primary coil (PRI).
-//  - PRIWG: American wire gauge of PRI.
-//  - PRIN:  Number of turns of wire in PRI.
-//  - PRIRI: Inner radius of PRI expressed in meters.
-//  - PRIS:  Separation of PRI wrappings expressed in meters.
-float PRIWG, PRIN, PRIRI, PRIS;
-
-// Output parameters pertaining to the primary coil (PRI).
-//  - PRILR: Inductive reactance of PRI expressed in ohms.
-//  - PRIWD: Wire diameter of PRI expressed in meters.
-//  - PRIRO: Outer radius of PRI expressed in meters.
-//  - PRIF:  Resonant frequency of PRI expressed in Hertz.
-//  - PRILN: Length of PRI expressed in meters.
-//  - PRIL:  Inductance of PRI expressed in Henries.
-float PRILR, PRIWD, PRIRO, PRIF, PRILN, PRIL;
-
-// Input parameters pertaining to the secondary coil (SEC).
-//  - SECWG: American wire gauge of SEC.
-//  - SECD:  Diameter of SEC expressed in meters.
-//  - SECH:  Height of SEC expressed in meters.
-float SECWG, SECD, SECH;
-
-// Output parameters pertaining to the secondary coil (SEC).
-//  - SECWD: Wire diameter of SEC expressed in meters.
-//  - SECF:  Resonant frequency of SEC expressed in hertz.
-//  - SECLN: Length of SEC expressed in meters.
-//  - SECL:  Inductance of SEC expressed in henries.
-//  - SECC:  Capacitance of SEC expressed in farads.
-//  - SECN:  Number of turns of wire in SEC.
-//  - SECHD: Coil height to diameter ratio.
-float SECWD, SECF, SECLN, SECL, SECC, SECN, SECHD;
-
-// Input parameters pertaining to the top load (TOP).
-//  - TOPD:  Diameter of TOP expressed in meters.
-float TOPD;
-
-// Output parameters pertaining to the top load (TOP).
-//  - TOPC:  Capacitance of TOP expressed in Farads.
-float TOPC;
-
-// Miscellaneous output parameters.
-//  - ARCLN: Maximum length of arc expressed in meters.
-float ARCLN;
-
-int main()
+// Prompt for the named input parameter, as described in the registry.
+void input( Coil* c, char* param );
+
+// Calculate every design in a multi-design settings file, writing one line per
+// design, or the full report of each design if reports is given. Results are
+// taken from and stored in cache unless it is NULL.
+long designs( Coil* base, char* file, FILE* out, Text* reports, Cache* cache );
+
+// Print the parameters the named parameters are calculated from and those
+// calculated from them, returning 1 if any name is not a valid parameter.
+int depends( char* names );
+
+// Print the partial derivative of each named output parameter, or of every one
+// given all, with respect to every input parameter of the calculated design c.
+int sensitivities( Coil* c, char* names );
+
+// Answer design queries on the socket at path until interrupted.
+int serve( Coil* base, char* path, Cache* cache, int threads );
+
+int main( int argc, char** argv )
 {
 
 	// Determine whether program should run in dev mode.
 	const int devel = 0;
 
+	// Hold the options selecting a non-interactive batch run.
+	char* settings = "parameters.dat";
+	char* multiple = NULL;
+	char* graph = NULL;
+	char* cached = NULL;
+	char* address = NULL;
+	char* jacobian = NULL;
+	int batch = 0, full = 0, chosen = 0, threads = processors(), opt, i;
+
+	// Holds the report of the coil, with every value in the default prefix if one is given.
+	Text t;
+	textInit( &t );
+
+	// Holds the parameters of the coil being designed.
+	Coil c;
+	memset( &c, 0, sizeof c );
+
+	// Holds results of earlier runs, shared with every other process using the same file.
+	Cache k, *cache = NULL;
+
 	// Holds information about program.
-	char name[strlen(NAME)+strlen(VERSION)+2];
+	char name[strlen(NAME)+strlen(VERSION)+3];
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "bf:m:rp:d:j:c:S:t:P:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'b': batch = 1; break;
+			case 'f': settings = optarg; break;
+			case 'm': multiple = optarg; break;
+			case 'r': full = 1; break;
+			case 'p': t.prefix = *optarg; break;
+			case 'd': graph = optarg; break;
+			case 'j': jacobian = optarg; break;
+			case 'c': cached = optarg; break;
+			case 'S': address = optarg; break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'P':
+				if ( precisionModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid precision.\n", optarg);
+					return 1;
+
+				}
+				chosen = 1;
+				break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-b] [-f parameters.dat] [-m designs.dat [-r]] [-P float|double] [-p prefix] [-c cache] [-S socket [-t threads]] [-d NAME[,NAME...]] [-j all|NAME[,NAME...]]\n", argv[0]);
+				return 1;
+
+		}
+
+	if ( graph ) return depends( graph );
+	if ( jacobian )
+	{
+
+		if ( parseSettings( &c, settings, NULL ) ) return 1;
+		return sensitivities( &c, jacobian );
+
+	}
+
+	// Reports are calculated in double precision and bulk runs in float unless -P says otherwise.
+	if ( !chosen ) precision = batch || address || ( multiple && !full ) ? SINGLE : DOUBLE;
+
+	// Map the cache before anything is calculated, keeping the models apart.
+	if ( cached && cacheOpen( &k, cached, CACHE_ENTRIES, NAME " " VERSION, inductance + 2 * precision ) == 0 ) cache = &k;
+
+	// Stream designs from stdin to stdout without prompts or banners,
+	// taking missing parameters from the settings file.
+	if ( batch || multiple || address )
+	{
+
+		parseSettings( &c, settings, NULL );
+		opt = address ? serve( &c, address, cache, threads )
+			: batch ? stream( &c, stdin, stdout, cache ) != 0
+			: designs( &c, multiple, stdout, full ? &t : NULL, cache ) < 0;
+		if ( cache )
+		{
+
+			fprintf(stderr, "  Cache: %ld found, %ld found in part, %ld calculated\n",
+				cache->hits, cache->partial, cache->misses);
+			cacheClose( cache );
+
+		}
+		return opt;
+
+	}
 
 	// Holds information about terminal size.
 	struct winsize w;
 	ioctl(0, TIOCGWINSZ, &w);
 
-	// Define values for the constants and ratios declared above.
-	PI  = 3.1415926535897932384626433832795;
-	PHI = 0.5 * ( 1.0 + sqrt(5.0) );
-	C0  = 299792458;
-	U0  = 4.0e-7 * PI;
-	E0  = 1.0 / ( U0*C0*C0 );
-
 	center("\n","",w.ws_col,'=',"\n\n");
 	sprintf(name,"%s v%s",NAME,VERSION);
 	center("",name,w.ws_col,' ',"\n");
@@ -143,325 +161,230 @@ int main()
 
 	// Read in parameters from external file.
 	center("\n","Parse Parameters",w.ws_col,'=',"\n\n");
-	parseSettings("parameters.dat");
+	parseSettings( &c, settings, stdout );
 
 	// Prompt user to input parameters of coil.
 	if ( devel == 0 )
 	{
 
 		center("\n","Edit Parameters",w.ws_col,'=',"\n\n");
-		input( "Transformer Input Voltage       ", &NSTVI, "V"   );
-		input( "Transformer Input Frequency     ", &NSTF,  "Hz"  );
-		input( "Transformer Output Voltage      ", &NSTVO, "V"   );
-		input( "Transformer Output Current      ", &NSTIO, "A"   );
-		input( "Transformer Primary Resistance  ", &NSTRP, "ohm" );
-		input( "Transformer Secondary Resistance", &NSTRS, "ohm" );
-		input( "Primary Coil Wire Gauge         ", &PRIWG, "AWG" );
-		input( "Primary Coil Wire Turns         ", &PRIN,  ""    );
-		input( "Primary Coil Inner Radius       ", &PRIRI, "m"   );
-		input( "Primary Coil Separation         ", &PRIS , "m"   );
-		input( "Secondary Coil Wire Gauge       ", &SECWG, "AWG" );
-		input( "Secondary Coil Form Diameter    ", &SECD,  "m"   );
-		input( "Secondary Coil Form Height      ", &SECH,  "m"   );
-		input( "Topload Sphere Diameter         ", &TOPD,  "m"   );
+		for ( i = 0; i < INPUTS; i++ ) input( &c, inputName( i ) );
 
 	}
 
-	// Calculate primary wire diameter from AWG value.
-	PRIWD = WD( PRIWG );
-	// Calculate secondary wire diameter from AWG value accounting for single insulation.
-	// Single insulation: 0.0014in 3.55600e-5m
-	// Double insulation: 0.0026in 6.60400e-5m
-	SECWD = WD( SECWG ) + 3.55600e-5;
-
-	// Calculate outer diameter of PRI.
-	PRIRO = PRIRI + PRIN * PRIS;               // Primary Outer Radius
-
-	SECN  = SECH / SECWD;                      // Secondary Wrap Number
-	SECLN = SECN*PI*(SECD+SECWD);              // Secondary Wire Length
-
-	// Calculate inductance of secondary using Wheeler's empirical formula.
-	// Accurate to within 1% for SECL > 0.4*SECD. 
-	SECL  = SECN*SECN*(SECD+SECWD)*(SECD+SECWD) / ( 2.54e4 * (18.0*(SECD+SECWD)+40.0*SECH) );
-
-	// Calculate inductance of secondary using theoretical solenoid equation.
-	// Implement Nagaoka coefficient to increase accuracy.
-	//SECL  = 0.25*PI*U0*SECN*SECN*(SECD+SECWD)*(SECD+SECWD)/SECH;
-
-	// Calculate transformer power performance statistics.
-	NSTTR = NSTVO / NSTVI;
-	NSTVA = NSTVO * NSTIO;
-	NSTII = NSTVA / NSTVI;
-	NSTPF = NSTVA / ( 2.0*PI*NSTF*NSTVI*NSTVI );
-
-	// Calculate peak voltages and currents from RMS values.
-	NSTVIP = NSTVI * sqrt(2.0);
-	NSTIIP = NSTII * sqrt(2.0);
-	NSTVOP = NSTVO * sqrt(2.0);
-	NSTIOP = NSTIO * sqrt(2.0);
-
-	NSTZ  = NSTVO / NSTIO;                                 // Impedance
-	NSTR  = NSTRS + NSTRP * NSTTR * NSTTR;                 // Reactance
-	/* SIGN? */ NSTZ  = sqrt( NSTZ * NSTZ - NSTR * NSTR ); // Total Impedance
-	PTCC  = 1.0 / ( 2.0*PI*NSTF*NSTZ );                    // Resonant Capacitance
-	LTRCS = PTCC * PHI;                                    // LTR Static Capacitance
-	LTRCR = PTCC * PHI * PHI;                              // LTR Rotary Capacitance
-
-	// Calculate resonant frequency of the system.
-	SECC = medhurst(0.5*SECD, SECH);                       // Secondary Self-Capacitance
-	TOPC  = 2.0 * PI * E0 * TOPD;                          // Topload Capacitance
-	// Estimate the secondary resonant frequency.
-	/* VERIFY */ SECF  = 0.25 * C0 / SECLN;
-	// Calculate the resonant frequency of the secondary circuit.
-	SECF  = 1.0 / ( 2.0 * PI * sqrt( SECL * ( SECC + TOPC ) ) );
-	PRIF  = SECF;
-
-	// Calculate primary inductance such that capacitive and inductive reactances cancel.
-	// Assume use of LTR static capacitor bank.
-	PTCCR = 1.0 / ( 2.0*PI*PRIF*LTRCS );                   // Capacitive Reactance
-	PRILR = PTCCR;                                         // Inductive Reactance
-	PRIL  = PRILR / ( 2.0*PI*PRIF );                       // Primary Inductance
-	//PRIF  = 1.0 / ( 2.0*PI*sqrt(PRIL*LTRCS) );           // Primary Resonant Frequency
-	//PRILN = 0.5*PI*PRIN*(PRIDI+PRIDO);                   // Primary Coil Length via DI and DO
-	PRILN = PI * PRIN * PRIS * ( PRIN + 2.0*PI );          // Primary Coil Length via RI and dR
-
-	SECHD = SECH / ( SECD + SECWD );                       // Aspect Ratio
-
-	/* VERIFY */ ARCLN = 0.04318*sqrt( NSTVA );            // Maximum Theroetical Arclength
+	// Calculate every stage of the coil from its input parameters.
+	if ( cache ) cacheCoils( cache, &c, 1 );
+	else calculate( &c );
 
 	// Write parameters to external file.
 	center("\n","Write Parameters",w.ws_col,'=',"\n\n");
-	writeSettings("parameters.out");
-
-	center("\n","Neon Sign Transformer",w.ws_col,'=',"\n\n");
-	printf("  Input (RMS):      %6.2f%cV %6.2f%cA %6.2f%cHz\n",
-		NSTVI*  SIfactor(NSTVI),  SIprefix(NSTVI),
-		NSTII*  SIfactor(NSTII),  SIprefix(NSTII),
-		NSTF*   SIfactor(NSTF),   SIprefix(NSTF));
-	printf("  Input (Peak):     %6.2f%cV %6.2f%cA %6.2f%cHz\n",
-		NSTVIP* SIfactor(NSTVIP), SIprefix(NSTVIP),
-		NSTIIP* SIfactor(NSTIIP), SIprefix(NSTIIP),
-		NSTF*   SIfactor(NSTF),   SIprefix(NSTF));
-	printf("  Output (RMS):     %6.2f%cV %6.2f%cA %6.2f%cHz\n",
-		NSTVO*  SIfactor(NSTVO),  SIprefix(NSTVO),
-		NSTIO*  SIfactor(NSTIO),  SIprefix(NSTIO),
-		NSTF*   SIfactor(NSTF),   SIprefix(NSTF));
-	printf("  Output (Peak):    %6.2f%cV %6.2f%cA %6.2f%cHz\n",
-		NSTVOP* SIfactor(NSTVOP), SIprefix(NSTVOP),
-		NSTIOP* SIfactor(NSTIOP), SIprefix(NSTIOP),
-		NSTF*   SIfactor(NSTF),   SIprefix(NSTF));
-	output("Step-up Ratio:   ", &NSTTR, ""   );
-	output("Power:           ", &NSTVA, "VA" );
-	output("PFC Capacitance: ", &NSTPF, "F"  );
-	output("Impedance:       ", &NSTZ,  "ohm");
-
-	center("\n","Primary Tank Capacitor",w.ws_col,'=',"\n\n");
-	output("Cap Reactance:   ", &PTCCR, "ohm");
-	output("Res Capacitance: ", &PTCC,  "F"  );
-	output("LTR Static Cap:  ", &LTRCS, "F"  );
-	output("LTR Rotary Cap:  ", &LTRCR, "F"  );
-
-	center("\n","Primary Coil",w.ws_col,'=',"\n\n");
-	output("L Reactance:     ", &PRILR, "ohm");
-	output("Wire Gauge:      ", &PRIWG, "AWG");
-	output("Wire Diameter:   ", &PRIWD, "m"  );
-	output("Wire Turns:      ", &PRIN,  ""   );
-	output("Wire Length:     ", &PRILN, "m"  );
-	output("Inner Radius:    ", &PRIRI, "m"  );
-	output("Winding Sep:     ", &PRIS,  "m"  );
-	output("Outer Radius:    ", &PRIRO, "m"  );
-	output("Inductance:      ", &PRIL,  "H"  );
-	output("Res Frequency:   ", &PRIF,  "Hz" );
-
-	center("\n","Secondary Coil",w.ws_col,'=',"\n\n");
-	output("Form Diameter:   ", &SECD,  "m"  );
-	output("Form Height:     ", &SECH,  "m"  );
-	output("Aspect Ratio:    ", &SECHD, ""   );
-	output("Wire Gauge:      ", &SECWG, "AWG");
-	output("Wire Diameter:   ", &SECWD, "m"  );
-	output("Wire Length:     ", &SECLN, "m"  );
-	output("Wire Turns:      ", &SECN,  ""   );
-	output("Inductance:      ", &SECL,  "H"  );
-	output("Capacitance:     ", &SECC,  "F"  );
-	output("Res Frequency:   ", &SECF,  "Hz" );
-
-	center("\n","Spherical Top Load",w.ws_col,'=',"\n\n");
-	output("Diameter:        ", &TOPD,  "m"  );
-	output("Capacitance:     ", &TOPC,  "F"  );
-
-	center("\n","Miscellaneous",w.ws_col,'=',"\n\n");
-	output("Arc Length (max):", &ARCLN, "m"  );
+	writeSettings( &c, "parameters.out" );
 
-	center("\n","",w.ws_col,'=',"\n\n");
+	// Build the report in memory and write it out in one go.
+	report( &t, &c, w.ws_col );
+	textFlush( &t, stdout );
+	textFree( &t );
 
 	return 0;
 
 }
 
-float WD( float WG ) { return 0.000127 * pow( 92.0, ( 36.0 - WG ) / 39.0 ); }
-float WG( float WD ) { return -39.0 * log10( WD / 0.000127 ) / log10( 92.0 ) + 36.0; }
+// Holds the daemon being run, for the signal handler to stop.
+static Daemon server;
+
+static void interrupt( int signal ) { daemonStop( &server ); }
 
-float medhurst( float R, float L )
+int serve( Coil* base, char* path, Cache* cache, int threads )
 {
 
-	return ( 1/0.0254 * (0.29*L + R * ( 0.41 + 1.94*sqrt(R / L) ) ) ) / 1000000000000.0;
+	struct sigaction a;
+	Latency l;
+
+	if ( daemonOpen( &server, path, base, cache, threads ) ) return 1;
+
+	memset( &a, 0, sizeof a );
+	a.sa_handler = interrupt;
+	sigaction( SIGINT, &a, NULL );
+	sigaction( SIGTERM, &a, NULL );
+
+	fprintf(stderr, "  Listening on %s with %d threads and %s kernel\n", path, server.threads, batchKernel());
+	daemonRun( &server );
+
+	daemonLatency( &server, &l );
+	fprintf(stderr, "  Daemon: %lu frames, %lu designs, %lu connections rejected\n",
+		(unsigned long)l.frames, (unsigned long)l.queries, (unsigned long)l.rejected);
+	fprintf(stderr, "  Latency: frame p50 %.1fus p99 %.1fus max %.1fus, design p50 %.3fus p99 %.3fus\n",
+		1.0e-3 * l.p50, 1.0e-3 * l.p99, 1.0e-3 * l.max, 1.0e-3 * l.q50, 1.0e-3 * l.q99);
+	return 0;
 
 }
 
-void input( char* description, float* value, char* unit )
+void input( Coil* c, char* param )
 {
 
+	Parameter* p = &registry[lookup( param, strlen( param ) )];
+	float* value = (float*)( (char*)c + p->offset );
+	char* unit = p->unit;
 	char dum;
-	char defaultString[10];
-	char enteredString[10];
-
-	sprintf(defaultString,"%6.2f%c%-3s",*value*SIfactor(*value),SIprefix(*value),unit);
-	printf("  %s [%s]: ", description, defaultString);
-	fgets(enteredString, sizeof enteredString, stdin);
-	if (strlen(enteredString) != 0) sprintf(defaultString,"%s%c%s",enteredString,SIprefix(*value),unit);
+	// Room for a line typed in with the prefix and longest unit after it.
+	char enteredString[64];
+	char defaultString[sizeof enteredString + 8];
+
+	snprintf(defaultString,sizeof defaultString,"%6.2f%c%-3s",*value*SIfactor(*value),SIprefix(*value),unit);
+	printf("  %-32s [%s]: ", p->prompt, defaultString);
+	if (!fgets(enteredString, sizeof enteredString, stdin)) enteredString[0] = '\0';
+	if (strlen(enteredString) != 0) snprintf(defaultString,sizeof defaultString,"%s%c%s",enteredString,SIprefix(*value),unit);
 	sscanf(defaultString,"%f%c%c\n",*&value,&dum,&dum);
 
 }
 
-void output( char* description, float* value, char* unit )
+// Holds the designs of a multi-design file waiting to be calculated together.
+typedef struct
 {
 
-	printf("  %s %6.2f%c%s\n", description, *value*SIfactor(*value), SIprefix(*value), unit);
+	int n;
+	Coil design[STREAM_BLOCK];
+	char text[STREAM_BLOCK*PARAMETERS*16];
+	FILE* out;
+	Text* reports;
+	Cache* cache;
 
-}
+} Pending;
 
-int parseSettings( char* file )
+// Calculate and write out every pending design.
+static void flush( Pending* p )
 {
 
-	char param[6] = {0};
-	float value = 0.0;
-	FILE* settings = fopen( file, "r" );
+	char* t = p->text;
+	int i;
 
-	if ( !settings )
+	if ( p->cache ) cacheCoils( p->cache, p->design, p->n );
+	else batchCoils( p->design, p->n );
+	if ( p->reports )
 	{
 
-		fprintf(stderr, "Cannot open %s for parsing!\n", file);
-		return 1;
+		for ( i = 0; i < p->n; i++ ) report( p->reports, &p->design[i], 80 );
+		textFlush( p->reports, p->out );
 
 	}
 	else
 	{
 
-		while ( fscanf(settings, "%s %f", param, &value) != EOF )
-			parseParameter( param, value );
-		fclose( settings );
-		return 0;
+		for ( i = 0; i < p->n; i++ ) t += formatRecord( t, &p->design[i] );
+		fwrite( p->text, 1, t - p->text, p->out );
 
 	}
+	p->n = 0;
 
 }
 
-int parseParameter( char* param, float value )
+static void pend( Coil* c, void* arg )
 {
 
-	     if ( strcmp( param, "NSTVI" ) == 0 ) NSTVI = value;
-	else if ( strcmp( param, "NSTF"  ) == 0 ) NSTF  = value;
-	else if ( strcmp( param, "NSTVO" ) == 0 ) NSTVO = value;
-	else if ( strcmp( param, "NSTIO" ) == 0 ) NSTIO = value;
-	else if ( strcmp( param, "NSTRP" ) == 0 ) NSTRP = value;
-	else if ( strcmp( param, "NSTRS" ) == 0 ) NSTRS = value;
-	else if ( strcmp( param, "PRIWG" ) == 0 ) PRIWG = value;
-	else if ( strcmp( param, "PRIN"  ) == 0 ) PRIN  = value;
-	else if ( strcmp( param, "PRIRI" ) == 0 ) PRIRI = value;
-	else if ( strcmp( param, "PRIS"  ) == 0 ) PRIS  = value;
-	else if ( strcmp( param, "SECWG" ) == 0 ) SECWG = value;
-	else if ( strcmp( param, "SECD"  ) == 0 ) SECD  = value;
-	else if ( strcmp( param, "SECH"  ) == 0 ) SECH  = value;
-	else if ( strcmp( param, "TOPD"  ) == 0 ) TOPD  = value;
-	else
+	Pending* p = arg;
+	p->design[p->n++] = *c;
+	if ( p->n == STREAM_BLOCK ) flush( p );
+
+}
+
+long designs( Coil* base, char* file, FILE* out, Text* reports, Cache* cache )
+{
+
+	Pending* p = malloc( sizeof *p );
+	long n;
+
+	p->n = 0;
+	p->out = out;
+	p->reports = reports;
+	p->cache = cache;
+	if ( !reports ) writeHeader( out );
+	n = parseDesigns( file, base, pend, p );
+	if ( p->n ) flush( p );
+	fflush( out );
+	free( p );
+
+	return n;
+
+}
+
+int depends( char* names )
+{
+
+	uint64_t mask, below, above;
+	int i;
+
+	if ( !( mask = parameterMask( names ) ) )
 	{
 
-		fprintf(stderr, "  %s not valid parameter.\n", param);
+		fprintf(stderr, "  %s not valid parameter list.\n", names);
 		return 1;
 
 	}
+	below = dependencies( mask ) & ~mask;
+	above = dependents( mask ) & ~mask;
+
+	printf("  Calculated from:");
+	for ( i = 0; i < PARAMETERS; i++ ) if ( below >> i & 1 ) printf(" %s", registry[i].name);
+	printf("\n  Feeds into:     ");
+	for ( i = 0; i < PARAMETERS; i++ ) if ( above >> i & 1 ) printf(" %s", registry[i].name);
+	printf("\n");
 
-    printf("  %s  	%e\n", param, value);
 	return 0;
 
 }
 
-int writeSettings( char* file )
+int sensitivities( Coil* c, char* names )
 {
 
-	FILE* settings = fopen( file, "w" );
+	double d[INPUTS][PARAMETERS];
+	uint64_t mask = 0;
+	char list[strlen( names ) + 1];
+	int all[INPUTS], column[PARAMETERS], n = 0, i, j, k;
 
-	if ( !settings )
+	strcpy( list, names );
+	if ( strcmp( names, "all" ) != 0 && !( mask = parameterMask( list ) ) )
 	{
 
-		fprintf(stderr, "Cannot open %s for writing!\n", file);
+		fprintf(stderr, "  %s not valid parameter list.\n", names);
 		return 1;
 
 	}
-	else
+	for ( i = 0; i < PARAMETERS; i++ )
+		if ( registry[i].role == OUTPUT && ( !mask || mask >> i & 1 ) ) column[n++] = i;
+	if ( n == 0 )
 	{
 
-		writeParameter( settings, "NSTVI",  NSTVI );
-		writeParameter( settings, "NSTF",   NSTF  );
-		writeParameter( settings, "NSTVO",  NSTVO );
-		writeParameter( settings, "NSTIO",  NSTIO );
-		writeParameter( settings, "NSTRP",  NSTRP );
-		writeParameter( settings, "NSTRS",  NSTRS );
-		writeParameter( settings, "NSTVIP", NSTVIP);
-		writeParameter( settings, "NSTII",  NSTII );
-		writeParameter( settings, "NSTIIP", NSTIIP);
-		writeParameter( settings, "NSTVOP", NSTVOP);
-		writeParameter( settings, "NSTIOP", NSTIOP);
-		writeParameter( settings, "NSTVA",  NSTVA );
-		writeParameter( settings, "NSTTR",  NSTTR );
-		writeParameter( settings, "NSTZ",   NSTZ  );
-		writeParameter( settings, "NSTR",   NSTR  );
-		writeParameter( settings, "NSTPF",  NSTPF );
-
-		writeParameter( settings, "PTCCR",  PTCCR );
-		writeParameter( settings, "PTCC",   PTCC  );
-		writeParameter( settings, "LTRCS",  LTRCS );
-		writeParameter( settings, "LTRCR",  LTRCR );
-
-		writeParameter( settings, "PRIWG",  PRIWG );
-		writeParameter( settings, "PRIN",   PRIN  );
-		writeParameter( settings, "PRIRI",  PRIRI );
-		writeParameter( settings, "PRIS",   PRIS  );
-		writeParameter( settings, "PRILR",  PRILR );
-		writeParameter( settings, "PRIWD",  PRIWD );
-		writeParameter( settings, "PRIRO",  PRIRO );
-		writeParameter( settings, "PRIF",   PRIF  );
-		writeParameter( settings, "PRILN",  PRILN );
-		writeParameter( settings, "PRIL",   PRIL  );
-
-		writeParameter( settings, "SECWG",  SECWG );
-		writeParameter( settings, "SECD",   SECD  );
-		writeParameter( settings, "SECH",   SECH  );
-		writeParameter( settings, "SECWD",  SECWD );
-		writeParameter( settings, "SECF",   SECF  );
-		writeParameter( settings, "SECLN",  SECLN );
-		writeParameter( settings, "SECL",   SECL  );
-		writeParameter( settings, "SECC",   SECC  );
-		writeParameter( settings, "SECN",   SECN  );
-		writeParameter( settings, "SECHD",  SECHD );
-
-		writeParameter( settings, "TOPD",   TOPD  );
-		writeParameter( settings, "TOPC",   TOPC  );
-
-		writeParameter( settings, "ARCLN",  ARCLN );
-
-		fclose( settings );
-
-		return 0;
+		fprintf(stderr, "  %s names no output parameter.\n", names);
+		return 1;
 
 	}
 
-}
+	calculate( c );
+	for ( j = 0; j < INPUTS; j++ ) all[j] = j;
+	sensitivity( c, INPUTS, all, d );
 
-void writeParameter( FILE* file, char* param, float value )
-{
+	// Six outputs to a block keep every line within a terminal.
+	printf("  Change in each output per unit of each input:\n");
+	for ( k = 0; k < n; k += 6 )
+	{
+
+		printf("\n  %-6s %12s", "INPUT", "VALUE");
+		for ( i = k; i < n && i < k + 6; i++ ) printf(" %12s", registry[column[i]].name);
+		printf("\n  %-6s %12s", "", "");
+		for ( i = k; i < n && i < k + 6; i++ ) printf(" %12s", registry[column[i]].unit);
+		printf("\n");
+		for ( j = 0; j < INPUTS; j++ )
+		{
+
+			Parameter* p = &registry[inputColumn[j]];
+			printf("  %-6s %9.3e%-3s", p->name, *(float*)( (char*)c + p->offset ), p->unit);
+			for ( i = k; i < n && i < k + 6; i++ ) printf(" %12.4g", d[j][column[i]]);
+			printf("\n");
+
+		}
 
-		fprintf( file, "%s	%e\n", param, value );
-		printf( "  %s  	%e\n", param, value );
+	}
+
+	return 0;
 
 }
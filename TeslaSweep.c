@@ -0,0 +1,339 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaSweep"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Summary.c"
+#include "Results.c"
+#include "Sensitivity.c"
+#include "Shard.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Number of output parameters summarized over the whole sweep.
+#define SUMMARY 5
+_Static_assert( SUMMARY <= SUMMARY_LIMIT, "Every summarized result must fit in a Summary" );
+
+// Holds what every worker thread needs to visit a block of designs.
+//  - out:     Text file receiving every calculated design, or NULL.
+//  - binary:  Binary result file receiving every calculated design, or NULL.
+//  - summary: Per thread ranges of the summarized output parameters.
+//  - outputs: Number of output parameters differentiated in out, by position within registry.
+//  - inputs:  Number of swept inputs they are differentiated with respect to, by position within inputName().
+typedef struct
+{
+
+	FILE* out;
+	ResultWriter* binary;
+	Summary* summary;
+	int outputs, inputs;
+	int output[PARAMETERS], input[SWEEP_AXES];
+
+} Report;
+
+// Names, units and storage of the summarized output parameters.
+static char* summaryName[SUMMARY] = { "SECF", "SECL", "SECLN", "PRIL", "LTRCS" };
+static char* summaryUnit[SUMMARY] = { "Hz",   "H",    "m",     "H",    "F"     };
+static float* summaryField( Coil* c, int i )
+{
+
+	float* field[SUMMARY] = { &c->SECF, &c->SECL, &c->SECLN, &c->PRIL, &c->LTRCS };
+	return field[i];
+
+}
+
+// Accumulate the summary of a block of designs and write them out if requested.
+void visit( Coil* designs, long first, int count, int thread, void* arg );
+
+// Write a calculated design followed by the derivatives of the outputs requested.
+void writeDerivatives( Report* r, Coil* c );
+
+// Run the given shard of the sweep held in dir, or every shard no other worker
+// holds if it is negative, adding the number of designs calculated to designs.
+int runShards( Sweep* s, char* dir, int shards, int shard, double every, int threads, Report* r, long* designs );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char* results = NULL;
+	char* binary = NULL;
+	char* derivatives = NULL;
+	char *dir = NULL, *merged = NULL;
+	ResultWriter writer;
+	int threads = processors(), shards = 0, shard = -1;
+	int opt, i, j, t;
+	struct timespec start, stop;
+	double elapsed, every = 10.0;
+	long designs;
+	uint64_t mask;
+	Coil base;
+	Sweep s;
+	Report r;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "b:c:d:f:j:m:n:o:s:t:P:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'b': binary = optarg; break;
+			case 'c': every = atof( optarg ) > 0.0 ? atof( optarg ) : every; break;
+			case 'd': dir = optarg; break;
+			case 'f': settings = optarg; break;
+			case 'j': derivatives = optarg; break;
+			case 'm': merged = optarg; break;
+			case 'n': shards = atoi( optarg ) > 0 ? atoi( optarg ) : shards; break;
+			case 'o': results = optarg; break;
+			case 's': shard = atoi( optarg ); break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'P':
+				if ( precisionModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid precision.\n", optarg);
+					return 1;
+
+				}
+				break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-o results.tsv [-j all|NAME[,NAME...]]] [-b results.bin] [-P float|double] [-t threads] [-d shared dir [-n shards] [-s shard] [-c checkpoint seconds]] NAME=lo:hi[:step] ...\n"
+					"       %s -d shared dir -m merged.bin\n", argv[0], argv[0]);
+				return 1;
+
+		}
+
+	printf("%s v%s\n\n", NAME, VERSION);
+
+	// Merging the shards of a sweep needs nothing but the directory holding them.
+	if ( merged )
+	{
+
+		Shards h;
+
+		if ( !dir )
+		{
+
+			fprintf(stderr, "  -m merges the shards of the sweep in the directory given with -d.\n");
+			return 1;
+
+		}
+		if ( shardOpen( &h, dir ) || shardMerge( &h, merged ) ) return 1;
+		printf("  Merged: %ld designs from %d shards of %s into %s\n", h.plan.sweep.total, h.plan.shards, dir, merged);
+		return 0;
+
+	}
+	if ( dir && ( results || binary ) )
+	{
+
+		fprintf(stderr, "  -d writes the results of each shard to the directory, merge them with -m.\n");
+		return 1;
+
+	}
+
+	// Read in the parameters that are held fixed across the sweep.
+	memset( &base, 0, sizeof base );
+	if ( parseSettings( &base, settings, stdout ) ) return 1;
+
+	sweepInit( &s, &base );
+	for ( i = optind; i < argc; i++ )
+		if ( sweepAxis( &s, argv[i] ) ) return 1;
+
+	printf("\n");
+	for ( i = 0; i < s.axes; i++ )
+		printf("  %-6s %e .. %e (%ld values)\n", s.axis[i].name, s.axis[i].lo,
+			s.axis[i].lo + s.axis[i].step * ( s.axis[i].count - 1 ), s.axis[i].count);
+	printf("  Designs: %ld on %d threads with %s kernel\n", s.total, threads, precision == DOUBLE ? "double" : batchKernel());
+
+	// Outputs named by -j are written with their derivative along every axis.
+	r.outputs = r.inputs = 0;
+	if ( derivatives )
+	{
+
+		mask = strcmp( derivatives, "all" ) == 0 ? ~0ULL : parameterMask( derivatives );
+		if ( !results || !mask )
+		{
+
+			fprintf(stderr, "  -j takes a list of output parameters and needs -o.\n");
+			return 1;
+
+		}
+		for ( i = 0; i < PARAMETERS; i++ )
+			if ( registry[i].role == OUTPUT && mask >> i & 1 ) r.output[r.outputs++] = i;
+		for ( i = 0; i < s.axes; i++ )
+			for ( j = 0; j < INPUTS; j++ )
+				if ( registry[inputColumn[j]].offset == s.axis[i].offset ) r.input[r.inputs++] = j;
+
+	}
+
+	r.out = NULL;
+	if ( results && !( r.out = fopen( results, "w" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", results);
+		return 1;
+
+	}
+	if ( r.out && r.outputs == 0 ) writeHeader( r.out );
+	else if ( r.out )
+	{
+
+		for ( i = 0; i < PARAMETERS; i++ ) fprintf(r.out, i ? "\t%s" : "%s", registry[i].name);
+		for ( i = 0; i < r.outputs; i++ )
+			for ( j = 0; j < r.inputs; j++ )
+				fprintf(r.out, "\td%s/d%s", registry[r.output[i]].name, inputName( r.input[j] ));
+		fprintf(r.out, "\n");
+
+	}
+	r.binary = NULL;
+	if ( binary )
+	{
+
+		if ( resultOpen( &writer, binary ) ) return 1;
+		r.binary = &writer;
+
+	}
+
+	r.summary = malloc( threads * sizeof *r.summary );
+	for ( t = 0; t < threads; t++ ) summaryInit( &r.summary[t] );
+
+	// Results are only written in order when they are written at all.
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	designs = dir ? 0 : s.total;
+	if ( dir ? runShards( &s, dir, shards, shard, every, threads, &r, &designs ) : sweepRun( &s, threads, r.out || r.binary, visit, &r ) )
+		return 1;
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+
+	if ( r.out ) fclose( r.out );
+	if ( r.binary && resultClose( r.binary ) )
+	{
+
+		fprintf(stderr, "Cannot write %s!\n", binary);
+		return 1;
+
+	}
+
+	// Combine the summaries of every thread.
+	summaryMerge( r.summary, threads, SUMMARY );
+
+	printf("  Elapsed: %.3fs (%.3e designs/s)\n\n", elapsed, designs / elapsed);
+	if ( designs > 0 ) summaryPrint( r.summary, SUMMARY, summaryName, summaryUnit );
+
+	free( r.summary );
+	return 0;
+
+}
+
+void visit( Coil* designs, long first, int count, int thread, void* arg )
+{
+
+	Report* r = arg;
+	Summary* s = &r->summary[thread];
+	int i, j;
+
+	for ( j = 0; j < count; j++ )
+	{
+
+		for ( i = 0; i < SUMMARY; i++ ) summaryAdd( s, i, *summaryField( &designs[j], i ), first + j );
+		if ( r->out && r->outputs ) writeDerivatives( r, &designs[j] );
+		else if ( r->out ) writeRecord( r->out, &designs[j] );
+
+	}
+	if ( r->binary ) resultWrite( r->binary, designs, count );
+
+}
+
+void writeDerivatives( Report* r, Coil* c )
+{
+
+	double d[SWEEP_AXES][PARAMETERS];
+	char buffer[16*PARAMETERS + 16*PARAMETERS*SWEEP_AXES];
+	char* p = buffer + formatRecord( buffer, c ) - 1;
+	int i, j;
+
+	sensitivity( c, r->inputs, r->input, d );
+	for ( i = 0; i < r->outputs; i++ )
+		for ( j = 0; j < r->inputs; j++ )
+		{
+
+			*p++ = '\t';
+			p += formatFloat( p, d[j][r->output[i]] );
+
+		}
+	*p++ = '\n';
+	fwrite( buffer, 1, p - buffer, r->out );
+
+}
+
+int runShards( Sweep* s, char* dir, int shards, int shard, double every, int threads, Report* r, long* designs )
+{
+
+	Shards h;
+	long* block;
+	long b;
+	int k, status;
+
+	if ( shardInit( &h, dir, s, shards, every ) ) return 1;
+	if ( shard >= h.plan.shards )
+	{
+
+		fprintf(stderr, "  Shard %d not valid, %s holds %d shards.\n", shard, dir, h.plan.shards);
+		return 1;
+
+	}
+
+	block = malloc( ( ( s->total + SWEEP_BLOCK - 1 ) / SWEEP_BLOCK + 1 ) * sizeof *block );
+	for ( k = shard < 0 ? 0 : shard; k < ( shard < 0 ? h.plan.shards : shard + 1 ); k++ )
+	{
+
+		status = shardRun( &h, k, threads, visit, r );
+		printf("  Shard %d of %d: ", k, h.plan.shards);
+		if ( status == SHARD_DONE ) printf("already complete\n");
+		else if ( status == SHARD_HELD ) printf("held by another worker\n");
+		else if ( status == SHARD_FAILED ) printf("failed\n");
+		else
+		{
+
+			printf("%ld blocks", h.blocks);
+			if ( h.resumed > 0 ) printf(", resumed after %ld", h.resumed);
+			printf(", %ld checkpoints\n", h.commits);
+
+			// Every block is full but the last block of the sweep.
+			shardBlocks( &h, k, block );
+			for ( b = h.resumed; b < h.blocks; b++ )
+				*designs += s->total - block[b] * SWEEP_BLOCK < SWEEP_BLOCK ? s->total - block[b] * SWEEP_BLOCK : SWEEP_BLOCK;
+
+		}
+		if ( status == SHARD_FAILED || ( status == SHARD_HELD && shard >= 0 ) )
+		{
+
+			free( block );
+			return 1;
+
+		}
+
+	}
+
+	free( block );
+	return 0;
+
+}
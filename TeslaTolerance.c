@@ -0,0 +1,201 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaTolerance"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Tolerance.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Fractions of samples reported below each percentile.
+#define PERCENTILES 7
+static double fraction[PERCENTILES] = { 0.001, 0.01, 0.05, 0.5, 0.95, 0.99, 0.999 };
+
+// Print a value of metric m in its own units.
+void metric( int m, double value );
+
+// Print a histogram of metric m between its 0.5 and 99.5 percentiles in rows rows.
+void histogram( Tolerance* t, int m, int rows );
+
+// Write the histogram of every metric as tab separated bins holding any samples.
+int writeHistograms( Tolerance* t, char* file );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char* results = NULL;
+	long samples = 1000000;
+	uint64_t seed = 1;
+	int threads = processors(), rows = 16;
+	int opt, i, m;
+	struct timespec start, stop;
+	double elapsed;
+	Tolerance* t = malloc( sizeof *t );
+	Coil base;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "f:n:s:t:o:r:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'f': settings = optarg; break;
+			case 'n': samples = atof( optarg ) >= 1.0 ? (long)atof( optarg ) : samples; break;
+			case 's': seed = strtoull( optarg, NULL, 0 ); break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'o': results = optarg; break;
+			case 'r': rows = atoi( optarg ) >= 0 ? atoi( optarg ) : rows; break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-n samples] [-s seed] [-t threads] [-r rows] [-o histograms.tsv] NAME=[u]percent ...\n", argv[0]);
+				return 1;
+
+		}
+
+	// Read in the parameters of the design as intended.
+	memset( &base, 0, sizeof base );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &base, settings, stdout ) ) return 1;
+
+	toleranceInit( t, &base, samples, seed );
+	for ( i = optind; i < argc; i++ )
+		if ( toleranceSpread( t, argv[i] ) ) return 1;
+
+	printf("\n");
+	for ( i = 0; i < t->spreads; i++ )
+		printf("  %-6s %-6s %5.2f%%%s\n", t->spread[i].name, t->spread[i].normal ? "sigma" : "within",
+			100.0 * t->spread[i].spread, t->spread[i].output ? " of the part as bought" : "");
+	printf("  Samples: %ld on %d threads from seed %llu\n", samples, threads, (unsigned long long)seed);
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	if ( toleranceRun( t, threads ) ) return 1;
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+	printf("  Elapsed: %.3fs (%.3e samples/s)\n", elapsed, samples / elapsed);
+	printf("  Primary tapped at %.3f of %g turns for the design as built.\n", t->tap, t->nominal.PRIN);
+	if ( t->failed ) printf("  Samples left out with metrics that are not finite: %ld (%.3f%%)\n", t->failed, 100.0 * t->failed / samples);
+	if ( t->failed == samples )
+	{
+
+		fprintf(stderr, "  No sample has finite metrics.\n");
+		return 1;
+
+	}
+	printf("\n");
+
+	printf("  %-6s %10s %10s %10s", "", "Nominal", "Mean", "Std Dev");
+	for ( i = 0; i < PERCENTILES; i++ ) printf(" %9.1f%%", 100.0 * fraction[i]);
+	printf("\n");
+	for ( m = 0; m < METRICS; m++ )
+	{
+
+		printf("  %-6s", metricName[m]);
+		metric( m, t->value[m] );
+		metric( m, metricMean( t, m ) );
+		metric( m, metricDeviation( t, m ) );
+		for ( i = 0; i < PERCENTILES; i++ ) metric( m, percentile( t, m, fraction[i] ) );
+		printf("\n");
+
+	}
+	for ( m = 0; m < METRICS && rows > 0; m++ ) histogram( t, m, rows );
+
+	if ( results && writeHistograms( t, results ) ) return 1;
+
+	free( t->sum );
+	free( t );
+	return 0;
+
+}
+
+void metric( int m, double value )
+{
+
+	if ( m == mDETUNE ) printf(" %+9.3f%%", 100.0 * value);
+	else if ( m == mTAP || m == mLTR ) printf(" %10.4f", value);
+	else printf(" %7.3f%c%-2s", value*SIfactor(value), SIprefix(value), metricUnit[m]);
+
+}
+
+void histogram( Tolerance* t, int m, int rows )
+{
+
+	double lo = percentile( t, m, 0.005 ), hi = percentile( t, m, 0.995 );
+	double width = ( hi - lo ) / rows, nominal = m == mDETUNE ? 0.0 : t->value[m];
+	long count[rows], most = 1;
+	int i, j;
+
+	// Gather the fine bins into rows by the value at their centre.
+	memset( count, 0, sizeof count );
+	for ( j = 1; j <= TOLERANCE_BINS; j++ )
+	{
+
+		double relative = ( j - 0.5 ) / TOLERANCE_BINS - 0.5;
+		double value = m == mDETUNE ? relative : nominal * ( 1.0 + relative );
+		i = width > 0.0 ? (int)floor( ( value - lo ) / width ) : 0;
+		if ( i >= 0 && i < rows ) count[i] += t->metric[m].count[j];
+
+	}
+	for ( i = 0; i < rows; i++ ) if ( count[i] > most ) most = count[i];
+
+	printf("\n  %s\n", metricName[m]);
+	for ( i = 0; i < rows; i++ )
+	{
+
+		printf("  ");
+		metric( m, lo + width * ( i + 0.5 ) );
+		printf(" %6.2f%% |", 100.0 * count[i] / ( t->samples - t->failed ));
+		for ( j = 0; j < 50 * count[i] / most; j++ ) putchar( '#' );
+		printf("\n");
+
+	}
+
+}
+
+int writeHistograms( Tolerance* t, char* file )
+{
+
+	FILE* out = fopen( file, "w" );
+	int m, b;
+
+	if ( !out )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", file);
+		return 1;
+
+	}
+
+	// Each bin is given by the value at its lower edge; the first and last hold every sample beyond.
+	fprintf(out, "metric\tvalue\tcount\n");
+	for ( m = 0; m < METRICS; m++ )
+		for ( b = 0; b < TOLERANCE_BINS + 2; b++ )
+			if ( t->metric[m].count[b] )
+			{
+
+				double relative = b == 0 ? -HUGE_VAL : (double)( b - 1 ) / TOLERANCE_BINS - 0.5;
+				double value = b == 0 ? t->metric[m].min : m == mDETUNE ? relative : t->value[m] * ( 1.0 + relative );
+				fprintf(out, "%s\t%e\t%ld\n", metricName[m], value, t->metric[m].count[b]);
+
+			}
+
+	return fclose( out ) != 0;
+
+}
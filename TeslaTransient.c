@@ -0,0 +1,268 @@
+#define AUTHOR  "Jay Phillips"
+#define NAME    "TeslaTransient"
+#define VERSION "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Shared.c"
+#include "Sweep.c"
+#include "Summary.c"
+#include "Transient.c"
+
+// Return the SI unit autoscale factor and prefix of a given value.
+extern double SIfactor( double value );
+extern char SIprefix( double value );
+
+// Number of results summarized over every design.
+#define SUMMARY 3
+_Static_assert( SUMMARY <= SUMMARY_LIMIT, "Every summarized result must fit in a Summary" );
+
+// Holds what every worker thread needs to simulate a block of designs.
+//  - transient: Settings of the simulation.
+//  - sweep:     Design space, whose axes are written with each result.
+//  - out:       Text file receiving the results of every design, or NULL.
+//  - waves:     Waveform file receiving the samples of every design, or NULL.
+//  - wave:      Per thread room for the samples of TRANSIENT_LANES designs.
+//  - summary:   Per thread ranges of the summarized results.
+//  - single:    Results of the first design, reported in full when it is the only one.
+typedef struct
+{
+
+	Transient* transient;
+	Sweep* sweep;
+	FILE *out, *waves;
+	float** wave;
+	Summary* summary;
+	Bang single;
+
+} Report;
+
+// Names and units of the summarized results.
+static char* summaryName[SUMMARY] = { "NOTCH", "XFER", "PEAK" };
+static char* summaryUnit[SUMMARY] = { "s",     "",     "V"    };
+static float summaryField( Bang* b, int i )
+{
+
+	float field[SUMMARY] = { b->notch, b->transfer, b->peak };
+	return field[i];
+
+}
+
+// Simulate a block of designs, accumulating the summary and writing results if requested.
+void visit( Coil* designs, long first, int count, int thread, void* arg );
+
+int main( int argc, char** argv )
+{
+
+	char* settings = "parameters.dat";
+	char* results = NULL;
+	char* waves = NULL;
+	Transient tr = { 0.15f, 0.5f, -1.0f, 200, 64, 4, 0 };
+	int threads = processors();
+	int opt, i, t;
+	struct timespec start, stop;
+	double elapsed;
+	Coil base, c;
+	Sweep s;
+	Report r;
+
+	// Define values for the global constants and ratios.
+	constants();
+
+	while ( ( opt = getopt( argc, argv, "c:e:f:k:n:o:p:qs:t:w:L:" ) ) != -1 )
+		switch ( opt )
+		{
+
+			case 'c': tr.cycles = atoi( optarg ); break;
+			case 'e': tr.every = atoi( optarg ); break;
+			case 'f': settings = optarg; break;
+			case 'k': tr.k = atof( optarg ); break;
+			case 'n': tr.steps = atoi( optarg ); break;
+			case 'o': results = optarg; break;
+			case 'p': tr.R1 = atof( optarg ); break;
+			case 'q': tr.quench = 1; break;
+			case 's': tr.R2 = atof( optarg ); break;
+			case 't': threads = atoi( optarg ) > 0 ? atoi( optarg ) : 1; break;
+			case 'w': waves = optarg; break;
+			case 'L':
+				if ( inductanceModel( optarg ) )
+				{
+
+					fprintf(stderr, "  %s not valid inductance model.\n", optarg);
+					return 1;
+
+				}
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-L wheeler|nagaoka] [-f parameters.dat] [-k coupling] [-p primary ohms] [-s secondary ohms] [-c cycles] [-n steps per cycle] [-e steps per sample] [-q] [-o results.tsv] [-w waves.bin] [-t threads] [NAME=lo:hi[:step] ...]\n", argv[0]);
+				return 1;
+
+		}
+	if ( transientCheck( &tr ) ) return 1;
+
+	// Read in the parameters that are held fixed across the designs.
+	memset( &base, 0, sizeof base );
+	printf("%s v%s\n\n", NAME, VERSION);
+	if ( parseSettings( &base, settings, stdout ) ) return 1;
+
+	sweepInit( &s, &base );
+	for ( i = optind; i < argc; i++ )
+		if ( sweepAxis( &s, argv[i] ) ) return 1;
+
+	printf("\n");
+	for ( i = 0; i < s.axes; i++ )
+		printf("  %-6s %e .. %e (%ld values)\n", s.axis[i].name, s.axis[i].lo,
+			s.axis[i].lo + s.axis[i].step * ( s.axis[i].count - 1 ), s.axis[i].count);
+	printf("  Coupling: %.3f, primary %.3f ohms, secondary ", tr.k, tr.R1);
+	if ( tr.R2 >= 0.0f ) printf("%.3f ohms", tr.R2);
+	else printf("wire DC resistance");
+	printf("%s\n", tr.quench ? ", gap quenching at the first notch" : "");
+	printf("  Designs: %ld for %d cycles of %d steps on %d threads with %s kernel\n",
+		s.total, tr.cycles, tr.steps, threads, transientKernel());
+
+	r.transient = &tr;
+	r.sweep = &s;
+	r.out = NULL;
+	if ( results && !( r.out = fopen( results, "w" ) ) )
+	{
+
+		fprintf(stderr, "Cannot open %s for writing!\n", results);
+		return 1;
+
+	}
+	if ( r.out )
+	{
+
+		fprintf(r.out, "DESIGN\t");
+		for ( i = 0; i < s.axes; i++ ) fprintf(r.out, "%s\t", s.axis[i].name);
+		fprintf(r.out, "NOTCH\tCYCLES\tXFER\tPEAK\tWHEN\n");
+
+	}
+
+	r.waves = NULL;
+	if ( waves )
+	{
+
+		WaveHeader header;
+
+		if ( !( r.waves = fopen( waves, "wb" ) ) )
+		{
+
+			fprintf(stderr, "Cannot open %s for writing!\n", waves);
+			return 1;
+
+		}
+		memset( &header, 0, sizeof header );
+		memcpy( header.magic, "TSWAVE1", 8 );
+		header.designs  = s.total;
+		header.samples  = transientSamples( &tr );
+		header.channels = CHANNELS;
+		fwrite( &header, sizeof header, 1, r.waves );
+
+	}
+
+	r.wave = malloc( threads * sizeof *r.wave );
+	r.summary = malloc( threads * sizeof *r.summary );
+	for ( t = 0; t < threads; t++ )
+	{
+
+		r.wave[t] = r.waves ? malloc( TRANSIENT_LANES * transientSamples( &tr ) * CHANNELS * sizeof( float ) ) : NULL;
+		summaryInit( &r.summary[t] );
+
+	}
+
+	// Results are only written in order when they are written at all.
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	if ( sweepRun( &s, threads, r.out || r.waves, visit, &r ) ) return 1;
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	elapsed = ( stop.tv_sec - start.tv_sec ) + 1.0e-9 * ( stop.tv_nsec - start.tv_nsec );
+
+	if ( r.out ) fclose( r.out );
+	if ( r.waves && ( ferror( r.waves ) | fclose( r.waves ) ) )
+	{
+
+		fprintf(stderr, "Cannot write %s!\n", waves);
+		return 1;
+
+	}
+
+	// Combine the summaries of every thread.
+	summaryMerge( r.summary, threads, SUMMARY );
+
+	printf("  Elapsed: %.3fs (%.3e design cycles/s)\n\n", elapsed, (double)s.total * tr.cycles / elapsed);
+	if ( s.total == 1 )
+	{
+
+		Bang* b = &r.single;
+		float C2;
+
+		c = base;
+		calculate( &c );
+		C2 = c.SECC + c.TOPC;
+		printf("  Primary:   %6.2f%cH %6.2f%cF at %6.2f%cV\n", c.PRIL*SIfactor(c.PRIL), SIprefix(c.PRIL),
+			c.LTRCS*SIfactor(c.LTRCS), SIprefix(c.LTRCS), c.NSTVOP*SIfactor(c.NSTVOP), SIprefix(c.NSTVOP));
+		printf("  Secondary: %6.2f%cH %6.2f%cF at %6.2f%cHz\n", c.SECL*SIfactor(c.SECL), SIprefix(c.SECL),
+			C2*SIfactor(C2), SIprefix(C2), c.SECF*SIfactor(c.SECF), SIprefix(c.SECF));
+		if ( b->notch > 0.0f )
+			printf("  First notch: %6.2f%cs (%.2f cycles), %.1f%% of the energy in the secondary\n",
+				b->notch*SIfactor(b->notch), SIprefix(b->notch), b->notch * c.SECF, 100.0 * b->transfer);
+		else printf("  First notch: none within %d cycles\n", tr.cycles);
+		printf("  Peak: %6.2f%cV at %6.2f%cs\n", b->peak*SIfactor(b->peak), SIprefix(b->peak),
+			b->when*SIfactor(b->when), SIprefix(b->when));
+
+	}
+	else summaryPrint( r.summary, SUMMARY, summaryName, summaryUnit );
+
+	for ( t = 0; t < threads; t++ ) free( r.wave[t] );
+	free( r.wave );
+	free( r.summary );
+	return 0;
+
+}
+
+void visit( Coil* designs, long first, int count, int thread, void* arg )
+{
+
+	Report* r = arg;
+	Summary* s = &r->summary[thread];
+	long samples = transientSamples( r->transient );
+	Bang bang[TRANSIENT_LANES];
+	int i, j, k, n;
+
+	for ( j = 0; j < count; j += n )
+	{
+
+		n = count - j < TRANSIENT_LANES ? count - j : TRANSIENT_LANES;
+		transient( r->transient, designs + j, n, bang, r->wave[thread] );
+		if ( first + j == 0 ) r->single = bang[0];
+
+		for ( k = 0; k < n; k++ )
+		{
+
+			for ( i = 0; i < SUMMARY; i++ ) summaryAdd( s, i, summaryField( &bang[k], i ), first + j + k );
+			if ( r->out )
+			{
+
+				fprintf(r->out, "%ld\t", first + j + k);
+				for ( i = 0; i < r->sweep->axes; i++ )
+					fprintf(r->out, "%g\t", *(float*)( (char*)&designs[j+k] + r->sweep->axis[i].offset ));
+				fprintf(r->out, "%e\t%.3f\t%.4f\t%e\t%e\n", bang[k].notch, bang[k].notch * designs[j+k].SECF,
+					bang[k].transfer, bang[k].peak, bang[k].when);
+
+			}
+			if ( r->waves )
+			{
+
+				fwrite( &bang[k].interval, sizeof( float ), 1, r->waves );
+				fwrite( r->wave[thread] + k * samples * CHANNELS, sizeof( float ), samples * CHANNELS, r->waves );
+
+			}
+
+		}
+
+	}
+
+}
@@ -0,0 +1,569 @@
+#ifndef TOLERANCE_C
+#define TOLERANCE_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "Coil.c"
+#include "Batch.c"
+
+// Number of samples handed to a worker thread at a time.
+#define TOLERANCE_BLOCK 4096
+
+// Number of histogram bins spanning -50% to +50% of the nominal value of each
+// metric, besides one bin either side for samples beyond them.
+#define TOLERANCE_BINS 20000
+
+// Metrics drawn from every sample of a tolerance analysis.
+//  - SECF:   Resonant frequency of the secondary.
+//  - PRIL:   Primary inductance resonating the capacitor bank at SECF.
+//  - TAP:    Turns of the primary spiral giving PRIL.
+//  - DETUNE: Relative offset of the tank, tapped for the nominal design, from SECF.
+//  - LTR:    Ratio of the capacitor bank to the resonant capacitance of the NST.
+enum { mSECF, mPRIL, mTAP, mDETUNE, mLTR, METRICS };
+
+// Holds the spread of a single parameter about its value.
+//  - name:   Name of the parameter as it appears in parameters.dat.
+//  - offset: Position of the parameter within a Coil in bytes.
+//  - mask:   Mask of the parameter by its position within registry.
+//  - output: Whether the parameter is an output, standing for a part bought to its nominal value.
+//  - normal: Whether the spread is normal with standard deviation spread, else uniform within it.
+//  - spread: Relative size of the spread.
+typedef struct
+{
+
+	char name[8];
+	size_t offset;
+	uint64_t mask;
+	int output, normal;
+	float spread;
+
+} Spread;
+
+// Holds the distribution of one metric over every sample.
+//  - count:    Samples in each bin, from below the first bin to above the last.
+//  - min, max: Smallest and largest value.
+typedef struct
+{
+
+	long count[TOLERANCE_BINS+2];
+	double min, max;
+
+} Histogram;
+
+// Holds a tolerance analysis and its results.
+//  - base:     Values of the input parameters as designed.
+//  - nominal:  Calculated design as built, before any spread.
+//  - spreads:  Number of parameters spread, inputs first, then outputs in the order they are calculated.
+//  - spread:   Spreads of the parameters.
+//  - samples:  Number of samples drawn.
+//  - failed:   Number of samples with a metric that is not finite, left out of every result.
+//  - seed:     Key of the random streams, every sample drawing from a stream of its own.
+//  - tap:      Turns at which the primary is tapped for the nominal design.
+//  - value:    Nominal value of each metric.
+//  - sum:      Sum and sum of squares of each metric within each block, added in order once done.
+//  - metric:   Distribution of each metric.
+typedef struct
+{
+
+	Coil base, nominal;
+	int spreads;
+	Spread spread[PARAMETERS];
+	long samples, failed;
+	uint64_t seed;
+	double tap, value[METRICS];
+	double (*sum)[METRICS][2];
+	Histogram metric[METRICS];
+
+} Tolerance;
+
+// Names and units of the metrics.
+static char* metricName[METRICS] = { "SECF", "PRIL", "TAP",   "DETUNE", "LTR" };
+static char* metricUnit[METRICS] = { "Hz",   "H",    "turns", "",       ""    };
+
+// Prepare an analysis of the design with the given base parameters. The tank
+// capacitor is always taken as bought to its nominal value, so LTRCS is always
+// spread, by nothing unless given a spread of its own.
+void toleranceInit( Tolerance* t, Coil* base, long samples, uint64_t seed );
+
+// Add the spread of a parameter given a specification of the form NAME=percent
+// for a normal spread with that standard deviation, or NAME=upercent for a
+// uniform spread within that bound.
+int toleranceSpread( Tolerance* t, char* spec );
+
+// Draw every sample across the given number of threads and gather the metrics.
+// Results depend only on the seed and not on the number of threads.
+int toleranceRun( Tolerance* t, int threads );
+
+// Return the value of a metric below which the given fraction of the finite
+// samples lie.
+double percentile( Tolerance* t, int m, double fraction );
+
+// Return the mean and standard deviation of a metric over the finite samples.
+double metricMean( Tolerance* t, int m );
+double metricDeviation( Tolerance* t, int m );
+
+// Holds a counter based random stream, Philox4x32-10 keyed by the seed and
+// counting through the words drawn for one sample.
+//  - counter: Sample in the first two words and block of words drawn in the third.
+//  - key:     Seed of the analysis.
+//  - word:    Last block of words drawn, used from the end.
+//  - left:    Number of words of the last block not yet used.
+//  - spare:   Second of the last pair of normal deviates, or NAN.
+typedef struct
+{
+
+	uint32_t counter[4], key[2], word[4];
+	int left;
+	double spare;
+
+} Random;
+
+static void randomInit( Random* r, uint64_t seed, long sample )
+{
+
+	r->counter[0] = (uint32_t)sample;
+	r->counter[1] = (uint32_t)( (uint64_t)sample >> 32 );
+	r->counter[2] = r->counter[3] = 0;
+	r->key[0] = (uint32_t)seed;
+	r->key[1] = (uint32_t)( seed >> 32 );
+	r->left = 0;
+	r->spare = NAN;
+
+}
+
+// Fill the words of r with the next block of the stream.
+static void philox( Random* r )
+{
+
+	uint32_t c0 = r->counter[0], c1 = r->counter[1], c2 = r->counter[2], c3 = r->counter[3];
+	uint32_t k0 = r->key[0], k1 = r->key[1];
+	uint64_t p0, p1;
+	int i;
+
+	for ( i = 0; i < 10; i++ )
+	{
+
+		p0 = (uint64_t)0xD2511F53 * c0;
+		p1 = (uint64_t)0xCD9E8D57 * c2;
+		c0 = (uint32_t)( p1 >> 32 ) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)( p0 >> 32 ) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+
+	}
+
+	r->word[0] = c0;
+	r->word[1] = c1;
+	r->word[2] = c2;
+	r->word[3] = c3;
+	r->left = 4;
+	r->counter[2]++;
+
+}
+
+// Return a uniform deviate strictly between 0 and 1.
+static double uniform( Random* r )
+{
+
+	if ( r->left == 0 ) philox( r );
+	return ( r->word[--r->left] + 0.5 ) * ( 1.0 / 4294967296.0 );
+
+}
+
+// Return a standard normal deviate by the Box-Muller transform.
+static double normal( Random* r )
+{
+
+	double radius, angle, z;
+
+	if ( !isnan( r->spare ) )
+	{
+
+		z = r->spare;
+		r->spare = NAN;
+		return z;
+
+	}
+
+	radius = sqrt( -2.0 * log( uniform( r ) ) );
+	angle = 2.0 * PI * uniform( r );
+	r->spare = radius * sin( angle );
+	return radius * cos( angle );
+
+}
+
+// Return the factor a spread scales its parameter by, drawn again until it is
+// positive, since no part is built to a size of zero or less.
+static double factor( Random* r, Spread* s )
+{
+
+	double f;
+
+	if ( s->spread == 0.0 ) return 1.0;
+	do f = 1.0 + s->spread * ( s->normal ? normal( r ) : 2.0 * uniform( r ) - 1.0 );
+	while ( !( f > 0.0 ) );
+	return f;
+
+}
+
+// Return the turns of a primary spiral with inner radius RI and turns spaced S
+// apart having inductance L, by Newton's method from guess.
+static double turns( double L, double RI, double S, double guess )
+{
+
+	double N = guess > 0.0 ? guess : 1.0, R, W, D, dL, step;
+	int i;
+
+	for ( i = 0; i < 8; i++ )
+	{
+
+		// Wheeler's formula of spiral() and its derivative with respect to N.
+		R = ( RI + 0.5 * N * S ) / 0.0254;
+		W = N * S / 0.0254;
+		D = 8.0 * R + 11.0 * W;
+		dL = 1.0e-6 * ( ( R * S / 0.0254 * N * N + 2.0 * R * R * N ) * D
+			- R * R * N * N * ( 4.0 * S / 0.0254 + 11.0 * S / 0.0254 ) ) / ( D * D );
+		if ( !( dL > 0.0 ) ) break;
+		step = ( 1.0e-6 * R * R * N * N / D - L ) / dL;
+		N = N - step > 0.0 ? N - step : 1.0e-3;
+		if ( fabs( step ) < 1.0e-6 * N ) break;
+
+	}
+
+	return N;
+
+}
+
+// Apply the spreads of the output parameters of calculated design c, scaling
+// their nominal values by the factors drawn, and fill value with its metrics.
+static void measure( Tolerance* t, Coil* c, float* drawn, double* value )
+{
+
+	double tank;
+	int i;
+
+	for ( i = 0; i < t->spreads; i++ )
+	{
+
+		Spread* s = &t->spread[i];
+		if ( !s->output ) continue;
+		*(float*)( (char*)c + s->offset ) = *(float*)( (char*)&t->nominal + s->offset ) * drawn[i];
+		recalculate( c, s->mask );
+
+	}
+
+	tank = 1.0 / ( 2.0 * PI * sqrt( spiral( c->PRIRI, c->PRIS, t->tap ) * c->LTRCS ) );
+	value[mSECF]   = c->SECF;
+	value[mPRIL]   = c->PRIL;
+	value[mTAP]    = turns( c->PRIL, c->PRIRI, c->PRIS, t->tap );
+	value[mDETUNE] = tank / c->SECF - 1.0;
+	value[mLTR]    = c->LTRCS / c->PTCC;
+
+}
+
+// Add a value of metric m to its histogram, binned relative to its nominal value.
+static void bin( Tolerance* t, Histogram* h, int m, double value )
+{
+
+	double relative = m == mDETUNE ? value : value / t->value[m] - 1.0;
+	double position = ( relative + 0.5 ) * TOLERANCE_BINS;
+	long b = !( position >= 0.0 ) ? 0 : position >= TOLERANCE_BINS ? TOLERANCE_BINS + 1 : (long)position + 1;
+
+	h->count[b]++;
+	if ( value < h->min ) h->min = value;
+	if ( value > h->max ) h->max = value;
+
+}
+
+void toleranceInit( Tolerance* t, Coil* base, long samples, uint64_t seed )
+{
+
+	char tank[] = "LTRCS=0";
+	int m;
+
+	memset( t, 0, sizeof *t );
+	t->base = *base;
+	t->samples = samples;
+	t->seed = seed;
+	for ( m = 0; m < METRICS; m++ )
+	{
+
+		t->metric[m].min = HUGE_VAL;
+		t->metric[m].max = -HUGE_VAL;
+
+	}
+	toleranceSpread( t, tank );
+
+}
+
+int toleranceSpread( Tolerance* t, char* spec )
+{
+
+	char name[8] = {0}, kind = 'n';
+	float spread;
+	Spread s;
+	int i, j;
+
+	if ( sscanf( spec, "%7[^=]=%f", name, &spread ) != 2 )
+		if ( sscanf( spec, "%7[^=]=%c%f", name, &kind, &spread ) != 3 || ( kind != 'u' && kind != 'n' ) )
+		{
+
+			fprintf(stderr, "  %s not valid spread of form NAME=percent or NAME=upercent.\n", spec);
+			return 1;
+
+		}
+	if ( spread < 0.0 || ( i = lookup( name, strlen( name ) ) ) < 0 )
+	{
+
+		fprintf(stderr, "  %s not valid parameter.\n", name);
+		return 1;
+
+	}
+
+	strcpy( s.name, name );
+	s.offset = registry[i].offset;
+	s.mask   = 1ULL << i;
+	s.output = registry[i].role == OUTPUT;
+	s.normal = kind == 'n';
+	s.spread = spread / 100.0;
+
+	// Replace an earlier spread of the same parameter, such as that of the tank.
+	for ( j = 0; j < t->spreads && t->spread[j].mask != s.mask; j++ );
+	if ( j < t->spreads ) { t->spread[j] = s; return 0; }
+
+	// Keep inputs ahead of outputs, and outputs after those they are calculated from.
+	for ( j = t->spreads; j > 0; j-- )
+	{
+
+		Spread* p = &t->spread[j-1];
+		if ( !p->output || ( s.output && __builtin_popcountll( dependencies( p->mask ) )
+			<= __builtin_popcountll( dependencies( s.mask ) ) ) ) break;
+		t->spread[j] = *p;
+
+	}
+	t->spread[j] = s;
+	t->spreads++;
+
+	return 0;
+
+}
+
+// Holds the state shared between the worker threads of a running analysis.
+typedef struct
+{
+
+	Tolerance* t;
+	pthread_mutex_t lock;
+	long next;
+
+} Draw;
+
+// Holds the state private to a single worker thread.
+typedef struct
+{
+
+	Draw* draw;
+	Histogram metric[METRICS];
+	long failed;
+
+} Sampler;
+
+static void* sampler( void* arg )
+{
+
+	Sampler* w = arg;
+	Draw* d = w->draw;
+	Tolerance* t = d->t;
+	Coil* designs = malloc( TOLERANCE_BLOCK * sizeof *designs );
+	float (*drawn)[PARAMETERS] = malloc( TOLERANCE_BLOCK * sizeof *drawn );
+	double value[METRICS], (*sum)[2];
+	long first;
+	int i, j, m, count;
+	Random r;
+
+	for ( ;; )
+	{
+
+		pthread_mutex_lock( &d->lock );
+		first = d->next;
+		d->next += TOLERANCE_BLOCK;
+		pthread_mutex_unlock( &d->lock );
+		if ( first >= t->samples ) break;
+		count = t->samples - first < TOLERANCE_BLOCK ? t->samples - first : TOLERANCE_BLOCK;
+
+		// Draw every spread of a sample from its own stream, in the order of the spreads.
+		for ( i = 0; i < count; i++ )
+		{
+
+			designs[i] = t->base;
+			randomInit( &r, t->seed, first + i );
+			for ( j = 0; j < t->spreads; j++ )
+			{
+
+				Spread* s = &t->spread[j];
+				drawn[i][j] = factor( &r, s );
+				if ( !s->output ) *(float*)( (char*)&designs[i] + s->offset ) *= drawn[i][j];
+
+			}
+
+		}
+		batchCoils( designs, count );
+
+		sum = t->sum[first / TOLERANCE_BLOCK];
+		for ( i = 0; i < count; i++ )
+		{
+
+			// A sample whose design cannot be calculated is counted apart.
+			measure( t, &designs[i], drawn[i], value );
+			for ( m = 0; m < METRICS && isfinite( value[m] ); m++ );
+			if ( m < METRICS )
+			{
+
+				w->failed++;
+				continue;
+
+			}
+			for ( m = 0; m < METRICS; m++ )
+			{
+
+				bin( t, &w->metric[m], m, value[m] );
+				sum[m][0] += value[m];
+				sum[m][1] += value[m] * value[m];
+
+			}
+
+		}
+
+	}
+
+	free( drawn );
+	free( designs );
+	return NULL;
+
+}
+
+int toleranceRun( Tolerance* t, int threads )
+{
+
+	long blocks = ( t->samples + TOLERANCE_BLOCK - 1 ) / TOLERANCE_BLOCK, b;
+	pthread_t thread[threads];
+	Sampler* work = malloc( threads * sizeof *work );
+	float ones[PARAMETERS];
+	Draw d;
+	int i, m;
+
+	// Tap the primary for the design as built.
+	t->nominal = t->base;
+	calculate( &t->nominal );
+	for ( i = 0; i < t->spreads; i++ ) ones[i] = 1.0;
+	t->tap = turns( t->nominal.PRIL, t->nominal.PRIRI, t->nominal.PRIS, t->nominal.PRIN );
+	for ( m = 0; m < METRICS; m++ ) t->value[m] = 1.0;
+	{
+
+		Coil c = t->nominal;
+		measure( t, &c, ones, t->value );
+
+	}
+
+	free( t->sum );
+	t->sum = calloc( blocks > 0 ? blocks : 1, sizeof *t->sum );
+	d.t = t;
+	d.next = 0;
+	pthread_mutex_init( &d.lock, NULL );
+
+	for ( i = 0; i < threads; i++ )
+	{
+
+		memset( work[i].metric, 0, sizeof work[i].metric );
+		work[i].failed = 0;
+		for ( m = 0; m < METRICS; m++ )
+		{
+
+			work[i].metric[m].min = HUGE_VAL;
+			work[i].metric[m].max = -HUGE_VAL;
+
+		}
+		work[i].draw = &d;
+		if ( pthread_create( &thread[i], NULL, sampler, &work[i] ) != 0 )
+		{
+
+			fprintf(stderr, "Cannot start worker thread %d!\n", i);
+			threads = i;
+			break;
+
+		}
+
+	}
+	for ( i = 0; i < threads; i++ ) pthread_join( thread[i], NULL );
+	pthread_mutex_destroy( &d.lock );
+
+	// Counts add up the same in any order; sums are added in the order of their blocks.
+	t->failed = 0;
+	for ( i = 0; i < threads; i++ ) t->failed += work[i].failed;
+	for ( i = 0; i < threads; i++ )
+		for ( m = 0; m < METRICS; m++ )
+		{
+
+			Histogram* h = &t->metric[m];
+			for ( b = 0; b < TOLERANCE_BINS + 2; b++ ) h->count[b] += work[i].metric[m].count[b];
+			if ( work[i].metric[m].min < h->min ) h->min = work[i].metric[m].min;
+			if ( work[i].metric[m].max > h->max ) h->max = work[i].metric[m].max;
+
+		}
+	for ( b = 1; b < blocks; b++ )
+		for ( m = 0; m < METRICS; m++ )
+		{
+
+			t->sum[0][m][0] += t->sum[b][m][0];
+			t->sum[0][m][1] += t->sum[b][m][1];
+
+		}
+
+	free( work );
+	return threads == 0;
+
+}
+
+double percentile( Tolerance* t, int m, double fraction )
+{
+
+	Histogram* h = &t->metric[m];
+	double want = fraction * ( t->samples - t->failed ), seen = 0.0, relative;
+	long b;
+
+	if ( want <= h->count[0] ) return h->min;
+	for ( seen = h->count[0], b = 1; b <= TOLERANCE_BINS; seen += h->count[b], b++ )
+		if ( seen + h->count[b] >= want && h->count[b] > 0 )
+		{
+
+			// Interpolate within the bin.
+			relative = ( b - 1 + ( want - seen ) / h->count[b] ) / TOLERANCE_BINS - 0.5;
+			return m == mDETUNE ? relative : t->value[m] * ( 1.0 + relative );
+
+		}
+
+	return h->max;
+
+}
+
+double metricMean( Tolerance* t, int m )
+{
+
+	return t->sum[0][m][0] / ( t->samples - t->failed );
+
+}
+
+double metricDeviation( Tolerance* t, int m )
+{
+
+	double mean = metricMean( t, m ), variance = t->sum[0][m][1] / ( t->samples - t->failed ) - mean * mean;
+	return variance > 0.0 ? sqrt( variance ) : 0.0;
+
+}
+
+#endif
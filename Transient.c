@@ -0,0 +1,539 @@
+#ifndef TRANSIENT_C
+#define TRANSIENT_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <immintrin.h>
+#include "Coil.c"
+
+// Number of designs simulated together, interleaved across several vectors
+// so that the dependent steps of one lane hide behind those of the others.
+#define TRANSIENT_LANES 64
+
+// Resistivity of the copper of the secondary in ohm meters.
+#define COPPER 1.72e-8
+
+// Number of channels of each waveform sample: V1, I1, V2 and I2.
+#define CHANNELS 4
+
+// Holds the settings of a transient simulation shared by every design.
+//  - k:      Coupling coefficient between primary and secondary.
+//  - R1:     Loss resistance of the primary, spark gap and wiring, in ohms.
+//  - R2:     Loss resistance of the secondary in ohms, or negative for the DC resistance of its wire.
+//  - cycles: Length of the simulation in cycles of the secondary.
+//  - steps:  Steps per cycle of the secondary.
+//  - every:  Steps between waveform samples.
+//  - quench: Whether the spark gap opens at the first notch, leaving the secondary to ring down alone.
+typedef struct
+{
+
+	float k, R1, R2;
+	int cycles, steps, every, quench;
+
+} Transient;
+
+// Holds what the simulation of one design found.
+//  - notch:    Time of the first notch in the primary energy, or 0 if none.
+//  - transfer: Fraction of the energy of the bank held by the secondary at the first notch.
+//  - peak:     Largest voltage across the secondary.
+//  - when:     Time of the largest voltage.
+//  - interval: Time between waveform samples.
+typedef struct
+{
+
+	float notch, transfer, peak, when, interval;
+
+} Bang;
+
+// Begins a waveform file, followed for each design by the interval between its
+// samples as a float and then its samples, each holding CHANNELS floats.
+//  - magic:    Identifies the file and the version of its layout.
+//  - designs:  Number of designs.
+//  - samples:  Number of samples of each design, the first taken as the gap fires.
+//  - channels: Number of floats in each sample.
+typedef struct
+{
+
+	char magic[8];
+	uint32_t designs, samples, channels, pad;
+
+} WaveHeader;
+
+// Check the settings, printing why and returning 1 if they cannot be simulated.
+int transientCheck( Transient* t );
+
+// Return the number of waveform samples taken of each design.
+long transientSamples( Transient* t );
+
+// Simulate n calculated designs, at most TRANSIENT_LANES, from the gap firing
+// with the bank charged to the peak NST voltage, filling in bang for each. Unless
+// wave is NULL it receives transientSamples samples of each design in turn.
+void transient( Transient* t, Coil* c, int n, Bang* bang, float* wave );
+
+// Return the name of the kernel used by transient.
+char* transientKernel();
+
+// Structure of arrays holding the circuits and state of the designs simulated together.
+//  - a11, a12, a22: Inverse of the inductance matrix, rate of change of current per volt.
+//  - iC1, iC2:      Reciprocal of the primary and secondary capacitance.
+//  - R1, R2:        Loss resistances.
+//  - L1, L2:        Primary and secondary inductance.
+//  - dt:            Time step.
+//  - E0:            Twice the energy of the bank as the gap fires.
+//  - q1, i1:        Charge of the bank and primary current.
+//  - q2, i2:        Charge of the secondary and secondary current.
+//  - lo, at, held:  Least twice energy of the primary so far this half cycle, its time,
+//                   and twice the energy of the secondary then.
+//  - last, lastAt, lastHeld: The same for the half cycle before.
+//  - notch, transfer, peak, when: Results as described for Bang.
+typedef struct
+{
+
+	float a11[TRANSIENT_LANES], a12[TRANSIENT_LANES], a22[TRANSIENT_LANES];
+	float iC1[TRANSIENT_LANES], iC2[TRANSIENT_LANES], R1[TRANSIENT_LANES], R2[TRANSIENT_LANES];
+	float L1[TRANSIENT_LANES], L2[TRANSIENT_LANES], dt[TRANSIENT_LANES], E0[TRANSIENT_LANES];
+	float q1[TRANSIENT_LANES], i1[TRANSIENT_LANES], q2[TRANSIENT_LANES], i2[TRANSIENT_LANES];
+	float lo[TRANSIENT_LANES], at[TRANSIENT_LANES], held[TRANSIENT_LANES];
+	float last[TRANSIENT_LANES], lastAt[TRANSIENT_LANES], lastHeld[TRANSIENT_LANES];
+	float notch[TRANSIENT_LANES], transfer[TRANSIENT_LANES], peak[TRANSIENT_LANES], when[TRANSIENT_LANES];
+
+} Lanes;
+
+int transientCheck( Transient* t )
+{
+
+	int needed;
+
+	if ( !( t->k > 0.0f && t->k < 1.0f ) )
+	{
+
+		fprintf(stderr, "  Coupling %g must lie between 0 and 1.\n", t->k);
+		return 1;
+
+	}
+	if ( !( t->R1 >= 0.0f ) )
+	{
+
+		fprintf(stderr, "  Primary resistance %g must not be negative.\n", t->R1);
+		return 1;
+
+	}
+	if ( t->cycles < 1 || t->every < 1 )
+	{
+
+		fprintf(stderr, "  Cycles and steps between samples must be positive.\n");
+		return 1;
+
+	}
+
+	// Leapfrog is stable while the faster coupled mode, at 1/sqrt(1-k) times the
+	// secondary frequency when tuned, gets more than pi steps per cycle. Twice
+	// that is asked for, leaving room for designs off tune, and never below 16.
+	needed = ceil( 2.0 * PI / sqrt( 1.0 - t->k ) );
+	if ( needed < 16 ) needed = 16;
+	if ( t->steps < needed )
+	{
+
+		fprintf(stderr, "  %d steps per cycle is too few for coupling %g, at least %d are needed.\n", t->steps, t->k, needed);
+		return 1;
+
+	}
+
+	return 0;
+
+}
+
+long transientSamples( Transient* t )
+{
+
+	return (long)t->cycles * t->steps / t->every + 1;
+
+}
+
+// Set up the circuits of n designs, filling the remaining lanes with the last.
+static void transientSetup( Transient* t, Coil* c, int n, Lanes* s )
+{
+
+	double L1, L2, C1, C2, R2, M, det, bare;
+	int j;
+
+	for ( j = 0; j < TRANSIENT_LANES; j++ )
+	{
+
+		Coil* d = &c[j < n ? j : n - 1];
+
+		L1 = d->PRIL;
+		L2 = d->SECL;
+		C1 = d->LTRCS;
+		C2 = d->SECC + d->TOPC;
+		bare = d->SECWD - 3.55600e-5;
+		R2 = t->R2 >= 0.0f ? t->R2 : COPPER * d->SECLN / ( 0.25 * PI * bare * bare );
+		M = t->k * sqrt( L1 * L2 );
+		det = L1 * L2 - M * M;
+
+		s->a11[j] = L2 / det;
+		s->a12[j] = -M / det;
+		s->a22[j] = L1 / det;
+		s->iC1[j] = 1.0 / C1;
+		s->iC2[j] = 1.0 / C2;
+		s->R1[j]  = t->R1;
+		s->R2[j]  = R2;
+		s->L1[j]  = L1;
+		s->L2[j]  = L2;
+		s->dt[j]  = 2.0 * PI * sqrt( L2 * C2 ) / t->steps;
+		s->E0[j]  = C1 * d->NSTVOP * d->NSTVOP;
+
+		s->q1[j] = C1 * d->NSTVOP;
+		s->i1[j] = s->q2[j] = s->i2[j] = 0.0f;
+		s->lo[j] = FLT_MAX;
+		s->last[j] = s->E0[j];
+		s->at[j] = s->held[j] = s->lastAt[j] = s->lastHeld[j] = 0.0f;
+		s->notch[j] = s->transfer[j] = s->peak[j] = s->when[j] = 0.0f;
+
+	}
+
+}
+
+// Take the waveform sample with the given index of the first n lanes.
+static void transientSample( Lanes* s, int n, float* wave, long samples, long index )
+{
+
+	float* w;
+	int j;
+
+	if ( !wave ) return;
+	for ( j = 0; j < n; j++ )
+	{
+
+		w = wave + ( j * samples + index ) * CHANNELS;
+		w[0] = s->q1[j] * s->iC1[j];
+		w[1] = s->i1[j];
+		w[2] = s->q2[j] * s->iC2[j];
+		w[3] = s->i2[j];
+
+	}
+
+}
+
+// The energy of the primary ripples at twice the frequency as it swaps between
+// bank and coil, so the first notch is found from the least energy of each half
+// cycle: the first half cycle whose least is above that of the one before, once
+// half the energy has gone, follows the notch. Unless quenching, this only reads
+// the state, and the gap opens up to half a cycle after the notch.
+static void transientNotch( Transient* t, Lanes* s )
+{
+
+	int j;
+
+	for ( j = 0; j < TRANSIENT_LANES; j++ )
+	{
+
+		if ( s->notch[j] == 0.0f && s->lo[j] > s->last[j] && s->last[j] < 0.5f * s->E0[j] )
+		{
+
+			s->notch[j] = s->lastAt[j];
+			s->transfer[j] = s->lastHeld[j] / s->E0[j];
+			if ( t->quench )
+			{
+
+				s->a11[j] = s->a12[j] = s->i1[j] = 0.0f;
+				s->a22[j] = 1.0f / s->L2[j];
+
+			}
+
+		}
+		s->last[j] = s->lo[j];
+		s->lastAt[j] = s->at[j];
+		s->lastHeld[j] = s->held[j];
+		s->lo[j] = FLT_MAX;
+
+	}
+
+}
+
+// Every step is a kick of the currents by half a step, a drift of the charges
+// by a whole step and another half step kick. The losses take the current at
+// the start of each kick. With 64 steps per cycle the frequencies of the
+// coupled modes come out about 0.05% high.
+static void transientScalar( Transient* t, Lanes* s, int n, float* wave )
+{
+
+	long samples = transientSamples( t ), total = (long)t->cycles * t->steps, step;
+	float f1, f2, h, E1, V2;
+	int j, k;
+
+	transientSample( s, n, wave, samples, 0 );
+	for ( step = 1; step <= total; step++ )
+	{
+
+		for ( j = 0; j < TRANSIENT_LANES; j++ )
+		{
+
+			h = 0.5f * s->dt[j];
+			for ( k = 0; k < 2; k++ )
+			{
+
+				f1 = -( s->q1[j] * s->iC1[j] + s->R1[j] * s->i1[j] );
+				f2 = -( s->q2[j] * s->iC2[j] + s->R2[j] * s->i2[j] );
+				s->i1[j] += h * ( s->a11[j] * f1 + s->a12[j] * f2 );
+				s->i2[j] += h * ( s->a12[j] * f1 + s->a22[j] * f2 );
+				if ( k == 0 )
+				{
+
+					s->q1[j] += s->dt[j] * s->i1[j];
+					s->q2[j] += s->dt[j] * s->i2[j];
+
+				}
+
+			}
+
+			V2 = fabsf( s->q2[j] * s->iC2[j] );
+			if ( V2 > s->peak[j] ) { s->peak[j] = V2; s->when[j] = step * s->dt[j]; }
+
+			E1 = s->L1[j] * s->i1[j] * s->i1[j] + s->iC1[j] * s->q1[j] * s->q1[j];
+			if ( E1 < s->lo[j] )
+			{
+
+				s->lo[j] = E1;
+				s->at[j] = step * s->dt[j];
+				s->held[j] = s->L2[j] * s->i2[j] * s->i2[j] + s->iC2[j] * s->q2[j] * s->q2[j];
+
+			}
+
+		}
+		if ( step % ( t->steps / 2 ) == 0 ) transientNotch( t, s );
+		if ( step % t->every == 0 ) transientSample( s, n, wave, samples, step / t->every );
+
+	}
+
+}
+
+__attribute__((target("avx512f")))
+static void transientAVX512( Transient* t, Lanes* s, int n, float* wave )
+{
+
+	long samples = transientSamples( t ), total = (long)t->cycles * t->steps, step;
+	const __m512 half = _mm512_set1_ps( 0.5f ), zero = _mm512_setzero_ps();
+	__m512 q1, i1, q2, i2, f1, f2, dt, h, a11, a12, a22, iC1, iC2, R1, R2, E1, E2, V2, T, L2;
+	__mmask16 m;
+	int j, k;
+
+	transientSample( s, n, wave, samples, 0 );
+	for ( step = 1; step <= total; step++ )
+	{
+
+		for ( j = 0; j < TRANSIENT_LANES; j += 16 )
+		{
+
+			q1 = _mm512_load_ps( s->q1 + j );
+			i1 = _mm512_load_ps( s->i1 + j );
+			q2 = _mm512_load_ps( s->q2 + j );
+			i2 = _mm512_load_ps( s->i2 + j );
+			dt = _mm512_load_ps( s->dt + j );
+			a11 = _mm512_load_ps( s->a11 + j );
+			a12 = _mm512_load_ps( s->a12 + j );
+			a22 = _mm512_load_ps( s->a22 + j );
+			iC1 = _mm512_load_ps( s->iC1 + j );
+			iC2 = _mm512_load_ps( s->iC2 + j );
+			R1 = _mm512_load_ps( s->R1 + j );
+			R2 = _mm512_load_ps( s->R2 + j );
+			h = _mm512_mul_ps( half, dt );
+
+			for ( k = 0; k < 2; k++ )
+			{
+
+				f1 = _mm512_sub_ps( zero, _mm512_fmadd_ps( q1, iC1, _mm512_mul_ps( R1, i1 ) ) );
+				f2 = _mm512_sub_ps( zero, _mm512_fmadd_ps( q2, iC2, _mm512_mul_ps( R2, i2 ) ) );
+				i1 = _mm512_fmadd_ps( h, _mm512_fmadd_ps( a11, f1, _mm512_mul_ps( a12, f2 ) ), i1 );
+				i2 = _mm512_fmadd_ps( h, _mm512_fmadd_ps( a12, f1, _mm512_mul_ps( a22, f2 ) ), i2 );
+				if ( k == 0 )
+				{
+
+					q1 = _mm512_fmadd_ps( dt, i1, q1 );
+					q2 = _mm512_fmadd_ps( dt, i2, q2 );
+
+				}
+
+			}
+
+			_mm512_store_ps( s->q1 + j, q1 );
+			_mm512_store_ps( s->i1 + j, i1 );
+			_mm512_store_ps( s->q2 + j, q2 );
+			_mm512_store_ps( s->i2 + j, i2 );
+
+			T = _mm512_mul_ps( _mm512_set1_ps( (float)step ), dt );
+			V2 = _mm512_abs_ps( _mm512_mul_ps( q2, iC2 ) );
+			m = _mm512_cmp_ps_mask( V2, _mm512_load_ps( s->peak + j ), _CMP_GT_OQ );
+			_mm512_mask_store_ps( s->peak + j, m, V2 );
+			_mm512_mask_store_ps( s->when + j, m, T );
+
+			E1 = _mm512_fmadd_ps( _mm512_mul_ps( _mm512_load_ps( s->L1 + j ), i1 ), i1, _mm512_mul_ps( _mm512_mul_ps( iC1, q1 ), q1 ) );
+			m = _mm512_cmp_ps_mask( E1, _mm512_load_ps( s->lo + j ), _CMP_LT_OQ );
+			if ( m )
+			{
+
+				L2 = _mm512_load_ps( s->L2 + j );
+				E2 = _mm512_fmadd_ps( _mm512_mul_ps( L2, i2 ), i2, _mm512_mul_ps( _mm512_mul_ps( iC2, q2 ), q2 ) );
+				_mm512_mask_store_ps( s->lo + j, m, E1 );
+				_mm512_mask_store_ps( s->at + j, m, T );
+				_mm512_mask_store_ps( s->held + j, m, E2 );
+
+			}
+
+		}
+		if ( step % ( t->steps / 2 ) == 0 ) transientNotch( t, s );
+		if ( step % t->every == 0 ) transientSample( s, n, wave, samples, step / t->every );
+
+	}
+
+}
+
+__attribute__((target("avx2,fma")))
+static void transientAVX2( Transient* t, Lanes* s, int n, float* wave )
+{
+
+	long samples = transientSamples( t ), total = (long)t->cycles * t->steps, step;
+	const __m256 half = _mm256_set1_ps( 0.5f ), zero = _mm256_setzero_ps();
+	const __m256 sign = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7fffffff ) );
+	__m256 q1, i1, q2, i2, f1, f2, dt, h, a11, a12, a22, iC1, iC2, R1, R2, E1, E2, V2, T, L2, m;
+	int j, k;
+
+	transientSample( s, n, wave, samples, 0 );
+	for ( step = 1; step <= total; step++ )
+	{
+
+		for ( j = 0; j < TRANSIENT_LANES; j += 8 )
+		{
+
+			q1 = _mm256_load_ps( s->q1 + j );
+			i1 = _mm256_load_ps( s->i1 + j );
+			q2 = _mm256_load_ps( s->q2 + j );
+			i2 = _mm256_load_ps( s->i2 + j );
+			dt = _mm256_load_ps( s->dt + j );
+			a11 = _mm256_load_ps( s->a11 + j );
+			a12 = _mm256_load_ps( s->a12 + j );
+			a22 = _mm256_load_ps( s->a22 + j );
+			iC1 = _mm256_load_ps( s->iC1 + j );
+			iC2 = _mm256_load_ps( s->iC2 + j );
+			R1 = _mm256_load_ps( s->R1 + j );
+			R2 = _mm256_load_ps( s->R2 + j );
+			h = _mm256_mul_ps( half, dt );
+
+			for ( k = 0; k < 2; k++ )
+			{
+
+				f1 = _mm256_sub_ps( zero, _mm256_fmadd_ps( q1, iC1, _mm256_mul_ps( R1, i1 ) ) );
+				f2 = _mm256_sub_ps( zero, _mm256_fmadd_ps( q2, iC2, _mm256_mul_ps( R2, i2 ) ) );
+				i1 = _mm256_fmadd_ps( h, _mm256_fmadd_ps( a11, f1, _mm256_mul_ps( a12, f2 ) ), i1 );
+				i2 = _mm256_fmadd_ps( h, _mm256_fmadd_ps( a12, f1, _mm256_mul_ps( a22, f2 ) ), i2 );
+				if ( k == 0 )
+				{
+
+					q1 = _mm256_fmadd_ps( dt, i1, q1 );
+					q2 = _mm256_fmadd_ps( dt, i2, q2 );
+
+				}
+
+			}
+
+			_mm256_store_ps( s->q1 + j, q1 );
+			_mm256_store_ps( s->i1 + j, i1 );
+			_mm256_store_ps( s->q2 + j, q2 );
+			_mm256_store_ps( s->i2 + j, i2 );
+
+			T = _mm256_mul_ps( _mm256_set1_ps( (float)step ), dt );
+			V2 = _mm256_and_ps( sign, _mm256_mul_ps( q2, iC2 ) );
+			m = _mm256_cmp_ps( V2, _mm256_load_ps( s->peak + j ), _CMP_GT_OQ );
+			_mm256_store_ps( s->peak + j, _mm256_blendv_ps( _mm256_load_ps( s->peak + j ), V2, m ) );
+			_mm256_store_ps( s->when + j, _mm256_blendv_ps( _mm256_load_ps( s->when + j ), T, m ) );
+
+			E1 = _mm256_fmadd_ps( _mm256_mul_ps( _mm256_load_ps( s->L1 + j ), i1 ), i1, _mm256_mul_ps( _mm256_mul_ps( iC1, q1 ), q1 ) );
+			m = _mm256_cmp_ps( E1, _mm256_load_ps( s->lo + j ), _CMP_LT_OQ );
+			if ( _mm256_movemask_ps( m ) )
+			{
+
+				L2 = _mm256_load_ps( s->L2 + j );
+				E2 = _mm256_fmadd_ps( _mm256_mul_ps( L2, i2 ), i2, _mm256_mul_ps( _mm256_mul_ps( iC2, q2 ), q2 ) );
+				_mm256_store_ps( s->lo + j, _mm256_blendv_ps( _mm256_load_ps( s->lo + j ), E1, m ) );
+				_mm256_store_ps( s->at + j, _mm256_blendv_ps( _mm256_load_ps( s->at + j ), T, m ) );
+				_mm256_store_ps( s->held + j, _mm256_blendv_ps( _mm256_load_ps( s->held + j ), E2, m ) );
+
+			}
+
+		}
+		if ( step % ( t->steps / 2 ) == 0 ) transientNotch( t, s );
+		if ( step % t->every == 0 ) transientSample( s, n, wave, samples, step / t->every );
+
+	}
+
+}
+
+// Kernel chosen for this processor the first time designs are simulated.
+static void (*transientChosen)( Transient* t, Lanes* s, int n, float* wave ) = NULL;
+static char* transientName = "scalar";
+
+static void transientChoose()
+{
+
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx512f" ) )
+	{
+
+		transientChosen = transientAVX512;
+		transientName = "avx512";
+
+	}
+	else if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+	{
+
+		transientChosen = transientAVX2;
+		transientName = "avx2";
+
+	}
+	else transientChosen = transientScalar;
+
+}
+
+char* transientKernel()
+{
+
+	if ( !transientChosen ) transientChoose();
+	return transientName;
+
+}
+
+void transient( Transient* t, Coil* c, int n, Bang* bang, float* wave )
+{
+
+	static __thread Lanes s __attribute__((aligned(64)));
+	unsigned int csr = _mm_getcsr();
+	int j;
+
+	if ( n <= 0 ) return;
+	if ( !transientChosen ) transientChoose();
+
+	// Rung down designs decay into denormals, which would slow every step of
+	// the batch many times over, so they are flushed to zero while stepping.
+	transientSetup( t, c, n, &s );
+	_mm_setcsr( csr | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON );
+	transientChosen( t, &s, n, wave );
+	_mm_setcsr( csr );
+
+	for ( j = 0; j < n; j++ )
+	{
+
+		bang[j].notch    = s.notch[j];
+		bang[j].transfer = s.transfer[j];
+		bang[j].peak     = s.peak[j];
+		bang[j].when     = s.when[j];
+		bang[j].interval = s.dt[j] * t->every;
+
+	}
+
+}
+
+#endif